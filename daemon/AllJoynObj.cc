@@ -65,6 +65,8 @@ using namespace qcc;
 namespace ajn {
 
 void* AllJoynObj::NameMapEntry::truthiness = reinterpret_cast<void*>(true);
+static int interestContextTag;
+void* AllJoynObj::interestContext = &interestContextTag;
 int AllJoynObj::JoinSessionThread::jstCount = 0;
 
 void AllJoynObj::AcquireLocks()
@@ -95,7 +97,10 @@ AllJoynObj::AllJoynObj(Bus& bus, BusController* busController) :
     guid(bus.GetInternal().GetGlobalGUID()),
     exchangeNamesSignal(NULL),
     detachSessionSignal(NULL),
+    interestSummarySignal(NULL),
     timer("NameReaper"),
+    interestAlarmPending(false),
+    interestSerial(1),
     isStopping(false),
     busController(busController)
 {
@@ -183,6 +188,8 @@ QStatus AllJoynObj::Init()
     assert(exchangeNamesSignal);
     detachSessionSignal = daemonIface->GetMember("DetachSession");
     assert(detachSessionSignal);
+    interestSummarySignal = daemonIface->GetMember("InterestSummary");
+    assert(interestSummarySignal);
 
     /* Register a signal handler for ExchangeNames */
     if (ER_OK == status) {
@@ -217,6 +224,17 @@ QStatus AllJoynObj::Init()
         }
     }
 
+    /* Register a signal handler for InterestSummary bus-to-bus signal */
+    if (ER_OK == status) {
+        status = bus.RegisterSignalHandler(this,
+                                           static_cast<MessageReceiver::SignalHandler>(&AllJoynObj::InterestSummarySignalHandler),
+                                           interestSummarySignal,
+                                           NULL);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to register InterestSummarySignalHandler"));
+        }
+    }
+
 
     /* Register a name table listener */
     router.AddBusNameListener(this);
@@ -2711,7 +2729,13 @@ QStatus AllJoynObj::AddBusToBusEndpoint(RemoteEndpoint& endpoint)
     AddVirtualEndpoint(remoteControllerName, endpoint->GetUniqueName());
 
     /* Exchange existing bus names if connected to another daemon */
-    return ExchangeNames(endpoint);
+    QStatus status = ExchangeNames(endpoint);
+
+    /* Tell the remote daemon which signals we and the daemons we know about are interested in */
+    if (ER_OK == status) {
+        status = SendInterestSummaries(endpoint);
+    }
+    return status;
 }
 
 void AllJoynObj::RemoveBusToBusEndpoint(RemoteEndpoint& endpoint)
@@ -3010,6 +3034,191 @@ void AllJoynObj::ExchangeNamesSignalHandler(const InterfaceDescription::Member*
     }
 }
 
+QStatus AllJoynObj::BuildInterestSummary(Message& msg, const qcc::String& controller, uint32_t serial, const InterestSummary& summary,
+                                         const uint16_t* toggled, size_t numToggled)
+{
+    MsgArg args[4];
+    args[0].Set("s", controller.c_str());
+    args[1].Set("u", serial);
+    if (toggled) {
+        args[2].Set("ay", (size_t)0, NULL);
+        args[3].Set("aq", numToggled, toggled);
+    } else {
+        args[2].Set("ay", InterestSummary::NUM_BITS / 8, summary.GetBitmap());
+        args[3].Set("aq", (size_t)0, NULL);
+    }
+    return msg->SignalMsg("suayaq",
+                          org::alljoyn::Daemon::WellKnownName,
+                          0,
+                          org::alljoyn::Daemon::ObjectPath,
+                          org::alljoyn::Daemon::InterfaceName,
+                          "InterestSummary",
+                          args,
+                          ArraySize(args),
+                          0,
+                          0);
+}
+
+QStatus AllJoynObj::SendInterestSummaries(RemoteEndpoint& endpoint)
+{
+    QCC_DbgTrace(("AllJoynObj::SendInterestSummaries(endpoint = %s)", endpoint->GetUniqueName().c_str()));
+
+    /* Our own interests */
+    interestLock.Lock(MUTEX_CONTEXT);
+    uint32_t serial = interestSerial;
+    InterestSummary summary = localInterest;
+    interestLock.Unlock(MUTEX_CONTEXT);
+
+    Message localMsg(bus);
+    QStatus status = BuildInterestSummary(localMsg, bus.GetUniqueName(), serial, summary, NULL, 0);
+    if (ER_OK == status) {
+        status = endpoint->PushMessage(localMsg);
+    }
+
+    /* The interests of the daemons we know about, the remote daemon ignores its own */
+    std::map<qcc::String, DaemonRouter::RemoteInterest> remoteInterests;
+    router.GetRemoteInterests(remoteInterests);
+    std::map<qcc::String, DaemonRouter::RemoteInterest>::const_iterator it = remoteInterests.begin();
+    while ((ER_OK == status) && (it != remoteInterests.end())) {
+        if (it->second.valid) {
+            Message remoteMsg(bus);
+            status = BuildInterestSummary(remoteMsg, it->first, it->second.serial, it->second.summary, NULL, 0);
+            if (ER_OK == status) {
+                status = endpoint->PushMessage(remoteMsg);
+            }
+        }
+        ++it;
+    }
+    if (ER_OK != status) {
+        QCC_LogError(status, ("Failed to send InterestSummary signal to %s", endpoint->GetUniqueName().c_str()));
+    }
+    return status;
+}
+
+void AllJoynObj::LocalInterestChanged(bool grew)
+{
+    /*
+     * New interests are sent right away so other daemons do not prune broadcasts that a new match
+     * rule is waiting for. Only removals are batched.
+     */
+    if (grew) {
+        if (!isStopping) {
+            PublishLocalInterest();
+        }
+        return;
+    }
+    interestLock.Lock(MUTEX_CONTEXT);
+    if (!interestAlarmPending && !isStopping) {
+        /* Give a burst of AddMatch/RemoveMatch calls time to finish */
+        const uint32_t delay = 100;
+        AllJoynObj* pObj = this;
+        Alarm alarm(delay, pObj, interestContext);
+        if (ER_OK == timer.AddAlarm(alarm)) {
+            interestAlarmPending = true;
+        }
+    }
+    interestLock.Unlock(MUTEX_CONTEXT);
+}
+
+void AllJoynObj::PublishLocalInterest()
+{
+    std::vector<uint16_t> toggled;
+    InterestSummary summary;
+
+    /*
+     * Changes are published from the alarm and from AddMatch calls, they are serialized so the
+     * deltas are sent in serial number order.
+     */
+    interestPublishLock.Lock(MUTEX_CONTEXT);
+    interestLock.Lock(MUTEX_CONTEXT);
+    if (!router.GetLocalInterestChanges(summary, toggled)) {
+        interestLock.Unlock(MUTEX_CONTEXT);
+        interestPublishLock.Unlock(MUTEX_CONTEXT);
+        return;
+    }
+    /* Serial number 0 is reserved to mean no summary */
+    if (++interestSerial == 0) {
+        interestSerial = 1;
+    }
+    const uint32_t serial = interestSerial;
+    localInterest = summary;
+    interestLock.Unlock(MUTEX_CONTEXT);
+
+    /*
+     * A full summary is sent periodically so daemons that missed a delta resynchronize, and
+     * whenever the delta would be larger than the full summary.
+     */
+    bool full = ((serial % 64) == 0) || ((toggled.size() * sizeof(uint16_t)) >= (InterestSummary::NUM_BITS / 8));
+    Message sigMsg(bus);
+    QStatus status = BuildInterestSummary(sigMsg, bus.GetUniqueName(), serial, summary, full ? NULL : &toggled[0], toggled.size());
+    if (ER_OK != status) {
+        QCC_LogError(status, ("Failed to build InterestSummary signal"));
+        interestPublishLock.Unlock(MUTEX_CONTEXT);
+        return;
+    }
+
+    AcquireLocks();
+    std::vector<RemoteEndpoint> endpoints;
+    map<qcc::StringMapKey, RemoteEndpoint>::iterator it = b2bEndpoints.begin();
+    while (it != b2bEndpoints.end()) {
+        endpoints.push_back(it->second);
+        ++it;
+    }
+    ReleaseLocks();
+
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        status = endpoints[i]->PushMessage(sigMsg);
+        if (ER_OK != status) {
+            QCC_LogError(status, ("Failed to send InterestSummary to %s", endpoints[i]->GetUniqueName().c_str()));
+        }
+    }
+    interestPublishLock.Unlock(MUTEX_CONTEXT);
+}
+
+void AllJoynObj::InterestSummarySignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg)
+{
+    QCC_DbgTrace(("AllJoynObj::InterestSummarySignalHandler(msg sender = \"%s\")", msg->GetSender()));
+
+    const char* controller;
+    uint32_t serial;
+    size_t bitmapLen;
+    uint8_t* bitmap;
+    size_t numToggled;
+    uint16_t* toggled;
+    QStatus status = msg->GetArgs("suayaq", &controller, &serial, &bitmapLen, &bitmap, &numToggled, &toggled);
+    if (ER_OK != status) {
+        QCC_LogError(status, ("Invalid InterestSummary signal"));
+        return;
+    }
+    if (bus.GetUniqueName() == controller) {
+        return;
+    }
+    if (!router.UpdateRemoteInterest(controller, serial, bitmapLen ? bitmap : NULL, bitmapLen, toggled, numToggled)) {
+        return;
+    }
+
+    /* Forward to all directly connected daemons except the one that sent us this InterestSummary */
+    AcquireLocks();
+    std::vector<RemoteEndpoint> endpoints;
+    map<qcc::StringMapKey, RemoteEndpoint>::const_iterator bit = b2bEndpoints.find(msg->GetRcvEndpointName());
+    map<qcc::StringMapKey, RemoteEndpoint>::iterator it = b2bEndpoints.begin();
+    while (it != b2bEndpoints.end()) {
+        if ((bit == b2bEndpoints.end()) || (bit->second->GetRemoteGUID() != it->second->GetRemoteGUID())) {
+            endpoints.push_back(it->second);
+        }
+        ++it;
+    }
+    ReleaseLocks();
+
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        QCC_DbgPrintf(("Propagating InterestSummary signal to %s", endpoints[i]->GetUniqueName().c_str()));
+        status = endpoints[i]->PushMessage(msg);
+        if (ER_OK != status) {
+            QCC_LogError(status, ("Failed to forward InterestSummary to %s", endpoints[i]->GetUniqueName().c_str()));
+        }
+    }
+}
+
 void AllJoynObj::NameChangedSignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg)
 {
     size_t numArgs;
@@ -3142,6 +3351,10 @@ void AllJoynObj::AddVirtualEndpoint(const qcc::String& uniqueName, const String&
             vep = it->second;
             added = vep->AddBusToBusEndpoint(busToBusEndpoint);
             ReleaseLocks();
+            if (added) {
+                /* The remote daemon is now reachable over another link */
+                router.InterestRoutesChanged();
+            }
         }
     } else {
         ReleaseLocks();
@@ -3638,6 +3851,15 @@ QStatus AllJoynObj::SendLostAdvertisedName(const String& name, TransportMask tra
 
 void AllJoynObj::AlarmTriggered(const Alarm& alarm, QStatus reason)
 {
+    if (alarm->GetContext() == interestContext) {
+        interestLock.Lock(MUTEX_CONTEXT);
+        interestAlarmPending = false;
+        interestLock.Unlock(MUTEX_CONTEXT);
+        if (ER_OK == reason) {
+            PublishLocalInterest();
+        }
+        return;
+    }
     if (ER_OK == reason) {
         AcquireLocks();
         if ((bool)alarm->GetContext()) {
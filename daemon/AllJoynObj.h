@@ -44,6 +44,7 @@
 #include "Transport.h"
 #include "VirtualEndpoint.h"
 #include "PermissionMgr.h"
+#include "InterestSummary.h"
 
 namespace ajn {
 
@@ -399,6 +400,24 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
      */
     void DetachSessionSignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg);
 
+    /**
+     * Process incoming InterestSummary signals from remote daemons.
+     *
+     * @param member        Interface member for signal
+     * @param sourcePath    object path sending the signal.
+     * @param msg           The signal message.
+     */
+    void InterestSummarySignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg);
+
+    /**
+     * Called by the router when the match rules of the local endpoints change. Added interests
+     * are sent to the other daemons immediately. Removed interests are sent a short time later
+     * so that a burst of RemoveMatch calls results in a single InterestSummary signal.
+     *
+     * @param grew  true if a match rule was added.
+     */
+    void LocalInterestChanged(bool grew);
+
     /**
      * NameListener implementation called when a bus name changes ownership.
      *
@@ -530,6 +549,7 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
 
     const InterfaceDescription::Member* exchangeNamesSignal;   /**< org.alljoyn.Daemon.ExchangeNames signal member */
     const InterfaceDescription::Member* detachSessionSignal;   /**< org.alljoyn.Daemon.DetachSession signal member */
+    const InterfaceDescription::Member* interestSummarySignal; /**< org.alljoyn.Daemon.InterestSummary signal member */
 
     std::map<qcc::String, VirtualEndpoint> virtualEndpoints;   /**< Map of endpoints that reside behind a connected AllJoyn daemon */
 
@@ -539,6 +559,13 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
 
     qcc::Timer timer;           /**< Timer object for reaping expired names */
 
+    qcc::Mutex interestLock;            /**< Lock that protects the local interest state */
+    qcc::Mutex interestPublishLock;     /**< Serializes sending local interest changes */
+    bool interestAlarmPending;          /**< true if the local interest alarm has been added to the timer */
+    uint32_t interestSerial;            /**< Serial number of the last local InterestSummary signal */
+    InterestSummary localInterest;      /**< The local interests as of interestSerial */
+    static void* interestContext;       /**< Alarm context for the local interest alarm */
+
     /**
      * Name reaper timeout alarm handler.
      *
@@ -742,6 +769,35 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
      */
     QStatus ExchangeNames(RemoteEndpoint& endpoint);
 
+    /**
+     * Build an InterestSummary signal. If toggled is NULL the signal carries the complete summary
+     * otherwise it carries only the bits that flipped since the previous serial number.
+     *
+     * @param msg         [OUT] The signal message.
+     * @param controller  Unique name of the bus controller whose interests are being sent.
+     * @param serial      Serial number of the interests.
+     * @param summary     The complete summary.
+     * @param toggled     The bits that flipped or NULL.
+     * @param numToggled  Number of bits that flipped.
+     * @return  ER_OK if successful.
+     */
+    QStatus BuildInterestSummary(Message& msg, const qcc::String& controller, uint32_t serial, const InterestSummary& summary,
+                                 const uint16_t* toggled, size_t numToggled);
+
+    /**
+     * Send the complete local interest summary and the valid interest summaries of all known
+     * remote daemons over a newly connected bus-to-bus endpoint.
+     *
+     * @param endpoint    Remote endpoint to send the summaries to.
+     * @return  ER_OK if successful.
+     */
+    QStatus SendInterestSummaries(RemoteEndpoint& endpoint);
+
+    /**
+     * Send the changes to the local interests to all connected daemons.
+     */
+    void PublishLocalInterest();
+
     /**
      * Process a request to cancel advertising a name from a given (locally-connected) endpoint.
      *
@@ -23,6 +23,8 @@
 #include <qcc/platform.h>
 
 #include <assert.h>
+#include <string.h>
+#include <vector>
 
 #include <qcc/Debug.h>
 #include <qcc/Logger.h>
@@ -35,6 +37,7 @@
 
 #include "BusController.h"
 #include "BusEndpoint.h"
+#include "DaemonConfig.h"
 #include "DaemonRouter.h"
 #include "EndpointHelper.h"
 
@@ -47,28 +50,93 @@ using namespace qcc;
 namespace ajn {
 
 
-DaemonRouter::DaemonRouter() : ruleTable(), nameTable(), busController(NULL)
+DaemonRouter::DaemonRouter() : ruleTable(), nameTable(), busController(NULL),
+    m_enableInterestSummaries(true),
+    m_enableCutThrough(true),
+    m_txOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_BLOCK),
+    m_txOverflowMaxDrops(0),
+    m_txQueueBytes(_RemoteEndpoint::DEFAULT_TX_QUEUE_BYTES),
+    m_txQueueMsgs(_RemoteEndpoint::DEFAULT_TX_QUEUE_MSGS),
+    m_interestGeneration(1)
 {
+    DaemonConfig* config = DaemonConfig::Access();
+    m_enableInterestSummaries = config->Get("property@enable_interest_summaries", "true") == "true";
+    m_enableCutThrough = config->Get("property@enable_cut_through_forwarding", "true") == "true";
+
+    /*
+     * The overflow policy decides what happens to a broadcast message when the transmit queue of
+     * a slow endpoint is full. The default, "block", waits for room like any other message so
+     * the drop policies are opt-in.
+     */
+    qcc::String policyName = config->Get("property@tx_overflow_policy", "block");
+    if (policyName == "drop-newest") {
+        m_txOverflowPolicy = _RemoteEndpoint::TX_OVERFLOW_DROP_NEWEST;
+    } else if (policyName == "drop-oldest") {
+        m_txOverflowPolicy = _RemoteEndpoint::TX_OVERFLOW_DROP_OLDEST;
+    } else if (policyName == "disconnect") {
+        m_txOverflowPolicy = _RemoteEndpoint::TX_OVERFLOW_DISCONNECT;
+    } else if (policyName != "block") {
+        QCC_LogError(ER_FAIL, ("Unknown tx_overflow_policy \"%s\", using \"block\"", policyName.c_str()));
+    }
+    m_txOverflowMaxDrops = config->Get("limit@tx_overflow_max_drops", 1000);
+    m_txQueueBytes = config->Get("limit@tx_queue_bytes", _RemoteEndpoint::DEFAULT_TX_QUEUE_BYTES);
+    m_txQueueMsgs = config->Get("limit@tx_queue_messages", _RemoteEndpoint::DEFAULT_TX_QUEUE_MSGS);
 }
 
 DaemonRouter::~DaemonRouter()
 {
 }
 
-static inline QStatus SendThroughEndpoint(Message& msg, BusEndpoint& ep, SessionId sessionId)
+/*
+ * The bus controller of a daemon is always the first unique name the daemon assigns.
+ */
+static inline bool IsControllerName(const qcc::String& uniqueName)
+{
+    size_t len = uniqueName.size();
+    return (len > 2) && (uniqueName[len - 2] == '.') && (uniqueName[len - 1] == '1');
+}
+
+static inline QStatus SendThroughEndpoint(Message& msg, BusEndpoint& ep, SessionId sessionId, bool noWait = false)
 {
     QStatus status;
-    if ((sessionId != 0) && (ep->GetEndpointType() == ENDPOINT_TYPE_VIRTUAL)) {
-        status = VirtualEndpoint::cast(ep)->PushMessage(msg, sessionId);
+    EndpointType epType = ep->GetEndpointType();
+    if ((sessionId != 0) && (epType == ENDPOINT_TYPE_VIRTUAL)) {
+        status = VirtualEndpoint::cast(ep)->PushMessage(msg, sessionId, noWait);
+    } else if (noWait && (epType == ENDPOINT_TYPE_VIRTUAL)) {
+        status = VirtualEndpoint::cast(ep)->PushMessage(msg, msg->GetSessionId(), true);
+    } else if (noWait && ((epType == ENDPOINT_TYPE_REMOTE) || (epType == ENDPOINT_TYPE_BUS2BUS))) {
+        status = RemoteEndpoint::cast(ep)->PushMessageNoWait(msg);
     } else {
         status = ep->PushMessage(msg);
     }
-    if ((status != ER_OK) && (status != ER_BUS_ENDPOINT_CLOSING)) {
+    if (noWait && (status == ER_BUS_WRITE_QUEUE_FULL)) {
+        /* Dropped by the overflow policy of a slow endpoint, the endpoint counts its drops */
+        QCC_DbgPrintf(("SendThroughEndpoint(dest=%s, ep=%s, id=%u) dropped", msg->GetDestination(), ep->GetUniqueName().c_str(), sessionId));
+        status = ER_OK;
+    } else if ((status != ER_OK) && (status != ER_BUS_ENDPOINT_CLOSING)) {
         QCC_LogError(status, ("SendThroughEndpoint(dest=%s, ep=%s, id=%u) failed", msg->GetDestination(), ep->GetUniqueName().c_str(), sessionId));
     }
     return status;
 }
 
+/*
+ * A broadcast signal is cloned for each bus attachment in this process that receives it over the
+ * null transport. Unmarshal the arguments once so the clones share them. This must be done before
+ * the fan-out starts because other receivers read the arguments of the message concurrently.
+ */
+static void ShareBroadcastArgs(Message& msg, const std::vector<BusEndpoint>& dests)
+{
+    size_t numNull = 0;
+    for (std::vector<BusEndpoint>::const_iterator it = dests.begin(); it != dests.end(); ++it) {
+        if ((*it)->GetEndpointType() == ENDPOINT_TYPE_NULL) {
+            ++numNull;
+        }
+    }
+    if (numNull > 1) {
+        msg->ShareArgs();
+    }
+}
+
 QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
 {
     /*
@@ -114,8 +182,22 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
 
     bool destinationEmpty = destination[0] == '\0';
     if (!destinationEmpty) {
-        nameTable.Lock();
         BusEndpoint destEndpoint = nameTable.FindEndpoint(destination);
+        /*
+         * Messages that were received cut-through can be forwarded to a remote daemon as they
+         * are once the skipped header fields have been checked, otherwise the rest of the header
+         * must be parsed before the message is delivered.
+         */
+        if (msg->HasDeferredHeaderFields()) {
+            if (destEndpoint->IsValid() && (destEndpoint->GetEndpointType() == ENDPOINT_TYPE_VIRTUAL)) {
+                status = msg->CheckDeferredHeaderFields();
+            } else {
+                status = msg->ParseDeferredHeaderFields();
+            }
+            if (status != ER_OK) {
+                return status;
+            }
+        }
         if (destEndpoint->IsValid()) {
             /* If this message is coming from a bus-to-bus ep, make sure the receiver is willing to receive it */
             if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !destEndpoint->AllowRemoteMessages())) {
@@ -133,9 +215,7 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
                     BusEndpoint busEndpoint = BusEndpoint::cast(localEndpoint);
                     PushMessage(msg, busEndpoint);
                 } else {
-                    nameTable.Unlock();
                     status = SendThroughEndpoint(msg, destEndpoint, sessionId);
-                    nameTable.Lock();
                 }
             } else {
                 QCC_DbgPrintf(("Blocking message from %s to %s (serial=%d) because receiver does not allow remote messages",
@@ -154,9 +234,7 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
             if ((ER_OK != status) && (ER_BUS_ENDPOINT_CLOSING != status)) {
                 QCC_LogError(status, ("BusEndpoint::PushMessage failed"));
             }
-            nameTable.Unlock();
         } else {
-            nameTable.Unlock();
             if ((msg->GetFlags() & ALLJOYN_FLAG_AUTO_START) &&
                 (sender->GetEndpointType() != ENDPOINT_TYPE_BUS2BUS) &&
                 (sender->GetEndpointType() != ENDPOINT_TYPE_NULL)) {
@@ -184,32 +262,23 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
          * The message has an empty destination field and no session is specified so this is a
          * regular broadcast message.
          */
-        nameTable.Lock();
+        std::vector<BusEndpoint> dests;
         ruleTable.Lock();
-        RuleIterator it = ruleTable.Begin();
-        while (it != ruleTable.End()) {
-            if (it->second.IsMatch(msg)) {
-                BusEndpoint dest = it->first;
-                QCC_DbgPrintf(("Routing %s (%d) to %s", msg->Description().c_str(), msg->GetCallSerial(), dest->GetUniqueName().c_str()));
-                /*
-                 * If the message originated locally or the destination allows remote messages
-                 * forward the message, otherwise silently ignore it.
-                 */
-                if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages())) {
-                    ruleTable.Unlock();
-                    nameTable.Unlock();
-                    QStatus tStatus = SendThroughEndpoint(msg, dest, sessionId);
-                    status = (status == ER_OK) ? tStatus : status;
-                    nameTable.Lock();
-                    ruleTable.Lock();
-                }
-                it = ruleTable.AdvanceToNextEndpoint(dest);
-            } else {
-                ++it;
+        ruleTable.GetMatchingEndpoints(msg, dests);
+        ruleTable.Unlock();
+        ShareBroadcastArgs(msg, dests);
+        for (std::vector<BusEndpoint>::iterator it = dests.begin(); it != dests.end(); ++it) {
+            BusEndpoint dest = *it;
+            QCC_DbgPrintf(("Routing %s (%d) to %s", msg->Description().c_str(), msg->GetCallSerial(), dest->GetUniqueName().c_str()));
+            /*
+             * If the message originated locally or the destination allows remote messages
+             * forward the message, otherwise silently ignore it.
+             */
+            if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages())) {
+                QStatus tStatus = SendThroughEndpoint(msg, dest, sessionId, true);
+                status = (status == ER_OK) ? tStatus : status;
             }
         }
-        ruleTable.Unlock();
-        nameTable.Unlock();
 
         if (msg->IsSessionless()) {
             /* Give "locally generated" sessionless message to SessionlessObj */
@@ -246,15 +315,24 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
                 }
             }
 
+            /*
+             * Global broadcasts are only forwarded over bus-to-bus endpoints that lead to a daemon
+             * with an interested client. The daemon's own signals are always forwarded.
+             */
+            bool isDaemonSignal = (::strcmp(org::alljoyn::Daemon::InterfaceName, msg->GetInterface()) == 0);
+            bool prune = m_enableInterestSummaries && !isDaemonSignal;
+            InterestKeys keys(msg->GetInterface(), msg->GetMemberName());
+
             /* Route global broadcast to all bus-to-bus endpoints that aren't the sender of the message */
             m_b2bEndpointsLock.Lock(MUTEX_CONTEXT);
             set<RemoteEndpoint>::iterator it = m_b2bEndpoints.begin();
             while (it != m_b2bEndpoints.end()) {
                 RemoteEndpoint ep = *it;
-                if ((ep != origSender) && ((sessionId == 0) || ep->GetSessionId() == sessionId)) {
+                if ((ep != origSender) && ((sessionId == 0) || ep->GetSessionId() == sessionId) && (!prune || MayForwardBroadcast(keys, ep))) {
                     m_b2bEndpointsLock.Unlock(MUTEX_CONTEXT);
                     BusEndpoint busEndpoint = BusEndpoint::cast(ep);
-                    QStatus tStatus = SendThroughEndpoint(msg, busEndpoint, sessionId);
+                    /* The daemon's own signals must not be dropped */
+                    QStatus tStatus = SendThroughEndpoint(msg, busEndpoint, sessionId, !isDaemonSignal);
                     status = (status == ER_OK) ? tStatus : status;
                     m_b2bEndpointsLock.Lock(MUTEX_CONTEXT);
                     it = m_b2bEndpoints.lower_bound(ep);
@@ -272,61 +350,68 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
          * session multicast message.
          */
         sessionCastSetLock.Lock(MUTEX_CONTEXT);
-        RemoteEndpoint lastB2b;
-        /* We need to obtain the first entry in the sessionCastSet that has the id equal to 'sessionId'
-         * and the src equal to 'msg->GetSender()'.
-         * Note: sce.id has been set to sessionId - 1. Since the src is compared first, and session Ids
-         * are integers, upper_bound will return the iterator to the first element with the desired or
-         * greater src(if not present) and desired or greater id in most cases.
-         */
-        SessionCastEntry sce(sessionId - 1, msg->GetSender());
-        set<SessionCastEntry>::iterator sit = sessionCastSet.upper_bound(sce);
-        bool foundDest = false;
-
-        /* In other cases, it may return the iterator to an element that has the desired src and
-         * (sessionId - 1). In that case iterate, until the id is less than the desired one.
-         */
-        while ((sit != sessionCastSet.end()) && (sit->src == sce.src) && (sit->id < sessionId)) {
-            sit++;
-        }
-
-        while ((sit != sessionCastSet.end()) && (sit->id == sessionId) && (sit->src == sce.src)) {
-            if (sit->b2bEp != lastB2b) {
-                foundDest = true;
-                lastB2b = sit->b2bEp;
-                SessionCastEntry entry = *sit;
-                BusEndpoint ep = sit->destEp;
-                sessionCastSetLock.Unlock(MUTEX_CONTEXT);
-                QStatus tStatus = SendThroughEndpoint(msg, ep, sessionId);
+        std::map<SessionCastKey, SessionCastList>::const_iterator cit = sessionCastLists.find(SessionCastKey(msg->GetSender(), sessionId));
+        if (cit != sessionCastLists.end()) {
+            SessionCastList dests = cit->second;
+            sessionCastSetLock.Unlock(MUTEX_CONTEXT);
+            ShareBroadcastArgs(msg, *dests);
+            for (std::vector<BusEndpoint>::const_iterator it = dests->begin(); it != dests->end(); ++it) {
+                BusEndpoint ep = *it;
+                /* Session members rely on in-order delivery of everything sent over the session */
+                QStatus tStatus = SendThroughEndpoint(msg, ep, sessionId, false);
                 status = (status == ER_OK) ? tStatus : status;
-                sessionCastSetLock.Lock(MUTEX_CONTEXT);
-                sit = sessionCastSet.lower_bound(entry);
-            }
-            if (sit != sessionCastSet.end()) {
-                ++sit;
             }
-        }
-        if (!foundDest) {
+        } else {
+            sessionCastSetLock.Unlock(MUTEX_CONTEXT);
             status = ER_BUS_NO_ROUTE;
         }
-        sessionCastSetLock.Unlock(MUTEX_CONTEXT);
     }
 
     return status;
 }
 
+void DaemonRouter::UpdateSessionCastList(const qcc::String& src, SessionId id)
+{
+    SessionCastList dests;
+    RemoteEndpoint lastB2b;
+
+    /*
+     * Find the first entry with the desired src and id, see SessionCastEntry::operator<. Only one
+     * destination is needed for each bus-to-bus endpoint since the remote daemon does its own
+     * session multicast.
+     */
+    set<SessionCastEntry>::const_iterator sit = sessionCastSet.upper_bound(SessionCastEntry(id - 1, src));
+    while ((sit != sessionCastSet.end()) && (sit->src == src) && (sit->id < id)) {
+        ++sit;
+    }
+    while ((sit != sessionCastSet.end()) && (sit->id == id) && (sit->src == src)) {
+        if (sit->b2bEp != lastB2b) {
+            lastB2b = sit->b2bEp;
+            dests->push_back(sit->destEp);
+        }
+        ++sit;
+    }
+
+    SessionCastKey key(src, id);
+    if (dests->empty()) {
+        sessionCastLists.erase(key);
+    } else {
+        sessionCastLists[key] = dests;
+    }
+}
+
 void DaemonRouter::GetBusNames(vector<qcc::String>& names) const
 {
     nameTable.GetBusNames(names);
 }
 
-BusEndpoint DaemonRouter::FindEndpoint(const qcc::String& busName)
+BusEndpoint DaemonRouter::FindEndpoint(const char* busName)
 {
     BusEndpoint ep = nameTable.FindEndpoint(busName);
     if (!ep->IsValid()) {
         m_b2bEndpointsLock.Lock(MUTEX_CONTEXT);
         for (set<RemoteEndpoint>::const_iterator it = m_b2bEndpoints.begin(); it != m_b2bEndpoints.end(); ++it) {
-            if ((*it)->GetUniqueName() == busName) {
+            if (strcmp((*it)->GetUniqueName().c_str(), busName) == 0) {
                 RemoteEndpoint rep = *it;
                 ep = BusEndpoint::cast(rep);
                 break;
@@ -344,6 +429,7 @@ QStatus DaemonRouter::AddRule(BusEndpoint& endpoint, Rule& rule)
     /* Allow busController to examine this rule */
     if (status == ER_OK) {
         busController->AddRule(endpoint->GetUniqueName(), rule);
+        busController->GetAllJoynObj().LocalInterestChanged(true);
     }
 
     return status;
@@ -355,10 +441,104 @@ QStatus DaemonRouter::RemoveRule(BusEndpoint& endpoint, Rule& rule)
 
     /* Allow busController to examine rule being removed */
     busController->RemoveRule(endpoint->GetUniqueName(), rule);
+    busController->GetAllJoynObj().LocalInterestChanged(false);
 
     return status;
 }
 
+QStatus DaemonRouter::RemoveAllRules(BusEndpoint& endpoint)
+{
+    QStatus status = ruleTable.RemoveAllRules(endpoint);
+    if (busController) {
+        busController->GetAllJoynObj().LocalInterestChanged(false);
+    }
+    return status;
+}
+
+bool DaemonRouter::UpdateRemoteInterest(const qcc::String& controller, uint32_t serial, const uint8_t* bitmap, size_t bitmapLen,
+                                        const uint16_t* toggled, size_t numToggled)
+{
+    if (serial == 0) {
+        return false;
+    }
+    m_interestLock.Lock(MUTEX_CONTEXT);
+    RemoteInterest& interest = m_remoteInterest[controller];
+    /*
+     * Summaries are flooded to all daemons so the same summary may arrive over several routes,
+     * only the first copy is applied and passed on. Serial number 0 means nothing has been
+     * received yet.
+     */
+    bool isNew = (interest.serial == 0) || ((int32_t)(serial - interest.serial) > 0);
+    if (isNew) {
+        if (bitmap) {
+            interest.valid = interest.summary.Set(bitmap, bitmapLen);
+        } else if (serial != (interest.serial + 1)) {
+            /*
+             * A delta was missed so the summary is unknown until the next full summary
+             */
+            interest.valid = false;
+        }
+        if (interest.valid) {
+            for (size_t i = 0; i < numToggled; ++i) {
+                interest.summary.Toggle(toggled[i]);
+            }
+        }
+        interest.serial = serial;
+        ++m_interestGeneration;
+    }
+    m_interestLock.Unlock(MUTEX_CONTEXT);
+    return isNew;
+}
+
+void DaemonRouter::GetRemoteInterests(std::map<qcc::String, RemoteInterest>& interests)
+{
+    m_interestLock.Lock(MUTEX_CONTEXT);
+    interests = m_remoteInterest;
+    m_interestLock.Unlock(MUTEX_CONTEXT);
+}
+
+void DaemonRouter::InterestRoutesChanged()
+{
+    m_interestLock.Lock(MUTEX_CONTEXT);
+    ++m_interestGeneration;
+    m_interestLock.Unlock(MUTEX_CONTEXT);
+}
+
+bool DaemonRouter::MayForwardBroadcast(const InterestKeys& keys, RemoteEndpoint& b2bEp)
+{
+    m_interestLock.Lock(MUTEX_CONTEXT);
+    LinkInterest& link = m_linkInterest[b2bEp->GetUniqueName()];
+    if (link.generation != m_interestGeneration) {
+        /*
+         * Merge the summaries of the daemons this endpoint is a route to. A daemon that has not
+         * sent a valid summary might be interested in anything, and so might the daemon at the
+         * other end of a link whose bus controller has not been registered yet.
+         */
+        link.generation = m_interestGeneration;
+        link.matchAll = false;
+        link.summary.Clear();
+        size_t numRoutes = 0;
+        std::map<qcc::String, RemoteInterest>::const_iterator it;
+        for (it = m_remoteInterest.begin(); it != m_remoteInterest.end(); ++it) {
+            BusEndpoint ep = nameTable.FindEndpoint(it->first);
+            if ((ep->GetEndpointType() == ENDPOINT_TYPE_VIRTUAL) && VirtualEndpoint::cast(ep)->CanUseRoute(b2bEp)) {
+                ++numRoutes;
+                if (!it->second.valid) {
+                    link.matchAll = true;
+                    break;
+                }
+                link.summary.Merge(it->second.summary);
+            }
+        }
+        if (numRoutes == 0) {
+            link.matchAll = true;
+        }
+    }
+    bool mayMatch = link.matchAll || link.summary.MayMatch(keys);
+    m_interestLock.Unlock(MUTEX_CONTEXT);
+    return mayMatch;
+}
+
 QStatus DaemonRouter::RegisterEndpoint(BusEndpoint& endpoint)
 {
     QCC_DbgTrace(("DaemonRouter::RegisterEndpoint(%s, %d)", endpoint->GetUniqueName().c_str(), endpoint->GetEndpointType()));
@@ -369,6 +549,38 @@ QStatus DaemonRouter::RegisterEndpoint(BusEndpoint& endpoint)
         localEndpoint = LocalEndpoint::cast(endpoint);
     }
 
+    /*
+     * Messages from other daemons and trusted clients that are only passing through this daemon
+     * can be forwarded without parsing the entire header.
+     */
+    if ((endpoint->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) || ((endpoint->GetEndpointType() == ENDPOINT_TYPE_REMOTE) && RemoteEndpoint::cast(endpoint)->IsTrusted())) {
+        RemoteEndpoint::cast(endpoint)->GetFeatures().cutThrough = m_enableCutThrough;
+    }
+
+    /*
+     * The overflow policy only applies to broadcast messages, session multicast and unicast
+     * messages always wait for room. Disconnecting is only done for clients, bus-to-bus
+     * endpoints with that policy wait for room instead.
+     */
+    if ((endpoint->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) || (endpoint->GetEndpointType() == ENDPOINT_TYPE_REMOTE)) {
+        _RemoteEndpoint::TxOverflowPolicy policy = m_txOverflowPolicy;
+        if ((policy == _RemoteEndpoint::TX_OVERFLOW_DISCONNECT) && (endpoint->GetEndpointType() != ENDPOINT_TYPE_REMOTE)) {
+            policy = _RemoteEndpoint::TX_OVERFLOW_BLOCK;
+        }
+        RemoteEndpoint rep = RemoteEndpoint::cast(endpoint);
+        rep->SetTxOverflowPolicy(policy, m_txOverflowMaxDrops);
+
+        /*
+         * Transmit queue budgets, limit@tx_queue_bytes and limit@tx_queue_messages apply to all
+         * transports and are overridden for a single transport by limit@<transport>_tx_queue_bytes
+         * and limit@<transport>_tx_queue_messages.
+         */
+        DaemonConfig* config = DaemonConfig::Access();
+        qcc::String prefix = qcc::String("limit@") + rep->GetTransportName();
+        rep->SetTxQueueLimits(config->Get((prefix + "_tx_queue_bytes").c_str(), m_txQueueBytes),
+                              config->Get((prefix + "_tx_queue_messages").c_str(), m_txQueueMsgs));
+    }
+
     if (endpoint->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) {
         /* AllJoynObj is in charge of managing bus-to-bus endpoints and their names */
         RemoteEndpoint busToBusEndpoint = RemoteEndpoint::cast(endpoint);
@@ -378,9 +590,20 @@ QStatus DaemonRouter::RegisterEndpoint(BusEndpoint& endpoint)
         m_b2bEndpointsLock.Lock(MUTEX_CONTEXT);
         m_b2bEndpoints.insert(busToBusEndpoint);
         m_b2bEndpointsLock.Unlock(MUTEX_CONTEXT);
+        InterestRoutesChanged();
     } else {
         /* Bus-to-client endpoints appear directly on the bus */
         nameTable.AddUniqueName(endpoint);
+        /*
+         * Track the remote daemons so broadcasts are forwarded to them until they send an
+         * interest summary.
+         */
+        if ((endpoint->GetEndpointType() == ENDPOINT_TYPE_VIRTUAL) && IsControllerName(endpoint->GetUniqueName())) {
+            m_interestLock.Lock(MUTEX_CONTEXT);
+            m_remoteInterest[endpoint->GetUniqueName()];
+            ++m_interestGeneration;
+            m_interestLock.Unlock(MUTEX_CONTEXT);
+        }
     }
 
     /* Notify local endpoint that it is connected */
@@ -396,9 +619,7 @@ void DaemonRouter::UnregisterEndpoint(const qcc::String& epName, EndpointType ep
     QCC_DbgTrace(("UnregisterEndpoint: %s", epName.c_str()));
 
     /* Attempt to get the endpoint */
-    nameTable.Lock();
     BusEndpoint endpoint = FindEndpoint(epName);
-    nameTable.Unlock();
 
     if (ENDPOINT_TYPE_BUS2BUS == endpoint->GetEndpointType()) {
         /* Inform bus controller of bus-to-bus endpoint removal */
@@ -421,16 +642,32 @@ void DaemonRouter::UnregisterEndpoint(const qcc::String& epName, EndpointType ep
 
         /* Remove entries from sessionCastSet with same b2bEp */
         sessionCastSetLock.Lock(MUTEX_CONTEXT);
+        set<SessionCastKey> changed;
         set<SessionCastEntry>::iterator sit = sessionCastSet.begin();
         while (sit != sessionCastSet.end()) {
             set<SessionCastEntry>::iterator doomed = sit;
             ++sit;
             if (doomed->b2bEp == endpoint) {
+                changed.insert(SessionCastKey(doomed->src, doomed->id));
                 sessionCastSet.erase(doomed);
             }
         }
+        for (set<SessionCastKey>::const_iterator cit = changed.begin(); cit != changed.end(); ++cit) {
+            UpdateSessionCastList(cit->first.c_str(), cit->second);
+        }
         sessionCastSetLock.Unlock(MUTEX_CONTEXT);
+
+        m_interestLock.Lock(MUTEX_CONTEXT);
+        m_linkInterest.erase(epName);
+        ++m_interestGeneration;
+        m_interestLock.Unlock(MUTEX_CONTEXT);
     } else {
+        if ((epType == ENDPOINT_TYPE_VIRTUAL) && IsControllerName(epName)) {
+            m_interestLock.Lock(MUTEX_CONTEXT);
+            m_remoteInterest.erase(epName);
+            ++m_interestGeneration;
+            m_interestLock.Unlock(MUTEX_CONTEXT);
+        }
         /* Remove any session routes */
         RemoveSessionRoutes(endpoint->GetUniqueName().c_str(), 0);
         /* Remove endpoint from names and rules */
@@ -499,6 +736,8 @@ QStatus DaemonRouter::AddSessionRoute(SessionId id, BusEndpoint& srcEp, RemoteEn
             RemoteEndpoint none;
             sessionCastSet.insert(SessionCastEntry(id, destEp->GetUniqueName(), none, srcEp));
         }
+        UpdateSessionCastList(srcEp->GetUniqueName(), id);
+        UpdateSessionCastList(destEp->GetUniqueName(), id);
         sessionCastSetLock.Unlock(MUTEX_CONTEXT);
     }
     return status;
@@ -539,6 +778,8 @@ QStatus DaemonRouter::RemoveSessionRoute(SessionId id, BusEndpoint& srcEp, BusEn
         if (it2 != sessionCastSet.end()) {
             sessionCastSet.erase(it2);
         }
+        UpdateSessionCastList(srcEp->GetUniqueName(), id);
+        UpdateSessionCastList(destEp->GetUniqueName(), id);
         sessionCastSetLock.Unlock(MUTEX_CONTEXT);
     }
     return status;
@@ -550,6 +791,7 @@ void DaemonRouter::RemoveSessionRoutes(const char* src, SessionId id)
     BusEndpoint ep = FindEndpoint(srcStr);
 
     sessionCastSetLock.Lock(MUTEX_CONTEXT);
+    set<SessionCastKey> changed;
     set<SessionCastEntry>::const_iterator it = sessionCastSet.begin();
     while (it != sessionCastSet.end()) {
         if (((it->id == id) || (id == 0)) && ((it->src == src) || (it->destEp == ep))) {
@@ -557,11 +799,15 @@ void DaemonRouter::RemoveSessionRoutes(const char* src, SessionId id)
                 BusEndpoint destEp = it->destEp;
                 VirtualEndpoint::cast(destEp)->RemoveSessionRef(it->id);
             }
+            changed.insert(SessionCastKey(it->src, it->id));
             sessionCastSet.erase(it++);
         } else {
             ++it;
         }
     }
+    for (set<SessionCastKey>::const_iterator cit = changed.begin(); cit != changed.end(); ++cit) {
+        UpdateSessionCastList(cit->first.c_str(), cit->second);
+    }
     sessionCastSetLock.Unlock(MUTEX_CONTEXT);
 }
 
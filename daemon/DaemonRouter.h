@@ -24,6 +24,11 @@
 
 #include <qcc/platform.h>
 
+#include <map>
+#include <vector>
+
+#include <qcc/ManagedObj.h>
+#include <qcc/StringMapKey.h>
 #include <qcc/Thread.h>
 
 #include "Transport.h"
@@ -34,6 +39,7 @@
 #include "Router.h"
 #include "NameTable.h"
 #include "RuleTable.h"
+#include "InterestSummary.h"
 
 namespace ajn {
 
@@ -154,7 +160,16 @@ class DaemonRouter : public Router {
      * @param busname    Unique or well-known bus name
      * @return Returns either the bus endpoint or an invalid bus endpoint with
      */
-    BusEndpoint FindEndpoint(const qcc::String& busname);
+    BusEndpoint FindEndpoint(const qcc::String& busname) { return FindEndpoint(busname.c_str()); }
+
+    /**
+     * Find the endpoint that owns the given unique or well-known name without allocating a
+     * qcc::String for the name.
+     *
+     * @param busname    Unique or well-known bus name
+     * @return Returns either the bus endpoint or an invalid bus endpoint with
+     */
+    BusEndpoint FindEndpoint(const char* busname);
 
     /**
      * Find the remote or bus-to-bus endpoint that owns the given unique or well-known name.
@@ -218,7 +233,59 @@ class DaemonRouter : public Router {
      * @param endpoint    Endpoint whose rules will be removed.
      * @return ER_OK if successful;
      */
-    QStatus RemoveAllRules(BusEndpoint& endpoint) { return ruleTable.RemoveAllRules(endpoint); }
+    QStatus RemoveAllRules(BusEndpoint& endpoint);
+
+    /**
+     * Get the summary of the interfaces and members the local match rules refer to and the bits of
+     * the summary that changed since this method was last called.
+     *
+     * @param summary  Returns the current summary.
+     * @param toggled  Returns the bits that changed.
+     *
+     * @return  true if the summary may have changed.
+     */
+    bool GetLocalInterestChanges(InterestSummary& summary, std::vector<uint16_t>& toggled)
+    {
+        return ruleTable.GetInterestChanges(summary, toggled);
+    }
+
+    /**
+     * The interest summary most recently received from another daemon.
+     */
+    struct RemoteInterest {
+        RemoteInterest() : serial(0), valid(false) { }
+        uint32_t serial;          /**< Serial number of the last summary or delta received, 0 if none */
+        bool valid;               /**< False until a full summary is received or if a delta was missed */
+        InterestSummary summary;  /**< The summary */
+    };
+
+    /**
+     * Apply a full interest summary or a delta received from another daemon.
+     *
+     * @param controller  Unique name of the bus controller of the daemon the summary describes.
+     * @param serial      Serial number of the summary or delta, this is never 0.
+     * @param bitmap      The full summary or NULL if this is a delta.
+     * @param bitmapLen   Length of the full summary.
+     * @param toggled     Bits that changed since the previous serial number.
+     * @param numToggled  Number of bits that changed.
+     *
+     * @return  true if this is newer than the summary we had and should be passed on to other daemons.
+     */
+    bool UpdateRemoteInterest(const qcc::String& controller, uint32_t serial, const uint8_t* bitmap, size_t bitmapLen,
+                              const uint16_t* toggled, size_t numToggled);
+
+    /**
+     * Get the interest summaries received from other daemons.
+     *
+     * @param interests  Returns the summaries keyed by bus controller unique name.
+     */
+    void GetRemoteInterests(std::map<qcc::String, RemoteInterest>& interests);
+
+    /**
+     * Called when a bus-to-bus endpoint becomes a route to a remote daemon so the daemons that
+     * are reachable over each bus-to-bus endpoint are recomputed.
+     */
+    void InterestRoutesChanged();
 
     /**
      * Route an incoming Message Bus Message from an endpoint.
@@ -352,6 +419,28 @@ class DaemonRouter : public Router {
     void RemoveSessionRoutes(const char* uniqueName, SessionId id);
 
   private:
+
+    /**
+     * Check if a global broadcast may be of interest to a daemon reachable over a bus-to-bus
+     * endpoint.
+     *
+     * @param keys   Interest keys for the message.
+     * @param b2bEp  The bus-to-bus endpoint.
+     *
+     * @return  false if no daemon reachable over b2bEp has a client with a matching rule.
+     */
+    bool MayForwardBroadcast(const InterestKeys& keys, RemoteEndpoint& b2bEp);
+
+    /**
+     * Summary of the interests of all the daemons reachable over a bus-to-bus endpoint.
+     */
+    struct LinkInterest {
+        LinkInterest() : generation(0), matchAll(true) { }
+        uint32_t generation;      /**< Value of interestGeneration when the summary was computed */
+        bool matchAll;            /**< True if a reachable daemon has not sent a valid summary */
+        InterestSummary summary;  /**< The merged summaries */
+    };
+
     LocalEndpoint localEndpoint;    /**< The local endpoint */
     RuleTable ruleTable;            /**< Routing rule table */
     NameTable nameTable;            /**< BusName to transport lookupl table */
@@ -360,6 +449,23 @@ class DaemonRouter : public Router {
     std::set<RemoteEndpoint> m_b2bEndpoints; /**< Collection of Bus-to-bus endpoints */
     qcc::Mutex m_b2bEndpointsLock;           /**< Lock that protects m_b2bEndpoints */
 
+    /*
+     * Configuration read once when the router is created. With the default tx_overflow_policy of
+     * "block" PushMessageNoWait() waits for room in the transmit queue exactly like PushMessage()
+     * so no message is ever dropped unless a drop policy is configured.
+     */
+    bool m_enableInterestSummaries;                   /**< property@enable_interest_summaries */
+    bool m_enableCutThrough;                          /**< property@enable_cut_through_forwarding */
+    _RemoteEndpoint::TxOverflowPolicy m_txOverflowPolicy; /**< property@tx_overflow_policy */
+    uint32_t m_txOverflowMaxDrops;                    /**< limit@tx_overflow_max_drops */
+    uint32_t m_txQueueBytes;                          /**< limit@tx_queue_bytes */
+    uint32_t m_txQueueMsgs;                           /**< limit@tx_queue_messages */
+
+    std::map<qcc::String, RemoteInterest> m_remoteInterest;  /**< Interest summaries keyed by remote bus controller name */
+    std::map<qcc::String, LinkInterest> m_linkInterest;      /**< Merged interest summaries keyed by bus-to-bus endpoint name */
+    uint32_t m_interestGeneration;                           /**< Incremented when the link interests must be recomputed */
+    qcc::Mutex m_interestLock;                               /**< Lock that protects the interest summaries */
+
     /** Session multicast destination map */
     struct SessionCastEntry {
         SessionId id;
@@ -387,7 +493,25 @@ class DaemonRouter : public Router {
     };
 
     std::set<SessionCastEntry> sessionCastSet; /**< Session multicast set */
-    qcc::Mutex sessionCastSetLock;             /**< Lock that protects sessionCastSet */
+    qcc::Mutex sessionCastSetLock;             /**< Lock that protects sessionCastSet and sessionCastLists */
+
+    /**
+     * Destinations of the session multicast messages sent by a (src, id) pair. A list is never
+     * modified once built so PushMessage can iterate over it without holding sessionCastSetLock.
+     */
+    typedef std::pair<qcc::StringMapKey, SessionId> SessionCastKey;
+    typedef qcc::ManagedObj<std::vector<BusEndpoint> > SessionCastList;
+    std::map<SessionCastKey, SessionCastList> sessionCastLists;
+
+    /**
+     * Rebuild the session multicast destination list for a (src, id) pair from sessionCastSet.
+     * Must be called with sessionCastSetLock held after sessionCastSet entries for the pair are
+     * added or removed.
+     *
+     * @param src   Unique name of the sender.
+     * @param id    Session id.
+     */
+    void UpdateSessionCastList(const qcc::String& src, SessionId id);
 };
 
 }
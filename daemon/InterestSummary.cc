@@ -0,0 +1,144 @@
+/**
+ * @file
+ * InterestSummary is a compact summary of the interfaces and members that the match rules of a
+ * daemon's clients refer to.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include "InterestSummary.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+namespace ajn {
+
+/*
+ * 32 bit FNV-1a, the interface and member are separated by a NUL so ("ab", "c") and ("a", "bc")
+ * hash differently.
+ */
+static uint32_t HashPair(const char* iface, const char* member)
+{
+    uint32_t h = 2166136261U;
+    while (*iface) {
+        h = (h ^ (uint8_t)*iface++) * 16777619U;
+    }
+    h = (h ^ 0) * 16777619U;
+    while (*member) {
+        h = (h ^ (uint8_t)*member++) * 16777619U;
+    }
+    return h;
+}
+
+void InterestKeys::GetBits(const char* iface, const char* member, uint16_t bits[NUM_HASHES])
+{
+    /*
+     * Double hashing - the second hash is derived from the first with a 32 bit mixing function
+     */
+    uint32_t h1 = HashPair(iface, member);
+    uint32_t h2 = h1;
+    h2 ^= h2 >> 16;
+    h2 *= 0x85EBCA6BU;
+    h2 ^= h2 >> 13;
+    h2 *= 0xC2B2AE35U;
+    h2 ^= h2 >> 16;
+    h2 |= 1;
+    for (size_t i = 0; i < NUM_HASHES; ++i) {
+        bits[i] = (uint16_t)((h1 + i * h2) % InterestSummary::NUM_BITS);
+    }
+}
+
+InterestKeys::InterestKeys(const char* iface, const char* member)
+{
+    GetBits(iface, member, bits[0]);
+    GetBits(iface, "", bits[1]);
+    GetBits("", member, bits[2]);
+    GetBits("", "", bits[3]);
+}
+
+bool InterestSummary::Test(const uint16_t bits[InterestKeys::NUM_HASHES]) const
+{
+    for (size_t i = 0; i < InterestKeys::NUM_HASHES; ++i) {
+        if (!(bitmap[bits[i] >> 3] & (1 << (bits[i] & 7)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool InterestSummary::MayMatch(const InterestKeys& keys) const
+{
+    return Test(keys.bits[0]) || Test(keys.bits[1]) || Test(keys.bits[2]) || Test(keys.bits[3]);
+}
+
+void InterestSummary::Merge(const InterestSummary& other)
+{
+    for (size_t i = 0; i < sizeof(bitmap); ++i) {
+        bitmap[i] |= other.bitmap[i];
+    }
+}
+
+bool InterestSummary::Set(const uint8_t* bytes, size_t len)
+{
+    if (len != sizeof(bitmap)) {
+        return false;
+    }
+    memcpy(bitmap, bytes, len);
+    return true;
+}
+
+void InterestCounter::Add(const char* iface, const char* member)
+{
+    uint16_t bits[InterestKeys::NUM_HASHES];
+    InterestKeys::GetBits(iface, member, bits);
+    for (size_t i = 0; i < InterestKeys::NUM_HASHES; ++i) {
+        uint16_t& count = counts[bits[i]];
+        /*
+         * A saturated count is never decremented so the bit stays set
+         */
+        if (count != 0xFFFF) {
+            if (count++ == 0) {
+                summary.Toggle(bits[i]);
+                changes.push_back(bits[i]);
+            }
+        }
+    }
+}
+
+void InterestCounter::Remove(const char* iface, const char* member)
+{
+    uint16_t bits[InterestKeys::NUM_HASHES];
+    InterestKeys::GetBits(iface, member, bits);
+    for (size_t i = 0; i < InterestKeys::NUM_HASHES; ++i) {
+        uint16_t& count = counts[bits[i]];
+        if ((count != 0) && (count != 0xFFFF)) {
+            if (--count == 0) {
+                summary.Toggle(bits[i]);
+                changes.push_back(bits[i]);
+            }
+        }
+    }
+}
+
+bool InterestCounter::TakeChanges(std::vector<uint16_t>& toggled)
+{
+    toggled.swap(changes);
+    changes.clear();
+    return !toggled.empty();
+}
+
+}
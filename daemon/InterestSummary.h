@@ -0,0 +1,186 @@
+/**
+ * @file
+ * InterestSummary is a compact summary of the interfaces and members that the match rules of a
+ * daemon's clients refer to. Daemons exchange their summaries so that global broadcast signals
+ * are only forwarded over bus-to-bus links that lead to a daemon with an interested client.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_INTERESTSUMMARY_H
+#define _ALLJOYN_INTERESTSUMMARY_H
+
+#include <qcc/platform.h>
+
+#include <vector>
+#include <string.h>
+
+namespace ajn {
+
+/**
+ * The bits of an interest summary that correspond to the interface and member of a message. A
+ * message may match a rule that names its interface and member, only its interface, only its
+ * member, or neither so there are four sets of bits.
+ */
+struct InterestKeys {
+
+    static const size_t NUM_HASHES = 3;     /**< Number of bits set for each interface/member pair */
+
+    /**
+     * Compute the bits for an interface and member, the empty string means any interface or any
+     * member.
+     *
+     * @param iface   The interface name.
+     * @param member  The member name.
+     */
+    InterestKeys(const char* iface, const char* member);
+
+    uint16_t bits[4][NUM_HASHES];   /**< Bits for (iface, member), (iface, *), (*, member) and (*, *) */
+
+    /**
+     * Compute the bits for a single interface/member pair. The hash is part of the daemon to daemon
+     * protocol so must not depend on the platform.
+     *
+     * @param iface   The interface name or "" for any interface.
+     * @param member  The member name or "" for any member.
+     * @param bits    Returns the bit positions.
+     */
+    static void GetBits(const char* iface, const char* member, uint16_t bits[NUM_HASHES]);
+};
+
+/**
+ * A Bloom filter over the interface/member pairs of a set of match rules. The filter gives no false
+ * negatives so a message that does not match the summary cannot match any of the rules.
+ */
+class InterestSummary {
+  public:
+
+    static const size_t NUM_BITS = 2048;    /**< Size of the filter in bits */
+
+    /**
+     * Constructor - an empty summary matches nothing.
+     */
+    InterestSummary() { Clear(); }
+
+    /**
+     * Remove all interests from the summary.
+     */
+    void Clear() { memset(bitmap, 0, sizeof(bitmap)); }
+
+    /**
+     * Test if a message with the interface and member the keys were computed for may match a rule
+     * in the summary.
+     *
+     * @param keys  The keys for the message.
+     *
+     * @return  false if no rule in the summary can match the message.
+     */
+    bool MayMatch(const InterestKeys& keys) const;
+
+    /**
+     * Flip a bit in the summary.
+     *
+     * @param bit  The bit to flip.
+     */
+    void Toggle(uint16_t bit) { bitmap[(bit % NUM_BITS) >> 3] ^= (uint8_t)(1 << (bit & 7)); }
+
+    /**
+     * Add all the interests in another summary to this one.
+     *
+     * @param other  The other summary.
+     */
+    void Merge(const InterestSummary& other);
+
+    /**
+     * Replace the summary with a marshaled bitmap.
+     *
+     * @param bytes  The bitmap.
+     * @param len    Length of the bitmap, this must be NUM_BITS / 8.
+     *
+     * @return  false if the bitmap is the wrong length.
+     */
+    bool Set(const uint8_t* bytes, size_t len);
+
+    /**
+     * Get the bitmap for marshaling.
+     *
+     * @return  The bitmap, this is NUM_BITS / 8 bytes long.
+     */
+    const uint8_t* GetBitmap() const { return bitmap; }
+
+  private:
+
+    bool Test(const uint16_t bits[InterestKeys::NUM_HASHES]) const;
+
+    uint8_t bitmap[NUM_BITS / 8];   /**< The filter bits */
+};
+
+/**
+ * A counting interest summary used to track the interests of a daemon's own clients as match
+ * rules are added and removed. The bits of the summary that change are recorded so they can be
+ * sent to other daemons as a delta.
+ */
+class InterestCounter {
+  public:
+
+    /**
+     * Constructor
+     */
+    InterestCounter() { memset(counts, 0, sizeof(counts)); }
+
+    /**
+     * Add an interest in an interface and member.
+     *
+     * @param iface   The interface name or "" for any interface.
+     * @param member  The member name or "" for any member.
+     */
+    void Add(const char* iface, const char* member);
+
+    /**
+     * Remove an interest in an interface and member.
+     *
+     * @param iface   The interface name or "" for any interface.
+     * @param member  The member name or "" for any member.
+     */
+    void Remove(const char* iface, const char* member);
+
+    /**
+     * Get the current summary.
+     *
+     * @return  The summary.
+     */
+    const InterestSummary& GetSummary() const { return summary; }
+
+    /**
+     * Get the bits that have flipped since this method was last called. A bit may appear more
+     * than once, applying all the flips in order gives the current summary.
+     *
+     * @param toggled  Returns the bits that flipped.
+     *
+     * @return  true if the summary may have changed.
+     */
+    bool TakeChanges(std::vector<uint16_t>& toggled);
+
+  private:
+
+    uint16_t counts[InterestSummary::NUM_BITS];   /**< Number of interests that set each bit */
+    InterestSummary summary;                       /**< The summary */
+    std::vector<uint16_t> changes;                 /**< Bits that flipped since the last TakeChanges() */
+};
+
+}
+
+#endif
@@ -43,6 +43,25 @@ using namespace qcc;
 
 namespace ajn {
 
+NameTable::NameTable() : uniqueId(0), uniquePrefix(":1."), snapshot(NULL), phase(0)
+{
+    /* The reader counts are aligned to a cache line so each one has a line to itself */
+    const size_t numSlots = 2 * NUM_READER_SLOTS;
+    readerBuf = new uint8_t[numSlots * sizeof(ReaderSlot) + CACHE_LINE_SIZE];
+    readerSlots = reinterpret_cast<ReaderSlot*>(((uintptr_t)readerBuf + CACHE_LINE_SIZE - 1) & ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+    for (size_t i = 0; i < numSlots; ++i) {
+        readerSlots[i].count = 0;
+    }
+    /* Start with an empty snapshot that has the minimum number of unique name slots */
+    Publish();
+}
+
+NameTable::~NameTable()
+{
+    delete snapshot;
+    delete [] readerBuf;
+}
+
 qcc::String NameTable::GenerateUniqueName(void)
 {
     return uniquePrefix + U32ToString(IncrementAndFetch((int32_t*)&uniqueId));
@@ -64,7 +83,9 @@ void NameTable::AddUniqueName(BusEndpoint& endpoint)
     QCC_DbgPrintf(("Add unique name %s", uniqueName.c_str()));
     lock.Lock(MUTEX_CONTEXT);
     uniqueNames[uniqueName] = endpoint;
+    const Snapshot* old = Publish();
     lock.Unlock(MUTEX_CONTEXT);
+    Reclaim(old);
 
     /* Notify listeners */
     CallListeners(uniqueName, NULL, &uniqueName);
@@ -78,56 +99,39 @@ void NameTable::RemoveUniqueName(const qcc::String& uniqueName)
     lock.Lock(MUTEX_CONTEXT);
     unordered_map<qcc::String, BusEndpoint, Hash, Equal>::iterator it = uniqueNames.find(uniqueName);
     if (it != uniqueNames.end()) {
-        BusEndpoint endpoint = it->second;
-
-        /* Remove well-known names asssociated with uniqueName */
-        unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::iterator ait = aliasNames.begin();
+        /*
+         * Remove all the well-known names first and publish the new snapshot once, the listeners
+         * are called after the lock is released.
+         */
+        vector<pair<String, String> > released;
+        AliasMap::iterator ait = aliasNames.begin();
         while (ait != aliasNames.end()) {
-            deque<NameQueueEntry>::iterator lit = ait->second.begin();
-            bool startOver = false;
-            while (lit != ait->second.end()) {
-                if (lit->endpointName == endpoint->GetUniqueName()) {
-                    if (lit == ait->second.begin()) {
-                        uint32_t disposition;
-                        String alias = ait->first;
-                        String epName = endpoint->GetUniqueName();
-                        /* Must unlock before calling RemoveAlias because it can call out (and cannot be locked at the time) */
-                        lock.Unlock(MUTEX_CONTEXT);
-                        RemoveAlias(alias, epName, disposition, NULL, NULL);
-                        lock.Lock(MUTEX_CONTEXT);
-                        /* Make sure iterator is still valid */
-                        it = uniqueNames.find(uniqueName);
-                        if (it == uniqueNames.end()) {
-                            break;
-                        }
-                        if (DBUS_RELEASE_NAME_REPLY_RELEASED == disposition) {
-                            ait = aliasNames.begin();
-                            startOver = true;
-                            break;
-                        } else {
-                            QCC_LogError(ER_FAIL, ("Failed to release %s from %s", alias.c_str(), epName.c_str()));
-                            break;
-                        }
-                    } else {
-                        ait->second.erase(lit);
+            AliasMap::iterator cur = ait++;
+            deque<NameQueueEntry>& queue = cur->second;
+            if (queue[0].endpointName == uniqueName) {
+                String alias = cur->first;
+                String newOwner;
+                RemovePrimaryOwner(cur, newOwner);
+                released.push_back(pair<String, String>(alias, newOwner));
+            } else {
+                for (deque<NameQueueEntry>::iterator lit = queue.begin(); lit != queue.end(); ++lit) {
+                    if (lit->endpointName == uniqueName) {
+                        queue.erase(lit);
                         break;
                     }
-                } else {
-                    ++lit;
                 }
             }
-            if (!startOver) {
-                ++ait;
-            }
-        }
-
-        if (it != uniqueNames.end()) {
-            uniqueNames.erase(it);
-            QCC_DbgPrintf(("Removed ep=%s from name table", uniqueName.c_str()));
         }
-
+        uniqueNames.erase(it);
+        const Snapshot* old = Publish();
+        QCC_DbgPrintf(("Removed ep=%s from name table", uniqueName.c_str()));
         lock.Unlock(MUTEX_CONTEXT);
+        Reclaim(old);
+
         /* Notify listeners */
+        for (vector<pair<String, String> >::const_iterator rit = released.begin(); rit != released.end(); ++rit) {
+            CallListeners(rit->first, &uniqueName, rit->second.empty() ? NULL : &rit->second);
+        }
         CallListeners(uniqueName, &uniqueName, NULL);
     } else {
         lock.Unlock(MUTEX_CONTEXT);
@@ -187,7 +191,9 @@ QStatus NameTable::AddAlias(const qcc::String& aliasName,
                 origOwner = &vit->second->GetUniqueName();
             }
         }
+        const Snapshot* old = newOwner ? Publish() : NULL;
         lock.Unlock(MUTEX_CONTEXT);
+        Reclaim(old);
 
         if (listener) {
             listener->AddAliasComplete(aliasName, disposition, context);
@@ -212,36 +218,23 @@ void NameTable::RemoveAlias(const qcc::String& aliasName,
     qcc::String oldOwner;
     qcc::String newOwner;
     qcc::String aliasNameCopy(aliasName);
+    const Snapshot* old = NULL;
 
     QCC_DbgTrace(("NameTable: RemoveAlias(%s, %s)", aliasName.c_str(), ownerName.c_str()));
 
     lock.Lock(MUTEX_CONTEXT);
 
     /* Find endpoint for aliasName */
-    unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::iterator it = aliasNames.find(aliasName);
+    AliasMap::iterator it = aliasNames.find(aliasName);
     if (it != aliasNames.end()) {
         deque<NameQueueEntry>& queue = it->second;
 
         assert(!queue.empty());
         if (queue[0].endpointName == ownerName) {
-            /* Remove primary */
-            if (queue.size() > 1) {
-                queue.pop_front();
-                BusEndpoint ep = FindEndpoint(queue[0].endpointName);
-                if (ep->IsValid()) {
-                    newOwner = queue[0].endpointName;
-                }
-            }
-            if (newOwner.empty()) {
-                /* Check to see if there is a (now unmasked) remote owner for the alias */
-                map<qcc::StringMapKey, VirtualEndpoint>::const_iterator vit = virtualAliasNames.find(aliasName);
-                if (vit != virtualAliasNames.end()) {
-                    newOwner = vit->second->GetUniqueName();
-                }
-                aliasNames.erase(it);
-            }
+            RemovePrimaryOwner(it, newOwner);
             oldOwner = ownerName;
             disposition = DBUS_RELEASE_NAME_REPLY_RELEASED;
+            old = Publish();
         } else {
             /* Alias is not owned by ownerName */
             disposition = DBUS_RELEASE_NAME_REPLY_NOT_OWNER;
@@ -251,6 +244,7 @@ void NameTable::RemoveAlias(const qcc::String& aliasName,
     }
 
     lock.Unlock(MUTEX_CONTEXT);
+    Reclaim(old);
 
     if (listener) {
         listener->RemoveAliasComplete(aliasNameCopy, disposition, context);
@@ -260,11 +254,132 @@ void NameTable::RemoveAlias(const qcc::String& aliasName,
     }
 }
 
-BusEndpoint NameTable::FindEndpoint(const qcc::String& busName) const
+void NameTable::RemovePrimaryOwner(AliasMap::iterator it, qcc::String& newOwner)
+{
+    deque<NameQueueEntry>& queue = it->second;
+    if (queue.size() > 1) {
+        queue.pop_front();
+        BusEndpoint ep = Lookup(queue[0].endpointName);
+        if (ep->IsValid()) {
+            newOwner = queue[0].endpointName;
+        }
+    }
+    if (newOwner.empty()) {
+        /* Check to see if there is a (now unmasked) remote owner for the alias */
+        map<qcc::StringMapKey, VirtualEndpoint>::const_iterator vit = virtualAliasNames.find(it->first);
+        if (vit != virtualAliasNames.end()) {
+            newOwner = vit->second->GetUniqueName();
+        }
+        aliasNames.erase(it);
+    }
+}
+
+bool NameTable::GetUniqueHandle(const char* name, uint64_t& handle)
+{
+    if (*name++ != ':') {
+        return false;
+    }
+    /* 32 bit FNV-1a of the prefix, this is the daemon's short GUID for names it generated */
+    uint32_t prefix = 2166136261U;
+    while (*name != '.') {
+        if (*name == '\0') {
+            return false;
+        }
+        prefix = (prefix ^ (uint8_t)*name++) * 16777619U;
+    }
+    ++name;
+    uint64_t counter = 0;
+    size_t digits = 0;
+    while (*name) {
+        if ((*name < '0') || (*name > '9') || (++digits > 10)) {
+            return false;
+        }
+        counter = counter * 10 + (*name++ - '0');
+    }
+    if ((digits == 0) || (counter > 0xFFFFFFFF)) {
+        return false;
+    }
+    handle = ((uint64_t)prefix << 32) | counter;
+    return true;
+}
+
+/*
+ * Names with the same prefix differ only in the counter so the names of local endpoints occupy
+ * consecutive slots.
+ */
+static inline size_t SlotIndex(uint64_t handle)
+{
+    return (size_t)((uint32_t)(handle >> 32) * 0x9E3779B1U + (uint32_t)handle);
+}
+
+BusEndpoint NameTable::Snapshot::FindUnique(uint64_t handle, const char* name) const
+{
+    if (unique.empty()) {
+        return BusEndpoint();
+    }
+    const size_t mask = unique.size() - 1;
+    for (size_t i = SlotIndex(handle) & mask; unique[i].used; i = (i + 1) & mask) {
+        if ((unique[i].handle == handle) && (strcmp(unique[i].ep->GetUniqueName().c_str(), name) == 0)) {
+            return unique[i].ep;
+        }
+    }
+    return BusEndpoint();
+}
+
+void NameTable::Snapshot::AddUnique(uint64_t handle, const BusEndpoint& ep)
+{
+    assert(!unique.empty());
+    const size_t mask = unique.size() - 1;
+    size_t i = SlotIndex(handle) & mask;
+    while (unique[i].used) {
+        i = (i + 1) & mask;
+    }
+    unique[i].used = true;
+    unique[i].handle = handle;
+    unique[i].ep = ep;
+}
+
+/*
+ * Pick the reader count for the calling thread. Thread stacks are far apart so the address of a
+ * local variable tells threads apart without thread local storage. Threads that pick the same
+ * count only share a cache line, the count is still correct.
+ */
+static inline size_t ReaderSlotIndex(uint32_t bits)
+{
+    int local;
+    uint32_t stackPage = (uint32_t)((uintptr_t)&local >> 16);
+    return (size_t)((stackPage * 0x9E3779B1U) >> (32 - bits));
+}
+
+BusEndpoint NameTable::FindEndpoint(const char* busName) const
+{
+    BusEndpoint ep;
+    uint64_t handle;
+    bool isUnique = GetUniqueHandle(busName, handle);
+
+    /*
+     * The reader count is incremented before the snapshot pointer is read so Reclaim() will
+     * wait for this lookup to finish before it frees the snapshot.
+     */
+    volatile int32_t* count = &readerSlots[((phase & 1) << READER_SLOT_BITS) + ReaderSlotIndex(READER_SLOT_BITS)].count;
+    IncrementAndFetch(count);
+    const Snapshot* names = snapshot;
+    if (isUnique) {
+        ep = names->FindUnique(handle, busName);
+    } else {
+        std::unordered_map<const char*, BusEndpoint, CStrHash, CStrEqual>::const_iterator it = names->aliases.find(busName);
+        if (it != names->aliases.end()) {
+            ep = it->second;
+        }
+    }
+    DecrementAndFetch(count);
+    return ep;
+}
+
+BusEndpoint NameTable::Lookup(const qcc::String& busName) const
 {
     BusEndpoint ep;
 
-    lock.Lock(MUTEX_CONTEXT);
     if (busName[0] == ':') {
         unordered_map<qcc::String, BusEndpoint, Hash, Equal>::const_iterator it = uniqueNames.find(busName);
         if (it != uniqueNames.end()) {
@@ -274,7 +389,7 @@ BusEndpoint NameTable::FindEndpoint(const qcc::String& busName) const
         unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::const_iterator it = aliasNames.find(busName);
         if (it != aliasNames.end()) {
             assert(!it->second.empty());
-            ep = FindEndpoint(it->second[0].endpointName);
+            ep = Lookup(it->second[0].endpointName);
         }
         /* Fallback to virtual (remote) aliases if a suitable local one cannot be found */
         if (!ep->IsValid()) {
@@ -285,10 +400,87 @@ BusEndpoint NameTable::FindEndpoint(const qcc::String& busName) const
             }
         }
     }
-    lock.Unlock(MUTEX_CONTEXT);
     return ep;
 }
 
+const NameTable::Snapshot* NameTable::Publish()
+{
+    Snapshot* next = new Snapshot();
+
+    /* Keep the unique name table at most half full */
+    size_t numSlots = MIN_UNIQUE_SLOTS;
+    while (numSlots < (2 * uniqueNames.size())) {
+        numSlots <<= 1;
+    }
+    next->unique.resize(numSlots);
+
+    unordered_map<qcc::String, BusEndpoint, Hash, Equal>::const_iterator uit = uniqueNames.begin();
+    while (uit != uniqueNames.end()) {
+        uint64_t handle;
+        if (GetUniqueHandle(uit->first.c_str(), handle)) {
+            next->AddUnique(handle, uit->second);
+        } else {
+            next->keys.push_back(uit->first);
+            next->aliases[next->keys.back().c_str()] = uit->second;
+        }
+        ++uit;
+    }
+    unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::const_iterator ait = aliasNames.begin();
+    while (ait != aliasNames.end()) {
+        if (ait->first[0] != ':') {
+            BusEndpoint ep = Lookup(ait->first);
+            if (ep->IsValid()) {
+                next->keys.push_back(ait->first);
+                next->aliases[next->keys.back().c_str()] = ep;
+            }
+        }
+        ++ait;
+    }
+    map<qcc::StringMapKey, VirtualEndpoint>::const_iterator vit = virtualAliasNames.begin();
+    while (vit != virtualAliasNames.end()) {
+        const char* alias = vit->first.c_str();
+        if ((alias[0] != ':') && (next->aliases.find(alias) == next->aliases.end())) {
+            VirtualEndpoint vep = vit->second;
+            next->keys.push_back(alias);
+            next->aliases[next->keys.back().c_str()] = BusEndpoint::cast(vep);
+        }
+        ++vit;
+    }
+
+    const Snapshot* old = snapshot;
+    snapshot = next;
+    return old;
+}
+
+void NameTable::Reclaim(const Snapshot* old)
+{
+    if (!old) {
+        return;
+    }
+    /*
+     * A reader that read the phase before the first flip may not increment its count until after
+     * the wait for the old phase completes, in which case it is counted against a phase we wait
+     * for in the second round. Waiting for both phases in turn guarantees that every reader that
+     * could have seen the old snapshot has finished. The phase flips of concurrent callers must
+     * not interleave or both rounds could wait for the same phase.
+     */
+    reclaimLock.Lock(MUTEX_CONTEXT);
+    for (size_t i = 0; i < 2; ++i) {
+        int32_t oldPhase = IncrementAndFetch(&phase) - 1;
+        const ReaderSlot* slots = &readerSlots[(oldPhase & 1) << READER_SLOT_BITS];
+        for (size_t s = 0; s < NUM_READER_SLOTS; ++s) {
+            uint32_t spins = 0;
+            while (slots[s].count != 0) {
+                if (++spins > 1000) {
+                    qcc::Sleep(1);
+                }
+            }
+        }
+    }
+    reclaimLock.Unlock(MUTEX_CONTEXT);
+    delete old;
+}
+
 void NameTable::GetBusNames(vector<qcc::String>& names) const
 {
     lock.Lock(MUTEX_CONTEXT);
@@ -320,7 +512,7 @@ void NameTable::GetUniqueNamesAndAliases(vector<pair<qcc::String, vector<qcc::St
     unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::const_iterator ait = aliasNames.begin();
     while (ait != aliasNames.end()) {
         if (!ait->second.empty()) {
-            BusEndpoint ep = FindEndpoint(ait->second.front().endpointName);
+            BusEndpoint ep = Lookup(ait->second.front().endpointName);
             if (ep->IsValid()) {
                 epMap.insert(pair<BusEndpoint, qcc::String>(ep, ait->first));
             }
@@ -380,29 +572,42 @@ void NameTable::GetQueuedNames(const qcc::String& busName, std::vector<qcc::Stri
 void NameTable::RemoveVirtualAliases(const qcc::String& epName)
 {
     lock.Lock(MUTEX_CONTEXT);
-    BusEndpoint tempEp = FindEndpoint(epName);
+    BusEndpoint tempEp = Lookup(epName);
     VirtualEndpoint ep = VirtualEndpoint::cast(tempEp);
 
     QCC_DbgTrace(("NameTable::RemoveVirtualAliases(%s)", ep->IsValid() ? ep->GetUniqueName().c_str() : "<none>"));
 
+    /*
+     * Remove all the aliases first and publish the new snapshot once, the listeners are called
+     * after the lock is released.
+     */
+    vector<String> lostAliases;
+    const Snapshot* old = NULL;
     if (ep->IsValid()) {
+        bool removed = false;
         map<qcc::StringMapKey, VirtualEndpoint>::iterator vit = virtualAliasNames.begin();
         while (vit != virtualAliasNames.end()) {
             if (vit->second == ep) {
                 String alias = vit->first.c_str();
                 virtualAliasNames.erase(vit++);
+                removed = true;
                 if (aliasNames.find(alias) == aliasNames.end()) {
-                    lock.Unlock(MUTEX_CONTEXT);
-                    CallListeners(alias, &epName, NULL);
-                    lock.Lock(MUTEX_CONTEXT);
-                    vit = virtualAliasNames.upper_bound(alias);
+                    lostAliases.push_back(alias);
                 }
             } else {
                 ++vit;
             }
         }
+        if (removed) {
+            old = Publish();
+        }
     }
     lock.Unlock(MUTEX_CONTEXT);
+    Reclaim(old);
+
+    for (vector<String>::const_iterator it = lostAliases.begin(); it != lostAliases.end(); ++it) {
+        CallListeners(*it, &epName, NULL);
+    }
 }
 
 bool NameTable::SetVirtualAlias(const qcc::String& alias,
@@ -447,11 +652,13 @@ bool NameTable::SetVirtualAlias(const qcc::String& alias,
         madeChange = true;
         virtualAliasNames.erase(StringMapKey(alias));
     }
+    const Snapshot* old = madeChange ? Publish() : NULL;
 
     String oldName = oldOwner->IsValid() ? oldOwner->GetUniqueName() : "";
     String newName = newOwner ? (*newOwner)->GetUniqueName() : "";
 
     lock.Unlock(MUTEX_CONTEXT);
+    Reclaim(old);
 
     /* Virtual aliases cannot override locally requested aliases */
     if (madeChange && !maskingLocalName) {
@@ -27,6 +27,7 @@
 #include <deque>
 #include <vector>
 #include <set>
+#include <string.h>
 
 #include <qcc/Mutex.h>
 #include <qcc/Environ.h>
@@ -50,6 +51,13 @@ class NameListener;
  * bus names and the BusEndpoint that these names exist on.
  * This mapping is many (names) to one (endpoint). Every endpoint has
  * exactly one unique name and zero or more well-known names.
+ *
+ * The table is read on every routed message but rarely changes. Lookups through FindEndpoint()
+ * read an immutable snapshot of the resolved names without taking the table lock. Every change
+ * to the table publishes a new snapshot. After the table lock is released the old snapshot is
+ * freed once the readers that might be using it have finished. Readers announce themselves in
+ * one of several reader counts, each on its own cache line, so lookups on different threads do
+ * not contend for the same memory.
  */
 class NameTable {
   public:
@@ -67,7 +75,12 @@ class NameTable {
     /**
      * Constructor
      */
-    NameTable() : uniqueId(0), uniquePrefix(":1.") { }
+    NameTable();
+
+    /**
+     * Destructor
+     */
+    ~NameTable();
 
     /**
      * Set the GUID of the bus.
@@ -171,12 +184,22 @@ class NameTable {
     void RemoveVirtualAliases(const qcc::String& uniqueName);
 
     /**
-     * Find an endpoint for a given unique or alias bus name.
+     * Find an endpoint for a given unique or alias bus name. This method does not take the table
+     * lock.
      *
      * @param busName   Name of bus.
      * @return  Returns the endpoint if it was found or an invalid endpoint if not found
      */
-    BusEndpoint FindEndpoint(const qcc::String& busName) const;
+    BusEndpoint FindEndpoint(const qcc::String& busName) const { return FindEndpoint(busName.c_str()); }
+
+    /**
+     * Find an endpoint for a given unique or alias bus name. This method does not take the table
+     * lock or allocate memory.
+     *
+     * @param busName   Name of bus.
+     * @return  Returns the endpoint if it was found or an invalid endpoint if not found
+     */
+    BusEndpoint FindEndpoint(const char* busName) const;
 
     /**
      * Get all bus names from name table.
@@ -231,6 +254,99 @@ class NameTable {
         }
     };
 
+    typedef std::unordered_map<qcc::String, std::deque<NameQueueEntry>, Hash, Equal> AliasMap;
+
+    /**
+     * Hash functor for names held as C strings
+     */
+    struct CStrHash {
+        inline size_t operator()(const char* s) const {
+            return qcc::hash_string(s);
+        }
+    };
+
+    struct CStrEqual {
+        inline bool operator()(const char* s1, const char* s2) const {
+            return (s1 == s2) || (strcmp(s1, s2) == 0);
+        }
+    };
+
+    /**
+     * Minimum number of slots in the table of unique names, the number of slots is a power of 2
+     */
+    static const size_t MIN_UNIQUE_SLOTS = 16;
+
+    /**
+     * Entry in the open addressed table of unique names
+     */
+    struct UniqueSlot {
+        UniqueSlot() : used(false), handle(0) { }
+        bool used;              /**< true if the slot holds an endpoint */
+        uint64_t handle;        /**< Numeric handle decoded from the unique name */
+        BusEndpoint ep;         /**< The endpoint */
+    };
+
+    /**
+     * Immutable mapping of every bus name to the endpoint FindEndpoint() returns for it. Unique
+     * names are found by the numeric handle decoded from the name, all other names by string.
+     */
+    struct Snapshot {
+        std::vector<UniqueSlot> unique;     /**< Unique names, the size is a power of 2 */
+        std::deque<qcc::String> keys;       /**< Storage for the keys of aliases */
+        std::unordered_map<const char*, BusEndpoint, CStrHash, CStrEqual> aliases;  /**< Well-known names */
+
+        /**
+         * Find the endpoint for a unique name.
+         *
+         * @param handle  Handle decoded from the unique name.
+         * @param name    The unique name.
+         * @return  Returns the endpoint if it was found or an invalid endpoint if not found
+         */
+        BusEndpoint FindUnique(uint64_t handle, const char* name) const;
+
+        /**
+         * Add a unique name, the slot table must already be large enough.
+         *
+         * @param handle  Handle decoded from the unique name.
+         * @param ep      The endpoint.
+         */
+        void AddUnique(uint64_t handle, const BusEndpoint& ep);
+    };
+
+    /**
+     * Number of bits of the index of the reader count a FindEndpoint() call uses
+     */
+    static const uint32_t READER_SLOT_BITS = 5;
+
+    /**
+     * Number of reader counts for each phase
+     */
+    static const size_t NUM_READER_SLOTS = 1 << READER_SLOT_BITS;
+
+    /**
+     * Size of a cache line
+     */
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    /**
+     * Count of FindEndpoint() calls in progress padded to fill a cache line
+     */
+    struct ReaderSlot {
+        volatile int32_t count;                             /**< Number of calls in progress */
+        uint8_t pad[CACHE_LINE_SIZE - sizeof(int32_t)];     /**< Keeps other counts off this cache line */
+    };
+
+    /**
+     * Decode a unique name of the form :<prefix>.<counter> (see GenerateUniqueName()) into a
+     * numeric handle. Two unique names may have the same handle so a match on the handle must be
+     * confirmed by comparing the names.
+     *
+     * @param name     The bus name.
+     * @param handle   [OUT] The handle.
+     * @return  true if the name is a well formed unique name.
+     */
+    static bool GetUniqueHandle(const char* name, uint64_t& handle);
+
     mutable qcc::Mutex lock;                                             /**< Lock protecting name tables */
     std::unordered_map<qcc::String, BusEndpoint, Hash, Equal> uniqueNames;   /**< Unique name table */
     std::unordered_map<qcc::String, std::deque<NameQueueEntry>, Hash, Equal> aliasNames;  /**< Alias name table */
@@ -241,6 +357,49 @@ class NameTable {
     std::set<ProtectedNameListener> listeners;                         /**< Listeners regsitered with name table */
     std::map<qcc::StringMapKey, VirtualEndpoint> virtualAliasNames;    /**< map of virtual aliases to virtual endpts */
 
+    const Snapshot* volatile snapshot;           /**< The current snapshot */
+    uint8_t* readerBuf;                          /**< Storage for the reader counts */
+    ReaderSlot* readerSlots;                     /**< NUM_READER_SLOTS reader counts for each of the two phases */
+    volatile int32_t phase;                      /**< Selects the reader counts new FindEndpoint() calls use */
+    qcc::Mutex reclaimLock;                      /**< Serializes waiting for readers of old snapshots */
+
+    /**
+     * Find an endpoint in the name tables. Must be called with the lock held.
+     *
+     * @param busName   Name of bus.
+     * @return  Returns the endpoint if it was found or an invalid endpoint if not found
+     */
+    BusEndpoint Lookup(const qcc::String& busName) const;
+
+    /**
+     * Build a new snapshot from the name tables and make it current. Must be called with the lock
+     * held after every change to the name tables and before the lock is released.
+     *
+     * @return  The old snapshot, this must be passed to Reclaim() after the lock is released.
+     */
+    const Snapshot* Publish();
+
+    /**
+     * Wait for the FindEndpoint() calls that might be using an old snapshot to finish and free it.
+     * Must be called without the lock held.
+     *
+     * @param old   The snapshot returned by Publish() or NULL.
+     */
+    void Reclaim(const Snapshot* old);
+
+    /**
+     * Remove the primary owner of a well-known name, the name passes to the next owner in the
+     * queue or to a virtual alias. Must be called with the lock held.
+     *
+     * @param it        The well-known name, the entry is erased if there is no queued owner.
+     * @param newOwner  [OUT] Unique name of the new owner or empty if none.
+     */
+    void RemovePrimaryOwner(AliasMap::iterator it, qcc::String& newOwner);
+
+    /* Copying the name table is not supported */
+    NameTable(const NameTable& other);
+    NameTable& operator=(const NameTable& other);
+
     /**
      * Helper used to call the listners
      *
@@ -21,13 +21,17 @@
  ******************************************************************************/
 #include <qcc/platform.h>
 
+#include <algorithm>
+#include <cctype>
 #include <cstring>
 
 #include "RuleTable.h"
 
 #include <qcc/Debug.h>
 #include <qcc/String.h>
+#include <qcc/StringUtil.h>
 #include <alljoyn/Message.h>
+#include <alljoyn/MsgTraits.h>
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -91,9 +95,29 @@ Rule::Rule(const char* ruleSpec, QStatus* outStatus) : type(MESSAGE_INVALID), se
         } else if (0 == strncmp("sessionless", pos, 11)) {
             sessionless = ((begQuotePos[0] == 't') || (begQuotePos[0] == 'T')) ? SESSIONLESS_TRUE : SESSIONLESS_FALSE;
         } else if (0 == strncmp("arg", pos, 3)) {
-            status = ER_NOT_IMPLEMENTED;
-            QCC_LogError(status, ("arg keys are not supported in ruleSpec \"%s\"", ruleSpec));
-            break;
+            /*
+             * Key is argN or argNpath where N is 0 to 63
+             */
+            const char* keyEnd = eqPos - 1;
+            const char* numPos = pos + 3;
+            uint32_t argN = 0;
+            while ((numPos < keyEnd) && isdigit(*numPos) && (argN <= MAX_ARG_INDEX)) {
+                argN = (argN * 10) + (*numPos++ - '0');
+            }
+            if ((numPos == pos + 3) || (argN > MAX_ARG_INDEX)) {
+                status = ER_FAIL;
+                QCC_LogError(status, ("Invalid arg index in ruleSpec \"%s\"", ruleSpec));
+                break;
+            }
+            if (numPos == keyEnd) {
+                args[argN] = qcc::String(begQuotePos, endQuotePos - begQuotePos);
+            } else if (((keyEnd - numPos) == 4) && (0 == strncmp("path", numPos, 4))) {
+                pathArgs[argN] = qcc::String(begQuotePos, endQuotePos - begQuotePos);
+            } else {
+                status = ER_FAIL;
+                QCC_LogError(status, ("Invalid arg key in ruleSpec \"%s\"", ruleSpec));
+                break;
+            }
         } else {
             status = ER_FAIL;
             QCC_LogError(status, ("Invalid key in ruleSpec \"%s\"", ruleSpec));
@@ -106,7 +130,118 @@ Rule::Rule(const char* ruleSpec, QStatus* outStatus) : type(MESSAGE_INVALID), se
     }
 }
 
+/*
+ * Path matching as defined for argNpath in the DBus specification: the values are equal or one
+ * ends with a '/' and is a prefix of the other. An empty path does not end with a '/' so it only
+ * matches another empty path.
+ */
+static bool PathMatch(const qcc::String& rulePath, const char* argPath)
+{
+    size_t ruleLen = rulePath.size();
+    size_t argLen = strlen(argPath);
+    if ((ruleLen == 0) || (argLen == 0)) {
+        return ruleLen == argLen;
+    } else if (ruleLen == argLen) {
+        return strcmp(rulePath.c_str(), argPath) == 0;
+    } else if (ruleLen < argLen) {
+        return (rulePath[ruleLen - 1] == '/') && (strncmp(rulePath.c_str(), argPath, ruleLen) == 0);
+    } else {
+        return (argPath[argLen - 1] == '/') && (strncmp(rulePath.c_str(), argPath, argLen) == 0);
+    }
+}
+
+void MatchRuleArgs::Parse()
+{
+    parsed = true;
+    /*
+     * The daemon cannot see the arguments of an encrypted message
+     */
+    if (msg->IsEncrypted()) {
+        opaque = true;
+        return;
+    }
+    const char* sig = msg->GetSignature();
+    if (msg->bodyPtr) {
+        bool endianSwap = ((_Message::MessageHeader*)msg->msgBuf)->endian != _Message::myEndian;
+        MsgReader reader(msg->bodyPtr, msg->msgHeader.bodyLen, endianSwap);
+        while ((*sig == ALLJOYN_STRING) || (*sig == ALLJOYN_OBJECT_PATH)) {
+            const char* str;
+            size_t len;
+            if (reader.ReadString(str, len) != ER_OK) {
+                /*
+                 * A malformed body is not parsed any further
+                 */
+                complete = true;
+                return;
+            }
+            values.push_back(str);
+            types.push_back(*sig++);
+        }
+    }
+    complete = (*sig == 0);
+}
+
+void MatchRuleArgs::ParseAll()
+{
+    complete = true;
+    /*
+     * Clone the message since the message may also be unmarshaled by the local endpoint and
+     * unmarshaling is not thread-safe.
+     */
+    Message clone = Message(msg, true);
+    QStatus status = clone->UnmarshalArgs("*");
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to unmarshal args for arg match"));
+        return;
+    }
+    size_t numArgs;
+    const MsgArg* msgArgs;
+    clone->GetArgs(numArgs, msgArgs);
+    values.clear();
+    types.clear();
+    /*
+     * Reserve space so the copied values are not reallocated
+     */
+    copies.reserve(numArgs);
+    for (size_t i = 0; i < numArgs; ++i) {
+        if (msgArgs[i].typeId == ALLJOYN_STRING) {
+            copies.push_back(qcc::String(msgArgs[i].v_string.str, msgArgs[i].v_string.len));
+            values.push_back(copies.back().c_str());
+        } else if (msgArgs[i].typeId == ALLJOYN_OBJECT_PATH) {
+            copies.push_back(qcc::String(msgArgs[i].v_objPath.str, msgArgs[i].v_objPath.len));
+            values.push_back(copies.back().c_str());
+        } else {
+            values.push_back(NULL);
+        }
+        types.push_back((char)msgArgs[i].typeId);
+    }
+}
+
+const char* MatchRuleArgs::Get(uint32_t argN, char& typeId)
+{
+    if (!parsed) {
+        Parse();
+    }
+    if (opaque) {
+        return NULL;
+    }
+    if ((argN >= values.size()) && !complete) {
+        ParseAll();
+    }
+    if (argN >= values.size()) {
+        return NULL;
+    }
+    typeId = types[argN];
+    return values[argN];
+}
+
 bool Rule::IsMatch(const Message& msg)
+{
+    MatchRuleArgs msgArgs(msg);
+    return IsMatch(msg, msgArgs);
+}
+
+bool Rule::IsMatch(const Message& msg, MatchRuleArgs& msgArgs)
 {
     /* The fields of a rule (if specified) are logically anded together */
     if ((type != MESSAGE_INVALID) && (type != msg->GetType())) {
@@ -132,20 +267,250 @@ bool Rule::IsMatch(const Message& msg)
         return false;
     }
 
-    // @@ TODO Arg matches are not handled
+    if (args.empty() && pathArgs.empty()) {
+        return true;
+    }
+    /*
+     * Arg matches cannot be checked for encrypted messages so the receiver gets the message and
+     * filters it.
+     */
+    if (msgArgs.IsOpaque()) {
+        return true;
+    }
+    char typeId;
+    for (std::map<uint32_t, qcc::String>::const_iterator it = args.begin(); it != args.end(); ++it) {
+        const char* val = msgArgs.Get(it->first, typeId);
+        if (!val || (typeId != ALLJOYN_STRING) || (it->second != val)) {
+            return false;
+        }
+    }
+    for (std::map<uint32_t, qcc::String>::const_iterator it = pathArgs.begin(); it != pathArgs.end(); ++it) {
+        const char* val = msgArgs.Get(it->first, typeId);
+        if (!val || !PathMatch(it->second, val)) {
+            return false;
+        }
+    }
     return true;
 }
 
 qcc::String Rule::ToString() const
 {
-    return "s:" + sender + " i:" + iface + " m:" + member + " p:" + path + " d:" + destination;
+    qcc::String str = "s:" + sender + " i:" + iface + " m:" + member + " p:" + path + " d:" + destination;
+    for (std::map<uint32_t, qcc::String>::const_iterator it = args.begin(); it != args.end(); ++it) {
+        str += " arg" + U32ToString(it->first) + ":" + it->second;
+    }
+    for (std::map<uint32_t, qcc::String>::const_iterator it = pathArgs.begin(); it != pathArgs.end(); ++it) {
+        str += " arg" + U32ToString(it->first) + "path:" + it->second;
+    }
+    return str;
+}
+
+RuleTable::~RuleTable()
+{
+    for (InterfaceIndex::iterator iit = index.begin(); iit != index.end(); ++iit) {
+        for (MemberIndex::iterator mit = iit->second->members.begin(); mit != iit->second->members.end(); ++mit) {
+            for (Arg0Index::iterator ait = mit->second->arg0Rules.begin(); ait != mit->second->arg0Rules.end(); ++ait) {
+                delete ait->second;
+            }
+            delete mit->second;
+        }
+        delete iit->second;
+    }
+}
+
+void RuleTable::IndexRule(RuleIterator it)
+{
+    const Rule& rule = it->second;
+    interest.Add(rule.iface.c_str(), rule.member.c_str());
+    InterfaceIndex::iterator iit = index.find(rule.iface.c_str());
+    InterfaceRules* ifaceRules;
+    if (iit == index.end()) {
+        ifaceRules = new InterfaceRules(rule.iface);
+        index[ifaceRules->iface.c_str()] = ifaceRules;
+    } else {
+        ifaceRules = iit->second;
+    }
+    MemberIndex::iterator mit = ifaceRules->members.find(rule.member.c_str());
+    MemberRules* memberRules;
+    if (mit == ifaceRules->members.end()) {
+        memberRules = new MemberRules(rule.member);
+        ifaceRules->members[memberRules->member.c_str()] = memberRules;
+    } else {
+        memberRules = mit->second;
+    }
+    std::map<uint32_t, qcc::String>::const_iterator arg0 = rule.args.find(0);
+    if (arg0 == rule.args.end()) {
+        memberRules->rules.push_back(it);
+    } else {
+        Arg0Index::iterator ait = memberRules->arg0Rules.find(arg0->second.c_str());
+        Arg0Rules* arg0Rules;
+        if (ait == memberRules->arg0Rules.end()) {
+            arg0Rules = new Arg0Rules(arg0->second);
+            memberRules->arg0Rules[arg0Rules->arg0.c_str()] = arg0Rules;
+        } else {
+            arg0Rules = ait->second;
+        }
+        arg0Rules->rules.push_back(it);
+    }
+}
+
+/*
+ * Remove a rule from a list of rules, returns true if the list is now empty.
+ */
+static bool RemoveFromBucket(std::vector<RuleIterator>& bucket, RuleIterator it)
+{
+    for (size_t i = 0; i < bucket.size(); ++i) {
+        if (bucket[i] == it) {
+            bucket[i] = bucket.back();
+            bucket.pop_back();
+            break;
+        }
+    }
+    return bucket.empty();
+}
+
+void RuleTable::UnindexRule(RuleIterator it)
+{
+    const Rule& rule = it->second;
+    interest.Remove(rule.iface.c_str(), rule.member.c_str());
+    InterfaceIndex::iterator iit = index.find(rule.iface.c_str());
+    if (iit == index.end()) {
+        return;
+    }
+    InterfaceRules* ifaceRules = iit->second;
+    MemberIndex::iterator mit = ifaceRules->members.find(rule.member.c_str());
+    if (mit == ifaceRules->members.end()) {
+        return;
+    }
+    MemberRules* memberRules = mit->second;
+    std::map<uint32_t, qcc::String>::const_iterator arg0 = rule.args.find(0);
+    if (arg0 == rule.args.end()) {
+        RemoveFromBucket(memberRules->rules, it);
+    } else {
+        Arg0Index::iterator ait = memberRules->arg0Rules.find(arg0->second.c_str());
+        if ((ait != memberRules->arg0Rules.end()) && RemoveFromBucket(ait->second->rules, it)) {
+            delete ait->second;
+            memberRules->arg0Rules.erase(ait);
+        }
+    }
+    /*
+     * Free the buckets when the last rule is removed so the index does not grow with churn
+     */
+    if (memberRules->rules.empty() && memberRules->arg0Rules.empty()) {
+        ifaceRules->members.erase(mit);
+        delete memberRules;
+        if (ifaceRules->members.empty()) {
+            index.erase(iit);
+            delete ifaceRules;
+        }
+    }
+}
+
+void RuleTable::MatchRules(const char* iface, const char* member, const Message& msg, MatchRuleArgs& msgArgs, std::vector<BusEndpoint>& endpoints)
+{
+    InterfaceIndex::iterator iit = index.find(iface);
+    if (iit == index.end()) {
+        return;
+    }
+    MemberIndex::iterator mit = iit->second->members.find(member);
+    if (mit == iit->second->members.end()) {
+        return;
+    }
+    MemberRules* memberRules = mit->second;
+    for (size_t i = 0; i < memberRules->rules.size(); ++i) {
+        if (memberRules->rules[i]->second.IsMatch(msg, msgArgs)) {
+            endpoints.push_back(memberRules->rules[i]->first);
+        }
+    }
+    if (memberRules->arg0Rules.empty()) {
+        return;
+    }
+    /*
+     * Only the rules for the message's arg0 value are evaluated unless the arguments are
+     * encrypted in which case all the rules match.
+     */
+    if (msgArgs.IsOpaque()) {
+        for (Arg0Index::iterator ait = memberRules->arg0Rules.begin(); ait != memberRules->arg0Rules.end(); ++ait) {
+            for (size_t i = 0; i < ait->second->rules.size(); ++i) {
+                if (ait->second->rules[i]->second.IsMatch(msg, msgArgs)) {
+                    endpoints.push_back(ait->second->rules[i]->first);
+                }
+            }
+        }
+        return;
+    }
+    char typeId;
+    const char* arg0 = msgArgs.Get(0, typeId);
+    if (arg0 && (typeId == ALLJOYN_STRING)) {
+        Arg0Index::iterator ait = memberRules->arg0Rules.find(arg0);
+        if (ait != memberRules->arg0Rules.end()) {
+            for (size_t i = 0; i < ait->second->rules.size(); ++i) {
+                if (ait->second->rules[i]->second.IsMatch(msg, msgArgs)) {
+                    endpoints.push_back(ait->second->rules[i]->first);
+                }
+            }
+        }
+    }
+}
+
+void RuleTable::GetMatchingEndpoints(const Message& msg, std::vector<BusEndpoint>& endpoints)
+{
+    const char* iface = msg->GetInterface();
+    const char* member = msg->GetMemberName();
+    MatchRuleArgs msgArgs(msg);
+
+    endpoints.clear();
+    /*
+     * Rules that specify the interface and/or member are only evaluated if the message has the
+     * same interface and/or member. Rules that specify neither are always evaluated.
+     */
+    if (*iface) {
+        if (*member) {
+            MatchRules(iface, member, msg, msgArgs, endpoints);
+        }
+        MatchRules(iface, "", msg, msgArgs, endpoints);
+    }
+    if (*member) {
+        MatchRules("", member, msg, msgArgs, endpoints);
+    }
+    MatchRules("", "", msg, msgArgs, endpoints);
+    /*
+     * An endpoint may have more than one matching rule but only gets one copy of the message.
+     * The rule table is keyed by endpoint so sorting puts the endpoints in rule table order.
+     */
+    if (endpoints.size() > 1) {
+        std::sort(endpoints.begin(), endpoints.end());
+        endpoints.erase(std::unique(endpoints.begin(), endpoints.end()), endpoints.end());
+    }
+}
+
+size_t RuleTable::GetIndexSize() const
+{
+    size_t size = index.size();
+    for (InterfaceIndex::const_iterator iit = index.begin(); iit != index.end(); ++iit) {
+        size += iit->second->members.size();
+        for (MemberIndex::const_iterator mit = iit->second->members.begin(); mit != iit->second->members.end(); ++mit) {
+            size += mit->second->arg0Rules.size();
+        }
+    }
+    return size;
+}
+
+bool RuleTable::GetInterestChanges(InterestSummary& summary, std::vector<uint16_t>& toggled)
+{
+    Lock();
+    bool changed = interest.TakeChanges(toggled);
+    summary = interest.GetSummary();
+    Unlock();
+    return changed;
 }
 
 QStatus RuleTable::AddRule(BusEndpoint& endpoint, const Rule& rule)
 {
     QCC_DbgPrintf(("AddRule for endpoint %s\n  %s", endpoint->GetUniqueName().c_str(), rule.ToString().c_str()));
     Lock();
-    rules.insert(std::pair<BusEndpoint, Rule>(endpoint, rule));
+    RuleIterator it = rules.insert(std::pair<BusEndpoint, Rule>(endpoint, rule));
+    IndexRule(it);
     Unlock();
     return ER_OK;
 }
@@ -158,6 +523,7 @@ QStatus RuleTable::RemoveRule(BusEndpoint& endpoint, Rule& rule)
     std::pair<RuleIterator, RuleIterator> range = rules.equal_range(endpoint);
     while (range.first != range.second) {
         if (range.first->second == rule) {
+            UnindexRule(range.first);
             rules.erase(range.first);
             break;
         }
@@ -172,6 +538,9 @@ QStatus RuleTable::RemoveAllRules(BusEndpoint& endpoint)
     Lock();
     std::pair<RuleIterator, RuleIterator> range = rules.equal_range(endpoint);
     if (range.first != rules.end()) {
+        for (RuleIterator it = range.first; it != range.second; ++it) {
+            UnindexRule(it);
+        }
         rules.erase(range.first, range.second);
     }
     Unlock();
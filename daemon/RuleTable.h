@@ -27,18 +27,82 @@
 #include <qcc/platform.h>
 
 #include <map>
+#include <vector>
+#include <string.h>
 
 #include <qcc/String.h>
 #include <qcc/Mutex.h>
+#include <qcc/STLContainer.h>
 
 #include <alljoyn/Message.h>
 
 #include "BusEndpoint.h"
+#include "InterestSummary.h"
 
 #include <alljoyn/Status.h>
 
 namespace ajn {
 
+/**
+ * The string arguments of a message that are compared against the argN and argNpath keys of match
+ * rules. The arguments are unmarshaled the first time they are needed and only once for all the
+ * rules a message is matched against. A message is not cloned or fully unmarshaled unless a rule
+ * refers to an argument that follows an argument that is not a string.
+ */
+class MatchRuleArgs {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param msg  The message whose arguments are matched.
+     */
+    MatchRuleArgs(const Message& msg) : msg(msg), parsed(false), complete(false), opaque(false) { }
+
+    /**
+     * Test if the arguments cannot be inspected because the message body is encrypted.
+     *
+     * @return  true if the message body is encrypted.
+     */
+    bool IsOpaque() {
+        if (!parsed) {
+            Parse();
+        }
+        return opaque;
+    }
+
+    /**
+     * Get a string or object path argument.
+     *
+     * @param argN    The index of the argument.
+     * @param typeId  Returns the type of the argument, ALLJOYN_STRING or ALLJOYN_OBJECT_PATH.
+     *
+     * @return  The argument value or NULL if the message has no such argument or the argument is
+     *          not a string or object path.
+     */
+    const char* Get(uint32_t argN, char& typeId);
+
+  private:
+
+    /**
+     * Unmarshal the leading string arguments directly from the message body.
+     */
+    void Parse();
+
+    /**
+     * Unmarshal all the arguments from a clone of the message.
+     */
+    void ParseAll();
+
+    const Message& msg;                /**< The message */
+    bool parsed;                       /**< True if Parse() has been called */
+    bool complete;                     /**< True if all the message arguments have been parsed */
+    bool opaque;                       /**< True if the message body is encrypted */
+    std::vector<const char*> values;   /**< String values or NULL for arguments that are not strings */
+    qcc::String types;                 /**< Type of each argument */
+    std::vector<qcc::String> copies;   /**< Values copied from a fully unmarshaled clone of the message */
+};
+
 /**
  * Rule defines a message bus routing rule.
  */
@@ -65,17 +129,24 @@ struct Rule {
     /** true iff Rule specifies a filter for sessionless signals */
     enum {SESSIONLESS_NOT_SPECIFIED, SESSIONLESS_FALSE, SESSIONLESS_TRUE} sessionless;
 
-    /** Map of argument matches */
-    // @@ TODO
+    /** Map of argN string argument matches keyed by argument index */
+    std::map<uint32_t, qcc::String> args;
+
+    /** Map of argNpath argument matches keyed by argument index */
+    std::map<uint32_t, qcc::String> pathArgs;
+
+    /** Largest argument index allowed in an arg match */
+    static const uint32_t MAX_ARG_INDEX = 63;
 
     /** Equality comparison */
     bool operator==(const Rule& o) const {
         return (type == o.type) && (sender == o.sender) && (iface == o.iface) &&
-               (member == o.member) && (path == o.path) && (destination == o.destination);
+               (member == o.member) && (path == o.path) && (destination == o.destination) &&
+               (args == o.args) && (pathArgs == o.pathArgs);
     }
 
     /** Constructor */
-    Rule() : type(MESSAGE_INVALID) { }
+    Rule() : type(MESSAGE_INVALID), sessionless(SESSIONLESS_NOT_SPECIFIED) { }
 
     /**
      * Construct a rule from a rule string.
@@ -84,6 +155,7 @@ struct Rule {
      *                  This format of this string is specified in the DBUS spec.
      *                  AllJoyn has added the following additional parameters:
      *                     sessionless  - Valid values are "true" and "false"
+     *                  The argN and argNpath keys are supported for N from 0 to 63.
      *
      * @param status    ER_OK if ruleStr was successfully parsed.
      */
@@ -97,6 +169,16 @@ struct Rule {
      */
     bool IsMatch(const Message& msg);
 
+    /**
+     * Return true if messages matches rule.
+     *
+     * @param msg      Message to compare with rule.
+     * @param msgArgs  Arguments of msg for evaluating arg matches, these are shared by all the
+     *                 rules msg is compared with.
+     * @return  true if this rule matches the message.
+     */
+    bool IsMatch(const Message& msg, MatchRuleArgs& msgArgs);
+
     /**
      * String representation of a rule
      */
@@ -115,6 +197,16 @@ typedef std::multimap<BusEndpoint, Rule>::iterator RuleIterator;
 class RuleTable {
   public:
 
+    /**
+     * Constructor
+     */
+    RuleTable() { }
+
+    /**
+     * Destructor
+     */
+    ~RuleTable();
+
     /**
      * Add a rule for an endpoint.
      *
@@ -202,9 +294,119 @@ class RuleTable {
         return ret;
     }
 
+    /**
+     * Get the endpoints that have at least one rule matching a message. Only the rules indexed
+     * under the message's interface and member, or that do not specify one or both of these, are
+     * evaluated. Each endpoint appears once in the result. The endpoints are sorted with the
+     * same ordering as the keys of the rule table so they are in the order in which iterating
+     * over the rule table would first reach them.
+     * Caller should obtain lock before calling this method.
+     *
+     * @param msg        The message to match.
+     * @param endpoints  Returns the endpoints with a matching rule.
+     */
+    void GetMatchingEndpoints(const Message& msg, std::vector<BusEndpoint>& endpoints);
+
+    /**
+     * Get the summary of the interfaces and members the rules refer to and the bits of the
+     * summary that changed since this method was last called.
+     *
+     * @param summary  Returns the current summary.
+     * @param toggled  Returns the bits that changed.
+     *
+     * @return  true if the summary may have changed.
+     */
+    bool GetInterestChanges(InterestSummary& summary, std::vector<uint16_t>& toggled);
+
+    /**
+     * Returns the number of interface, member and arg0 buckets in the rule index. Used by unit
+     * tests.
+     * Caller should obtain lock before calling this method.
+     *
+     * @return  The number of buckets.
+     */
+    size_t GetIndexSize() const;
+
   private:
+
+    /**
+     * Copy constructor is undefined.
+     */
+    RuleTable(const RuleTable& other);
+
+    /**
+     * Assignment operator is undefined.
+     */
+    RuleTable& operator=(const RuleTable& other);
+
+    /**
+     * Hash functor
+     */
+    struct Hash {
+        inline size_t operator()(const char* s) const {
+            return qcc::hash_string(s);
+        }
+    };
+
+    /**
+     * Equality functor
+     */
+    struct StrEq { bool operator()(const char* s1, const char* s2) const { return (s1 == s2) || (strcmp(s1, s2) == 0); } };
+
+    /**
+     * Rules with the same arg0 string match.
+     */
+    struct Arg0Rules {
+        Arg0Rules(const qcc::String& arg0) : arg0(arg0) { }
+        qcc::String arg0;                  /**< The arg0 value, this is also the key in the arg0 index */
+        std::vector<RuleIterator> rules;   /**< The rules */
+    };
+
+    typedef std::unordered_map<const char*, Arg0Rules*, Hash, StrEq> Arg0Index;
+
+    /**
+     * Rules for one member name. An empty member holds the rules that match any member.
+     */
+    struct MemberRules {
+        MemberRules(const qcc::String& member) : member(member) { }
+        qcc::String member;                /**< The member name, this is also the key in the member index */
+        std::vector<RuleIterator> rules;   /**< The rules without an arg0 string match */
+        Arg0Index arg0Rules;               /**< The rules with an arg0 string match indexed by arg0 */
+    };
+
+    typedef std::unordered_map<const char*, MemberRules*, Hash, StrEq> MemberIndex;
+
+    /**
+     * Index of rules for one interface name. An empty interface holds the rules that match any
+     * interface.
+     */
+    struct InterfaceRules {
+        InterfaceRules(const qcc::String& iface) : iface(iface) { }
+        qcc::String iface;    /**< The interface name, this is also the key in the interface index */
+        MemberIndex members;  /**< Rules indexed by member name */
+    };
+
+    typedef std::unordered_map<const char*, InterfaceRules*, Hash, StrEq> InterfaceIndex;
+
+    /**
+     * Add a rule to the interface/member index.
+     */
+    void IndexRule(RuleIterator it);
+
+    /**
+     * Remove a rule from the interface/member index.
+     */
+    void UnindexRule(RuleIterator it);
+
+    /**
+     * Evaluate the rules indexed under an interface and member name.
+     */
+    void MatchRules(const char* iface, const char* member, const Message& msg, MatchRuleArgs& msgArgs, std::vector<BusEndpoint>& endpoints);
+
     qcc::Mutex lock;                            /**< Lock protecting rule table */
     std::multimap<BusEndpoint, Rule> rules;    /**< Rule table */
+    InterfaceIndex index;                       /**< Rules indexed by interface and member name */
+    InterestCounter interest;                   /**< Summary of the interfaces and members of the rules */
 };
 
 }
@@ -23,11 +23,13 @@
 #include <qcc/platform.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
+#include <qcc/STLContainer.h>
 
 #include <vector>
 
 #include <alljoyn/Message.h>
 
+#include "DaemonConfig.h"
 #include "VirtualEndpoint.h"
 #include "EndpointHelper.h"
 
@@ -43,7 +45,8 @@ namespace ajn {
 _VirtualEndpoint::_VirtualEndpoint(const String& uniqueName, RemoteEndpoint& b2bEp) :
     _BusEndpoint(ENDPOINT_TYPE_VIRTUAL),
     m_uniqueName(uniqueName),
-    m_hasRefs(false)
+    m_hasRefs(false),
+    m_loadBalance(DaemonConfig::Access()->Get("property@b2b_load_balancing", "true") == "true")
 {
     m_b2bEndpoints.insert(pair<SessionId, RemoteEndpoint>(0, b2bEp));
 }
@@ -53,12 +56,13 @@ QStatus _VirtualEndpoint::PushMessage(Message& msg)
     return PushMessage(msg, msg->GetSessionId());
 }
 
-QStatus _VirtualEndpoint::PushMessage(Message& msg, SessionId id)
+QStatus _VirtualEndpoint::PushMessage(Message& msg, SessionId id, bool noWait)
 {
     QCC_DbgTrace(("_VirtualEndpoint::PushMessage(this=%s [%x], SessionId=%u)", GetUniqueName().c_str(), this, id));
 
     QStatus status = ER_BUS_NO_ROUTE;
     vector<RemoteEndpoint> tryEndpoints;
+    size_t flow = NUM_FLOWS;
 
     /*
      * There may be multiple routes from this virtual endpoint so we are going to try all of
@@ -71,18 +75,89 @@ QStatus _VirtualEndpoint::PushMessage(Message& msg, SessionId id)
         tryEndpoints.push_back(ep);
         ++it;
     }
+    if ((id == 0) && (tryEndpoints.size() > 1)) {
+        flow = SelectBusToBusEndpoint(msg, tryEndpoints);
+    }
     m_b2bEndpointsLock.Unlock(MUTEX_CONTEXT);
+
+    if (flow != NUM_FLOWS) {
+        /*
+         * Falling back to another link could deliver this message ahead of earlier ones from the
+         * same sender so that is only done if the flow's link is going away. The flow then moves to
+         * the link that took the message.
+         */
+        status = noWait ? tryEndpoints[0]->PushMessageNoWait(msg) : tryEndpoints[0]->PushMessage(msg);
+        if ((status == ER_BUS_ENDPOINT_CLOSING) || (status == ER_BUS_NO_ENDPOINT)) {
+            QStatus linkStatus = status;
+            for (size_t i = 1; i < tryEndpoints.size(); ++i) {
+                status = noWait ? tryEndpoints[i]->PushMessageNoWait(msg) : tryEndpoints[i]->PushMessage(msg);
+                if (status == ER_OK) {
+                    QCC_LogError(linkStatus, ("Flow from %s to %s moved from %s to %s, earlier messages may arrive out of order",
+                                              msg->GetSender(), GetUniqueName().c_str(),
+                                              tryEndpoints[0]->GetUniqueName().c_str(), tryEndpoints[i]->GetUniqueName().c_str()));
+                    m_b2bEndpointsLock.Lock(MUTEX_CONTEXT);
+                    if (m_flows[flow] == tryEndpoints[0]) {
+                        m_flows[flow] = tryEndpoints[i];
+                    }
+                    m_b2bEndpointsLock.Unlock(MUTEX_CONTEXT);
+                    break;
+                }
+            }
+        }
+        return status;
+    }
     /*
      * We got the candidates so now try them all.
      */
     for (vector<RemoteEndpoint>::iterator iter = tryEndpoints.begin(); iter != tryEndpoints.end(); ++iter) {
         if (status != ER_OK) {
-            status = (*iter)->PushMessage(msg);
+            status = noWait ? (*iter)->PushMessageNoWait(msg) : (*iter)->PushMessage(msg);
         }
     }
     return status;
 }
 
+size_t _VirtualEndpoint::SelectBusToBusEndpoint(Message& msg, vector<RemoteEndpoint>& candidates)
+{
+    if (!m_loadBalance) {
+        return NUM_FLOWS;
+    }
+
+    const size_t slot = hash_string(msg->GetSender()) & (NUM_FLOWS - 1);
+    size_t chosen = candidates.size();
+
+    if (m_flows.empty()) {
+        m_flows.resize(NUM_FLOWS);
+    }
+    /*
+     * There is no way to know when messages written to a link have been delivered by the daemon at
+     * the other end so a flow stays on its link for as long as that link can route for it.
+     */
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (candidates[i] == m_flows[slot]) {
+            chosen = i;
+            break;
+        }
+    }
+    if (chosen == candidates.size()) {
+        size_t fewest = 0;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            size_t bytes = candidates[i]->GetTxQueueBytes();
+            if ((i == 0) || (bytes < fewest)) {
+                fewest = bytes;
+                chosen = i;
+            }
+        }
+        m_flows[slot] = candidates[chosen];
+    }
+
+    if (chosen != 0) {
+        RemoteEndpoint ep = candidates[chosen];
+        candidates[chosen] = candidates[0];
+        candidates[0] = ep;
+    }
+}
+
 RemoteEndpoint _VirtualEndpoint::GetBusToBusEndpoint(SessionId sessionId, int* b2bCount) const
 {
     RemoteEndpoint ret;
@@ -155,6 +230,12 @@ bool _VirtualEndpoint::RemoveBusToBusEndpoint(RemoteEndpoint& endpoint)
             ++it;
         }
     }
+    /* Don't keep the endpoint alive just because a flow last used it */
+    for (size_t i = 0; i < m_flows.size(); ++i) {
+        if (m_flows[i] == endpoint) {
+            m_flows[i] = RemoteEndpoint();
+        }
+    }
 
     /*
      * This Virtual endpoint reports itself as empty (of b2b endpoints) when any of the following are true:
@@ -23,6 +23,9 @@
 #define _ALLJOYN_VIRTUALENDPOINT_H
 
 #include <qcc/platform.h>
+
+#include <vector>
+
 #include <qcc/ManagedObj.h>
 #include <qcc/String.h>
 
@@ -53,7 +56,7 @@ class _VirtualEndpoint : public _BusEndpoint {
     /**
      * Default constructor initializes an invalid endpoint. This allows for the declaration of uninitialized VirtualEndpoint variables.
      */
-    _VirtualEndpoint() { }
+    _VirtualEndpoint() : m_hasRefs(false), m_loadBalance(false) { }
 
     /**
      * Constructor
@@ -77,13 +80,15 @@ class _VirtualEndpoint : public _BusEndpoint {
     /**
      * Send an outgoing message over a specific session.
      *
-     * @param msg   Message to be sent.
-     * @param id    SessionId to use for outgoing message.
+     * @param msg     Message to be sent.
+     * @param id      SessionId to use for outgoing message.
+     * @param noWait  If true use RemoteEndpoint::PushMessageNoWait() so the caller is not
+     *                blocked by a full bus-to-bus transmit queue.
      * @return
      *      - ER_OK if successful.
      *      - An error status otherwise
      */
-    QStatus PushMessage(Message& msg, SessionId id);
+    QStatus PushMessage(Message& msg, SessionId id, bool noWait = false);
 
     /**
      * Get unique bus name.
@@ -227,8 +232,25 @@ class _VirtualEndpoint : public _BusEndpoint {
         SessionOpts opts;     /**< Session options for B2BEndpoint */
         uint32_t hops;        /**< Currently unused hop count from local daemon to final destination */
     };
-    mutable qcc::Mutex m_b2bEndpointsLock;      /**< Lock that protects m_b2bEndpoints */
+    mutable qcc::Mutex m_b2bEndpointsLock;      /**< Lock that protects m_b2bEndpoints and m_flows */
     bool m_hasRefs;
+
+    static const size_t NUM_FLOWS = 64;         /**< Number of sender flows tracked, must be a power of 2 */
+
+    std::vector<RemoteEndpoint> m_flows;        /**< Bus-to-bus endpoint of each flow indexed by a hash of the sender, empty until needed */
+    bool m_loadBalance;                         /**< property@b2b_load_balancing, read when the endpoint is created */
+
+    /**
+     * Choose which of several bus-to-bus endpoints a non-session message should be sent on first.
+     * Messages from a sender stay on the endpoint their flow was given for as long as it can route
+     * for this virtual endpoint so they cannot be reordered. A new flow is given the endpoint with
+     * the fewest queued bytes. Must be called with m_b2bEndpointsLock held.
+     *
+     * @param msg         The message.
+     * @param candidates  [IN/OUT] The bus-to-bus endpoints, the chosen one is moved to the front.
+     * @return  The flow the message belongs to or NUM_FLOWS if load balancing is disabled.
+     */
+    size_t SelectBusToBusEndpoint(Message& msg, std::vector<RemoteEndpoint>& candidates);
 };
 
 }
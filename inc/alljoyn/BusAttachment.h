@@ -167,6 +167,11 @@ class BusAttachment : public MessageReceiver {
      * Allow the currently executing method/signal handler to enable concurrent callbacks
      * during the scope of the handler's execution.
      *
+     * Method and signal handlers are called one at a time in the order the messages were received
+     * unless EnableConcurrentSenders() was called. Once a handler has enabled concurrent callbacks
+     * the next message may be dispatched before the handler returns, this is required if the
+     * handler makes a synchronous method call.
+     *
      * See also these sample file(s): @n
      * basic/basic_client.cc @n
      * basic/nameChange_client.cc @n
@@ -180,6 +185,20 @@ class BusAttachment : public MessageReceiver {
      */
     void EnableConcurrentCallbacks();
 
+    /**
+     * Allow method and signal handlers for messages from different senders to be called
+     * concurrently, up to the concurrency limit passed to the constructor. Handlers for messages
+     * from the same sender are still called one at a time in the order the messages were received.
+     * By default all handlers are called one at a time.
+     *
+     * This must be called before Start().
+     *
+     * @return
+     *      - #ER_OK if successful.
+     *      - #ER_BUS_BUS_ALREADY_STARTED if the bus has already been started.
+     */
+    QStatus EnableConcurrentSenders();
+
     /**
      * Create an interface description with a given name.
      *
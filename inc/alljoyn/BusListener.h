@@ -393,6 +393,17 @@ class BusListener {
      */
     virtual void BusDisconnected() { }
 
+    /**
+     * Called when a BusAttachment this listener is registered with can accept messages again
+     * after a call to BusObject::SignalNoWait() or ProxyBusObject::MethodCallAsyncNoWait()
+     * returned #ER_BUS_WRITE_QUEUE_FULL. This is called once each time the queue drains
+     * after one or more such failures.
+     *
+     * This is called on the thread that writes to the bus so it must not block. Sending more
+     * messages with SignalNoWait() or MethodCallAsyncNoWait() is allowed.
+     */
+    virtual void BusWritable() { }
+
 };
 
 }
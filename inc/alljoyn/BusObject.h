@@ -31,6 +31,7 @@
 #include <qcc/String.h>
 #include <alljoyn/InterfaceDescription.h>
 #include <alljoyn/MsgArg.h>
+#include <alljoyn/MsgTraits.h>
 #include <alljoyn/MessageReceiver.h>
 #include <alljoyn/Session.h>
 #include <alljoyn/Status.h>
@@ -247,6 +248,94 @@ class BusObject : public MessageReceiver {
                    uint8_t flags = 0,
                    Message* msg = NULL);
 
+    /**
+     * Send a signal with arguments marshaled directly from C++ variables. See MsgTraits.h for the
+     * supported types.
+     *
+     * @code
+     *     std::vector<int32_t> samples;
+     *     qcc::String label;
+     *     status = Signal(NULL, sessionId, *sampleSignal, MakeTypedArgs(samples, label));
+     * @endcode
+     *
+     * @param destination      The unique or well-known bus name or the signal recipient (NULL for broadcast signals)
+     * @param sessionId        The session this message is for.
+     * @param signal           Interface member of signal being emitted.
+     * @param args             The arguments for the signal, the types must match the signature of the signal.
+     * @param timeToLive       If non-zero this specifies the useful lifetime for this signal. See Signal() above.
+     * @param flags            Logical OR of the message flags for this signal. See Signal() above.
+     * @param msg              [OUT] If non-null, the sent signal message is returned to the caller.
+     * @return
+     *      - #ER_OK if successful
+     *      - #ER_BUS_OBJECT_NOT_REGISTERED if bus object has not yet been registered
+     *      - #ER_BUS_UNEXPECTED_SIGNATURE if the argument types do not match the signal signature
+     *      - An error status otherwise
+     */
+    QStatus Signal(const char* destination,
+                   SessionId sessionId,
+                   const InterfaceDescription::Member& signal,
+                   const TypedArgsWriter& args,
+                   uint16_t timeToLive = 0,
+                   uint8_t flags = 0,
+                   Message* msg = NULL);
+
+    /**
+     * Send a signal without waiting for room in the queue to the bus. Signal() blocks the
+     * calling thread while the connection to the bus is congested. This method returns
+     * #ER_BUS_WRITE_QUEUE_FULL instead, and BusListener::BusWritable() is called when the
+     * signal can be retried. This lets an application apply backpressure without a thread per
+     * blocked sender.
+     *
+     * When the bus attachment uses a bundled daemon there is no queue to the bus and this
+     * method behaves like Signal().
+     *
+     * @param destination      The unique or well-known bus name or the signal recipient (NULL for broadcast signals)
+     * @param sessionId        The session this message is for.
+     * @param signal           Interface member of signal being emitted.
+     * @param args             The arguments for the signal (can be NULL)
+     * @param numArgs          The number of arguments
+     * @param timeToLive       If non-zero this specifies the useful lifetime for this signal. See Signal() above.
+     * @param flags            Logical OR of the message flags for this signal. See Signal() above.
+     * @param msg              [OUT] If non-null, the sent signal message is returned to the caller.
+     * @return
+     *      - #ER_OK if successful
+     *      - #ER_BUS_WRITE_QUEUE_FULL if the signal was not sent because the queue is full
+     *      - #ER_BUS_OBJECT_NOT_REGISTERED if bus object has not yet been registered
+     *      - An error status otherwise
+     */
+    QStatus SignalNoWait(const char* destination,
+                         SessionId sessionId,
+                         const InterfaceDescription::Member& signal,
+                         const MsgArg* args = NULL,
+                         size_t numArgs = 0,
+                         uint16_t timeToLive = 0,
+                         uint8_t flags = 0,
+                         Message* msg = NULL);
+
+    /**
+     * Send a signal with typed arguments without waiting for room in the queue to the bus. See
+     * SignalNoWait() above.
+     *
+     * @param destination      The unique or well-known bus name or the signal recipient (NULL for broadcast signals)
+     * @param sessionId        The session this message is for.
+     * @param signal           Interface member of signal being emitted.
+     * @param args             The arguments for the signal, the types must match the signature of the signal.
+     * @param timeToLive       If non-zero this specifies the useful lifetime for this signal. See Signal() above.
+     * @param flags            Logical OR of the message flags for this signal. See Signal() above.
+     * @param msg              [OUT] If non-null, the sent signal message is returned to the caller.
+     * @return
+     *      - #ER_OK if successful
+     *      - #ER_BUS_WRITE_QUEUE_FULL if the signal was not sent because the queue is full
+     *      - An error status otherwise
+     */
+    QStatus SignalNoWait(const char* destination,
+                         SessionId sessionId,
+                         const InterfaceDescription::Member& signal,
+                         const TypedArgsWriter& args,
+                         uint16_t timeToLive = 0,
+                         uint8_t flags = 0,
+                         Message* msg = NULL);
+
     /**
      * Remove sessionless message sent from this object from local daemon's
      * store/forward cache.
@@ -307,6 +396,20 @@ class BusObject : public MessageReceiver {
      */
     QStatus MethodReply(const Message& msg, const MsgArg* args = NULL, size_t numArgs = 0);
 
+    /**
+     * Reply to a method call with arguments marshaled directly from C++ variables. See
+     * MsgTraits.h for the supported types.
+     *
+     * @param msg      The method call message
+     * @param args     The reply arguments, the types must match the reply signature of the method.
+     * @return
+     *      - #ER_OK if successful
+     *      - #ER_BUS_OBJECT_NOT_REGISTERED if bus object has not yet been registered
+     *      - #ER_BUS_UNEXPECTED_SIGNATURE if the argument types do not match the reply signature
+     *      - An error status otherwise
+     */
+    QStatus MethodReply(const Message& msg, const TypedArgsWriter& args);
+
     /**
      * Reply to a method call with an error message.
      *
@@ -618,6 +721,25 @@ class BusObject : public MessageReceiver {
      */
     void InstallMethods(MethodTable& methodTable);
 
+    /**
+     * Send a signal with either MsgArg or typed arguments.
+     */
+    QStatus EmitSignal(const char* destination,
+                       SessionId sessionId,
+                       const InterfaceDescription::Member& signal,
+                       const MsgArg* args,
+                       size_t numArgs,
+                       const TypedArgsWriter* typedArgs,
+                       uint16_t timeToLive,
+                       uint8_t flags,
+                       Message* msg,
+                       bool noWait);
+
+    /**
+     * Reply to a method call with either MsgArg or typed arguments.
+     */
+    QStatus SendMethodReply(const Message& msg, const MsgArg* args, size_t numArgs, const TypedArgsWriter* typedArgs);
+
     /**
      * This utility method is called by the bus during object registration.
      * Do not call this object explicitly.
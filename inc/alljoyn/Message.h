@@ -110,6 +110,24 @@ typedef enum {
     MESSAGE_COMPLETE
 }AllJoynMessageState;
 
+/**
+ * @cond ALLJOYN_DEV
+ * @internal
+ * Write state for a message that is being written to an endpoint. The write state is kept by the
+ * endpoint rather than by the message so a single marshaled message can be queued on many
+ * endpoints at once without being copied.
+ */
+class MessageWriteState {
+  public:
+    AllJoynMessageState state;  ///< The current state of the message during write.
+    const uint8_t* writePtr;    ///< Pointer to the current write position in the message buffer.
+    size_t countWrite;          ///< Number of bytes remaining to write for completion of the message.
+
+    /** Constructor */
+    MessageWriteState() : state(MESSAGE_NEW), writePtr(NULL), countWrite(0) { }
+};
+/// @endcond
+
 
 /** AllJoyn header fields */
 class HeaderFields {
@@ -157,6 +175,12 @@ class HeaderFields {
 class _Message;
 class _RemoteEndpoint;
 class BusAttachment;
+class MsgArgArena;
+class SharedArgs;
+class SignaturePlan;
+class MsgWriter;
+class TypedArgsWriter;
+class TypedArgsReader;
 
 /**
  * @cond ALLJOYN_DEV
@@ -186,9 +210,12 @@ class _Message {
     friend class _LocalEndpoint;
     friend class _NullEndpoint;
     friend class DaemonRouter;
+    friend class ClientRouter;
     friend class AllJoynObj;
     friend class DeferredMsg;
     friend class AllJoynPeerObj;
+    friend class MsgWriter;
+    friend class MatchRuleArgs;
 
   public:
     /**
@@ -342,6 +369,25 @@ class _Message {
      */
     QStatus GetArgs(const char* signature, ...);
 
+    /**
+     * Unmarshal the arguments for this message directly into C++ variables. The arguments are read
+     * from the message body so this does not depend on the MsgArg representation of the arguments.
+     * See MsgTraits.h for the supported types.
+     *
+     * @code
+     *     std::vector<int32_t> samples;
+     *     qcc::String label;
+     *     status = msg->GetArgs(TieTypedArgs(samples, label));
+     * @endcode
+     *
+     * @param args  The variables to unmarshal the arguments into.
+     * @return
+     *      - #ER_OK if successful.
+     *      - #ER_BUS_SIGNATURE_MISMATCH if the message signature does not match the variable types.
+     *      - An error status if the message body is not valid.
+     */
+    QStatus GetArgs(const TypedArgsReader& args);
+
     /**
      * Accessor function to get serial number for the message. Usually only important for
      * #MESSAGE_METHOD_CALL for matching up the reply to the call.
@@ -619,7 +665,8 @@ class _Message {
     }
 
     /**
-     * Copy constructor.
+     * Copy constructor. If the arguments of the other message are shared the copy shares them and
+     * the message buffer, otherwise the copy is a deep copy.
      *
      * @param other   The other message to copy.
      */
@@ -638,11 +685,12 @@ class _Message {
      * @param call        The call message - can be this message.
      * @param args        The arguments for the reply (can be NULL)
      * @param numArgs     The number of arguments
+     * @param typedArgs   Typed arguments to marshal instead of args (can be NULL)
      * @return
      *      - #ER_OK if successful
      *      - An error status otherwise
      */
-    QStatus ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs);
+    QStatus ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs, const TypedArgsWriter* typedArgs = NULL);
 
     /**
      * @internal
@@ -731,6 +779,7 @@ class _Message {
      * @param flags       A logical OR of the AllJoyn flags.
      * @param timeToLive  Time-to-live. Units are seconds for sessionless signals. Milliseconds for non-sessionless signals.
      *                    Signals that cannot be sent within this time limit are discarded. Zero indicates reliable delivery.
+     * @param typedArgs   Typed arguments to marshal instead of args (can be NULL)
      * @return
      *      - #ER_OK if successful
      *      - An error status otherwise
@@ -744,7 +793,8 @@ class _Message {
                       const MsgArg* args,
                       size_t numArgs,
                       uint8_t flags,
-                      uint16_t timeToLive);
+                      uint16_t timeToLive,
+                      const TypedArgsWriter* typedArgs = NULL);
 
 
     /**
@@ -820,12 +870,13 @@ class _Message {
      * @internal
      * Deliver a marshaled message to a remote endpoint. Non-blocking
      *
-     * @param endpoint   Endpoint to receive marshaled message.
+     * @param endpoint    Endpoint to receive marshaled message.
+     * @param writeState  The endpoint's write state for this message.
      * @return
      *      - #ER_OK if successful
      *      - An error status otherwise
      */
-    QStatus DeliverNonBlocking(RemoteEndpoint& endpoint);
+    QStatus DeliverNonBlocking(RemoteEndpoint& endpoint, MessageWriteState& writeState);
     /**
      * @internal
      * Marshal the message again with the new sender name if one was provided.
@@ -837,9 +888,58 @@ class _Message {
      */
     QStatus ReMarshal(const char* senderName = NULL);
 
+    /**
+     * @internal
+     * Test if some header fields were skipped because the message was unmarshaled for cut-through
+     * forwarding.
+     *
+     * @return  true if ParseDeferredHeaderFields() must be called before the message is delivered
+     *          locally or modified.
+     */
+    bool HasDeferredHeaderFields() const { return hasDeferredFields; }
+
+    /**
+     * @internal
+     * Parse the header fields that were skipped when the message was unmarshaled for cut-through
+     * forwarding and perform the header checks that were skipped.
+     *
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus ParseDeferredHeaderFields();
+
+    /**
+     * @internal
+     * Check that the header fields that were skipped when the message was unmarshaled for
+     * cut-through forwarding are well formed without parsing them into the message. This is
+     * called before a message is forwarded to another daemon as it is.
+     *
+     * @return
+     *      - #ER_OK if the deferred header fields are valid
+     *      - An error status otherwise
+     */
+    QStatus CheckDeferredHeaderFields();
+
+    /**
+     * @internal
+     * Unmarshal the arguments into a SharedArgs so copies of this message share the arguments and
+     * the message buffer instead of copying and unmarshaling the message again. Encrypted and
+     * compressed messages cannot share their arguments because each receiver must decrypt or
+     * expand them. Messages that carry handles cannot share their arguments because the
+     * unmarshaled handles belong to this message. This must not be called while other threads may
+     * be reading the arguments of the message.
+     *
+     * @return
+     *      - #ER_OK if the arguments are shared
+     *      - An error status otherwise
+     */
+    QStatus ShareArgs();
+
     /**
      * @internal
      * Sets the serial number to the next available value for the bus attachment for this message.
+     * A message that shares its buffer is remarshaled into a private buffer first.
      */
     void SetSerialNumber();
 
@@ -929,6 +1029,8 @@ class _Message {
     uint64_t* msgBuf;            ///< Pointer to the current msg buffer (8 byte aligned pointer into _msgBuf).
     MsgArg* msgArgs;             ///< Pointer to the unmarshaled arguments.
     uint8_t numMsgArgs;          ///< Number of message args (signature cannot be longer than 255 chars).
+    MsgArgArena* argArena;       ///< Arena the unmarshaled arguments are allocated from.
+    SharedArgs* sharedArgs;      ///< Unmarshaled arguments shared with other messages, msgArgs points into these if set.
 
     size_t bufSize;              ///< The current allocated size of the msg buffer.
     uint8_t* bufEOD;             ///< End of data currently in buffer.
@@ -953,23 +1055,30 @@ class _Message {
     size_t countRead;               ///< Number of bytes remaining to read for completion of the message.
     size_t maxFds;                  ///< Store the number of max FDs for the endpoint, so it doesnt need to be calculated each time.
 
-    AllJoynMessageState writeState; ///< The current state of the message during write.
-    uint8_t* writePtr;              ///< Pointer to the current write position in the buffer.
-    size_t countWrite;              ///< Number of bytes remaining to write for completion of the message.
-
     /**
      * The header fields for this message. Which header fields are present depends on the message
      * type defined in the message header.
      */
     HeaderFields hdrFields;
 
+    /**
+     * Offsets into the message buffer of header fields that were skipped when the header was
+     * unmarshaled for cut-through forwarding, 0 if the field was not skipped.
+     */
+    uint32_t deferredFields[ALLJOYN_HDR_FIELD_UNKNOWN];
+    bool hasDeferredFields;         ///< True if any header fields have not been parsed yet.
+
+    bool hasDispatchKeys;           ///< True if memberKey and pathKey are valid for the header fields.
+    uint64_t memberKey;             ///< Key for looking up handlers by interface and member.
+    uint64_t pathKey;               ///< Key for looking up handlers by object path.
+
     /* Internal methods unmarshal side */
 
     void ClearHeader();
-    QStatus ParseValue(MsgArg* arg, const char*& sigPtr, bool arrayElem = false);
-    QStatus ParseStruct(MsgArg* arg, const char*& sigPtr);
-    QStatus ParseDictEntry(MsgArg* arg, const char*& sigPtr);
-    QStatus ParseArray(MsgArg* arg, const char*& sigPtr);
+    QStatus ParseValue(MsgArg* arg, const SignaturePlan& plan, size_t op);
+    QStatus ParseStruct(MsgArg* arg, const SignaturePlan& plan, size_t op);
+    QStatus ParseDictEntry(MsgArg* arg, const SignaturePlan& plan, size_t op);
+    QStatus ParseArray(MsgArg* arg, const SignaturePlan& plan, size_t op);
     QStatus ParseSignature(MsgArg* arg);
     QStatus ParseVariant(MsgArg* arg);
 
@@ -985,6 +1094,54 @@ class _Message {
      */
     QStatus HeaderChecks(bool pedantic);
 
+    /**
+     * @internal
+     * Test if a header field is present, either parsed or deferred for cut-through forwarding.
+     *
+     * @param fieldId  The header field.
+     *
+     * @return  true if the field is present in the message.
+     */
+    bool HasHeaderField(AllJoynFieldType fieldId) const {
+        return (hdrFields.field[fieldId].typeId != ALLJOYN_INVALID) || (deferredFields[fieldId] != 0);
+    }
+
+    /**
+     * Compute the keys used to look up the method or signal handlers for this message from the
+     * interface, member and object path header fields.
+     */
+    void ComputeDispatchKeys();
+
+    /**
+     * Release the unmarshaled arguments.
+     */
+    void ClearArgs();
+
+    /**
+     * Get the key for looking up handlers by interface and member. The key is normally computed
+     * when the header is marshaled or unmarshaled.
+     *
+     * @return  The member key.
+     */
+    uint64_t GetMemberKey() {
+        if (!hasDispatchKeys) {
+            ComputeDispatchKeys();
+        }
+        return memberKey;
+    }
+
+    /**
+     * Get the key for looking up handlers by object path.
+     *
+     * @return  The path key.
+     */
+    uint64_t GetPathKey() {
+        if (!hasDispatchKeys) {
+            ComputeDispatchKeys();
+        }
+        return pathKey;
+    }
+
     /* Internal methods marshal side */
 
     QStatus EncryptMessage();
@@ -995,9 +1152,11 @@ class _Message {
                            const MsgArg* args,
                            uint8_t numArgs,
                            uint8_t flags,
-                           SessionId sessionId);
+                           SessionId sessionId,
+                           const TypedArgsWriter* typedArgs = NULL);
 
-    QStatus MarshalArgs(const MsgArg* arg, size_t numArgs);
+    QStatus MarshalValue(const MsgArg* arg, const SignaturePlan& plan, size_t op);
+    void GrowBuffer(size_t needed);
     void MarshalHeaderFields();
     size_t ComputeHeaderLen();
 
@@ -1010,6 +1169,18 @@ class _Message {
     /* Internal methods for read */
     inline QStatus InterpretHeader();
     QStatus PullBytes(RemoteEndpoint& endpoint, bool checkSender, bool pedantic = true, uint32_t timeout = 0);
+
+    /**
+     * Load message bytes that have already been read from the endpoint into memory. This is used
+     * by endpoints that read many messages in a single read to carve out the individual messages.
+     *
+     * @param data   [IN/OUT] Pointer to the buffered data, advanced past the bytes consumed.
+     * @param avail  [IN/OUT] Number of bytes available, decremented by the bytes consumed.
+     * @return
+     *      - #ER_OK if successful (check readState to find out if the message is complete)
+     *      - An error status otherwise
+     */
+    QStatus LoadBytes(const uint8_t*& data, size_t& avail);
 };
 
 }
@@ -115,6 +115,7 @@ typedef struct {
 class AllJoynArray {
 
     friend class MsgArg;
+    friend class MsgArgArena;
     friend class SignatureUtils;
     friend class _Message;
 
@@ -0,0 +1,784 @@
+#ifndef _ALLJOYN_MSGTRAITS_H
+#define _ALLJOYN_MSGTRAITS_H
+/**
+ * @file
+ * This file defines templates for marshaling and unmarshaling message arguments directly from and
+ * to C++ types without going through MsgArg.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include MsgTraits.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <string.h>
+
+#include <qcc/String.h>
+
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/Status.h>
+
+namespace ajn {
+
+class _Message;
+
+/**
+ * Writes marshaled values directly into the body of a message that is being marshaled. Values
+ * are written in the endianness of the message.
+ */
+class MsgWriter {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param msg  The message being marshaled.
+     */
+    MsgWriter(_Message& msg) : msg(msg), status(ER_OK) { }
+
+    /**
+     * Write a 1, 2, 4 or 8 byte value aligned on its size.
+     *
+     * @param val  The value to write.
+     */
+    void Write1(uint8_t val);
+    void Write2(uint16_t val);    /**< @copydoc Write1 */
+    void Write4(uint32_t val);    /**< @copydoc Write1 */
+    void Write8(uint64_t val);    /**< @copydoc Write1 */
+
+    /**
+     * Write a string.
+     *
+     * @param str  The string, this does not need to be NUL terminated.
+     * @param len  The length of the string.
+     */
+    void WriteString(const char* str, size_t len);
+
+    /**
+     * Write padding up to an alignment boundary.
+     *
+     * @param alignment  The alignment, this must be 1, 2, 4 or 8.
+     */
+    void Align(size_t alignment);
+
+    /**
+     * Start an array by writing a placeholder for the array length and the padding before the first
+     * element.
+     *
+     * @param elemAlignment  Alignment of the array elements.
+     *
+     * @return  The position of the array length to pass to EndArray().
+     */
+    size_t BeginArray(size_t elemAlignment);
+
+    /**
+     * Finish an array by patching in the array length.
+     *
+     * @param lenPos         The position returned by BeginArray().
+     * @param elemAlignment  Alignment of the array elements.
+     */
+    void EndArray(size_t lenPos, size_t elemAlignment);
+
+    /**
+     * Write an array of fixed size scalars in a single copy. The scalars are converted to the
+     * message endianness if required.
+     *
+     * @param elems        The array elements in native endianness.
+     * @param numElements  The number of elements.
+     * @param elemSize     The size of each element, this must be 1, 2, 4 or 8.
+     */
+    void WriteScalarArray(const void* elems, size_t numElements, size_t elemSize);
+
+    /**
+     * Get the status of the values written so far.
+     *
+     * @return  ER_OK or the first error encountered.
+     */
+    QStatus GetStatus() const { return status; }
+
+  private:
+
+    /**
+     * Assignment operator is undefined.
+     */
+    MsgWriter& operator=(const MsgWriter& other);
+
+    _Message& msg;   /**< The message being marshaled */
+    QStatus status;  /**< Status of the values written so far */
+};
+
+/**
+ * Reads marshaled values directly from the body of a received message.
+ */
+class MsgReader {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param body        The marshaled message body, this must be 8 byte aligned.
+     * @param len         The length of the message body.
+     * @param endianSwap  true if the body is not in native endianness.
+     */
+    MsgReader(const uint8_t* body, size_t len, bool endianSwap) : body(body), len(len), pos(0), endianSwap(endianSwap) { }
+
+    /**
+     * Read a 1, 2, 4 or 8 byte value aligned on its size.
+     *
+     * @param val  Returns the value.
+     *
+     * @return
+     *      - ER_OK if the value was read.
+     *      - ER_BUS_BAD_LENGTH if the value extends past the end of the body.
+     */
+    QStatus Read1(uint8_t& val);
+    QStatus Read2(uint16_t& val);    /**< @copydoc Read1 */
+    QStatus Read4(uint32_t& val);    /**< @copydoc Read1 */
+    QStatus Read8(uint64_t& val);    /**< @copydoc Read1 */
+
+    /**
+     * Read a boolean.
+     *
+     * @param val  Returns the value.
+     *
+     * @return
+     *      - ER_OK if the value was read.
+     *      - ER_BUS_BAD_VALUE if the marshaled value is not 0 or 1.
+     *      - ER_BUS_BAD_LENGTH if the value extends past the end of the body.
+     */
+    QStatus ReadBool(bool& val);
+
+    /**
+     * Read a string.
+     *
+     * @param str  Returns a pointer to the NUL terminated string in the message body.
+     * @param len  Returns the length of the string.
+     *
+     * @return
+     *      - ER_OK if the string was read.
+     *      - ER_BUS_NOT_NUL_TERMINATED if the string is not NUL terminated.
+     *      - ER_BUS_BAD_LENGTH if the string extends past the end of the body.
+     */
+    QStatus ReadString(const char*& str, size_t& len);
+
+    /**
+     * Skip padding up to an alignment boundary.
+     *
+     * @param alignment  The alignment, this must be 1, 2, 4 or 8.
+     *
+     * @return
+     *      - ER_OK if the padding was skipped.
+     *      - ER_BUS_BAD_LENGTH if the padding extends past the end of the body.
+     */
+    QStatus Align(size_t alignment);
+
+    /**
+     * Start reading an array.
+     *
+     * @param elemAlignment  Alignment of the array elements.
+     * @param end            Returns the position of the end of the array.
+     *
+     * @return
+     *      - ER_OK if the array is valid.
+     *      - ER_BUS_BAD_LENGTH if the array is too long or extends past the end of the body.
+     */
+    QStatus BeginArray(size_t elemAlignment, size_t& end);
+
+    /**
+     * Test if there are more elements in an array.
+     *
+     * @param end  The end position returned by BeginArray().
+     *
+     * @return  true if the end of the array has not been reached.
+     */
+    bool InArray(size_t end) const { return pos < end; }
+
+    /**
+     * Finish reading an array.
+     *
+     * @param end  The end position returned by BeginArray().
+     *
+     * @return
+     *      - ER_OK if the last element ended exactly at the end of the array.
+     *      - ER_BUS_BAD_LENGTH otherwise.
+     */
+    QStatus EndArray(size_t end) const { return (pos == end) ? ER_OK : ER_BUS_BAD_LENGTH; }
+
+    /**
+     * Read an array of fixed size scalars.
+     *
+     * @param elemSize     The size of each element, this must be 1, 2, 4 or 8.
+     * @param elems        Returns a pointer to the marshaled elements in the message body.
+     * @param numElements  Returns the number of elements.
+     *
+     * @return
+     *      - ER_OK if the array was read.
+     *      - ER_BUS_BAD_LENGTH if the array length is not a multiple of the element size or
+     *        the array extends past the end of the body.
+     */
+    QStatus ReadScalarArray(size_t elemSize, const void*& elems, size_t& numElements);
+
+    /**
+     * Copy scalars returned by ReadScalarArray() converting them to native endianness if required.
+     *
+     * @param dest         The destination for the scalars.
+     * @param elems        The marshaled elements.
+     * @param numElements  The number of elements.
+     * @param elemSize     The size of each element, this must be 1, 2, 4 or 8.
+     */
+    void CopyScalars(void* dest, const void* elems, size_t numElements, size_t elemSize) const;
+
+  private:
+
+    const uint8_t* body;  /**< The message body */
+    size_t len;           /**< Length of the message body */
+    size_t pos;           /**< Current read position in the body */
+    bool endianSwap;      /**< true if the body is not in native endianness */
+};
+
+/**
+ * Traits describing how a C++ type is marshaled. Specializations provide:
+ *
+ * @code
+ *     enum { ALIGNMENT = <wire alignment>, SCALAR_SIZE = <size if an array can be copied in bulk or 0> };
+ *     static void AppendSignature(qcc::String& sig);
+ *     static void Marshal(MsgWriter& writer, const T& val);
+ *     static QStatus Unmarshal(MsgReader& reader, T& val);
+ * @endcode
+ *
+ * There is no definition for types that have no mapping so these fail to compile. Applications
+ * add mappings for their own structs by deriving a specialization from MsgStructTraits.
+ */
+template <typename T>
+struct MsgTraits;
+
+/**
+ * Placeholder for unused arguments of TypedArgs and TypedArgRefs.
+ */
+struct MsgNone {
+    static MsgNone none;  /**< The placeholder instance */
+};
+
+/// @cond ALLJOYN_DEV
+template <>
+struct MsgTraits<MsgNone> {
+    enum { ALIGNMENT = 1, SCALAR_SIZE = 0 };
+    static void AppendSignature(qcc::String& sig) { }
+    static void Marshal(MsgWriter& writer, const MsgNone& val) { }
+    static QStatus Unmarshal(MsgReader& reader, MsgNone& val) { return ER_OK; }
+};
+
+#define ALLJOYN_SCALAR_MSGTRAITS(T, U, typeId, size) \
+    template <> \
+    struct MsgTraits<T> { \
+        enum { ALIGNMENT = size, SCALAR_SIZE = size }; \
+        static void AppendSignature(qcc::String& sig) { sig.push_back((char)typeId); } \
+        static void Marshal(MsgWriter& writer, const T& val) { writer.Write ## size((U)val); } \
+        static QStatus Unmarshal(MsgReader& reader, T& val) { \
+            U u; \
+            QStatus status = reader.Read ## size(u); \
+            val = (T)u; \
+            return status; \
+        } \
+    }
+
+ALLJOYN_SCALAR_MSGTRAITS(uint8_t, uint8_t, ALLJOYN_BYTE, 1);
+ALLJOYN_SCALAR_MSGTRAITS(int16_t, uint16_t, ALLJOYN_INT16, 2);
+ALLJOYN_SCALAR_MSGTRAITS(uint16_t, uint16_t, ALLJOYN_UINT16, 2);
+ALLJOYN_SCALAR_MSGTRAITS(int32_t, uint32_t, ALLJOYN_INT32, 4);
+ALLJOYN_SCALAR_MSGTRAITS(uint32_t, uint32_t, ALLJOYN_UINT32, 4);
+ALLJOYN_SCALAR_MSGTRAITS(int64_t, uint64_t, ALLJOYN_INT64, 8);
+ALLJOYN_SCALAR_MSGTRAITS(uint64_t, uint64_t, ALLJOYN_UINT64, 8);
+
+#undef ALLJOYN_SCALAR_MSGTRAITS
+
+template <>
+struct MsgTraits<double> {
+    enum { ALIGNMENT = 8, SCALAR_SIZE = 8 };
+    static void AppendSignature(qcc::String& sig) { sig.push_back((char)ALLJOYN_DOUBLE); }
+    static void Marshal(MsgWriter& writer, const double& val) {
+        uint64_t u;
+        memcpy(&u, &val, sizeof(u));
+        writer.Write8(u);
+    }
+    static QStatus Unmarshal(MsgReader& reader, double& val) {
+        uint64_t u;
+        QStatus status = reader.Read8(u);
+        memcpy(&val, &u, sizeof(val));
+        return status;
+    }
+};
+
+/*
+ * Booleans are marshaled as 4 byte values so arrays of booleans cannot be copied in bulk.
+ */
+template <>
+struct MsgTraits<bool> {
+    enum { ALIGNMENT = 4, SCALAR_SIZE = 0 };
+    static void AppendSignature(qcc::String& sig) { sig.push_back((char)ALLJOYN_BOOLEAN); }
+    static void Marshal(MsgWriter& writer, const bool& val) { writer.Write4(val ? 1 : 0); }
+    static QStatus Unmarshal(MsgReader& reader, bool& val) { return reader.ReadBool(val); }
+};
+
+template <>
+struct MsgTraits<qcc::String> {
+    enum { ALIGNMENT = 4, SCALAR_SIZE = 0 };
+    static void AppendSignature(qcc::String& sig) { sig.push_back((char)ALLJOYN_STRING); }
+    static void Marshal(MsgWriter& writer, const qcc::String& val) { writer.WriteString(val.data(), val.size()); }
+    static QStatus Unmarshal(MsgReader& reader, qcc::String& val) {
+        const char* str;
+        size_t len;
+        QStatus status = reader.ReadString(str, len);
+        if (status == ER_OK) {
+            val.assign(str, len);
+        }
+        return status;
+    }
+};
+
+template <>
+struct MsgTraits<std::string> {
+    enum { ALIGNMENT = 4, SCALAR_SIZE = 0 };
+    static void AppendSignature(qcc::String& sig) { sig.push_back((char)ALLJOYN_STRING); }
+    static void Marshal(MsgWriter& writer, const std::string& val) { writer.WriteString(val.data(), val.size()); }
+    static QStatus Unmarshal(MsgReader& reader, std::string& val) {
+        const char* str;
+        size_t len;
+        QStatus status = reader.ReadString(str, len);
+        if (status == ER_OK) {
+            val.assign(str, len);
+        }
+        return status;
+    }
+};
+
+/*
+ * Arrays of fixed size scalars are copied in bulk, other arrays are marshaled element by element.
+ */
+template <typename T>
+struct MsgTraits<std::vector<T> > {
+    enum { ALIGNMENT = 4, SCALAR_SIZE = 0 };
+    static void AppendSignature(qcc::String& sig) {
+        sig.push_back((char)ALLJOYN_ARRAY);
+        MsgTraits<T>::AppendSignature(sig);
+    }
+    static void Marshal(MsgWriter& writer, const std::vector<T>& val) {
+        if (MsgTraits<T>::SCALAR_SIZE != 0) {
+            writer.WriteScalarArray(val.empty() ? NULL : &val[0], val.size(), MsgTraits<T>::SCALAR_SIZE);
+        } else {
+            size_t lenPos = writer.BeginArray(MsgTraits<T>::ALIGNMENT);
+            for (typename std::vector<T>::const_iterator it = val.begin(); it != val.end(); ++it) {
+                MsgTraits<T>::Marshal(writer, *it);
+            }
+            writer.EndArray(lenPos, MsgTraits<T>::ALIGNMENT);
+        }
+    }
+    static QStatus Unmarshal(MsgReader& reader, std::vector<T>& val) {
+        QStatus status;
+        val.clear();
+        if (MsgTraits<T>::SCALAR_SIZE != 0) {
+            const void* elems;
+            size_t numElements;
+            status = reader.ReadScalarArray(MsgTraits<T>::SCALAR_SIZE, elems, numElements);
+            if ((status == ER_OK) && numElements) {
+                val.resize(numElements);
+                reader.CopyScalars(&val[0], elems, numElements, MsgTraits<T>::SCALAR_SIZE);
+            }
+        } else {
+            size_t end;
+            status = reader.BeginArray(MsgTraits<T>::ALIGNMENT, end);
+            while ((status == ER_OK) && reader.InArray(end)) {
+                val.push_back(T());
+                status = MsgTraits<T>::Unmarshal(reader, val.back());
+            }
+            if (status == ER_OK) {
+                status = reader.EndArray(end);
+            }
+        }
+        return status;
+    }
+};
+
+/*
+ * std::vector<bool> does not store its elements as an array of bool.
+ */
+template <>
+struct MsgTraits<std::vector<bool> > {
+    enum { ALIGNMENT = 4, SCALAR_SIZE = 0 };
+    static void AppendSignature(qcc::String& sig) {
+        sig.push_back((char)ALLJOYN_ARRAY);
+        sig.push_back((char)ALLJOYN_BOOLEAN);
+    }
+    static void Marshal(MsgWriter& writer, const std::vector<bool>& val) {
+        size_t lenPos = writer.BeginArray(4);
+        for (std::vector<bool>::const_iterator it = val.begin(); it != val.end(); ++it) {
+            writer.Write4(*it ? 1 : 0);
+        }
+        writer.EndArray(lenPos, 4);
+    }
+    static QStatus Unmarshal(MsgReader& reader, std::vector<bool>& val) {
+        size_t end;
+        val.clear();
+        QStatus status = reader.BeginArray(4, end);
+        while ((status == ER_OK) && reader.InArray(end)) {
+            bool b;
+            status = reader.ReadBool(b);
+            val.push_back(b);
+        }
+        return (status == ER_OK) ? reader.EndArray(end) : status;
+    }
+};
+
+/*
+ * Maps are marshaled as arrays of dictionary entries.
+ */
+template <typename K, typename V>
+struct MsgTraits<std::map<K, V> > {
+    enum { ALIGNMENT = 4, SCALAR_SIZE = 0 };
+    static void AppendSignature(qcc::String& sig) {
+        sig.push_back((char)ALLJOYN_ARRAY);
+        sig.push_back((char)ALLJOYN_DICT_ENTRY_OPEN);
+        MsgTraits<K>::AppendSignature(sig);
+        MsgTraits<V>::AppendSignature(sig);
+        sig.push_back((char)ALLJOYN_DICT_ENTRY_CLOSE);
+    }
+    static void Marshal(MsgWriter& writer, const std::map<K, V>& val) {
+        size_t lenPos = writer.BeginArray(8);
+        for (typename std::map<K, V>::const_iterator it = val.begin(); it != val.end(); ++it) {
+            writer.Align(8);
+            MsgTraits<K>::Marshal(writer, it->first);
+            MsgTraits<V>::Marshal(writer, it->second);
+        }
+        writer.EndArray(lenPos, 8);
+    }
+    static QStatus Unmarshal(MsgReader& reader, std::map<K, V>& val) {
+        size_t end;
+        val.clear();
+        QStatus status = reader.BeginArray(8, end);
+        while ((status == ER_OK) && reader.InArray(end)) {
+            K key;
+            status = reader.Align(8);
+            if (status == ER_OK) {
+                status = MsgTraits<K>::Unmarshal(reader, key);
+            }
+            if (status == ER_OK) {
+                status = MsgTraits<V>::Unmarshal(reader, val[key]);
+            }
+        }
+        return (status == ER_OK) ? reader.EndArray(end) : status;
+    }
+};
+
+/*
+ * Functors applied to each member of a struct.
+ */
+struct MsgMemberSignature {
+    MsgMemberSignature(qcc::String& sig) : sig(sig) { }
+    template <typename M> void operator()(M& member) { MsgTraits<M>::AppendSignature(sig); }
+    qcc::String& sig;
+};
+
+struct MsgMemberWriter {
+    MsgMemberWriter(MsgWriter& writer) : writer(writer) { }
+    template <typename M> void operator()(M& member) { MsgTraits<M>::Marshal(writer, member); }
+    MsgWriter& writer;
+};
+
+struct MsgMemberReader {
+    MsgMemberReader(MsgReader& reader) : reader(reader), status(ER_OK) { }
+    template <typename M> void operator()(M& member) {
+        if (status == ER_OK) {
+            status = MsgTraits<M>::Unmarshal(reader, member);
+        }
+    }
+    MsgReader& reader;
+    QStatus status;
+};
+/// @endcond
+
+/**
+ * Base for the MsgTraits specialization of an application struct. The specialization provides a
+ * function that applies a functor to each member in order, for example:
+ *
+ * @code
+ *     struct Point { int32_t x; int32_t y; qcc::String label; };
+ *
+ *     namespace ajn {
+ *     template <> struct MsgTraits<Point> : public MsgStructTraits<Point> {
+ *         template <typename F> static void Members(F& f, Point& p) { f(p.x); f(p.y); f(p.label); }
+ *     };
+ *     }
+ * @endcode
+ *
+ * The struct must be default constructible. Point is marshaled with signature "(iis)".
+ */
+template <typename T>
+struct MsgStructTraits {
+    enum { ALIGNMENT = 8, SCALAR_SIZE = 0 };
+    static void AppendSignature(qcc::String& sig) {
+        T val;
+        MsgMemberSignature f(sig);
+        sig.push_back((char)ALLJOYN_STRUCT_OPEN);
+        MsgTraits<T>::Members(f, val);
+        sig.push_back((char)ALLJOYN_STRUCT_CLOSE);
+    }
+    static void Marshal(MsgWriter& writer, const T& val) {
+        MsgMemberWriter f(writer);
+        writer.Align(8);
+        MsgTraits<T>::Members(f, const_cast<T&>(val));
+    }
+    static QStatus Unmarshal(MsgReader& reader, T& val) {
+        MsgMemberReader f(reader);
+        f.status = reader.Align(8);
+        MsgTraits<T>::Members(f, val);
+        return f.status;
+    }
+};
+
+/**
+ * Message arguments that can marshal themselves.
+ */
+class TypedArgsWriter {
+  public:
+
+    /**
+     * Destructor
+     */
+    virtual ~TypedArgsWriter() { }
+
+    /**
+     * Get the signature of the arguments.
+     *
+     * @return  The signature.
+     */
+    virtual const char* GetSignature() const = 0;
+
+    /**
+     * Marshal the arguments.
+     *
+     * @param writer  The writer for the message body.
+     */
+    virtual void Marshal(MsgWriter& writer) const = 0;
+};
+
+/**
+ * Message arguments that can unmarshal themselves.
+ */
+class TypedArgsReader {
+  public:
+
+    /**
+     * Destructor
+     */
+    virtual ~TypedArgsReader() { }
+
+    /**
+     * Get the signature of the arguments.
+     *
+     * @return  The signature.
+     */
+    virtual const char* GetSignature() const = 0;
+
+    /**
+     * Unmarshal the arguments.
+     *
+     * @param reader  The reader for the message body.
+     *
+     * @return  ER_OK if the arguments were unmarshaled.
+     */
+    virtual QStatus Unmarshal(MsgReader& reader) const = 0;
+};
+
+/// @cond ALLJOYN_DEV
+/*
+ * Get a signature that is built once and kept for the life of the program. Once the slot has been
+ * published it is read without a lock, the signature is only built while holding a lock, so this
+ * is safe to call from any thread.
+ *
+ * @param slot   Pointer to the signature, NULL until the signature has been built.
+ * @param build  Function that builds the signature.
+ *
+ * @return  The signature.
+ */
+const char* GetTypedSignature(const char* volatile& slot, void (*build)(qcc::String& sig));
+
+/*
+ * The signature for a list of argument types. This is built the first time it is needed and kept
+ * for the life of the program.
+ */
+template <typename A1, typename A2, typename A3, typename A4>
+struct TypedSignature {
+    static const char* Get() {
+        return GetTypedSignature(signature, Build);
+    }
+    static void Build(qcc::String& sig) {
+        MsgTraits<A1>::AppendSignature(sig);
+        MsgTraits<A2>::AppendSignature(sig);
+        MsgTraits<A3>::AppendSignature(sig);
+        MsgTraits<A4>::AppendSignature(sig);
+    }
+    static const char* volatile signature;
+};
+
+template <typename A1, typename A2, typename A3, typename A4>
+const char* volatile TypedSignature<A1, A2, A3, A4>::signature = NULL;
+/// @endcond
+
+/**
+ * References to up to four values to marshal as message arguments. Use MakeTypedArgs() to
+ * construct one. The values are not copied so must remain valid until the message has been sent.
+ */
+template <typename A1, typename A2 = MsgNone, typename A3 = MsgNone, typename A4 = MsgNone>
+class TypedArgs : public TypedArgsWriter {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param a1  The first argument.
+     * @param a2  The second argument.
+     * @param a3  The third argument.
+     * @param a4  The fourth argument.
+     */
+    TypedArgs(const A1& a1, const A2& a2 = MsgNone::none, const A3& a3 = MsgNone::none, const A4& a4 = MsgNone::none) :
+        a1(&a1), a2(&a2), a3(&a3), a4(&a4) { }
+
+    const char* GetSignature() const { return TypedSignature<A1, A2, A3, A4>::Get(); }
+
+    void Marshal(MsgWriter& writer) const {
+        MsgTraits<A1>::Marshal(writer, *a1);
+        MsgTraits<A2>::Marshal(writer, *a2);
+        MsgTraits<A3>::Marshal(writer, *a3);
+        MsgTraits<A4>::Marshal(writer, *a4);
+    }
+
+  private:
+    const A1* a1;
+    const A2* a2;
+    const A3* a3;
+    const A4* a4;
+};
+
+/**
+ * References to up to four values to unmarshal message arguments into. Use TieTypedArgs() to
+ * construct one.
+ */
+template <typename A1, typename A2 = MsgNone, typename A3 = MsgNone, typename A4 = MsgNone>
+class TypedArgRefs : public TypedArgsReader {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param a1  Returns the first argument.
+     * @param a2  Returns the second argument.
+     * @param a3  Returns the third argument.
+     * @param a4  Returns the fourth argument.
+     */
+    TypedArgRefs(A1& a1, A2& a2 = MsgNone::none, A3& a3 = MsgNone::none, A4& a4 = MsgNone::none) :
+        a1(&a1), a2(&a2), a3(&a3), a4(&a4) { }
+
+    const char* GetSignature() const { return TypedSignature<A1, A2, A3, A4>::Get(); }
+
+    QStatus Unmarshal(MsgReader& reader) const {
+        QStatus status = MsgTraits<A1>::Unmarshal(reader, *a1);
+        if (status == ER_OK) {
+            status = MsgTraits<A2>::Unmarshal(reader, *a2);
+        }
+        if (status == ER_OK) {
+            status = MsgTraits<A3>::Unmarshal(reader, *a3);
+        }
+        if (status == ER_OK) {
+            status = MsgTraits<A4>::Unmarshal(reader, *a4);
+        }
+        return status;
+    }
+
+  private:
+    A1* a1;
+    A2* a2;
+    A3* a3;
+    A4* a4;
+};
+
+/**
+ * Make a list of arguments to marshal.
+ *
+ * @code
+ *     std::vector<int32_t> samples;
+ *     std::map<qcc::String, uint32_t> counts;
+ *     status = Signal(NULL, sessionId, *sampleSignal, MakeTypedArgs(samples, counts));
+ * @endcode
+ */
+template <typename A1>
+TypedArgs<A1> MakeTypedArgs(const A1& a1) {
+    return TypedArgs<A1>(a1);
+}
+
+template <typename A1, typename A2>
+TypedArgs<A1, A2> MakeTypedArgs(const A1& a1, const A2& a2) {
+    return TypedArgs<A1, A2>(a1, a2);
+}
+
+template <typename A1, typename A2, typename A3>
+TypedArgs<A1, A2, A3> MakeTypedArgs(const A1& a1, const A2& a2, const A3& a3) {
+    return TypedArgs<A1, A2, A3>(a1, a2, a3);
+}
+
+template <typename A1, typename A2, typename A3, typename A4>
+TypedArgs<A1, A2, A3, A4> MakeTypedArgs(const A1& a1, const A2& a2, const A3& a3, const A4& a4) {
+    return TypedArgs<A1, A2, A3, A4>(a1, a2, a3, a4);
+}
+
+/**
+ * Make a list of variables to unmarshal arguments into.
+ *
+ * @code
+ *     std::vector<int32_t> samples;
+ *     std::map<qcc::String, uint32_t> counts;
+ *     status = msg->GetArgs(TieTypedArgs(samples, counts));
+ * @endcode
+ */
+template <typename A1>
+TypedArgRefs<A1> TieTypedArgs(A1& a1) {
+    return TypedArgRefs<A1>(a1);
+}
+
+template <typename A1, typename A2>
+TypedArgRefs<A1, A2> TieTypedArgs(A1& a1, A2& a2) {
+    return TypedArgRefs<A1, A2>(a1, a2);
+}
+
+template <typename A1, typename A2, typename A3>
+TypedArgRefs<A1, A2, A3> TieTypedArgs(A1& a1, A2& a2, A3& a3) {
+    return TypedArgRefs<A1, A2, A3>(a1, a2, a3);
+}
+
+template <typename A1, typename A2, typename A3, typename A4>
+TypedArgRefs<A1, A2, A3, A4> TieTypedArgs(A1& a1, A2& a2, A3& a3, A4& a4) {
+    return TypedArgRefs<A1, A2, A3, A4>(a1, a2, a3, a4);
+}
+
+}
+
+#endif
@@ -831,6 +831,37 @@ class ProxyBusObject : public MessageReceiver {
                             uint32_t timeout = DefaultCallTimeout,
                             uint8_t flags = 0) const;
 
+    /**
+     * Make an asynchronous method call from this object without waiting for room in the queue to
+     * the bus. MethodCallAsync() blocks the calling thread while the connection to the bus is
+     * congested. This method returns #ER_BUS_WRITE_QUEUE_FULL instead and the reply handler is
+     * not called. BusListener::BusWritable() is called when the method call can be retried.
+     *
+     * When the bus attachment uses a bundled daemon there is no queue to the bus and this
+     * method behaves like MethodCallAsync().
+     *
+     * @param method       Method being invoked.
+     * @param receiver     The object to be called when the asych method call completes.
+     * @param replyFunc    The function that is called to deliver the reply
+     * @param args         The arguments for the method call (can be NULL)
+     * @param numArgs      The number of arguments
+     * @param context      User-defined context that will be returned to the reply handler
+     * @param timeout      Timeout specified in milliseconds to wait for a reply
+     * @param flags        Logical OR of the message flags for this method call. See MethodCallAsync() above.
+     * @return
+     *      - ER_OK if successful
+     *      - ER_BUS_WRITE_QUEUE_FULL if the method call was not sent because the queue is full
+     *      - An error status otherwise
+     */
+    QStatus MethodCallAsyncNoWait(const InterfaceDescription::Member& method,
+                                  MessageReceiver* receiver,
+                                  MessageReceiver::ReplyHandler replyFunc,
+                                  const MsgArg* args = NULL,
+                                  size_t numArgs = 0,
+                                  void* context = NULL,
+                                  uint32_t timeout = DefaultCallTimeout,
+                                  uint8_t flags = 0) const;
+
     /**
      * Initialize this proxy object from an XML string. Calling this method does several things:
      *
@@ -922,6 +953,20 @@ class ProxyBusObject : public MessageReceiver {
 
   private:
 
+    /**
+     * @internal
+     * Send an asynchronous method call, optionally without waiting for room in the transmit queue.
+     */
+    QStatus SendMethodCall(const InterfaceDescription::Member& method,
+                           MessageReceiver* receiver,
+                           MessageReceiver::ReplyHandler replyHandler,
+                           const MsgArg* args,
+                           size_t numArgs,
+                           void* context,
+                           uint32_t timeout,
+                           uint8_t flags,
+                           bool noWait) const;
+
     /**
      * @internal
      * Method return handler used to process synchronous method calls.
@@ -109,6 +109,7 @@ QStatus org::alljoyn::CreateInterfaces(BusAttachment& bus)
         ifc->AddSignal("NameChanged",    "sss",    "name,oldOwner,newOwner", 0);
         ifc->AddSignal("ProbeReq",       "",       "",                       0);
         ifc->AddSignal("ProbeAck",       "",       "",                       0);
+        ifc->AddSignal("InterestSummary", "suayaq", "controller,serial,summary,toggled", 0);
         ifc->Activate();
     }
     {
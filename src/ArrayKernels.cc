@@ -0,0 +1,293 @@
+/**
+ * @file
+ *
+ * This file implements the scalar array conversion functions
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <qcc/Util.h>
+
+#include "ArrayKernels.h"
+
+/*
+ * SSE2 is always available on x86-64 and on 32 bit x86 targets built for it. AVX2 is only used if
+ * the compiler can generate it for individual functions and the processor reports support at run
+ * time.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define USE_SSE2_KERNELS 1
+#if defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))
+#define USE_AVX2_KERNELS 1
+#endif
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define USE_SSE2_KERNELS 1
+#endif
+
+#if defined(USE_SSE2_KERNELS)
+#include <emmintrin.h>
+#endif
+#if defined(USE_AVX2_KERNELS)
+#include <immintrin.h>
+#endif
+
+#define QCC_MODULE "ALLJOYN"
+
+namespace ajn {
+
+/*
+ * Marshaled booleans with any bits set other than the low bit of the value are invalid.
+ */
+static const uint32_t BOOL_INVALID_BITS = 0xFFFFFFFE;
+static const uint32_t BOOL_INVALID_BITS_SWAPPED = 0xFEFFFFFF;
+
+static inline void SwapScalar16(uint16_t* dest, const uint16_t* src, size_t num)
+{
+    for (size_t i = 0; i < num; ++i) {
+        dest[i] = EndianSwap16(src[i]);
+    }
+}
+
+static inline void SwapScalar32(uint32_t* dest, const uint32_t* src, size_t num)
+{
+    for (size_t i = 0; i < num; ++i) {
+        dest[i] = EndianSwap32(src[i]);
+    }
+}
+
+static inline void SwapScalar64(uint64_t* dest, const uint64_t* src, size_t num)
+{
+    for (size_t i = 0; i < num; ++i) {
+        dest[i] = EndianSwap64(src[i]);
+    }
+}
+
+static inline bool NarrowScalar(bool* dest, const uint32_t* src, size_t num, bool endianSwap)
+{
+    for (size_t i = 0; i < num; ++i) {
+        uint32_t b = endianSwap ? EndianSwap32(src[i]) : src[i];
+        if (b > 1) {
+            return false;
+        }
+        dest[i] = (b == 1);
+    }
+    return true;
+}
+
+#if defined(USE_AVX2_KERNELS)
+
+static bool DetectAVX2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+static const bool haveAVX2 = DetectAVX2();
+
+/*
+ * Swap bytes within each 16, 32 or 64 bit lane using a byte shuffle. The shuffle works within each
+ * 128 bit half of the register so the same 16 byte pattern is used for both halves.
+ */
+__attribute__((target("avx2")))
+static void SwapAVX2(uint8_t* dest, const uint8_t* src, size_t len, __m128i pattern)
+{
+    const __m256i shuffle = _mm256_broadcastsi128_si256(pattern);
+    for (size_t i = 0; i < len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_shuffle_epi8(v, shuffle));
+    }
+}
+
+__attribute__((target("avx2")))
+static bool NarrowAVX2(bool* dest, const uint32_t* src, size_t num, bool endianSwap)
+{
+    const __m256i invalid = _mm256_set1_epi32(endianSwap ? BOOL_INVALID_BITS_SWAPPED : BOOL_INVALID_BITS);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    __m256i bad = _mm256_setzero_si256();
+    for (size_t i = 0; i < num; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 8));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(src + i + 16));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(src + i + 24));
+        bad = _mm256_or_si256(bad, _mm256_and_si256(_mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d)), invalid));
+        if (endianSwap) {
+            a = _mm256_srli_epi32(a, 24);
+            b = _mm256_srli_epi32(b, 24);
+            c = _mm256_srli_epi32(c, 24);
+            d = _mm256_srli_epi32(d, 24);
+        }
+        /*
+         * The packs operate within 128 bit halves so the result is permuted back into order.
+         */
+        __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_permutevar8x32_epi32(bytes, order));
+    }
+    return _mm256_testz_si256(bad, bad) != 0;
+}
+
+#endif
+
+#if defined(USE_SSE2_KERNELS)
+
+/*
+ * SSE2 has no byte shuffle so bytes are swapped within 16 bit words with shifts, then the words are
+ * reversed within each 32 or 64 bit value.
+ */
+static inline __m128i SwapWordBytes(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static void SwapSSE2_16(uint8_t* dest, const uint8_t* src, size_t len)
+{
+    for (size_t i = 0; i < len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dest + i), SwapWordBytes(v));
+    }
+}
+
+static void SwapSSE2_32(uint8_t* dest, const uint8_t* src, size_t len)
+{
+    for (size_t i = 0; i < len; i += 16) {
+        __m128i v = SwapWordBytes(_mm_loadu_si128((const __m128i*)(src + i)));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i*)(dest + i), v);
+    }
+}
+
+static void SwapSSE2_64(uint8_t* dest, const uint8_t* src, size_t len)
+{
+    for (size_t i = 0; i < len; i += 16) {
+        __m128i v = SwapWordBytes(_mm_loadu_si128((const __m128i*)(src + i)));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        _mm_storeu_si128((__m128i*)(dest + i), v);
+    }
+}
+
+static bool NarrowSSE2(bool* dest, const uint32_t* src, size_t num, bool endianSwap)
+{
+    const __m128i invalid = _mm_set1_epi32(endianSwap ? BOOL_INVALID_BITS_SWAPPED : BOOL_INVALID_BITS);
+    __m128i bad = _mm_setzero_si128();
+    for (size_t i = 0; i < num; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 4));
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i + 8));
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + i + 12));
+        bad = _mm_or_si128(bad, _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), invalid));
+        if (endianSwap) {
+            a = _mm_srli_epi32(a, 24);
+            b = _mm_srli_epi32(b, 24);
+            c = _mm_srli_epi32(c, 24);
+            d = _mm_srli_epi32(d, 24);
+        }
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128((__m128i*)(dest + i), bytes);
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) == 0xFFFF;
+}
+
+#endif
+
+void EndianSwapArray16(void* dest, const void* src, size_t numElements)
+{
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+    size_t done = 0;
+#if defined(USE_AVX2_KERNELS)
+    if (haveAVX2) {
+        done = numElements & ~(size_t)15;
+        SwapAVX2(d, s, done * 2, _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+    }
+#endif
+#if defined(USE_SSE2_KERNELS)
+    size_t sse = numElements & ~(size_t)7;
+    SwapSSE2_16(d + done * 2, s + done * 2, (sse - done) * 2);
+    done = sse;
+#endif
+    SwapScalar16((uint16_t*)d + done, (const uint16_t*)s + done, numElements - done);
+}
+
+void EndianSwapArray32(void* dest, const void* src, size_t numElements)
+{
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+    size_t done = 0;
+#if defined(USE_AVX2_KERNELS)
+    if (haveAVX2) {
+        done = numElements & ~(size_t)7;
+        SwapAVX2(d, s, done * 4, _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+    }
+#endif
+#if defined(USE_SSE2_KERNELS)
+    size_t sse = numElements & ~(size_t)3;
+    SwapSSE2_32(d + done * 4, s + done * 4, (sse - done) * 4);
+    done = sse;
+#endif
+    SwapScalar32((uint32_t*)d + done, (const uint32_t*)s + done, numElements - done);
+}
+
+void EndianSwapArray64(void* dest, const void* src, size_t numElements)
+{
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+    size_t done = 0;
+#if defined(USE_AVX2_KERNELS)
+    if (haveAVX2) {
+        done = numElements & ~(size_t)3;
+        SwapAVX2(d, s, done * 8, _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+    }
+#endif
+#if defined(USE_SSE2_KERNELS)
+    size_t sse = numElements & ~(size_t)1;
+    SwapSSE2_64(d + done * 8, s + done * 8, (sse - done) * 8);
+    done = sse;
+#endif
+    SwapScalar64((uint64_t*)d + done, (const uint64_t*)s + done, numElements - done);
+}
+
+bool NarrowBoolArray(bool* dest, const void* src, size_t numElements, bool endianSwap)
+{
+    const uint32_t* s = (const uint32_t*)src;
+    size_t done = 0;
+    /*
+     * The vector kernels store the narrowed values as bytes.
+     */
+    if (sizeof(bool) == 1) {
+#if defined(USE_AVX2_KERNELS)
+        if (haveAVX2) {
+            done = numElements & ~(size_t)31;
+            if (!NarrowAVX2(dest, s, done, endianSwap)) {
+                return false;
+            }
+        }
+#endif
+#if defined(USE_SSE2_KERNELS)
+        size_t sse = numElements & ~(size_t)15;
+        if (!NarrowSSE2(dest + done, s + done, sse - done, endianSwap)) {
+            return false;
+        }
+        done = sse;
+#endif
+    }
+    return NarrowScalar(dest + done, s + done, numElements - done, endianSwap);
+}
+
+}
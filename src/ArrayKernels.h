@@ -0,0 +1,76 @@
+#ifndef _ALLJOYN_ARRAYKERNELS_H
+#define _ALLJOYN_ARRAYKERNELS_H
+/**
+ * @file
+ *
+ * This file defines functions for converting scalar arrays between the wire format and the native
+ * format. On x86 platforms these use SSE2 and, if the processor supports it, AVX2 instructions.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include ArrayKernels.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * Copy an array of 16 bit values reversing the byte order of each value.
+ *
+ * @param dest         The destination array.
+ * @param src          The source array, this must not overlap the destination.
+ * @param numElements  The number of array elements.
+ */
+void EndianSwapArray16(void* dest, const void* src, size_t numElements);
+
+/**
+ * Copy an array of 32 bit values reversing the byte order of each value.
+ *
+ * @param dest         The destination array.
+ * @param src          The source array, this must not overlap the destination.
+ * @param numElements  The number of array elements.
+ */
+void EndianSwapArray32(void* dest, const void* src, size_t numElements);
+
+/**
+ * Copy an array of 64 bit values reversing the byte order of each value.
+ *
+ * @param dest         The destination array.
+ * @param src          The source array, this must not overlap the destination.
+ * @param numElements  The number of array elements.
+ */
+void EndianSwapArray64(void* dest, const void* src, size_t numElements);
+
+/**
+ * Convert an array of marshaled booleans (32 bit values that must be 0 or 1) to an array of bool.
+ *
+ * @param dest         The destination array.
+ * @param src          The marshaled booleans.
+ * @param numElements  The number of array elements.
+ * @param endianSwap   True if the marshaled booleans are in the opposite byte order to the host.
+ *
+ * @return  true if all of the marshaled values were 0 or 1, false otherwise in which case the
+ *          contents of the destination array are undefined.
+ */
+bool NarrowBoolArray(bool* dest, const void* src, size_t numElements, bool endianSwap);
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef _ALLJOYN_ATOMICPOINTER_H
+#define _ALLJOYN_ATOMICPOINTER_H
+/**
+ * @file
+ *
+ * This file defines functions for publishing a pointer from one thread and reading it from others
+ * without holding a lock.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include AtomicPointer.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+namespace ajn {
+
+/**
+ * Read a pointer that another thread may publish with StoreRelease(). Everything the publishing
+ * thread wrote before publishing the pointer is visible to the caller once the pointer is seen.
+ *
+ * @param ptr  The pointer to read.
+ *
+ * @return  The value of the pointer.
+ */
+template <typename T>
+inline T* LoadAcquire(T* const volatile& ptr)
+{
+#if defined(__ATOMIC_ACQUIRE)
+    return __atomic_load_n(&ptr, __ATOMIC_ACQUIRE);
+#elif defined(__GNUC__)
+    T* val = ptr;
+    __sync_synchronize();
+    return val;
+#else
+    T* val = ptr;
+    MemoryBarrier();
+    return val;
+#endif
+}
+
+/**
+ * Publish a pointer to threads that read it with LoadAcquire(). Everything the caller wrote before
+ * publishing the pointer is visible to a thread that sees the new value.
+ *
+ * @param ptr  The pointer to write.
+ * @param val  The new value.
+ */
+template <typename T>
+inline void StoreRelease(T* volatile& ptr, T* val)
+{
+#if defined(__ATOMIC_RELEASE)
+    __atomic_store_n(&ptr, val, __ATOMIC_RELEASE);
+#elif defined(__GNUC__)
+    __sync_synchronize();
+    ptr = val;
+#else
+    MemoryBarrier();
+    ptr = val;
+#endif
+}
+
+}
+
+#endif
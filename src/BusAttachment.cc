@@ -120,6 +120,7 @@ BusAttachment::Internal::Internal(const char* appName,
     msgSerial(1),
     router(router ? router : new ClientRouter),
     localEndpoint(transportList.GetLocalTransport()->GetLocalEndpoint()),
+    msgBufferPool(new MessageBufferPool()),
     allowRemoteMessages(allowRemoteMessages),
     listenAddresses(listenAddresses ? listenAddresses : ""),
     stopLock(),
@@ -155,6 +156,11 @@ BusAttachment::Internal::~Internal()
     transportList.Join();
     delete router;
     router = NULL;
+    /*
+     * Messages that are still alive hold their own references to the message buffer pool.
+     */
+    msgBufferPool->Release();
+    msgBufferPool = NULL;
 }
 
 /*
@@ -766,6 +772,9 @@ QStatus BusAttachment::RegisterSignalHandler(MessageReceiver* receiver,
                                              const InterfaceDescription::Member* member,
                                              const char* srcPath)
 {
+    if (member) {
+        busInternal->signaturePlans.AddMember(*member);
+    }
     return busInternal->localEndpoint->RegisterSignalHandler(receiver, signalHandler, member, srcPath);
 }
 
@@ -878,6 +887,13 @@ QStatus BusAttachment::RequestName(const char* requestedName, uint32_t flags)
         if (ER_OK == status) {
             switch (disposition) {
             case DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER :
+                /*
+                 * A name that allows replacement can be taken over before the NameLost signal
+                 * arrives so messages to it always go through the daemon.
+                 */
+                if (!(flags & DBUS_NAME_FLAG_ALLOW_REPLACEMENT)) {
+                    busInternal->GetRouter().LocalNameOwnerChanged(requestedName, true);
+                }
                 break;
 
             case DBUS_REQUEST_NAME_REPLY_IN_QUEUE :
@@ -915,6 +931,11 @@ QStatus BusAttachment::ReleaseName(const char* name)
 
     MsgArg::Set(args, numArgs, "s", name);
 
+    /*
+     * Stop delivering messages for the name locally before the daemon gives it to the next owner
+     */
+    busInternal->GetRouter().LocalNameOwnerChanged(name, false);
+
     const ProxyBusObject& dbusObj = this->GetDBusProxyObj();
     QStatus status = dbusObj.MethodCall(org::freedesktop::DBus::InterfaceName, "ReleaseName", args, numArgs, reply);
     if (ER_OK == status) {
@@ -1693,11 +1714,34 @@ void BusAttachment::Internal::NonLocalEndpointDisconnected()
     listenersLock.Unlock(MUTEX_CONTEXT);
 }
 
+void BusAttachment::Internal::NonLocalEndpointWritable()
+{
+    listenersLock.Lock(MUTEX_CONTEXT);
+    ListenerSet::iterator it = listeners.begin();
+    while (it != listeners.end()) {
+        ProtectedBusListener l = *it;
+        listenersLock.Unlock(MUTEX_CONTEXT);
+        (*l)->BusWritable();
+        listenersLock.Lock(MUTEX_CONTEXT);
+        it = listeners.upper_bound(l);
+    }
+    listenersLock.Unlock(MUTEX_CONTEXT);
+}
+
 void BusAttachment::EnableConcurrentCallbacks()
 {
     busInternal->localEndpoint->EnableReentrancy();
 }
 
+QStatus BusAttachment::EnableConcurrentSenders()
+{
+    if (isStarted) {
+        return ER_BUS_BUS_ALREADY_STARTED;
+    }
+    busInternal->localEndpoint->EnableConcurrentSenders();
+    return ER_OK;
+}
+
 void BusAttachment::Internal::AllJoynSignalHandler(const InterfaceDescription::Member* member,
                                                    const char* srcPath,
                                                    Message& msg)
@@ -39,7 +39,9 @@
 #include "AuthManager.h"
 #include "ClientRouter.h"
 #include "KeyStore.h"
+#include "MessageBufferPool.h"
 #include "PeerState.h"
+#include "SignaturePlan.h"
 #include "Transport.h"
 #include "TransportList.h"
 #include "CompressionRules.h"
@@ -137,6 +139,20 @@ class BusAttachment::Internal : public MessageReceiver {
      */
     CompressionRules& GetCompressionRules() { return compressionRules; };
 
+    /**
+     * Get the pool that message buffers for this bus attachment are allocated from.
+     *
+     * @return The message buffer pool.
+     */
+    MessageBufferPool& GetMessageBufferPool() { return *msgBufferPool; }
+
+    /**
+     * Get the cache of compiled signatures used for marshaling and unmarshaling messages.
+     *
+     * @return The signature plan cache.
+     */
+    SignaturePlanCache& GetSignaturePlanCache() { return signaturePlans; }
+
     /**
      * Override the compressions rules for this bus attachment.
      */
@@ -217,6 +233,12 @@ class BusAttachment::Internal : public MessageReceiver {
      */
     void NonLocalEndpointDisconnected();
 
+    /**
+     * Called when the bus attachment can send messages again after a non-blocking send failed
+     * because the transmit queue to the bus was full.
+     */
+    void NonLocalEndpointWritable();
+
     /**
      * JoinSessionAsync method_reply handler.
      */
@@ -275,6 +297,8 @@ class BusAttachment::Internal : public MessageReceiver {
     LocalEndpoint localEndpoint;          /* The local endpoint */
     BusEndpoint daemonEndpoint;           /* Endpoint to the daemon */
     CompressionRules compressionRules;    /* Rules for compresssing and decompressing headers */
+    MessageBufferPool* msgBufferPool;     /* Pool of message buffers (outlives the bus if messages are still in use) */
+    SignaturePlanCache signaturePlans;    /* Compiled signatures for marshaling and unmarshaling messages */
     std::map<qcc::StringMapKey, InterfaceDescription> ifaceDescriptions;
 
     bool allowRemoteMessages;             /* true iff endpoints of this attachment can receive messages from remote devices */
@@ -459,6 +459,10 @@ QStatus BusObject::DoRegistration(BusAttachment& busAttachment)
             break;
         }
     }
+    /* Compile the signatures of the interfaces this object implements */
+    for (size_t i = 0; i < components->ifaces.size(); ++i) {
+        bus->GetInternal().GetSignaturePlanCache().AddInterface(*components->ifaces[i]);
+    }
     status = AddMethodHandlers(methodEntries, ArraySize(methodEntries));
     return status;
 }
@@ -471,6 +475,54 @@ QStatus BusObject::Signal(const char* destination,
                           uint16_t timeToLive,
                           uint8_t flags,
                           Message* outMsg)
+{
+    return EmitSignal(destination, sessionId, signalMember, args, numArgs, NULL, timeToLive, flags, outMsg, false);
+}
+
+QStatus BusObject::Signal(const char* destination,
+                          SessionId sessionId,
+                          const InterfaceDescription::Member& signalMember,
+                          const TypedArgsWriter& args,
+                          uint16_t timeToLive,
+                          uint8_t flags,
+                          Message* outMsg)
+{
+    return EmitSignal(destination, sessionId, signalMember, NULL, 0, &args, timeToLive, flags, outMsg, false);
+}
+
+QStatus BusObject::SignalNoWait(const char* destination,
+                                SessionId sessionId,
+                                const InterfaceDescription::Member& signalMember,
+                                const MsgArg* args,
+                                size_t numArgs,
+                                uint16_t timeToLive,
+                                uint8_t flags,
+                                Message* outMsg)
+{
+    return EmitSignal(destination, sessionId, signalMember, args, numArgs, NULL, timeToLive, flags, outMsg, true);
+}
+
+QStatus BusObject::SignalNoWait(const char* destination,
+                                SessionId sessionId,
+                                const InterfaceDescription::Member& signalMember,
+                                const TypedArgsWriter& args,
+                                uint16_t timeToLive,
+                                uint8_t flags,
+                                Message* outMsg)
+{
+    return EmitSignal(destination, sessionId, signalMember, NULL, 0, &args, timeToLive, flags, outMsg, true);
+}
+
+QStatus BusObject::EmitSignal(const char* destination,
+                              SessionId sessionId,
+                              const InterfaceDescription::Member& signalMember,
+                              const MsgArg* args,
+                              size_t numArgs,
+                              const TypedArgsWriter* typedArgs,
+                              uint16_t timeToLive,
+                              uint8_t flags,
+                              Message* outMsg,
+                              bool noWait)
 {
     /* Protect against calling Signal before object is registered */
     if (!bus) {
@@ -498,10 +550,15 @@ QStatus BusObject::Signal(const char* destination,
                             args,
                             numArgs,
                             flags,
-                            timeToLive);
+                            timeToLive,
+                            typedArgs);
     if (status == ER_OK) {
         BusEndpoint bep = BusEndpoint::cast(bus->GetInternal().GetLocalEndpoint());
-        status = bus->GetInternal().GetRouter().PushMessage(msg, bep);
+        if (noWait) {
+            status = bus->GetInternal().GetRouter().PushMessageNoWait(msg, bep);
+        } else {
+            status = bus->GetInternal().GetRouter().PushMessage(msg, bep);
+        }
         if ((status == ER_OK) && outMsg) {
             *outMsg = msg;
         }
@@ -549,6 +606,16 @@ QStatus BusObject::CancelSessionlessMessage(uint32_t serialNum)
 }
 
 QStatus BusObject::MethodReply(const Message& msg, const MsgArg* args, size_t numArgs)
+{
+    return SendMethodReply(msg, args, numArgs, NULL);
+}
+
+QStatus BusObject::MethodReply(const Message& msg, const TypedArgsWriter& args)
+{
+    return SendMethodReply(msg, NULL, 0, &args);
+}
+
+QStatus BusObject::SendMethodReply(const Message& msg, const MsgArg* args, size_t numArgs, const TypedArgsWriter* typedArgs)
 {
     QStatus status;
 
@@ -561,7 +628,7 @@ QStatus BusObject::MethodReply(const Message& msg, const MsgArg* args, size_t nu
         status = ER_BUS_NO_CALL_FOR_REPLY;
     } else {
         Message reply(*bus);
-        status = reply->ReplyMsg(msg, args, numArgs);
+        status = reply->ReplyMsg(msg, args, numArgs, typedArgs);
         if (status == ER_OK) {
             BusEndpoint bep = BusEndpoint::cast(bus->GetInternal().GetLocalEndpoint());
             status = bus->GetInternal().GetRouter().PushMessage(reply, bep);
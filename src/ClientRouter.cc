@@ -22,14 +22,19 @@
 
 #include <qcc/platform.h>
 
+#include <string.h>
+
 #include <qcc/Debug.h>
+#include <qcc/atomic.h>
 #include <qcc/Util.h>
 #include <qcc/String.h>
 
+#include <alljoyn/DBusStd.h>
 #include <alljoyn/Status.h>
 
 #include "Transport.h"
 #include "BusEndpoint.h"
+#include "RemoteEndpoint.h"
 #include "LocalTransport.h"
 #include "ClientRouter.h"
 #include "BusInternal.h"
@@ -50,8 +55,15 @@ QStatus ClientRouter::PushMessage(Message& msg, BusEndpoint& sender)
     } else {
         if (sender == BusEndpoint::cast(localEndpoint)) {
             localEndpoint->UpdateSerialNumber(msg);
-            status = nonLocalEndpoint->PushMessage(msg);
+            if (IsLocalDestination(msg)) {
+                /* Queued for the dispatcher like a message that came back from the daemon */
+                status = localEndpoint->PushMessage(msg);
+            } else {
+                IncrementAndFetch(&busTxCount);
+                status = nonLocalEndpoint->PushMessage(msg);
+            }
         } else {
+            CheckNameLost(msg);
             status = localEndpoint->PushMessage(msg);
         }
     }
@@ -62,6 +74,76 @@ QStatus ClientRouter::PushMessage(Message& msg, BusEndpoint& sender)
     return status;
 }
 
+QStatus ClientRouter::PushMessageNoWait(Message& msg, BusEndpoint& sender)
+{
+    /*
+     * Only a remote endpoint to the daemon has a transmit queue that can be full
+     */
+    if ((sender != BusEndpoint::cast(localEndpoint)) || (nonLocalEndpoint->GetEndpointType() != ENDPOINT_TYPE_REMOTE)) {
+        return PushMessage(msg, sender);
+    }
+    QStatus status = ER_OK;
+    if (!localEndpoint->IsValid() || !nonLocalEndpoint->IsValid()) {
+        status = ER_BUS_NO_ENDPOINT;
+    } else {
+        localEndpoint->UpdateSerialNumber(msg);
+        if (IsLocalDestination(msg)) {
+            status = localEndpoint->PushMessage(msg);
+        } else {
+            IncrementAndFetch(&busTxCount);
+            status = RemoteEndpoint::cast(nonLocalEndpoint)->PushMessageNoWait(msg);
+        }
+    }
+    if (ER_OK != status) {
+        QCC_DbgHLPrintf(("ClientRouter::PushMessageNoWait failed: %s", QCC_StatusText(status)));
+    }
+    return status;
+}
+
+bool ClientRouter::IsLocalDestination(Message& msg)
+{
+    const char* dest = msg->GetDestination();
+    if (!dest[0] || (msg->GetSessionId() != 0) || (msg->GetFlags() & (ALLJOYN_FLAG_ENCRYPTED | ALLJOYN_FLAG_SESSIONLESS))) {
+        return false;
+    }
+    if (localEndpoint->GetUniqueName() == dest) {
+        return true;
+    }
+    if (numLocalNames == 0) {
+        return false;
+    }
+    localNamesLock.Lock(MUTEX_CONTEXT);
+    bool isLocal = localNames.find(dest) != localNames.end();
+    localNamesLock.Unlock(MUTEX_CONTEXT);
+    return isLocal;
+}
+
+void ClientRouter::CheckNameLost(Message& msg)
+{
+    if ((numLocalNames == 0) || (msg->GetType() != MESSAGE_SIGNAL)) {
+        return;
+    }
+    if ((strcmp(msg->GetMemberName(), "NameLost") != 0) || (strcmp(msg->GetInterface(), org::freedesktop::DBus::InterfaceName) != 0)) {
+        return;
+    }
+    const char* name;
+    if ((msg->UnmarshalArgs("s") == ER_OK) && (msg->GetArgs("s", &name) == ER_OK)) {
+        LocalNameOwnerChanged(name, false);
+    }
+}
+
+void ClientRouter::LocalNameOwnerChanged(const qcc::String& name, bool owned)
+{
+    localNamesLock.Lock(MUTEX_CONTEXT);
+    if (owned) {
+        localNames.insert(name);
+    } else {
+        localNames.erase(name);
+    }
+    numLocalNames = (int32_t)localNames.size();
+    localNamesLock.Unlock(MUTEX_CONTEXT);
+}
+
 QStatus ClientRouter::RegisterEndpoint(BusEndpoint& endpoint)
 {
     bool isLocal = endpoint->GetEndpointType() == ENDPOINT_TYPE_LOCAL;
@@ -74,6 +156,10 @@ QStatus ClientRouter::RegisterEndpoint(BusEndpoint& endpoint)
         localEndpoint = LocalEndpoint::cast(endpoint);
     } else {
         nonLocalEndpoint = endpoint;
+        /* PushMessageNoWait() reports a full transmit queue to the caller */
+        if (endpoint->GetEndpointType() == ENDPOINT_TYPE_REMOTE) {
+            RemoteEndpoint::cast(endpoint)->SetTxOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_DROP_NEWEST);
+        }
     }
 
     /* Local and non-local endpoints must have the same unique name */
@@ -99,6 +185,11 @@ void ClientRouter::UnregisterEndpoint(const String& epName, EndpointType epType)
          */
         localEndpoint->GetBus().GetInternal().NonLocalEndpointDisconnected();
         nonLocalEndpoint->Invalidate();
+        /* Names are owned through the connection to the daemon */
+        localNamesLock.Lock(MUTEX_CONTEXT);
+        localNames.clear();
+        numLocalNames = 0;
+        localNamesLock.Unlock(MUTEX_CONTEXT);
     }
 
 }
@@ -24,6 +24,9 @@
 
 #include <qcc/platform.h>
 
+#include <set>
+
+#include <qcc/Mutex.h>
 #include <qcc/Thread.h>
 #include <qcc/String.h>
 
@@ -43,6 +46,11 @@ class ClientRouter : public Router {
 
   public:
 
+    /**
+     * Constructor
+     */
+    ClientRouter() : numLocalNames(0), busTxCount(0) { }
+
     /**
      * Route an incoming Message Bus Message from an endpoint.
      *
@@ -55,6 +63,20 @@ class ClientRouter : public Router {
      */
     QStatus PushMessage(Message& msg, BusEndpoint& sender);
 
+    /**
+     * Route a message from the local endpoint without waiting for room in the transmit queue
+     * to the daemon.
+     *
+     * @param sender  Endpoint that is sending the message
+     * @param msg     Message to be processed.
+     * @return
+     *      - ER_OK if successful
+     *      - ER_BUS_WRITE_QUEUE_FULL if the transmit queue to the daemon is full
+     *      - ER_BUS_NO_ENDPOINT if unable to find endpoint
+     *      - An error status otherwise
+     */
+    QStatus PushMessageNoWait(Message& msg, BusEndpoint& sender);
+
     /**
      * Register an endpoint.
      *
@@ -84,6 +106,9 @@ class ClientRouter : public Router {
      */
     BusEndpoint FindEndpoint(const qcc::String& busname);
 
+    /* The const char* overload from Router forwards to the qcc::String overload */
+    using Router::FindEndpoint;
+
     /**
      * Generate a unique endpoint name.
      *
@@ -117,14 +142,56 @@ class ClientRouter : public Router {
      */
     void SetGlobalGUID(const qcc::GUID128& guid) { }
 
+    /**
+     * Keep track of the well-known names owned by the local endpoint so messages the local
+     * endpoint sends to itself can be delivered without a round trip through the daemon. Only
+     * names that the daemon cannot hand to another endpoint may be tracked.
+     *
+     * @param name   The well-known name.
+     * @param owned  true if the name was acquired, false if it was released.
+     */
+    void LocalNameOwnerChanged(const qcc::String& name, bool owned);
+
+    /**
+     * Get the number of messages from the local endpoint that have been sent to the bus.
+     * Messages the local endpoint sends to itself are not counted.
+     *
+     * @return  The number of messages sent to the bus.
+     */
+    uint32_t GetBusTxCount() const { return (uint32_t)busTxCount; }
+
     /**
      * Destructor
      */
     ~ClientRouter();
 
   private:
-    LocalEndpoint localEndpoint;   /**< Local endpoint */
-    BusEndpoint nonLocalEndpoint;  /**< Last non-local enpoint to register */
+
+    /**
+     * Determine if a message from the local endpoint can be queued straight back on the local
+     * endpoint. This is the case for messages addressed to the unique name of the local endpoint
+     * or to a well-known name it owns. Broadcast, sessionless, encrypted and session messages
+     * always go through the daemon.
+     *
+     * @param msg  The message.
+     *
+     * @return  true if the message is for the local endpoint.
+     */
+    bool IsLocalDestination(Message& msg);
+
+    /**
+     * Forget a well-known name if a message is the NameLost signal from the daemon.
+     *
+     * @param msg  A message received from the daemon.
+     */
+    void CheckNameLost(Message& msg);
+
+    LocalEndpoint localEndpoint;        /**< Local endpoint */
+    BusEndpoint nonLocalEndpoint;       /**< Last non-local enpoint to register */
+    std::set<qcc::String> localNames;   /**< Well-known names owned by the local endpoint */
+    qcc::Mutex localNamesLock;          /**< Protects localNames */
+    volatile int32_t numLocalNames;     /**< Size of localNames, read without the lock */
+    volatile int32_t busTxCount;        /**< Number of messages from the local endpoint sent to the bus */
 
 };
 
@@ -81,6 +81,12 @@ void ClientTransport::EndpointExit(RemoteEndpoint& ep)
     m_endpoint->Invalidate();
 }
 
+void ClientTransport::EndpointWritable(RemoteEndpoint& ep)
+{
+    QCC_DbgTrace(("ClientTransport::EndpointWritable()"));
+    m_bus.GetInternal().NonLocalEndpointWritable();
+}
+
 QStatus ClientTransport::Disconnect(const char* connectSpec)
 {
     QCC_DbgHLPrintf(("ClientTransport::Disconnect(): %s", connectSpec));
@@ -174,6 +174,13 @@ class ClientTransport : public Transport, public _RemoteEndpoint::EndpointListen
      */
     void EndpointExit(RemoteEndpoint& endpoint);
 
+    /**
+     * Callback for ClientEndpoint becoming writable after a non-blocking send failed.
+     *
+     * @param endpoint   ClientEndpoint instance that can accept messages again.
+     */
+    void EndpointWritable(RemoteEndpoint& endpoint);
+
   private:
     BusAttachment& m_bus;           /**< The message bus for this transport */
     bool m_running;                 /**< True after Start() has been called, before Stop() */
@@ -0,0 +1,106 @@
+/**
+ * @file
+ * Keys for looking up the method and signal handlers for a message
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_DISPATCHKEY_H
+#define _ALLJOYN_DISPATCHKEY_H
+
+#ifndef __cplusplus
+#error Only include DispatchKey.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * 64 bit keys computed from the header fields of a message. The keys for a message are computed
+ * once when its header is marshaled or unmarshaled and the method and signal tables compute the
+ * same keys when a handler is registered, so a lookup does not need to hash any strings. Two
+ * different names can have the same key so a table must still compare the names of the entries
+ * that it finds.
+ */
+class DispatchKey {
+  public:
+
+    /**
+     * Compute the key for an interface and member name.
+     *
+     * @param iface   The interface name, NULL or "" if there is no interface.
+     * @param member  The member name.
+     *
+     * @return  The key.
+     */
+    static uint64_t Member(const char* iface, const char* member)
+    {
+        /* The NUL between the names keeps ("a.b", "c") and ("a", "bc") apart */
+        uint64_t h = Hash(iface ? iface : "", 14695981039346656037ULL);
+        h *= 1099511628211ULL;
+        return Hash(member ? member : "", h);
+    }
+
+    /**
+     * Compute the key for an object path.
+     *
+     * @param path  The object path.
+     *
+     * @return  The key.
+     */
+    static uint64_t Path(const char* path)
+    {
+        return Hash(path ? path : "", 14695981039346656037ULL);
+    }
+
+    /**
+     * Combine the keys for an object path and a member into a single key.
+     *
+     * @param pathKey    Key from Path().
+     * @param memberKey  Key from Member().
+     *
+     * @return  The combined key.
+     */
+    static uint64_t Method(uint64_t pathKey, uint64_t memberKey)
+    {
+        return (pathKey * 0x9E3779B97F4A7C15ULL) ^ memberKey;
+    }
+
+    /**
+     * Hash functor for hash tables keyed by a dispatch key. The keys are already well mixed.
+     */
+    struct Hasher {
+        size_t operator()(uint64_t key) const { return (size_t)(key ^ (key >> 32)); }
+    };
+
+  private:
+
+    /*
+     * 64 bit FNV-1a
+     */
+    static uint64_t Hash(const char* str, uint64_t h)
+    {
+        while (*str) {
+            h = (h ^ (uint8_t)*str++) * 1099511628211ULL;
+        }
+        return h;
+    }
+};
+
+}
+
+#endif
@@ -22,14 +22,18 @@
  ******************************************************************************/
 #include <qcc/platform.h>
 
-#include <list>
+#include <algorithm>
+#include <vector>
 
 #include <qcc/Debug.h>
+#include <qcc/Event.h>
 #include <qcc/GUID.h>
+#include <qcc/Mutex.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Thread.h>
 #include <qcc/atomic.h>
+#include <qcc/time.h>
 
 #include <alljoyn/DBusStd.h>
 #include <alljoyn/AllJoynStd.h>
@@ -55,23 +59,138 @@ namespace ajn {
 
 static const uint32_t LOCAL_ENDPOINT_CONCURRENCY = 4;
 
+/*
+ * Reply timeouts that fall due within this many milliseconds of each other are handled together.
+ */
+static const uint64_t REPLY_TIMEOUT_GRANULARITY = 10;
+
+/*
+ * Number of ordering lanes. Messages from the same sender always hash to the same lane. Unless
+ * concurrent senders are enabled all messages go to the first lane.
+ */
+static const size_t LOCAL_ENDPOINT_LANES = 256;
+
+/*
+ * Maximum number of messages a worker dispatches from one lane before giving other lanes a turn.
+ */
+static const size_t LOCAL_ENDPOINT_LANE_BATCH = 16;
 
-class _LocalEndpoint::Dispatcher : public qcc::Timer, public qcc::AlarmListener {
+/*
+ * Number of queued messages above which senders are held off until the workers catch up.
+ */
+static const int32_t LOCAL_ENDPOINT_MAX_PENDING = 64;
+
+/*
+ * The dispatcher delivers messages from remote senders to the local endpoint on a pool of worker
+ * threads. A lane is serviced by at most one worker at a time so the messages on a lane are handled
+ * one at a time in order. By default all messages share one lane. If concurrent senders are
+ * enabled each message is queued on a lane chosen by hashing the sender's unique name so messages
+ * from different senders are handled in parallel. A handler that enables concurrent callbacks
+ * gives up its lane so the next message can be dispatched on another worker while the handler is
+ * still running. Deferred callbacks have a lane of their own so they are not held up behind
+ * messages.
+ */
+class _LocalEndpoint::Dispatcher {
   public:
-    Dispatcher(_LocalEndpoint* endpoint, uint32_t concurrency = LOCAL_ENDPOINT_CONCURRENCY) : Timer("lepDisp", true, concurrency, true, 10), AlarmListener(), endpoint(endpoint) { }
+    Dispatcher(_LocalEndpoint* endpoint, uint32_t concurrency = LOCAL_ENDPOINT_CONCURRENCY);
+
+    ~Dispatcher();
+
+    QStatus Start();
+
+    QStatus Stop();
+
+    QStatus Join();
+
+    /*
+     * Queue a message for dispatch on the lane for its sender.
+     */
     QStatus DispatchMessage(Message& msg);
 
-    void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
+    /*
+     * Give each sender its own lane, called before the dispatcher is started.
+     */
+    void EnableConcurrentSenders() { concurrentSenders = true; }
+
+    /*
+     * Queue the deferred callbacks for dispatch.
+     */
+    QStatus DispatchDeferredCallbacks();
+
+    /*
+     * Called from within a handler to release the handler's lane.
+     */
+    void EnableReentrancy();
+
+    /*
+     * Returns true if the calling thread is a worker in a handler that has not released its lane.
+     */
+    bool ThreadHoldsLane();
 
   private:
+
+    Dispatcher(const Dispatcher& other);
+    Dispatcher& operator=(const Dispatcher& other);
+
+    struct Item {
+        Item(const Message& msg, bool deferred) : msg(msg), deferred(deferred), next(NULL) { }
+        Message msg;
+        bool deferred;
+        Item* next;
+    };
+
+    struct Lane {
+        Lane() : head(NULL), tail(NULL), scheduled(false), nextReady(NULL) { }
+        qcc::Mutex lock;   /* Protects the item list and the scheduled flag */
+        Item* head;        /* Oldest queued item */
+        Item* tail;        /* Newest queued item */
+        bool scheduled;    /* True if the lane is on the ready list or owned by a worker */
+        Lane* nextReady;   /* Next lane on the ready list */
+    };
+
+    class Worker : public qcc::Thread {
+      public:
+        Worker(Dispatcher* dispatcher) : Thread("lepDisp"), dispatcher(dispatcher), lane(NULL), holdsLane(false) { }
+
+        Dispatcher* dispatcher;
+        Lane* lane;        /* The lane this worker is servicing */
+        bool holdsLane;    /* False once the current handler has enabled concurrent callbacks */
+
+      protected:
+        qcc::ThreadReturn STDCALL Run(void* arg);
+    };
+
+    friend class Worker;
+
+    QStatus Enqueue(Lane& lane, Item* item);
+
+    void Schedule(Lane& lane);
+
+    Lane* NextLane(Worker& worker);
+
+    void ServiceLane(Worker& worker, Lane& lane);
+
+    Worker* GetWorker();
+
     _LocalEndpoint* endpoint;
+    std::vector<Worker*> workers;
+    Lane lanes[LOCAL_ENDPOINT_LANES];
+    Lane deferredLane;              /* Lane for the deferred callbacks */
+    qcc::Mutex readyLock;           /* Protects the ready list and the stopping flag */
+    Lane* readyHead;                /* Lanes with items waiting for a worker */
+    Lane* readyTail;
+    qcc::Event readyEvent;          /* Set when a lane is added to the ready list */
+    qcc::Event roomEvent;           /* Set when the workers have caught up with a backlog */
+    volatile int32_t pending;       /* Number of queued items */
+    bool stopping;
+    bool concurrentSenders;         /* True if messages are queued on a lane per sender */
 };
 
-class _LocalEndpoint::DeferredCallbacks : public qcc::AlarmListener {
+class _LocalEndpoint::DeferredCallbacks {
   public:
     DeferredCallbacks(_LocalEndpoint* ep) : endpoint(ep) { }
 
-    void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
+    void Run();
 
   private:
     _LocalEndpoint* endpoint;
@@ -117,24 +236,17 @@ class _LocalEndpoint::ReplyContext {
                  const InterfaceDescription::Member* method,
                  Message& methodCall,
                  void* context,
-                 uint32_t timeout) :
+                 uint64_t expiry) :
         ep(ep),
         receiver(receiver),
         handler(handler),
         method(method),
         callFlags(methodCall->GetFlags()),
         serial(methodCall->msgHeader.serialNum),
-        context(context)
-    {
-        uint32_t zero = 0;
-        void* tempContext = (void*)this;
-        AlarmListener* listener = ep.unwrap();
-        alarm = Alarm(timeout, listener, tempContext, zero);
-    }
-
-    ~ReplyContext() {
-        ep->replyTimer.RemoveAlarm(alarm, false /* don't block if alarm in progress */);
-    }
+        context(context),
+        expiry(expiry),
+        paused(false)
+    { }
 
     LocalEndpoint ep;                            /* The endpoint this reply context is associated with */
     MessageReceiver* receiver;                   /* The object to receive the reply */
@@ -143,7 +255,9 @@ class _LocalEndpoint::ReplyContext {
     uint8_t callFlags;                           /* Flags from the method call */
     uint32_t serial;                             /* Serial number for the method reply */
     void* context;                               /* The calling object's context */
-    qcc::Alarm alarm;                            /* Alarm object for handling method call timeouts */
+    uint64_t expiry;                             /* Time in milliseconds at which the method call times out */
+    bool paused;                                 /* True if the timeout is paused */
+    TimingWheel::Handle timeout;                 /* Position of the timeout in the timing wheel */
 
   private:
     ReplyContext(const ReplyContext& other);
@@ -159,6 +273,7 @@ _LocalEndpoint::_LocalEndpoint(BusAttachment& bus, uint32_t concurrency) :
     objectsLock(),
     replyMapLock(),
     replyTimer("replyTimer", true),
+    replyAlarmTime(0),
     dbusObj(NULL),
     alljoynObj(NULL),
     alljoynDebugObj(NULL),
@@ -179,11 +294,14 @@ _LocalEndpoint::~_LocalEndpoint()
          * Delete any stale reply contexts
          */
         replyMapLock.Lock(MUTEX_CONTEXT);
-        for (map<uint32_t, ReplyContext*>::iterator iter = replyMap.begin(); iter != replyMap.end(); ++iter) {
-            QCC_DbgHLPrintf(("LocalEndpoint~LocalEndpoint deleting reply handler for serial %u", iter->second->serial));
-            delete iter->second;
+        replyTimeouts.Clear();
+        vector<ReplyContext*> contexts;
+        replyMap.GetAll(contexts);
+        for (size_t i = 0; i < contexts.size(); ++i) {
+            QCC_DbgHLPrintf(("LocalEndpoint~LocalEndpoint deleting reply handler for serial %u", contexts[i]->serial));
+            delete contexts[i];
         }
-        replyMap.clear();
+        replyMap.Clear();
         replyMapLock.Unlock(MUTEX_CONTEXT);
         /*
          * Unregister all application registered bus objects
@@ -382,45 +500,290 @@ QStatus _LocalEndpoint::PeerInterface(Message& message)
 }
 
 
-QStatus _LocalEndpoint::Dispatcher::DispatchMessage(Message& msg)
+_LocalEndpoint::Dispatcher::Dispatcher(_LocalEndpoint* endpoint, uint32_t concurrency) :
+    endpoint(endpoint),
+    readyHead(NULL),
+    readyTail(NULL),
+    pending(0),
+    stopping(true),
+    concurrentSenders(false)
 {
-    uint32_t zero = 0;
-    void* context = new Message(msg);
-    qcc::AlarmListener* localEndpointListener = this;
-    Alarm alarm(zero, localEndpointListener, context, zero);
-    return AddAlarm(alarm);
+    if (concurrency == 0) {
+        concurrency = 1;
+    }
+    for (uint32_t i = 0; i < concurrency; ++i) {
+        workers.push_back(new Worker(this));
+    }
 }
 
-void _LocalEndpoint::EnableReentrancy()
+_LocalEndpoint::Dispatcher::~Dispatcher()
 {
-    if (dispatcher) {
-        dispatcher->EnableReentrancy();
+    Stop();
+    Join();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        delete workers[i];
     }
+    workers.clear();
 }
 
-bool _LocalEndpoint::IsReentrantCall()
+QStatus _LocalEndpoint::Dispatcher::Start()
 {
-    if (!dispatcher) {
-        return false;
+    QStatus status = ER_OK;
+    readyLock.Lock(MUTEX_CONTEXT);
+    stopping = false;
+    readyLock.Unlock(MUTEX_CONTEXT);
+    for (size_t i = 0; (status == ER_OK) && (i < workers.size()); ++i) {
+        status = workers[i]->Start();
     }
-    return dispatcher->ThreadHoldsLock();
+    return status;
+}
 
+QStatus _LocalEndpoint::Dispatcher::Stop()
+{
+    readyLock.Lock(MUTEX_CONTEXT);
+    stopping = true;
+    /* Release any senders waiting for room */
+    roomEvent.SetEvent();
+    readyLock.Unlock(MUTEX_CONTEXT);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->Stop();
+    }
+    return ER_OK;
 }
 
-void _LocalEndpoint::Dispatcher::AlarmTriggered(const Alarm& alarm, QStatus reason)
+QStatus _LocalEndpoint::Dispatcher::Join()
 {
-    Message* msg = static_cast<Message*>(alarm->GetContext());
-    if (msg) {
-        if (reason == ER_OK) {
-            QStatus status = endpoint->DoPushMessage(*msg);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->Join();
+    }
+    /*
+     * Messages still queued when the dispatcher stops are discarded
+     */
+    readyLock.Lock(MUTEX_CONTEXT);
+    for (size_t i = 0; i <= LOCAL_ENDPOINT_LANES; ++i) {
+        Lane& lane = (i < LOCAL_ENDPOINT_LANES) ? lanes[i] : deferredLane;
+        lane.lock.Lock(MUTEX_CONTEXT);
+        while (lane.head) {
+            Item* item = lane.head;
+            lane.head = item->next;
+            delete item;
+            DecrementAndFetch(&pending);
+        }
+        lane.tail = NULL;
+        lane.scheduled = false;
+        lane.nextReady = NULL;
+        lane.lock.Unlock(MUTEX_CONTEXT);
+    }
+    readyHead = NULL;
+    readyTail = NULL;
+    readyLock.Unlock(MUTEX_CONTEXT);
+    return ER_OK;
+}
+
+QStatus _LocalEndpoint::Dispatcher::DispatchMessage(Message& msg)
+{
+    Lane& lane = concurrentSenders ? lanes[qcc::hash_string(msg->GetSender()) % LOCAL_ENDPOINT_LANES] : lanes[0];
+    return Enqueue(lane, new Item(msg, false));
+}
+
+QStatus _LocalEndpoint::Dispatcher::DispatchDeferredCallbacks()
+{
+    Message msg(*endpoint->bus);
+    return Enqueue(deferredLane, new Item(msg, true));
+}
+
+QStatus _LocalEndpoint::Dispatcher::Enqueue(Lane& lane, Item* item)
+{
+    if (stopping) {
+        delete item;
+        return ER_BUS_STOPPING;
+    }
+    /*
+     * Hold off the sender if the workers have fallen behind. Workers are never held off because
+     * they are the ones that drain the queue.
+     */
+    if ((IncrementAndFetch(&pending) > LOCAL_ENDPOINT_MAX_PENDING) && !GetWorker()) {
+        readyLock.Lock(MUTEX_CONTEXT);
+        while (!stopping && (pending > LOCAL_ENDPOINT_MAX_PENDING)) {
+            roomEvent.ResetEvent();
+            QStatus status = Event::Wait(roomEvent, readyLock);
+            readyLock.Lock(MUTEX_CONTEXT);
             if (status != ER_OK) {
-                QCC_LogError(status, ("LocalEndpoint::DoPushMessage failed"));
+                break;
+            }
+        }
+        readyLock.Unlock(MUTEX_CONTEXT);
+    }
+    lane.lock.Lock(MUTEX_CONTEXT);
+    if (lane.tail) {
+        lane.tail->next = item;
+    } else {
+        lane.head = item;
+    }
+    lane.tail = item;
+    bool idle = !lane.scheduled;
+    lane.scheduled = true;
+    lane.lock.Unlock(MUTEX_CONTEXT);
+    /*
+     * A lane that is already scheduled will get to this item without any help
+     */
+    if (idle) {
+        Schedule(lane);
+    }
+    return ER_OK;
+}
+
+void _LocalEndpoint::Dispatcher::Schedule(Lane& lane)
+{
+    readyLock.Lock(MUTEX_CONTEXT);
+    lane.nextReady = NULL;
+    if (readyTail) {
+        readyTail->nextReady = &lane;
+    } else {
+        readyHead = &lane;
+    }
+    readyTail = &lane;
+    readyEvent.SetEvent();
+    readyLock.Unlock(MUTEX_CONTEXT);
+}
+
+_LocalEndpoint::Dispatcher::Lane* _LocalEndpoint::Dispatcher::NextLane(Worker& worker)
+{
+    Lane* lane = NULL;
+    readyLock.Lock(MUTEX_CONTEXT);
+    while (!readyHead && !worker.IsStopping()) {
+        readyEvent.ResetEvent();
+        QStatus status = Event::Wait(readyEvent, readyLock);
+        readyLock.Lock(MUTEX_CONTEXT);
+        if ((status == ER_ALERTED_THREAD) && !worker.IsStopping()) {
+            worker.GetStopEvent().ResetEvent();
+        }
+    }
+    if (!worker.IsStopping()) {
+        lane = readyHead;
+        readyHead = lane->nextReady;
+        if (!readyHead) {
+            readyTail = NULL;
+        }
+        lane->nextReady = NULL;
+    }
+    readyLock.Unlock(MUTEX_CONTEXT);
+    return lane;
+}
+
+void _LocalEndpoint::Dispatcher::ServiceLane(Worker& worker, Lane& lane)
+{
+    worker.lane = &lane;
+    for (size_t n = 0; n < LOCAL_ENDPOINT_LANE_BATCH; ++n) {
+        lane.lock.Lock(MUTEX_CONTEXT);
+        Item* item = lane.head;
+        if (item) {
+            lane.head = item->next;
+            if (!lane.head) {
+                lane.tail = NULL;
             }
+        } else {
+            lane.scheduled = false;
+        }
+        lane.lock.Unlock(MUTEX_CONTEXT);
+        if (!item) {
+            worker.lane = NULL;
+            return;
+        }
+        worker.holdsLane = true;
+        /* Messages dequeued after the dispatcher was told to stop are discarded */
+        if (!worker.IsStopping()) {
+            if (item->deferred) {
+                endpoint->deferredCallbacks->Run();
+            } else {
+                QStatus status = endpoint->DoPushMessage(item->msg);
+                if (status != ER_OK) {
+                    QCC_LogError(status, ("LocalEndpoint::DoPushMessage failed"));
+                }
+            }
+        }
+        bool released = !worker.holdsLane;
+        worker.holdsLane = false;
+        delete item;
+        if (DecrementAndFetch(&pending) >= LOCAL_ENDPOINT_MAX_PENDING) {
+            readyLock.Lock(MUTEX_CONTEXT);
+            roomEvent.SetEvent();
+            readyLock.Unlock(MUTEX_CONTEXT);
         }
-        delete msg;
+        /*
+         * If the handler enabled concurrent callbacks the lane now belongs to another worker
+         */
+        if (released) {
+            worker.lane = NULL;
+            return;
+        }
+    }
+    /*
+     * Put the lane at the back of the ready list so busy senders cannot starve the others
+     */
+    worker.lane = NULL;
+    Schedule(lane);
+}
+
+_LocalEndpoint::Dispatcher::Worker* _LocalEndpoint::Dispatcher::GetWorker()
+{
+    Thread* thread = Thread::GetThread();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (workers[i] == thread) {
+            return workers[i];
+        }
+    }
+    return NULL;
+}
+
+void _LocalEndpoint::Dispatcher::EnableReentrancy()
+{
+    Worker* worker = GetWorker();
+    if (worker && worker->holdsLane) {
+        worker->holdsLane = false;
+        Schedule(*worker->lane);
+    }
+}
+
+bool _LocalEndpoint::Dispatcher::ThreadHoldsLane()
+{
+    Worker* worker = GetWorker();
+    return worker && worker->holdsLane;
+}
+
+qcc::ThreadReturn STDCALL _LocalEndpoint::Dispatcher::Worker::Run(void* arg)
+{
+    while (!IsStopping()) {
+        Lane* lane = dispatcher->NextLane(*this);
+        if (lane) {
+            dispatcher->ServiceLane(*this, *lane);
+        }
+    }
+    return 0;
+}
+
+void _LocalEndpoint::EnableReentrancy()
+{
+    if (dispatcher) {
+        dispatcher->EnableReentrancy();
     }
 }
 
+void _LocalEndpoint::EnableConcurrentSenders()
+{
+    if (dispatcher) {
+        dispatcher->EnableConcurrentSenders();
+    }
+}
+
+bool _LocalEndpoint::IsReentrantCall()
+{
+    if (!dispatcher) {
+        return false;
+    }
+    return dispatcher->ThreadHoldsLane();
+}
+
 QStatus _LocalEndpoint::PushMessage(Message& message)
 {
     QStatus ret;
@@ -628,7 +991,11 @@ void _LocalEndpoint::UpdateSerialNumber(Message& msg)
             ReplyContext* rc = RemoveReplyHandler(serial);
             if (rc) {
                 rc->serial = msg->msgHeader.serialNum;
-                replyMap[rc->serial] = rc;
+                replyMap.Insert(rc->serial, rc);
+                /* The timeout was cancelled when the context was removed, re-arm it for the new serial number */
+                if (!rc->paused) {
+                    ArmReplyTimeout(rc, GetTimestamp64());
+                }
             }
             replyMapLock.Unlock(MUTEX_CONTEXT);
         }
@@ -648,21 +1015,16 @@ QStatus _LocalEndpoint::RegisterReplyHandler(MessageReceiver* receiver,
         status = ER_BUS_STOPPING;
         QCC_LogError(status, ("Local transport not running"));
     } else {
-        ReplyContext* rc =  new ReplyContext(LocalEndpoint::wrap(this), receiver, replyHandler, &method, methodCallMsg, context, timeout);
+        uint64_t now = GetTimestamp64();
+        ReplyContext* rc =  new ReplyContext(LocalEndpoint::wrap(this), receiver, replyHandler, &method, methodCallMsg, context, now + timeout);
         QCC_DbgPrintf(("LocalEndpoint::RegisterReplyHandler"));
         /*
-         * Add reply context.
+         * Add reply context and set the timeout
          */
         replyMapLock.Lock(MUTEX_CONTEXT);
-        replyMap[methodCallMsg->msgHeader.serialNum] = rc;
+        replyMap.Insert(methodCallMsg->msgHeader.serialNum, rc);
+        ArmReplyTimeout(rc, now);
         replyMapLock.Unlock(MUTEX_CONTEXT);
-        /*
-         * Set timeout
-         */
-        status = replyTimer.AddAlarm(rc->alarm);
-        if (status != ER_OK) {
-            UnregisterReplyHandler(methodCallMsg);
-        }
     }
     return status;
 }
@@ -686,25 +1048,61 @@ bool _LocalEndpoint::UnregisterReplyHandler(Message& methodCall)
 _LocalEndpoint::ReplyContext* _LocalEndpoint::RemoveReplyHandler(uint32_t serial)
 {
     QCC_DbgPrintf(("LocalEndpoint::RemoveReplyHandler for serial=%u", serial));
-    ReplyContext* rc = NULL;
-    map<uint32_t, ReplyContext*>::iterator iter = replyMap.find(serial);
-    if (iter != replyMap.end()) {
-        rc = iter->second;
-        replyMap.erase(iter);
+    ReplyContext* rc = replyMap.Remove(serial);
+    if (rc) {
         assert(rc->serial == serial);
+        replyTimeouts.Cancel(rc->timeout);
     }
     return rc;
 }
 
+/*
+ * NOTE: Must be called holding replyMapLock
+ */
+void _LocalEndpoint::ArmReplyTimeout(ReplyContext* rc, uint64_t now)
+{
+    /*
+     * A context has at most one entry in the timing wheel and the entry is cancelled when the
+     * context is removed or paused so the wheel only holds timeouts for calls still waiting.
+     */
+    replyTimeouts.Cancel(rc->timeout);
+    replyTimeouts.Add(now, rc->expiry, reinterpret_cast<void*>((uintptr_t)rc->serial), &rc->timeout);
+    if ((replyAlarmTime == 0) || (rc->expiry < replyAlarmTime)) {
+        SetReplyAlarm(rc->expiry, now);
+    }
+}
+
+/*
+ * NOTE: Must be called holding replyMapLock
+ */
+void _LocalEndpoint::SetReplyAlarm(uint64_t when, uint64_t now)
+{
+    if (replyAlarmTime != 0) {
+        replyTimer.RemoveAlarm(replyAlarm, false /* don't block if alarm in progress */);
+    }
+    uint32_t zero = 0;
+    uint32_t delay = (when > now) ? (uint32_t)(when - now) : 0;
+    AlarmListener* listener = this;
+    replyAlarm = Alarm(delay, listener, NULL, zero);
+    replyAlarmTime = when;
+    QStatus status = replyTimer.AddAlarm(replyAlarm);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to set reply timeout alarm"));
+        replyAlarmTime = 0;
+    }
+}
+
 bool _LocalEndpoint::PauseReplyHandlerTimeout(Message& methodCallMsg)
 {
     bool paused = false;
     if (methodCallMsg->GetType() == MESSAGE_METHOD_CALL) {
         replyMapLock.Lock();
-        map<uint32_t, ReplyContext*>::iterator iter = replyMap.find(methodCallMsg->GetCallSerial());
-        if (iter != replyMap.end()) {
-            ReplyContext*rc = iter->second;
-            paused = replyTimer.RemoveAlarm(rc->alarm);
+        ReplyContext* rc = replyMap.Find(methodCallMsg->GetCallSerial());
+        if (rc && !rc->paused) {
+            /* The timeout is re-armed with the original expiry time when it is resumed */
+            replyTimeouts.Cancel(rc->timeout);
+            rc->paused = true;
+            paused = true;
         }
         replyMapLock.Unlock();
     }
@@ -716,15 +1114,12 @@ bool _LocalEndpoint::ResumeReplyHandlerTimeout(Message& methodCallMsg)
     bool resumed = false;
     if (methodCallMsg->GetType() == MESSAGE_METHOD_CALL) {
         replyMapLock.Lock();
-        map<uint32_t, ReplyContext*>::iterator iter = replyMap.find(methodCallMsg->GetCallSerial());
-        if (iter != replyMap.end()) {
-            ReplyContext*rc = iter->second;
-            QStatus status = replyTimer.AddAlarm(rc->alarm);
-            if (status == ER_OK) {
-                resumed = true;
-            } else {
-                QCC_LogError(status, ("Failed to resume reply handler timeout for %s", methodCallMsg->Description().c_str()));
-            }
+        ReplyContext* rc = replyMap.Find(methodCallMsg->GetCallSerial());
+        if (rc && rc->paused) {
+            /* The original timeout still applies, if it has passed the call times out now */
+            rc->paused = false;
+            ArmReplyTimeout(rc, GetTimestamp64());
+            resumed = true;
         }
         replyMapLock.Unlock();
     }
@@ -777,14 +1172,14 @@ QStatus _LocalEndpoint::UnregisterAllHandlers(MessageReceiver* receiver)
      * Remove any reply handlers for this receiver
      */
     replyMapLock.Lock(MUTEX_CONTEXT);
-    for (map<uint32_t, ReplyContext*>::iterator iter = replyMap.begin(); iter != replyMap.end();) {
-        ReplyContext* rc = iter->second;
+    vector<ReplyContext*> contexts;
+    replyMap.GetAll(contexts);
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        ReplyContext* rc = contexts[i];
         if (rc->receiver == receiver) {
-            replyMap.erase(iter);
+            replyMap.Remove(rc->serial);
+            replyTimeouts.Cancel(rc->timeout);
             delete rc;
-            iter = replyMap.begin();
-        } else {
-            ++iter;
         }
     }
     replyMapLock.Unlock(MUTEX_CONTEXT);
@@ -796,19 +1191,73 @@ QStatus _LocalEndpoint::UnregisterAllHandlers(MessageReceiver* receiver)
  */
 void _LocalEndpoint::AlarmTriggered(const Alarm& alarm, QStatus reason)
 {
-    ReplyContext* rc = reinterpret_cast<ReplyContext*>(alarm->GetContext());
-    uint32_t serial = rc->serial;
-    Message msg(*bus);
-    QStatus status = ER_OK;
+    vector<uint32_t> serials;
+    bool exiting = (reason == ER_TIMER_EXITING);
 
+    replyMapLock.Lock(MUTEX_CONTEXT);
+    if (exiting) {
+        /*
+         * The timer is shutting down so all method calls that are waiting for a reply are abandoned
+         */
+        vector<ReplyContext*> contexts;
+        replyMap.GetAll(contexts);
+        for (size_t i = 0; i < contexts.size(); ++i) {
+            if (!contexts[i]->paused) {
+                serials.push_back(contexts[i]->serial);
+            }
+        }
+        replyAlarmTime = 0;
+    } else {
+        uint64_t now = GetTimestamp64();
+        vector<void*> expired;
+        replyTimeouts.Advance(now, expired);
+        for (size_t i = 0; i < expired.size(); ++i) {
+            uint32_t serial = (uint32_t)reinterpret_cast<uintptr_t>(expired[i]);
+            ReplyContext* rc = replyMap.Find(serial);
+            /*
+             * Timeouts are cancelled when calls are answered, paused or renumbered so every
+             * expired entry should still have a context, check anyway.
+             */
+            if (rc && !rc->paused && (rc->expiry <= now)) {
+                serials.push_back(serial);
+            }
+        }
+        /*
+         * Set the alarm for the next timeout unless this alarm has already been replaced. Timeouts
+         * are batched so a steady stream of calls doesn't wake the timer every millisecond.
+         */
+        if (alarm == replyAlarm) {
+            uint64_t next;
+            replyAlarmTime = 0;
+            if (replyTimeouts.GetNextExpiry(next)) {
+                SetReplyAlarm(max(next, now + REPLY_TIMEOUT_GRANULARITY), now);
+            }
+        }
+    }
     /*
      * Clear the encrypted flag so the error response doesn't get rejected.
      */
-    rc->callFlags &= ~ALLJOYN_FLAG_ENCRYPTED;
+    for (size_t i = 0; i < serials.size(); ++i) {
+        ReplyContext* rc = replyMap.Find(serials[i]);
+        if (rc) {
+            rc->callFlags &= ~ALLJOYN_FLAG_ENCRYPTED;
+        }
+    }
+    replyMapLock.Unlock(MUTEX_CONTEXT);
+
+    for (size_t i = 0; i < serials.size(); ++i) {
+        ReplyTimedOut(serials[i], exiting);
+    }
+}
+
+void _LocalEndpoint::ReplyTimedOut(uint32_t serial, bool exiting)
+{
+    Message msg(*bus);
+    QStatus status = ER_OK;
 
     if (running) {
         QCC_DbgPrintf(("Timed out waiting for METHOD_REPLY with serial %d", serial));
-        if (reason == ER_TIMER_EXITING) {
+        if (exiting) {
             msg->ErrorMsg("org.alljoyn.Bus.Exiting", serial);
         } else {
             msg->ErrorMsg("org.alljoyn.Bus.Timeout", serial);
@@ -837,7 +1286,9 @@ QStatus _LocalEndpoint::HandleMethodCall(Message& message)
     QStatus status = ER_OK;
 
     /* Look up the member */
-    MethodTable::SafeEntry* safeEntry = methodTable.Find(message->GetObjectPath(),
+    MethodTable::SafeEntry* safeEntry = methodTable.Find(message->GetPathKey(),
+                                                         message->GetMemberKey(),
+                                                         message->GetObjectPath(),
                                                          message->GetInterface(),
                                                          message->GetMemberName());
     const MethodTable::Entry* entry = safeEntry ? safeEntry->entry : NULL;
@@ -919,31 +1370,14 @@ QStatus _LocalEndpoint::HandleSignal(Message& message)
 {
     QStatus status = ER_OK;
 
-    signalTable.Lock();
-
-    /* Look up the signal */
-    pair<SignalTable::const_iterator, SignalTable::const_iterator> range =
-        signalTable.Find(message->GetObjectPath(), message->GetInterface(), message->GetMemberName());
-
     /*
-     * Quick exit if there are no handlers for this signal
+     * Build a list of all signal handlers for this signal, quick exit if there are none
      */
-    if (range.first == range.second) {
-        signalTable.Unlock();
+    vector<SignalTable::Entry> callList;
+    if (!signalTable.Find(message->GetMemberKey(), message->GetObjectPath(), message->GetInterface(), message->GetMemberName(), callList)) {
         return ER_OK;
     }
-    /*
-     * Build a list of all signal handlers for this signal
-     */
-    list<SignalTable::Entry> callList;
-    const InterfaceDescription::Member* signal = range.first->second.member;
-    do {
-        callList.push_back(range.first->second);
-    } while (++range.first != range.second);
-    /*
-     * We have our callback list so we can unlock the signal table.
-     */
-    signalTable.Unlock();
+    const InterfaceDescription::Member* signal = callList.front().member;
     /*
      * Validate and unmarshal the signal
      */
@@ -959,7 +1393,7 @@ QStatus _LocalEndpoint::HandleSignal(Message& message)
             status = ER_OK;
         }
     } else {
-        list<SignalTable::Entry>::const_iterator callit;
+        vector<SignalTable::Entry>::const_iterator callit;
         for (callit = callList.begin(); callit != callList.end(); ++callit) {
             (callit->object->*callit->handler)(callit->member, message->GetObjectPath(), message);
         }
@@ -1017,34 +1451,32 @@ QStatus _LocalEndpoint::HandleMethodReply(Message& message)
     return status;
 }
 
-void _LocalEndpoint::DeferredCallbacks::AlarmTriggered(const qcc::Alarm& alarm, QStatus reason)
+void _LocalEndpoint::DeferredCallbacks::Run()
 {
-    if (reason == ER_OK) {
-        /*
-         * Allow synchronous method calls from within the object registration callbacks
-         */
-        endpoint->bus->EnableConcurrentCallbacks();
-        /*
-         * Call ObjectRegistered for any unregistered bus objects
-         */
-        endpoint->objectsLock.Lock(MUTEX_CONTEXT);
-        unordered_map<const char*, BusObject*, Hash, PathEq>::iterator iter = endpoint->localObjects.begin();
-        while (endpoint->running && (iter != endpoint->localObjects.end())) {
-            if (!iter->second->isRegistered) {
-                BusObject* bo = iter->second;
-                bo->isRegistered = true;
-                bo->InUseIncrement();
-                endpoint->objectsLock.Unlock(MUTEX_CONTEXT);
-                bo->ObjectRegistered();
-                endpoint->objectsLock.Lock(MUTEX_CONTEXT);
-                bo->InUseDecrement();
-                iter = endpoint->localObjects.begin();
-            } else {
-                ++iter;
-            }
+    /*
+     * Allow synchronous method calls from within the object registration callbacks
+     */
+    endpoint->bus->EnableConcurrentCallbacks();
+    /*
+     * Call ObjectRegistered for any unregistered bus objects
+     */
+    endpoint->objectsLock.Lock(MUTEX_CONTEXT);
+    unordered_map<const char*, BusObject*, Hash, PathEq>::iterator iter = endpoint->localObjects.begin();
+    while (endpoint->running && (iter != endpoint->localObjects.end())) {
+        if (!iter->second->isRegistered) {
+            BusObject* bo = iter->second;
+            bo->isRegistered = true;
+            bo->InUseIncrement();
+            endpoint->objectsLock.Unlock(MUTEX_CONTEXT);
+            bo->ObjectRegistered();
+            endpoint->objectsLock.Lock(MUTEX_CONTEXT);
+            bo->InUseDecrement();
+            iter = endpoint->localObjects.begin();
+        } else {
+            ++iter;
         }
-        endpoint->objectsLock.Unlock(MUTEX_CONTEXT);
     }
+    endpoint->objectsLock.Unlock(MUTEX_CONTEXT);
 }
 
 void _LocalEndpoint::OnBusConnected()
@@ -1052,9 +1484,8 @@ void _LocalEndpoint::OnBusConnected()
     /*
      * Use the local endpoint's dispatcher to call back to report the object registrations.
      */
-    uint32_t zero = 0;
     if (dispatcher) {
-        dispatcher->AddAlarm(Alarm(zero, deferredCallbacks));
+        dispatcher->DispatchDeferredCallbacks();
     }
 }
 
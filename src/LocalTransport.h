@@ -45,7 +45,9 @@
 #include "BusEndpoint.h"
 #include "CompressionRules.h"
 #include "MethodTable.h"
+#include "SerialTable.h"
 #include "SignalTable.h"
+#include "TimingWheel.h"
 #include "Transport.h"
 
 #include <qcc/STLContainer.h>
@@ -75,7 +77,7 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
     /**
      * Default constructor initializes an invalid endpoint. This allows for the declaration of uninitialized LocalEndpoint variables.
      */
-    _LocalEndpoint() : dispatcher(NULL), deferredCallbacks(NULL), bus(NULL), replyTimer("replyTimer", true) { }
+    _LocalEndpoint() : dispatcher(NULL), deferredCallbacks(NULL), bus(NULL), replyTimer("replyTimer", true), replyAlarmTime(0) { }
 
     /**
      * Constructor
@@ -354,19 +356,28 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
     bool AllowRemoteMessages() { return true; }
 
     /**
-     * Set reentrancy on the dispatcher
+     * Called from within a method or signal handler to release the handler's ordering lane so the
+     * next message from the same sender can be dispatched while the handler is still running.
      */
     void EnableReentrancy();
 
     /**
-     * Check the calling thread is making an illegal reentrant call.
+     * Dispatch messages from different senders in parallel. By default all messages are dispatched
+     * one at a time in the order they were received. Must be called before the endpoint is started.
+     */
+    void EnableConcurrentSenders();
+
+    /**
+     * Check the calling thread is making an illegal reentrant call. A call is reentrant if it is
+     * made from a handler that has not enabled concurrent callbacks.
      */
     bool IsReentrantCall();
 
   private:
 
     /**
-     * Signal/Method dispatcher
+     * Signal/Method dispatcher. Messages from the same sender are dispatched in order, messages
+     * from different senders are only dispatched in parallel if concurrent senders are enabled.
      */
     class Dispatcher;
     Dispatcher* dispatcher;
@@ -412,6 +423,36 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
      */
     ReplyContext* RemoveReplyHandler(uint32_t serial);
 
+    /**
+     * Add a reply context to the timing wheel and bring the reply timer alarm forward if the
+     * context expires before the alarm is due.
+     *
+     * NOTE: Must be called holding replyMapLock
+     *
+     * @param rc   The reply context.
+     * @param now  The current time in milliseconds.
+     */
+    void ArmReplyTimeout(ReplyContext* rc, uint64_t now);
+
+    /**
+     * Set the reply timer alarm, replacing any alarm that is already set.
+     *
+     * NOTE: Must be called holding replyMapLock
+     *
+     * @param when  The time in milliseconds at which the alarm should go off.
+     * @param now   The current time in milliseconds.
+     */
+    void SetReplyAlarm(uint64_t when, uint64_t now);
+
+    /**
+     * Deliver an error reply for a method call that timed out or was abandoned because the
+     * endpoint is exiting.
+     *
+     * @param serial   Serial number of the method call.
+     * @param exiting  true if the endpoint is exiting.
+     */
+    void ReplyTimedOut(uint32_t serial, bool exiting);
+
     /**
      * Hash functor
      */
@@ -427,9 +468,17 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
     std::unordered_map<const char*, BusObject*, Hash, PathEq> localObjects;
 
     /**
-     * List of contexts for method call replies.
+     * Contexts for method call replies indexed by serial number.
+     */
+    SerialTable<ReplyContext> replyMap;
+
+    /**
+     * Method call timeouts. Entries are not removed when a reply arrives, an expired entry is
+     * ignored if there is no longer a reply context for its serial number. The wheel is cleared
+     * whenever no calls are outstanding, while calls are outstanding it holds at most the call
+     * rate times the longest call timeout worth of entries.
      */
-    std::map<uint32_t, ReplyContext*> replyMap;
+    TimingWheel replyTimeouts;
 
     bool running;                      /**< Is the local endpoint up and running */
     MethodTable methodTable;           /**< Hash table of BusObject methods */
@@ -440,6 +489,8 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
     qcc::GUID128 guid;                 /**< GUID to uniquely identify a local endpoint */
     qcc::String uniqueName;            /**< Unique name for endpoint */
     qcc::Timer replyTimer;             /**< Timer used to timeout method calls */
+    qcc::Alarm replyAlarm;             /**< Alarm for the next method call timeout */
+    uint64_t replyAlarmTime;           /**< Time the reply alarm goes off or 0 if it is not set */
 
     std::vector<BusObject*> defaultObjects;  /**< Auto-generated, heap allocated parent objects */
 
@@ -485,7 +536,7 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
     QStatus HandleMethodReply(Message& msg);
 
     /**
-     *   Process a timeout on a METHOD_REPLY message
+     *   Process timeouts on METHOD_REPLY messages
      */
     void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
 
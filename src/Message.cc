@@ -36,9 +36,12 @@
 
 #include <alljoyn/Message.h>
 #include <alljoyn/BusAttachment.h>
+#include <alljoyn/MsgTraits.h>
 
 #include "BusInternal.h"
 #include "BusUtil.h"
+#include "DispatchKey.h"
+#include "MsgArgArena.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -300,6 +303,31 @@ QStatus _Message::GetArgs(const char* signature, ...)
     return status;
 }
 
+QStatus _Message::GetArgs(const TypedArgsReader& args)
+{
+    if (strcmp(args.GetSignature(), GetSignature()) != 0) {
+        return ER_BUS_SIGNATURE_MISMATCH;
+    }
+    /*
+     * Encrypted message bodies are decrypted when the arguments are unmarshaled.
+     */
+    if ((msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED) && !msgArgs && *GetSignature()) {
+        QStatus status = UnmarshalArgs(GetSignature());
+        if (status != ER_OK) {
+            return status;
+        }
+    }
+    if (!bodyPtr) {
+        return (*args.GetSignature() == 0) ? ER_OK : ER_BUS_BAD_BODY_LEN;
+    }
+    /*
+     * The body is left in the endianness it was marshaled in.
+     */
+    bool swap = ((MessageHeader*)msgBuf)->endian != myEndian;
+    MsgReader reader(bodyPtr, msgHeader.bodyLen, swap);
+    return args.Unmarshal(reader);
+}
+
 _Message::_Message(BusAttachment& bus) :
     bus(&bus),
     endianSwap(false),
@@ -307,23 +335,31 @@ _Message::_Message(BusAttachment& bus) :
     msgBuf(NULL),
     msgArgs(NULL),
     numMsgArgs(0),
+    argArena(NULL),
+    sharedArgs(NULL),
     ttl(0),
     handles(NULL),
     numHandles(0),
     encrypt(false),
     readState(MESSAGE_NEW),
     countRead(0),
-    writeState(MESSAGE_NEW),
-    countWrite(0)
+    hasDeferredFields(false),
+    hasDispatchKeys(false),
+    memberKey(0),
+    pathKey(0)
 {
     msgHeader.msgType = MESSAGE_INVALID;
     msgHeader.endian = myEndian;
+    memset(deferredFields, 0, sizeof(deferredFields));
 }
 
 _Message::~_Message(void)
 {
-    delete [] _msgBuf;
-    delete [] msgArgs;
+    MessageBufferPool::Free(_msgBuf);
+    delete argArena;
+    if (sharedArgs) {
+        sharedArgs->Release();
+    }
     while (numHandles) {
         qcc::Close(handles[--numHandles]);
     }
@@ -345,13 +381,31 @@ _Message::_Message(const _Message& other) :
     encrypt(other.encrypt),
     readState(other.readState),
     countRead(other.countRead),
-    writeState(other.writeState),
-    countWrite(other.countWrite),
-    hdrFields(other.hdrFields)
+    hdrFields(other.hdrFields),
+    hasDeferredFields(other.hasDeferredFields),
+    hasDispatchKeys(other.hasDispatchKeys),
+    memberKey(other.memberKey),
+    pathKey(other.pathKey)
 {
-    if (bufSize > 0) {
+    /*
+     * Offsets of deferred fields are relative to the start of the buffer so are valid for the copy
+     */
+    memcpy(deferredFields, other.deferredFields, sizeof(deferredFields));
+    if (other.sharedArgs) {
+        /*
+         * The buffer of a message with shared arguments is not modified so the copy shares it.
+         * SetSerialNumber() makes a private copy if the serial number of the copy is changed.
+         */
+        assert(other._msgBuf != NULL);
+        _msgBuf = other._msgBuf;
+        MessageBufferPool::AddRef(_msgBuf);
+        msgBuf = other.msgBuf;
+        bufEOD = other.bufEOD;
+        bufPos = other.bufPos;
+        bodyPtr = other.bodyPtr;
+    } else if (bufSize > 0) {
         assert(other.msgBuf != NULL);
-        _msgBuf = new uint8_t[bufSize + 7];
+        _msgBuf = bus->GetInternal().GetMessageBufferPool().Alloc(bufSize + 7);
         msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7);
         bufEOD = ((uint8_t*)msgBuf) + (other.bufEOD - ((uint8_t*)other.msgBuf));
         bufPos = ((uint8_t*)msgBuf) + (other.bufPos - ((uint8_t*)other.msgBuf));
@@ -369,11 +423,18 @@ _Message::_Message(const _Message& other) :
         bufPos = NULL;
         bodyPtr = NULL;
     }
-    if (numMsgArgs > 0) {
-        msgArgs =  new MsgArg[numMsgArgs];
-        for (size_t i = 0; i < numMsgArgs; ++i) {
-            msgArgs[i] = other.msgArgs[i];
-        }
+    argArena = NULL;
+    sharedArgs = NULL;
+    if (other.sharedArgs) {
+        /*
+         * Shared arguments are immutable and hold their own reference to the buffer they reference
+         */
+        sharedArgs = other.sharedArgs;
+        sharedArgs->AddRef();
+        msgArgs = sharedArgs->GetArgs();
+    } else if (numMsgArgs > 0) {
+        argArena = new MsgArgArena();
+        msgArgs = argArena->CopyArgs(other.msgArgs, numMsgArgs);
     } else {
         msgArgs = NULL;
     }
@@ -390,6 +451,15 @@ _Message::_Message(const _Message& other) :
 
 QStatus _Message::ReMarshal(const char* senderName)
 {
+    /*
+     * All header fields must be parsed before the header can be remarshaled.
+     */
+    if (hasDeferredFields) {
+        QStatus status = ParseDeferredHeaderFields();
+        if (status != ER_OK) {
+            return status;
+        }
+    }
     if (senderName) {
         hdrFields.field[ALLJOYN_HDR_FIELD_SENDER].Set("s", senderName);
     }
@@ -397,9 +467,7 @@ QStatus _Message::ReMarshal(const char* senderName)
     /*
      * Remarshal invalidates any unmarshalled message args.
      */
-    delete [] msgArgs;
-    msgArgs = NULL;
-    numMsgArgs = 0;
+    ClearArgs();
 
     /*
      * We delete the current buffer after we have copied the body data
@@ -415,7 +483,7 @@ QStatus _Message::ReMarshal(const char* senderName)
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
     bufSize = sizeof(msgHeader) + ((((msgHeader.headerLen + 7) & ~7) + msgHeader.bodyLen + 7) & ~7) + 8;
-    _msgBuf = new uint8_t[bufSize + 7];
+    _msgBuf = bus->GetInternal().GetMessageBufferPool().Alloc(bufSize + 7);
     msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
     bufPos = (uint8_t*)msgBuf;
     memcpy(bufPos, &msgHeader, sizeof(msgHeader));
@@ -448,7 +516,7 @@ QStatus _Message::ReMarshal(const char* senderName)
      */
     assert((size_t)(bufEOD - (uint8_t*)msgBuf) < bufSize);
     memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
-    delete [] _savBuf;
+    MessageBufferPool::Free(_savBuf);
     return ER_OK;
 }
 
@@ -489,9 +557,7 @@ void _Message::ClearHeader()
         for (uint32_t fieldId = ALLJOYN_HDR_FIELD_INVALID; fieldId < ArraySize(hdrFields.field); fieldId++) {
             hdrFields.field[fieldId].Clear();
         }
-        delete [] msgArgs;
-        msgArgs = NULL;
-        numMsgArgs = 0;
+        ClearArgs();
         ttl = 0;
         msgHeader.msgType = MESSAGE_INVALID;
         while (numHandles) {
@@ -501,7 +567,72 @@ void _Message::ClearHeader()
         handles = NULL;
         encrypt = false;
         authMechanism.clear();
+        if (hasDeferredFields) {
+            memset(deferredFields, 0, sizeof(deferredFields));
+            hasDeferredFields = false;
+        }
+    }
+    hasDispatchKeys = false;
+}
+
+void _Message::ComputeDispatchKeys()
+{
+    /*
+     * Deferred fields must be parsed first or the keys would be computed from missing fields
+     */
+    if (hasDeferredFields) {
+        ParseDeferredHeaderFields();
+    }
+    memberKey = DispatchKey::Member(GetInterface(), GetMemberName());
+    pathKey = DispatchKey::Path(GetObjectPath());
+    hasDispatchKeys = true;
+}
+
+void _Message::ClearArgs()
+{
+    if (sharedArgs) {
+        sharedArgs->Release();
+        sharedArgs = NULL;
+    }
+    if (argArena) {
+        argArena->Reset();
+    }
+    msgArgs = NULL;
+    numMsgArgs = 0;
+}
+
+QStatus _Message::ShareArgs()
+{
+    if (sharedArgs) {
+        return ER_OK;
     }
+    /*
+     * Unmarshaling an encrypted or compressed message depends on the keys and expansion rules of
+     * the receiving bus attachment. Byte swapped messages are excluded because unmarshaling
+     * changes the endianness recorded in the header but not the buffer. Unmarshaled handles are
+     * the socket descriptors owned by this message so they cannot outlive it in shared arguments.
+     */
+    if (!_msgBuf || endianSwap || (numHandles > 0) || (msgHeader.flags & (ALLJOYN_FLAG_ENCRYPTED | ALLJOYN_FLAG_COMPRESSED))) {
+        return ER_BUS_NOT_ALLOWED;
+    }
+    /*
+     * Unmarshal directly into the arena of the shared arguments rather than copying arguments that
+     * have already been unmarshaled. The arguments reference the message buffer so the shared
+     * arguments hold a reference to it.
+     */
+    ClearArgs();
+    SharedArgs* shared = new SharedArgs(_msgBuf);
+    MsgArgArena* ownArena = argArena;
+    argArena = &shared->GetArena();
+    QStatus status = UnmarshalArgs("*");
+    argArena = ownArena;
+    if (status == ER_OK) {
+        shared->SetArgs(msgArgs, numMsgArgs);
+        sharedArgs = shared;
+    } else {
+        shared->Release();
+    }
+    return status;
 }
 
 }
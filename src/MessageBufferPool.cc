@@ -0,0 +1,207 @@
+/**
+ * @file
+ *
+ * This file implements the MessageBufferPool class
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+#include <qcc/atomic.h>
+#include <qcc/Debug.h>
+#include <qcc/Mutex.h>
+#include <qcc/Util.h>
+
+#include "MessageBufferPool.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+/*
+ * Size classes for pooled buffers.
+ */
+static const size_t SizeClass[MessageBufferPool::NUM_SIZE_CLASSES] = { 128, 512, 4 * 1024, 64 * 1024 };
+
+/*
+ * Maximum number of free buffers kept for each size class.
+ */
+static const size_t MaxFree[MessageBufferPool::NUM_SIZE_CLASSES] = { 256, 128, 32, 4 };
+
+/*
+ * Every buffer is preceded by a header that identifies the pool and size class it belongs to. The
+ * header size is a multiple of 8 so the buffer keeps the alignment returned by new.
+ */
+struct BufferHeader {
+    MessageBufferPool* pool;
+    uint32_t sizeClass;
+    uint32_t size;
+    volatile int32_t refs;
+};
+
+static const size_t HEADER_SIZE = (sizeof(BufferHeader) + 7) & ~7;
+
+MessageBufferPool::MessageBufferPool() : released(false), outstanding(0)
+{
+}
+
+MessageBufferPool::~MessageBufferPool()
+{
+    for (size_t i = 0; i < NUM_SIZE_CLASSES; ++i) {
+        vector<uint8_t*>::iterator it = stripes[i].freeList.begin();
+        for (; it != stripes[i].freeList.end(); ++it) {
+            delete [] *it;
+        }
+        stripes[i].freeList.clear();
+    }
+}
+
+uint8_t* MessageBufferPool::Alloc(size_t size)
+{
+    size_t sizeClass = 0;
+    while ((sizeClass < NUM_SIZE_CLASSES) && (size > SizeClass[sizeClass])) {
+        ++sizeClass;
+    }
+    if (sizeClass < NUM_SIZE_CLASSES) {
+        size = SizeClass[sizeClass];
+    }
+    uint8_t* block = NULL;
+
+    Stripe& stripe = stripes[sizeClass];
+    stripe.lock.Lock(MUTEX_CONTEXT);
+    assert(!released);
+    ++stripe.allocs;
+    if (!stripe.freeList.empty()) {
+        block = stripe.freeList.back();
+        stripe.freeList.pop_back();
+        ++stripe.hits;
+    }
+    stripe.bytesInUse += size;
+    stripe.peakInUse = (std::max)(stripe.peakInUse, ++stripe.inUse);
+    stripe.lock.Unlock(MUTEX_CONTEXT);
+
+    if (!block) {
+        block = new uint8_t[HEADER_SIZE + size];
+    }
+    BufferHeader* hdr = reinterpret_cast<BufferHeader*>(block);
+    hdr->pool = this;
+    hdr->sizeClass = static_cast<uint32_t>(sizeClass);
+    hdr->size = static_cast<uint32_t>(size);
+    hdr->refs = 1;
+    return block + HEADER_SIZE;
+}
+
+void MessageBufferPool::Free(uint8_t* buf)
+{
+    if (buf) {
+        uint8_t* block = buf - HEADER_SIZE;
+        BufferHeader* hdr = reinterpret_cast<BufferHeader*>(block);
+        if (DecrementAndFetch(&hdr->refs) == 0) {
+            hdr->pool->Return(block, hdr->sizeClass, hdr->size);
+        }
+    }
+}
+
+void MessageBufferPool::AddRef(uint8_t* buf)
+{
+    if (buf) {
+        BufferHeader* hdr = reinterpret_cast<BufferHeader*>(buf - HEADER_SIZE);
+        IncrementAndFetch(&hdr->refs);
+    }
+}
+
+bool MessageBufferPool::IsShared(const uint8_t* buf)
+{
+    if (buf) {
+        const BufferHeader* hdr = reinterpret_cast<const BufferHeader*>(buf - HEADER_SIZE);
+        return hdr->refs > 1;
+    }
+    return false;
+}
+
+void MessageBufferPool::Return(uint8_t* block, size_t sizeClass, size_t size)
+{
+    Stripe& stripe = stripes[sizeClass];
+    stripe.lock.Lock(MUTEX_CONTEXT);
+    --stripe.inUse;
+    stripe.bytesInUse -= size;
+    if ((sizeClass < NUM_SIZE_CLASSES) && (stripe.freeList.size() < MaxFree[sizeClass])) {
+        stripe.freeList.push_back(block);
+        block = NULL;
+    }
+    /*
+     * Buffers that were in use when the pool was released were counted in the outstanding total
+     * while this stripe was locked so the flag is stable here. The count is decremented after the
+     * stripe is unlocked because the last decrement deletes the pool.
+     */
+    bool counted = released;
+    stripe.lock.Unlock(MUTEX_CONTEXT);
+    delete [] block;
+    if (counted && (DecrementAndFetch(&outstanding) == 0)) {
+        delete this;
+    }
+}
+
+void MessageBufferPool::Release()
+{
+    int32_t inUse = 0;
+    for (size_t i = 0; i <= NUM_SIZE_CLASSES; ++i) {
+        stripes[i].lock.Lock(MUTEX_CONTEXT);
+    }
+    for (size_t i = 0; i <= NUM_SIZE_CLASSES; ++i) {
+        inUse += static_cast<int32_t>(stripes[i].inUse);
+    }
+    released = true;
+    outstanding = inUse;
+    for (size_t i = NUM_SIZE_CLASSES + 1; i > 0; --i) {
+        stripes[i - 1].lock.Unlock(MUTEX_CONTEXT);
+    }
+    if (inUse == 0) {
+        delete this;
+    }
+}
+
+void MessageBufferPool::GetStats(Stats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+    for (size_t i = 0; i <= NUM_SIZE_CLASSES; ++i) {
+        Stripe& stripe = stripes[i];
+        stripe.lock.Lock(MUTEX_CONTEXT);
+        stats.allocs += stripe.allocs;
+        stats.hits += stripe.hits;
+        stats.inUse += stripe.inUse;
+        stats.bytesInUse += stripe.bytesInUse;
+        if (i < NUM_SIZE_CLASSES) {
+            stats.classInUse[i] = stripe.inUse;
+            stats.classPeakInUse[i] = stripe.peakInUse;
+            stats.classFree[i] = static_cast<uint32_t>(stripe.freeList.size());
+        } else {
+            stats.unpooled = stripe.allocs;
+        }
+        stripe.lock.Unlock(MUTEX_CONTEXT);
+    }
+}
+
+}
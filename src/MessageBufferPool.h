@@ -0,0 +1,165 @@
+/**
+ * @file
+ * Implements a pool of size-classed buffers for marshaled messages
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_MESSAGEBUFFERPOOL_H
+#define _ALLJOYN_MESSAGEBUFFERPOOL_H
+
+#ifndef __cplusplus
+#error Only include MessageBufferPool.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+#include <qcc/Mutex.h>
+
+namespace ajn {
+
+/**
+ * Pool of message buffers. Buffers are allocated from a small number of size classes and returned
+ * to a per-size-class free list when the message that owns them is destroyed. Each size class has
+ * its own lock so threads allocating buffers of different sizes do not contend. Each buffer records
+ * the pool it came from so it can be freed without reference to the bus attachment (messages can
+ * be moved between bus attachments). Buffers are reference counted so messages that carry the same
+ * bytes can share a buffer. The pool is only deleted after its creator has released it and the
+ * last outstanding buffer has been returned.
+ */
+class MessageBufferPool {
+  public:
+
+    /**
+     * Number of size classes. Requests larger than the largest size class are not pooled.
+     */
+    static const size_t NUM_SIZE_CLASSES = 4;
+
+    /**
+     * Pool statistics. Each size class is sampled separately so the totals are only consistent if
+     * the pool is not in use while the statistics are read.
+     */
+    struct Stats {
+        uint32_t allocs;                           /**< Total number of buffer allocations */
+        uint32_t hits;                             /**< Number of allocations satisfied from a free list */
+        uint32_t unpooled;                         /**< Number of allocations too large to be pooled */
+        uint32_t inUse;                            /**< Number of buffers currently in use */
+        size_t bytesInUse;                         /**< Number of bytes currently in use */
+        uint32_t classInUse[NUM_SIZE_CLASSES];     /**< Number of buffers currently in use per size class */
+        uint32_t classPeakInUse[NUM_SIZE_CLASSES]; /**< Maximum number of buffers in use at any one time per size class */
+        uint32_t classFree[NUM_SIZE_CLASSES];      /**< Number of buffers on the free list per size class */
+    };
+
+    /**
+     * Constructor.
+     */
+    MessageBufferPool();
+
+    /**
+     * Allocate a buffer.
+     *
+     * @param size  Minimum size of the buffer.
+     *
+     * @return  Pointer to a buffer at least size bytes long.
+     */
+    uint8_t* Alloc(size_t size);
+
+    /**
+     * Release a reference to a buffer. The buffer is returned to the pool it was allocated from
+     * when the last reference is released.
+     *
+     * @param buf  A buffer returned by Alloc() or NULL.
+     */
+    static void Free(uint8_t* buf);
+
+    /**
+     * Add a reference to a buffer so it can be shared by several messages. A shared buffer must not
+     * be modified, each reference is released by a call to Free().
+     *
+     * @param buf  A buffer returned by Alloc().
+     */
+    static void AddRef(uint8_t* buf);
+
+    /**
+     * Check if a buffer is shared.
+     *
+     * @param buf  A buffer returned by Alloc() or NULL.
+     *
+     * @return  true if more than one reference to the buffer is held.
+     */
+    static bool IsShared(const uint8_t* buf);
+
+    /**
+     * Called by the creator when it no longer needs the pool. No buffers may be allocated after
+     * this. The pool is deleted now if no buffers are outstanding or else when the last one is
+     * returned.
+     */
+    void Release();
+
+    /**
+     * Get a snapshot of the pool statistics.
+     *
+     * @param stats  [OUT] Returns the current statistics.
+     */
+    void GetStats(Stats& stats);
+
+  private:
+
+    /**
+     * Destructor is private, the pool deletes itself once it has been released and is unused.
+     */
+    ~MessageBufferPool();
+
+    /**
+     * Copy constructor is undefined.
+     */
+    MessageBufferPool(const MessageBufferPool& other);
+
+    /**
+     * Assignment operator is undefined.
+     */
+    MessageBufferPool& operator=(const MessageBufferPool& other);
+
+    /**
+     * Return a buffer to the free list for its size class.
+     */
+    void Return(uint8_t* block, size_t sizeClass, size_t size);
+
+    /**
+     * State for a size class. Buffers too large to be pooled are counted in an extra stripe that
+     * has no free list.
+     */
+    struct Stripe {
+        Stripe() : allocs(0), hits(0), inUse(0), peakInUse(0), bytesInUse(0) { }
+        qcc::Mutex lock;                  /**< Protects the free list and counts of this stripe */
+        std::vector<uint8_t*> freeList;   /**< Free buffers */
+        uint32_t allocs;                  /**< Number of allocations */
+        uint32_t hits;                    /**< Number of allocations satisfied from the free list */
+        uint32_t inUse;                   /**< Number of buffers currently in use */
+        uint32_t peakInUse;               /**< Maximum number of buffers in use at any one time */
+        size_t bytesInUse;                /**< Number of bytes currently in use */
+    };
+
+    Stripe stripes[NUM_SIZE_CLASSES + 1];  /**< One stripe per size class plus one for unpooled buffers */
+    bool released;                         /**< Set with all stripe locks held when the creator releases the pool */
+    volatile int32_t outstanding;          /**< Buffers still in use when the pool was released */
+};
+
+}
+
+#endif
@@ -22,6 +22,8 @@
 
 #include <qcc/platform.h>
 
+#include <algorithm>
+
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Debug.h>
@@ -33,6 +35,7 @@
 #include <alljoyn/AllJoynStd.h>
 #include <alljoyn/Message.h>
 #include <alljoyn/MsgArg.h>
+#include <alljoyn/MsgTraits.h>
 
 #include "LocalTransport.h"
 #include "PeerState.h"
@@ -41,8 +44,10 @@
 #include "BusUtil.h"
 #include "AllJoynCrypto.h"
 #include "AllJoynPeerObj.h"
+#include "ArrayKernels.h"
 #include "SignatureUtils.h"
 #include "BusInternal.h"
+#include "SignaturePlan.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -102,6 +107,8 @@ namespace ajn {
  */
 #define ROUNDUP8(n)  (((n) + 7) & ~7)
 
+#define PadUp(n, i)   (((n) + (i) - 1) & ~((i) - 1))
+
 static inline QStatus CheckedArraySize(size_t sz, uint32_t& len)
 {
     if (sz > ALLJOYN_MAX_ARRAY_LEN) {
@@ -114,302 +121,458 @@ static inline QStatus CheckedArraySize(size_t sz, uint32_t& len)
     }
 }
 
-QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
+/*
+ * Make sure there is room in the buffer for len bytes plus up to 7 bytes of alignment padding.
+ */
+#define ReserveBytes(len) \
+    do { \
+        size_t _needed = (size_t)(len) + 8; \
+        if (((size_t)(bufPos - (uint8_t*)msgBuf) + _needed) > bufSize) { \
+            GrowBuffer(_needed); \
+        } \
+    } while (0)
+
+void _Message::GrowBuffer(size_t needed)
+{
+    uint8_t* oldBuf = (uint8_t*)msgBuf;
+    size_t used = bufPos - oldBuf;
+    size_t newSize = 2 * bufSize;
+    while (newSize < (used + needed)) {
+        newSize *= 2;
+    }
+    uint8_t* _newMsgBuf = bus->GetInternal().GetMessageBufferPool().Alloc(newSize + 7);
+    uint8_t* newBuf = (uint8_t*)((uintptr_t)(_newMsgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    memcpy(newBuf, oldBuf, used);
+    /*
+     * The header fields that have been marshaled and possibly the body pointer point into the old
+     * buffer so must be relocated.
+     */
+    const uintptr_t oldStart = (uintptr_t)oldBuf;
+    const uintptr_t oldEnd = oldStart + used;
+    for (size_t fieldId = ALLJOYN_HDR_FIELD_PATH; fieldId < ArraySize(hdrFields.field); fieldId++) {
+        MsgArg* field = &hdrFields.field[fieldId];
+        switch (field->typeId) {
+        case ALLJOYN_OBJECT_PATH:
+        case ALLJOYN_STRING:
+            if (((uintptr_t)field->v_string.str >= oldStart) && ((uintptr_t)field->v_string.str < oldEnd)) {
+                field->v_string.str = (const char*)(newBuf + ((uintptr_t)field->v_string.str - oldStart));
+            }
+            break;
+
+        case ALLJOYN_SIGNATURE:
+            if (((uintptr_t)field->v_signature.sig >= oldStart) && ((uintptr_t)field->v_signature.sig < oldEnd)) {
+                field->v_signature.sig = (const char*)(newBuf + ((uintptr_t)field->v_signature.sig - oldStart));
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+    if (((uintptr_t)bodyPtr >= oldStart) && ((uintptr_t)bodyPtr <= oldEnd)) {
+        bodyPtr = newBuf + ((uintptr_t)bodyPtr - oldStart);
+    }
+    bufPos = newBuf + used;
+    MessageBufferPool::Free(_msgBuf);
+    _msgBuf = _newMsgBuf;
+    msgBuf = (uint64_t*)newBuf;
+    bufSize = newSize;
+}
+
+/*
+ * Scalar array types keyed by element type
+ */
+static inline bool IsScalarArray(AllJoynTypeId typeId, uint8_t elemTypeId)
+{
+    return typeId == (AllJoynTypeId)((elemTypeId << 8) | ALLJOYN_ARRAY);
+}
+
+QStatus _Message::MarshalValue(const MsgArg* arg, const SignaturePlan& plan, size_t op)
 {
     QStatus status = ER_OK;
-    size_t alignment;
+    const SignaturePlan::Op& code = plan.ops[op];
     uint32_t len;
 
-    while (numArgs--) {
-        if (!arg) {
-            status = ER_BUS_BAD_VALUE;
+    if (!arg) {
+        return ER_BUS_BAD_VALUE;
+    }
+    /*
+     * Make room for the value, this is enough for any value that doesn't have a fixed size other
+     * than the length, signature or padding.
+     */
+    ReserveBytes((code.fixedSize > 8) ? code.fixedSize : 8);
+    /*
+     * Align on boundary for type as specified in the wire protocol
+     */
+    MarshalPad(code.alignment);
+
+    switch (code.typeId) {
+    case ALLJOYN_DICT_ENTRY_OPEN:
+        if (arg->typeId != ALLJOYN_DICT_ENTRY) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
             break;
         }
-        /*
-         * Align on boundary for type as specified in the wire protocol
-         */
-        MarshalPad(SignatureUtils::AlignmentForType(arg->typeId));
+        status = MarshalValue(arg->v_dictEntry.key, plan, op + 1);
+        if (status == ER_OK) {
+            status = MarshalValue(arg->v_dictEntry.val, plan, plan.ops[op + 1].next);
+        }
+        break;
 
-        switch (arg->typeId) {
-        case ALLJOYN_DICT_ENTRY:
-            status = MarshalArgs(arg->v_dictEntry.key, 1);
-            if (status == ER_OK) {
-                status = MarshalArgs(arg->v_dictEntry.val, 1);
-            }
+    case ALLJOYN_STRUCT_OPEN:
+        if ((arg->typeId != ALLJOYN_STRUCT) || (arg->v_struct.numMembers != code.numMembers)) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
             break;
-
-        case ALLJOYN_STRUCT:
-            status = MarshalArgs(arg->v_struct.members, arg->v_struct.numMembers);
+        }
+        if (code.numMembers && !arg->v_struct.members) {
+            status = ER_BUS_BAD_VALUE;
             break;
+        }
+        {
+            size_t memberOp = op + 1;
+            for (size_t i = 0; (status == ER_OK) && (i < code.numMembers); i++) {
+                status = MarshalValue(&arg->v_struct.members[i], plan, memberOp);
+                memberOp = plan.ops[memberOp].next;
+            }
+        }
+        break;
 
-        case ALLJOYN_ARRAY:
-            if (!arg->v_array.elemSig) {
-                status = ER_BUS_BAD_VALUE;
+    case ALLJOYN_ARRAY:
+    {
+        const SignaturePlan::Op& elem = plan.ops[op + 1];
+        if (arg->typeId == ALLJOYN_ARRAY) {
+            if (!plan.MatchSignature(elem, arg->v_array.elemSig)) {
+                status = ER_BUS_UNEXPECTED_SIGNATURE;
                 break;
             }
-            alignment = SignatureUtils::AlignmentForType((AllJoynTypeId)(arg->v_array.elemSig[0]));
             if (arg->v_array.numElements > 0) {
                 if (!arg->v_array.elements) {
                     status = ER_BUS_BAD_VALUE;
                     break;
                 }
                 /*
-                 * Check elements conform to the expected signature type
+                 * Offsets rather than pointers because the buffer may grow.
                  */
+                size_t lenOffset = bufPos - (uint8_t*)msgBuf;
+                bufPos += 4;
+                /* Length does not include padding for first element, so pad to 8 byte boundary if required. */
+                if (elem.alignment == 8) {
+                    MarshalPad(8);
+                }
+                size_t elemOffset = bufPos - (uint8_t*)msgBuf;
+                /*
+                 * If the elements have a fixed size reserve space for all of them in one go.
+                 */
+                if (elem.fixedSize) {
+                    ReserveBytes(arg->v_array.numElements * PadUp(elem.fixedSize, elem.alignment));
+                }
                 for (size_t i = 0; i < arg->v_array.numElements; i++) {
-                    if (!arg->v_array.elements[i].HasSignature(arg->v_array.GetElemSig())) {
-                        status = ER_BUS_BAD_VALUE;
-                        QCC_LogError(status, ("Array element[%d] does not have expected signature \"%s\"", i, arg->v_array.GetElemSig()));
+                    status = MarshalValue(&arg->v_array.elements[i], plan, op + 1);
+                    if (status != ER_OK) {
+                        /*
+                         * Elements must conform to the array element signature
+                         */
+                        if (status == ER_BUS_UNEXPECTED_SIGNATURE) {
+                            status = ER_BUS_BAD_VALUE;
+                            QCC_LogError(status, ("Array element[%d] does not have expected signature \"%s\"", i, arg->v_array.GetElemSig()));
+                        }
                         break;
                     }
                 }
-                if (status == ER_OK) {
-                    uint8_t* lenPos = bufPos;
-                    bufPos += 4;
-                    /* Length does not include padding for first element, so pad to 8 byte boundary if required. */
-                    if (alignment == 8) {
-                        MarshalPad(8);
-                    }
-                    uint8_t* elemPos = bufPos;
-                    status = MarshalArgs(arg->v_array.elements, arg->v_array.numElements);
-                    if (status != ER_OK) {
-                        break;
+                if (status != ER_OK) {
+                    break;
+                }
+                status = CheckedArraySize(bufPos - (uint8_t*)msgBuf - elemOffset, len);
+                if (status != ER_OK) {
+                    break;
+                }
+                /* Patch in length */
+                uint8_t* tmpPos = bufPos;
+                bufPos = (uint8_t*)msgBuf + lenOffset;
+                if (endianSwap) {
+                    MarshalReversed(&len, 4);
+                } else {
+                    Marshal4(len);
+                }
+                bufPos = tmpPos;
+            } else {
+                Marshal4(0);
+                if (elem.alignment == 8) {
+                    MarshalPad(8);
+                }
+            }
+        } else if (IsScalarArray(arg->typeId, elem.typeId)) {
+            switch (elem.typeId) {
+            case ALLJOYN_BOOLEAN:
+                status = CheckedArraySize(4 * arg->v_scalarArray.numElements, len);
+                if (status != ER_OK) {
+                    break;
+                }
+                if (len && !arg->v_scalarArray.v_bool) {
+                    status = ER_BUS_BAD_VALUE;
+                    break;
+                }
+                ReserveBytes(len);
+                if (endianSwap) {
+                    MarshalReversed(&len, 4);
+                } else {
+                    Marshal4(len);
+                }
+                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
+                    uint32_t b = arg->v_scalarArray.v_bool[i] ? 1 : 0;
+                    if (endianSwap) {
+                        MarshalReversed(&b, 4);
+                    } else {
+                        Marshal4(b);
                     }
-                    status = CheckedArraySize(bufPos - elemPos, len);
-                    if (status != ER_OK) {
+                }
+                break;
+
+            case ALLJOYN_INT32:
+            case ALLJOYN_UINT32:
+                status = CheckedArraySize(4 * arg->v_scalarArray.numElements, len);
+                if (status != ER_OK) {
+                    break;
+                }
+                if (len && !arg->v_scalarArray.v_uint32) {
+                    status = ER_BUS_BAD_VALUE;
+                    break;
+                }
+                ReserveBytes(len);
+                if (endianSwap) {
+                    MarshalReversed(&len, 4);
+                    EndianSwapArray32(bufPos, arg->v_scalarArray.v_uint32, arg->v_scalarArray.numElements);
+                    bufPos += len;
+                } else {
+                    Marshal4(len);
+                    MarshalBytes(arg->v_scalarArray.v_uint32, len);
+                }
+                break;
+
+            case ALLJOYN_DOUBLE:
+            case ALLJOYN_UINT64:
+            case ALLJOYN_INT64:
+                status = CheckedArraySize(8 * arg->v_scalarArray.numElements, len);
+                if (status != ER_OK) {
+                    break;
+                }
+                if (len > 0) {
+                    if (!arg->v_scalarArray.v_uint64) {
+                        status = ER_BUS_BAD_VALUE;
                         break;
                     }
-                    /* Patch in length */
-                    uint8_t* tmpPos = bufPos;
-                    bufPos = lenPos;
+                    ReserveBytes(len);
                     if (endianSwap) {
                         MarshalReversed(&len, 4);
+                        MarshalPad(8);
+                        EndianSwapArray64(bufPos, arg->v_scalarArray.v_uint64, arg->v_scalarArray.numElements);
+                        bufPos += len;
                     } else {
                         Marshal4(len);
+                        MarshalPad(8);
+                        MarshalBytes(arg->v_scalarArray.v_uint64, len);
                     }
-                    bufPos = tmpPos;
-                }
-            } else {
-                Marshal4(0);
-                if (alignment == 8) {
+                } else {
+                    /* Even empty arrays are padded to the element type alignment boundary */
+                    Marshal4(0);
                     MarshalPad(8);
                 }
-            }
-            break;
-
-        case ALLJOYN_BOOLEAN_ARRAY:
-            status = CheckedArraySize(4 * arg->v_scalarArray.numElements, len);
-            if (status != ER_OK) {
                 break;
-            }
-            if (len && !arg->v_scalarArray.v_bool) {
-                status = ER_BUS_BAD_VALUE;
-                break;
-            }
-            if (endianSwap) {
-                MarshalReversed(&len, 4);
-            } else {
-                Marshal4(len);
-            }
-            for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                uint32_t b = arg->v_scalarArray.v_bool[i] ? 1 : 0;
+
+            case ALLJOYN_INT16:
+            case ALLJOYN_UINT16:
+                status = CheckedArraySize(2 * arg->v_scalarArray.numElements, len);
+                if (status != ER_OK) {
+                    break;
+                }
+                if (len && !arg->v_scalarArray.v_uint16) {
+                    status = ER_BUS_BAD_VALUE;
+                    break;
+                }
+                ReserveBytes(len);
                 if (endianSwap) {
-                    MarshalReversed(&b, 4);
+                    MarshalReversed(&len, 4);
+                    EndianSwapArray16(bufPos, arg->v_scalarArray.v_uint16, arg->v_scalarArray.numElements);
+                    bufPos += len;
                 } else {
-                    Marshal4(b);
+                    Marshal4(len);
+                    MarshalBytes(arg->v_scalarArray.v_uint16, len);
                 }
-            }
-            break;
-
-        case ALLJOYN_INT32_ARRAY:
-        case ALLJOYN_UINT32_ARRAY:
-            status = CheckedArraySize(4 * arg->v_scalarArray.numElements, len);
-            if (status != ER_OK) {
                 break;
-            }
-            if (len && !arg->v_scalarArray.v_uint32) {
-                status = ER_BUS_BAD_VALUE;
-                break;
-            }
-            if (endianSwap) {
-                MarshalReversed(&len, 4);
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    MarshalReversed(&arg->v_scalarArray.v_uint32[i], 4);
-                }
-            } else {
-                Marshal4(len);
-                MarshalBytes(arg->v_scalarArray.v_uint32, len);
-            }
-            break;
 
-        case ALLJOYN_DOUBLE_ARRAY:
-        case ALLJOYN_UINT64_ARRAY:
-        case ALLJOYN_INT64_ARRAY:
-            status = CheckedArraySize(8 * arg->v_scalarArray.numElements, len);
-            if (status != ER_OK) {
-                break;
-            }
-            if (len > 0) {
-                if (!arg->v_scalarArray.v_uint64) {
+            case ALLJOYN_BYTE:
+                status = CheckedArraySize(arg->v_scalarArray.numElements, len);
+                if (status != ER_OK) {
+                    break;
+                }
+                if (len && !arg->v_scalarArray.v_byte) {
                     status = ER_BUS_BAD_VALUE;
                     break;
                 }
+                ReserveBytes(len);
                 if (endianSwap) {
                     MarshalReversed(&len, 4);
-                    MarshalPad(8);
-                    for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                        MarshalReversed(&arg->v_scalarArray.v_uint64[i], 8);
-                    }
                 } else {
                     Marshal4(len);
-                    MarshalPad(8);
-                    MarshalBytes(arg->v_scalarArray.v_uint64, len);
                 }
-            } else {
-                /* Even empty arrays are padded to the element type alignment boundary */
-                Marshal4(0);
-                MarshalPad(8);
-            }
-            break;
-
-        case ALLJOYN_INT16_ARRAY:
-        case ALLJOYN_UINT16_ARRAY:
-            status = CheckedArraySize(2 * arg->v_scalarArray.numElements, len);
-            if (status != ER_OK) {
+                MarshalBytes(arg->v_scalarArray.v_byte, arg->v_scalarArray.numElements);
                 break;
-            }
-            if (len && !arg->v_scalarArray.v_uint16) {
-                status = ER_BUS_BAD_VALUE;
+
+            default:
+                status = ER_BUS_BAD_VALUE_TYPE;
                 break;
             }
+        } else {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        }
+    }
+    break;
+
+    case ALLJOYN_BOOLEAN:
+        if (arg->typeId != ALLJOYN_BOOLEAN) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        } else if (arg->v_bool) {
             if (endianSwap) {
-                MarshalReversed(&len, 4);
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    MarshalReversed(&arg->v_scalarArray.v_uint16[i], 2);
-                }
+                uint32_t b = 1;
+                MarshalReversed(&b, 4);
             } else {
-                Marshal4(len);
-                MarshalBytes(arg->v_scalarArray.v_uint16, len);
+                Marshal4(1);
             }
-            break;
+        } else {
+            Marshal4(0);
+        }
+        break;
 
-        case ALLJOYN_BYTE_ARRAY:
-            status = CheckedArraySize(arg->v_scalarArray.numElements, len);
-            if (status != ER_OK) {
-                break;
-            }
-            if (len && !arg->v_scalarArray.v_byte) {
-                status = ER_BUS_BAD_VALUE;
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+        if (arg->typeId != (AllJoynTypeId)code.typeId) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        } else if (endianSwap) {
+            MarshalReversed(&arg->v_uint32, 4);
+        } else {
+            Marshal4(arg->v_uint32);
+        }
+        break;
+
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_UINT64:
+    case ALLJOYN_INT64:
+        if (arg->typeId != (AllJoynTypeId)code.typeId) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        } else if (endianSwap) {
+            MarshalReversed(&arg->v_uint64, 8);
+        } else {
+            Marshal8(arg->v_uint64);
+        }
+        break;
+
+    case ALLJOYN_SIGNATURE:
+        if (arg->typeId != ALLJOYN_SIGNATURE) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        } else if (arg->v_signature.sig) {
+            if (arg->v_signature.sig[arg->v_signature.len]) {
+                status = ER_BUS_NOT_NUL_TERMINATED;
                 break;
             }
-            if (endianSwap) {
-                MarshalReversed(&len, 4);
-            } else {
-                Marshal4(len);
-            }
-            MarshalBytes(arg->v_scalarArray.v_byte, arg->v_scalarArray.numElements);
-            break;
+            ReserveBytes(arg->v_signature.len + 2);
+            Marshal1(arg->v_signature.len);
+            MarshalBytes((void*)arg->v_signature.sig, arg->v_signature.len + 1);
+        } else {
+            Marshal1(0);
+            Marshal1(0);
+        }
+        break;
 
-        case ALLJOYN_BOOLEAN:
-            if (arg->v_bool) {
-                if (endianSwap) {
-                    uint32_t b = 1;
-                    MarshalReversed(&b, 4);
-                } else {
-                    Marshal4(1);
-                }
-            } else {
-                Marshal4(0);
-            }
-            break;
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+        if (arg->typeId != (AllJoynTypeId)code.typeId) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        } else if (endianSwap) {
+            MarshalReversed(&arg->v_uint16, 2);
+        } else {
+            Marshal2(arg->v_uint16);
+        }
+        break;
 
-        case ALLJOYN_INT32:
-        case ALLJOYN_UINT32:
-            if (endianSwap) {
-                MarshalReversed(&arg->v_uint32, 4);
-            } else {
-                Marshal4(arg->v_uint32);
-            }
+    case ALLJOYN_OBJECT_PATH:
+        if (arg->typeId != ALLJOYN_OBJECT_PATH) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
             break;
-
-        case ALLJOYN_DOUBLE:
-        case ALLJOYN_UINT64:
-        case ALLJOYN_INT64:
-            if (endianSwap) {
-                MarshalReversed(&arg->v_uint64, 8);
-            } else {
-                Marshal8(arg->v_uint64);
-            }
+        }
+        if (!arg->v_objPath.str || (arg->v_objPath.len == 0)) {
+            status = ER_BUS_BAD_OBJ_PATH;
             break;
+        }
 
-        case ALLJOYN_SIGNATURE:
-            if (arg->v_signature.sig) {
-                if (arg->v_signature.sig[arg->v_signature.len]) {
-                    status = ER_BUS_NOT_NUL_TERMINATED;
-                    break;
-                }
-                Marshal1(arg->v_signature.len);
-                MarshalBytes((void*)arg->v_signature.sig, arg->v_signature.len + 1);
-            } else {
-                Marshal1(0);
-                Marshal1(0);
+    // FALLTHROUGH
+    case ALLJOYN_STRING:
+        if (arg->typeId != (AllJoynTypeId)code.typeId) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        } else if (arg->v_string.str) {
+            if (arg->v_string.str[arg->v_string.len]) {
+                status = ER_BUS_NOT_NUL_TERMINATED;
+                break;
             }
-            break;
-
-        case ALLJOYN_INT16:
-        case ALLJOYN_UINT16:
+            ReserveBytes(arg->v_string.len + 5);
             if (endianSwap) {
-                MarshalReversed(&arg->v_uint16, 2);
+                MarshalReversed(&arg->v_string.len, 4);
             } else {
-                Marshal2(arg->v_uint16);
-            }
-            break;
-
-        case ALLJOYN_OBJECT_PATH:
-            if (!arg->v_objPath.str || (arg->v_objPath.len == 0)) {
-                status = ER_BUS_BAD_OBJ_PATH;
-                break;
+                Marshal4(arg->v_string.len);
             }
+            MarshalBytes((void*)arg->v_string.str, arg->v_string.len + 1);
+        } else {
+            Marshal4(0);
+            Marshal1(0);
+        }
+        break;
 
-        // FALLTHROUGH
-        case ALLJOYN_STRING:
-            if (arg->v_string.str) {
-                if (arg->v_string.str[arg->v_string.len]) {
-                    status = ER_BUS_NOT_NUL_TERMINATED;
-                    break;
+    case ALLJOYN_VARIANT:
+        if (arg->typeId != ALLJOYN_VARIANT) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        } else if (!arg->v_variant.val) {
+            status = ER_BUS_BAD_VALUE;
+        } else {
+            SignaturePlanCache& cache = bus->GetInternal().GetSignaturePlanCache();
+            /*
+             * Variants usually hold a basic type so we can avoid building the signature.
+             */
+            AllJoynTypeId valTypeId = arg->v_variant.val->typeId;
+            const SignaturePlan* valPlan = (valTypeId < 0x80) ? cache.GetBasicPlan((char)valTypeId) : NULL;
+            if (valPlan) {
+                Marshal1(1);
+                Marshal1((uint8_t)valTypeId);
+                Marshal1(0);
+                status = MarshalValue(arg->v_variant.val, *valPlan, 0);
+            } else {
+                /* First byte is reserved for the length */
+                char sig[257];
+                size_t len = 0;
+                SignaturePlan scratch;
+                status = SignatureUtils::MakeSignature(arg->v_variant.val, 1, sig + 1, len);
+                if (status == ER_OK) {
+                    status = cache.GetPlan(sig + 1, scratch, valPlan);
                 }
-                if (endianSwap) {
-                    MarshalReversed(&arg->v_string.len, 4);
-                } else {
-                    Marshal4(arg->v_string.len);
+                if (status == ER_OK) {
+                    sig[0] = (char)len;
+                    ReserveBytes(len + 2);
+                    MarshalBytes(sig, len + 2);
+                    status = MarshalValue(arg->v_variant.val, *valPlan, 0);
                 }
-                MarshalBytes((void*)arg->v_string.str, arg->v_string.len + 1);
-            } else {
-                Marshal4(0);
-                Marshal1(0);
-            }
-            break;
-
-        case ALLJOYN_VARIANT:
-        {
-            /* First byte is reserved for the length */
-            char sig[257];
-            size_t len = 0;
-            status = SignatureUtils::MakeSignature(arg->v_variant.val, 1, sig + 1, len);
-            if (status == ER_OK) {
-                sig[0] = (char)len;
-                MarshalBytes(sig, len + 2);
-                status = MarshalArgs(arg->v_variant.val, 1);
             }
         }
         break;
 
-        case ALLJOYN_BYTE:
+    case ALLJOYN_BYTE:
+        if (arg->typeId != ALLJOYN_BYTE) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        } else {
             Marshal1(arg->v_byte);
-            break;
+        }
+        break;
 
-        case ALLJOYN_HANDLE:
-        {
+    case ALLJOYN_HANDLE:
+        if (arg->typeId != ALLJOYN_HANDLE) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+        } else {
             uint32_t index = 0;
             /* Check if handle is already listed */
             while ((index < numHandles) && (handles[index] != arg->v_handle.fd)) {
@@ -436,14 +599,9 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
         }
         break;
 
-        default:
-            status = ER_BUS_BAD_VALUE_TYPE;
-            break;
-        }
-        if (status != ER_OK) {
-            break;
-        }
-        ++arg;
+    default:
+        status = ER_BUS_BAD_VALUE_TYPE;
+        break;
     }
     return status;
 }
@@ -517,19 +675,19 @@ QStatus _Message::Deliver(RemoteEndpoint& endpoint)
     return status;
 }
 
-QStatus _Message::DeliverNonBlocking(RemoteEndpoint& endpoint)
+QStatus _Message::DeliverNonBlocking(RemoteEndpoint& endpoint, MessageWriteState& writeState)
 {
     size_t pushed;
     QStatus status = ER_OK;
     Sink& sink = endpoint->GetSink();
 
-    switch (writeState) {
+    switch (writeState.state) {
     case MESSAGE_NEW:
-        writePtr = reinterpret_cast<uint8_t*>(msgBuf);
-        countWrite = bufEOD - writePtr;
+        writeState.writePtr = reinterpret_cast<const uint8_t*>(msgBuf);
+        writeState.countWrite = bufEOD - writeState.writePtr;
         pushed = 0;
 
-        if (countWrite == 0) {
+        if (writeState.countWrite == 0) {
             status = ER_BUS_EMPTY_MESSAGE;
             QCC_LogError(status, ("Message is empty"));
             return status;
@@ -561,32 +719,32 @@ QStatus _Message::DeliverNonBlocking(RemoteEndpoint& endpoint)
                 return ER_OK;
             }
         }
-        writeState = MESSAGE_HEADERFIELDS;
+        writeState.state = MESSAGE_HEADERFIELDS;
 
     case MESSAGE_HEADERFIELDS:
         if (handles) {
-            status = sink.PushBytesAndFds(writePtr, countWrite, pushed, handles, numHandles, endpoint->GetProcessId());
+            status = sink.PushBytesAndFds(writeState.writePtr, writeState.countWrite, pushed, handles, numHandles, endpoint->GetProcessId());
         } else {
-            status = sink.PushBytes(writePtr, countWrite, pushed, (msgHeader.flags & ALLJOYN_FLAG_SESSIONLESS) ? (ttl * 1000) : ttl);
+            status = sink.PushBytes(writeState.writePtr, writeState.countWrite, pushed, (msgHeader.flags & ALLJOYN_FLAG_SESSIONLESS) ? (ttl * 1000) : ttl);
         }
 
         if (status == ER_OK) {
-            countWrite -= pushed;
-            writePtr += pushed;
-            writeState = MESSAGE_HEADER_BODY;
+            writeState.countWrite -= pushed;
+            writeState.writePtr += pushed;
+            writeState.state = MESSAGE_HEADER_BODY;
         } else break;
 
     case MESSAGE_HEADER_BODY:
         status = ER_OK;
-        while (status == ER_OK && countWrite > 0) {
-            status = sink.PushBytes(writePtr, countWrite, pushed);
+        while (status == ER_OK && writeState.countWrite > 0) {
+            status = sink.PushBytes(writeState.writePtr, writeState.countWrite, pushed);
             if (status == ER_OK) {
-                countWrite -= pushed;
-                writePtr += pushed;
+                writeState.countWrite -= pushed;
+                writeState.writePtr += pushed;
             }
         }
-        if (countWrite == 0) {
-            writeState = MESSAGE_COMPLETE;
+        if (writeState.countWrite == 0) {
+            writeState.state = MESSAGE_COMPLETE;
         }
         break;
 
@@ -699,7 +857,7 @@ void _Message::MarshalHeaderFields()
             {
                 MsgArg variant(ALLJOYN_VARIANT);
                 variant.v_variant.val = field;
-                MarshalArgs(&variant, 1);
+                MarshalValue(&variant, *bus->GetInternal().GetSignaturePlanCache().GetBasicPlan(ALLJOYN_VARIANT), 0);
                 variant.v_variant.val = NULL;
             }
             break;
@@ -783,12 +941,15 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
                                  const MsgArg* args,
                                  uint8_t numArgs,
                                  uint8_t flags,
-                                 uint32_t sessionId)
+                                 uint32_t sessionId,
+                                 const TypedArgsWriter* typedArgs)
 {
-    char signature[256];
     QStatus status = ER_OK;
-    size_t argsLen = (numArgs == 0) ? 0 : SignatureUtils::GetSize(args, numArgs);
+    size_t argsLen = 0;
     size_t hdrLen = 0;
+    SignaturePlan scratch;
+    const SignaturePlan* plan = NULL;
+    size_t sizeHint = 0;
 
     if (!bus->IsStarted()) {
         return ER_BUS_BUS_NOT_STARTED;
@@ -806,14 +967,10 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
     msgHeader.msgType = (uint8_t)msgType;
     msgHeader.majorVersion = ALLJOYN_MAJOR_PROTOCOL_VERSION;
     /*
-     * Encryption will typically make the body length slightly larger because the encryption
-     * algorithm appends a MAC block to the end of the encrypted data.
+     * The body length is not known until the body has been marshaled.
      */
-    if (encrypt) {
-        msgHeader.bodyLen = static_cast<uint32_t>(argsLen + ajn::Crypto::MACLength);
-    } else {
-        msgHeader.bodyLen = static_cast<uint32_t>(argsLen);
-    }
+    msgHeader.bodyLen = 0;
+    hasDispatchKeys = false;
     /*
      * Keep the old message buffer around until we are done because some of the strings we are
      * marshaling may point into the old message.
@@ -855,29 +1012,27 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
         hdrFields.field[ALLJOYN_HDR_FIELD_SENDER].v_string.len = sender.size();
     }
     /*
-     * If there are arguments build the signature
+     * Get the compiled plan for the expected signature. The args are checked against the plan as
+     * they are marshaled.
      */
     hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].Clear();
-    if (numArgs > 0) {
-        size_t sigLen = 0;
-        status = SignatureUtils::MakeSignature(args, numArgs, signature, sigLen);
-        if (status != ER_OK) {
-            goto ExitMarshalMessage;
-        }
-        if (sigLen > 0) {
+    if (!expectedSignature.empty()) {
+        status = bus->GetInternal().GetSignaturePlanCache().GetPlan(expectedSignature.c_str(), scratch, plan, &sizeHint);
+        if (status == ER_OK) {
             hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].typeId = ALLJOYN_SIGNATURE;
-            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].v_signature.sig = signature;
-            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].v_signature.len = (uint8_t)sigLen;
+            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].v_signature.sig = expectedSignature.c_str();
+            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].v_signature.len = expectedSignature.size();
         }
-    } else {
-        signature[0] = 0;
     }
-    /*
-     * Check the signature computed from the args matches the expected signature.
-     */
-    if (expectedSignature != signature) {
+    if (typedArgs) {
+        if ((status != ER_OK) || (strcmp(typedArgs->GetSignature(), expectedSignature.c_str()) != 0)) {
+            status = ER_BUS_UNEXPECTED_SIGNATURE;
+            QCC_LogError(status, ("MarshalMessage expected signature \"%s\" got \"%s\"", expectedSignature.c_str(), typedArgs->GetSignature()));
+            goto ExitMarshalMessage;
+        }
+    } else if ((status != ER_OK) || (numArgs != (plan ? plan->numArgs : 0))) {
         status = ER_BUS_UNEXPECTED_SIGNATURE;
-        QCC_LogError(status, ("MarshalMessage expected signature \"%s\" got \"%s\"", expectedSignature.c_str(), signature));
+        QCC_LogError(status, ("MarshalMessage expected signature \"%s\" got %d args", expectedSignature.c_str(), numArgs));
         goto ExitMarshalMessage;
     }
     /* Check if we are adding a session id */
@@ -900,18 +1055,14 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      */
     hdrLen = ComputeHeaderLen();
     /*
-     * Check that total packet size is within limits
+     * Allocate a buffer for the entire message. The body size is a guess based on the size of the
+     * last message marshaled with the same signature, the buffer grows if the guess is too small.
      */
-    if ((hdrLen + argsLen) > ALLJOYN_MAX_PACKET_LEN) {
-        status = ER_BUS_BAD_BODY_LEN;
-        QCC_LogError(status, ("Message size %d exceeds maximum size", hdrLen + argsLen));
-        goto ExitMarshalMessage;
+    bufSize = hdrLen + (plan ? (std::max)(sizeHint, (size_t)64) : 0) + 8;
+    if (encrypt) {
+        bufSize += ajn::Crypto::MACLength;
     }
-    /*
-     * Allocate buffer for entire message.
-     */
-    bufSize = (hdrLen + msgHeader.bodyLen + 7);
-    _msgBuf = new uint8_t[bufSize + 7];
+    _msgBuf = bus->GetInternal().GetMessageBufferPool().Alloc(bufSize + 7);
     msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
     /*
      * Initialize the buffer and copy in the message header
@@ -942,7 +1093,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      */
     MarshalHeaderFields();
     assert((bufPos - (uint8_t*)msgBuf) == static_cast<ptrdiff_t>(hdrLen));
-    if (msgHeader.bodyLen == 0) {
+    if (!plan) {
         bufEOD = bufPos;
         bodyPtr = NULL;
         goto ExitMarshalMessage;
@@ -951,10 +1102,50 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * Marshal the message body
      */
     bodyPtr = bufPos;
-    status = MarshalArgs(args, numArgs);
-    if (status != ER_OK) {
+    if (typedArgs) {
+        MsgWriter writer(*this);
+        typedArgs->Marshal(writer);
+        status = writer.GetStatus();
+        if (status != ER_OK) {
+            goto ExitMarshalMessage;
+        }
+    }
+    for (size_t i = 0, op = 0; i < numArgs; i++) {
+        status = MarshalValue(&args[i], *plan, op);
+        if (status != ER_OK) {
+            if (status == ER_BUS_UNEXPECTED_SIGNATURE) {
+                QCC_LogError(status, ("MarshalMessage expected signature \"%s\" got \"%s\"", expectedSignature.c_str(), MsgArg::Signature(args, numArgs).c_str()));
+            }
+            goto ExitMarshalMessage;
+        }
+        op = plan->ops[op].next;
+    }
+    argsLen = bufPos - bodyPtr;
+    /*
+     * Check that total packet size is within limits
+     */
+    if ((hdrLen + argsLen) > ALLJOYN_MAX_PACKET_LEN) {
+        status = ER_BUS_BAD_BODY_LEN;
+        QCC_LogError(status, ("Message size %d exceeds maximum size", hdrLen + argsLen));
         goto ExitMarshalMessage;
     }
+    if (argsLen != sizeHint) {
+        bus->GetInternal().GetSignaturePlanCache().SetSizeHint(plan, argsLen);
+    }
+    /*
+     * Encryption will typically make the body length slightly larger because the encryption
+     * algorithm appends a MAC block to the end of the encrypted data.
+     */
+    if (encrypt) {
+        ReserveBytes(ajn::Crypto::MACLength);
+        msgHeader.bodyLen = static_cast<uint32_t>(argsLen + ajn::Crypto::MACLength);
+    } else {
+        msgHeader.bodyLen = static_cast<uint32_t>(argsLen);
+    }
+    /*
+     * Patch the body length into the marshaled header.
+     */
+    ((MessageHeader*)msgBuf)->bodyLen = endianSwap ? EndianSwap32(msgHeader.bodyLen) : msgHeader.bodyLen;
     /*
      * If there handles to be marshalled we need to patch up the message header to add the
      * ALLJOYN_HDR_FIELD_HANDLES field. Since handles are rare it is more efficient to do a
@@ -982,14 +1173,14 @@ ExitMarshalMessage:
     /*
      * Don't need the old message buffer any more
      */
-    delete [] _oldMsgBuf;
+    MessageBufferPool::Free(_oldMsgBuf);
 
     if (status == ER_OK) {
         QCC_DbgHLPrintf(("MarshalMessage: %d+%d %s %s", hdrLen, msgHeader.bodyLen, Description().c_str(), encrypt ? " (encrypted)" : ""));
     } else {
         QCC_LogError(status, ("MarshalMessage: %s", Description().c_str()));
         msgBuf = NULL;
-        delete [] _msgBuf;
+        MessageBufferPool::Free(_msgBuf);
         _msgBuf = NULL;
         bodyPtr = NULL;
         bufPos = NULL;
@@ -1152,7 +1343,8 @@ QStatus _Message::SignalMsg(const qcc::String& signature,
                             const MsgArg* args,
                             size_t numArgs,
                             uint8_t flags,
-                            uint16_t timeToLive)
+                            uint16_t timeToLive,
+                            const TypedArgsWriter* typedArgs)
 {
     QStatus status;
 
@@ -1211,14 +1403,14 @@ QStatus _Message::SignalMsg(const qcc::String& signature,
     /*
      * Build signal message
      */
-    status = MarshalMessage(signature, destination, MESSAGE_SIGNAL, args, numArgs, flags, sessionId);
+    status = MarshalMessage(signature, destination, MESSAGE_SIGNAL, args, numArgs, flags, sessionId, typedArgs);
 
 ExitSignalMsg:
     return status;
 }
 
 
-QStatus _Message::ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs)
+QStatus _Message::ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs, const TypedArgsWriter* typedArgs)
 {
     QStatus status;
     SessionId sessionId = call->GetSessionId();
@@ -1244,7 +1436,7 @@ QStatus _Message::ReplyMsg(const Message& call, const MsgArg* args, size_t numAr
      * Build method return message (encrypted if the method call was encrypted)
      */
     status = MarshalMessage(call->replySignature, destination, MESSAGE_METHOD_RET, args,
-                            numArgs, call->msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED, sessionId);
+                            numArgs, call->msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED, sessionId, typedArgs);
 
     return status;
 }
@@ -1417,7 +1609,16 @@ QStatus _Message::GetExpansion(uint32_t token, MsgArg& replyArg)
 void _Message::SetSerialNumber()
 {
     msgHeader.serialNum = bus->GetInternal().NextSerial();
-    if (msgBuf) {
+    if (MessageBufferPool::IsShared(_msgBuf)) {
+        /*
+         * Other messages or shared arguments reference the buffer so remarshal into a private
+         * buffer, this picks up the new serial number.
+         */
+        QStatus status = ReMarshal(NULL);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to remarshal shared message buffer"));
+        }
+    } else if (msgBuf) {
         ((MessageHeader*)msgBuf)->serialNum = endianSwap ? EndianSwap32(msgHeader.serialNum) : msgHeader.serialNum;
     }
 }
@@ -40,8 +40,11 @@
 #include "BusUtil.h"
 #include "AllJoynCrypto.h"
 #include "AllJoynPeerObj.h"
+#include "ArrayKernels.h"
 #include "SignatureUtils.h"
 #include "BusInternal.h"
+#include "MsgArgArena.h"
+#include "SignaturePlan.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -60,26 +63,187 @@ namespace ajn {
 
 #define MIN_BUF_ADD   (DEFAULT_BUFFER_SIZE / 2)
 
+#define PadUp(n, i)   (((n) + (i) - 1) & ~((i) - 1))
+
 #define VALID_HEADER_FIELD(f) (((f) > ALLJOYN_HDR_FIELD_INVALID) && ((f) < ALLJOYN_HDR_FIELD_UNKNOWN))
 
 
+/*
+ * Skip over a marshaled value without unmarshaling it. This performs the same validity checks as
+ * ParseValue() except for checks that depend on the message header such as handle indices.
+ */
+static QStatus SkipValue(uint8_t*& pos, const uint8_t* eod, const char*& sigPtr, bool endianSwap)
+{
+    QStatus status = ER_OK;
+
+    switch (*sigPtr++) {
+    case ALLJOYN_BYTE:
+        pos += 1;
+        break;
+
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+        pos = AlignPtr(pos, 2) + 2;
+        break;
+
+    case ALLJOYN_BOOLEAN:
+    {
+        pos = AlignPtr(pos, 4);
+        uint32_t v = *((uint32_t*)pos);
+        if (endianSwap) {
+            v = EndianSwap32(v);
+        }
+        if (v > 1) {
+            status = ER_BUS_BAD_VALUE;
+        }
+        pos += 4;
+    }
+    break;
+
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+    case ALLJOYN_HANDLE:
+        pos = AlignPtr(pos, 4) + 4;
+        break;
+
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_UINT64:
+    case ALLJOYN_INT64:
+        pos = AlignPtr(pos, 8) + 8;
+        break;
+
+    case ALLJOYN_OBJECT_PATH:
+    case ALLJOYN_STRING:
+    {
+        pos = AlignPtr(pos, 4);
+        uint32_t len = *((uint32_t*)pos);
+        if (endianSwap) {
+            len = EndianSwap32(len);
+        }
+        if (len > ALLJOYN_MAX_PACKET_LEN) {
+            status = ER_BUS_BAD_LENGTH;
+            break;
+        }
+        pos += 4 + len;
+        if (pos >= eod) {
+            status = ER_BUS_BAD_LENGTH;
+        } else if (*pos++ != 0) {
+            status = ER_BUS_NOT_NUL_TERMINATED;
+        }
+    }
+    break;
+
+    case ALLJOYN_SIGNATURE:
+        pos += 1 + *pos;
+        if (pos >= eod) {
+            status = ER_BUS_BAD_LENGTH;
+        } else if (*pos++ != 0) {
+            status = ER_BUS_NOT_NUL_TERMINATED;
+        }
+        break;
+
+    case ALLJOYN_ARRAY:
+    {
+        char elemTypeId = *sigPtr;
+        status = SignatureUtils::ParseCompleteType(sigPtr);
+        if (status != ER_OK) {
+            break;
+        }
+        pos = AlignPtr(pos, 4);
+        uint32_t len = *((uint32_t*)pos);
+        if (endianSwap) {
+            len = EndianSwap32(len);
+        }
+        pos += 4;
+        if ((len > ALLJOYN_MAX_ARRAY_LEN) || ((len + pos) > eod)) {
+            status = ER_BUS_BAD_LENGTH;
+            break;
+        }
+        switch (elemTypeId) {
+        case ALLJOYN_DOUBLE:
+        case ALLJOYN_UINT64:
+        case ALLJOYN_INT64:
+        case ALLJOYN_STRUCT_OPEN:
+        case ALLJOYN_DICT_ENTRY_OPEN:
+            pos = AlignPtr(pos, 8);
+            break;
+
+        default:
+            break;
+        }
+        pos += len;
+    }
+    break;
+
+    case ALLJOYN_STRUCT_OPEN:
+    case ALLJOYN_DICT_ENTRY_OPEN:
+        pos = AlignPtr(pos, 8);
+        while ((status == ER_OK) && (*sigPtr != ALLJOYN_STRUCT_CLOSE) && (*sigPtr != ALLJOYN_DICT_ENTRY_CLOSE)) {
+            if (*sigPtr == 0) {
+                status = ER_BUS_BAD_SIGNATURE;
+            } else {
+                status = SkipValue(pos, eod, sigPtr, endianSwap);
+            }
+        }
+        if (status == ER_OK) {
+            ++sigPtr;
+        }
+        break;
+
+    case ALLJOYN_VARIANT:
+    {
+        size_t len = (size_t)(*pos);
+        const char* varSig = (char*)(++pos);
+        pos += len;
+        if (pos >= eod) {
+            status = ER_BUS_BAD_LENGTH;
+        } else if (*pos++ != 0) {
+            status = ER_BUS_BAD_SIGNATURE;
+        } else {
+            status = SkipValue(pos, eod, varSig, endianSwap);
+            if ((status == ER_OK) && (*varSig != 0)) {
+                status = ER_BUS_BAD_SIGNATURE;
+            }
+        }
+    }
+    break;
+
+    default:
+        status = ER_BUS_BAD_VALUE_TYPE;
+        break;
+    }
+    if ((status == ER_OK) && (pos > eod)) {
+        status = ER_BUS_BAD_SIGNATURE;
+    }
+    return status;
+}
+
+/*
+ * Count the elements in a marshaled array so the array of MsgArgs can be allocated before the
+ * elements are unmarshaled. If the array is malformed the count is of the elements before the
+ * error, the error itself will be reported when the elements are unmarshaled.
+ */
+static size_t CountArrayElements(uint8_t* pos, const uint8_t* endOfArray, const uint8_t* eod, const char* elemSig, bool endianSwap)
+{
+    size_t numElements = 0;
+    while (pos < endOfArray) {
+        const char* sigPtr = elemSig;
+        if (SkipValue(pos, eod, sigPtr, endianSwap) != ER_OK) {
+            break;
+        }
+        ++numElements;
+    }
+    return numElements;
+}
+
 
-QStatus _Message::ParseArray(MsgArg* arg,
-                             const char*& sigPtr)
+QStatus _Message::ParseArray(MsgArg* arg, const SignaturePlan& plan, size_t op)
 {
-    QStatus status;
+    QStatus status = ER_OK;
     uint32_t len;
-    const char* sigStart = sigPtr;
+    const size_t elemOp = op + 1;
+    const SignaturePlan::Op& elem = plan.ops[elemOp];
 
-    /*
-     * First check that the array type signature is valid
-     */
-    arg->typeId = ALLJOYN_ARRAY;
-    status = SignatureUtils::ParseContainerSignature(*arg, sigPtr);
-    if (status != ER_OK) {
-        arg->typeId = ALLJOYN_INVALID;
-        return status;
-    }
     /*
      * Length is aligned on a 4 byte boundary
      */
@@ -104,7 +268,7 @@ QStatus _Message::ParseArray(MsgArg* arg,
      * Note: at this point alignment is on a 4 bytes boundary so we only need to align values that
      * need 8 byte alignment.
      */
-    switch (char elemTypeId = *sigStart) {
+    switch (char elemTypeId = (char)elem.typeId) {
     case ALLJOYN_BYTE:
         arg->typeId = (AllJoynTypeId)((elemTypeId << 8) | ALLJOYN_ARRAY);
         arg->v_scalarArray.numElements = (size_t)len;
@@ -118,13 +282,9 @@ QStatus _Message::ParseArray(MsgArg* arg,
             arg->typeId = (AllJoynTypeId)((elemTypeId << 8) | ALLJOYN_ARRAY);
             arg->v_scalarArray.numElements = (size_t)(len / 2);
             if (endianSwap) {
-                arg->v_scalarArray.v_uint16 = new uint16_t[arg->v_scalarArray.numElements];
-                uint16_t* p = (uint16_t*)arg->v_scalarArray.v_uint16;
-                uint16_t* n = (uint16_t*)bufPos;
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    *p++ = EndianSwap16(*n++);
-                }
-                arg->flags = MsgArg::OwnsData;
+                uint16_t* swapped = (uint16_t*)argArena->Alloc(len);
+                EndianSwapArray16(swapped, bufPos, arg->v_scalarArray.numElements);
+                arg->v_scalarArray.v_uint16 = swapped;
             } else {
                 arg->v_scalarArray.v_uint16 = (uint16_t*)bufPos;
             }
@@ -137,33 +297,18 @@ QStatus _Message::ParseArray(MsgArg* arg,
     case ALLJOYN_BOOLEAN:
         if ((len & 3) == 0) {
             size_t num = (size_t)(len / 4);
-            bool* bools = new bool[num];
-            for (size_t i = 0; i < num; i++) {
-                uint32_t b = *(uint32_t*)bufPos;
-                if (endianSwap) {
-                    b = EndianSwap32(b);
-                }
-                if (b > 1) {
-                    delete [] bools;
-                    status = ER_BUS_BAD_VALUE;
-                    break;
-                }
-                bools[i] = (b == 1);
-                bufPos += 4;
-            }
+            bool* bools = (bool*)argArena->Alloc(num * sizeof(bool));
             /*
-             * if status is set to ER_BUS_BAD_VALUE it means the for loop above
-             * found that the value was not an ALLJOYN_BOOLEAN type and deleted
-             * the array 'bools' then exited the for loop. Do not try and set
-             * the 'v_scalarArray.v_bool' to the now invalid 'bools'.
+             * Marshaled booleans must have a value of 0 or 1
              */
-            if (status == ER_BUS_BAD_VALUE) {
+            if (!NarrowBoolArray(bools, bufPos, num, endianSwap)) {
+                status = ER_BUS_BAD_VALUE;
                 break;
             }
+            bufPos += len;
             arg->typeId = ALLJOYN_BOOLEAN_ARRAY;
             arg->v_scalarArray.numElements = num;
             arg->v_scalarArray.v_bool = bools;
-            arg->flags = MsgArg::OwnsData;
         } else {
             status = ER_BUS_BAD_LENGTH;
         }
@@ -175,13 +320,9 @@ QStatus _Message::ParseArray(MsgArg* arg,
             arg->typeId = (AllJoynTypeId)((elemTypeId << 8) | ALLJOYN_ARRAY);
             arg->v_scalarArray.numElements = (size_t)(len / 4);
             if (endianSwap) {
-                arg->v_scalarArray.v_uint32 = new uint32_t[arg->v_scalarArray.numElements];
-                uint32_t* p = (uint32_t*)arg->v_scalarArray.v_uint32;
-                uint32_t* n = (uint32_t*)bufPos;
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    *p++ = EndianSwap32(*n++);
-                }
-                arg->flags = MsgArg::OwnsData;
+                uint32_t* swapped = (uint32_t*)argArena->Alloc(len);
+                EndianSwapArray32(swapped, bufPos, arg->v_scalarArray.numElements);
+                arg->v_scalarArray.v_uint32 = swapped;
             } else {
                 arg->v_scalarArray.v_uint32 = (uint32_t*)bufPos;
             }
@@ -198,15 +339,10 @@ QStatus _Message::ParseArray(MsgArg* arg,
             arg->typeId = (AllJoynTypeId)((elemTypeId << 8) | ALLJOYN_ARRAY);
             arg->v_scalarArray.numElements = (size_t)(len / 8);
             bufPos = AlignPtr(bufPos, 8);
-            arg->v_scalarArray.v_uint64 = (uint64_t*)bufPos;
             if (endianSwap) {
-                arg->v_scalarArray.v_uint64 = new uint64_t[arg->v_scalarArray.numElements];
-                uint64_t* p = (uint64_t*)arg->v_scalarArray.v_uint64;
-                uint64_t* n = (uint64_t*)bufPos;
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    *p++ = EndianSwap64(*n++);
-                }
-                arg->flags = MsgArg::OwnsData;
+                uint64_t* swapped = (uint64_t*)argArena->Alloc(len);
+                EndianSwapArray64(swapped, bufPos, arg->v_scalarArray.numElements);
+                arg->v_scalarArray.v_uint64 = swapped;
             } else {
                 arg->v_scalarArray.v_uint64 = (uint64_t*)bufPos;
             }
@@ -227,48 +363,46 @@ QStatus _Message::ParseArray(MsgArg* arg,
     /* Falling through */
     default:
     {
-        qcc::String elemSig(sigStart, sigPtr - sigStart);
+        const char* elemSig = plan.GetSignature(elem);
         size_t numElements = 0;
         MsgArg* elements = NULL;
         if (len > 0) {
             /*
-             * We know how many bytes there are in the array but not how many elements until we
-             * unmarshal them.
+             * We know how many bytes there are in the array but not how many elements. If the
+             * elements have a fixed size the count can be calculated from the length, otherwise
+             * count them before allocating the elements.
              */
             uint8_t* endOfArray = bufPos + len;
-            size_t capacity = 8;
-            numElements = 0;
-            elements = new MsgArg[capacity];
+            size_t capacity;
+            size_t stride = PadUp(elem.fixedSize, elem.alignment);
+            if (elem.fixedSize && (len >= elem.fixedSize) && (((len - elem.fixedSize) % stride) == 0)) {
+                capacity = ((len - elem.fixedSize) / stride) + 1;
+            } else {
+                capacity = CountArrayElements(bufPos, endOfArray, bufEOD, elemSig, endianSwap);
+            }
+            elements = argArena->NewArgs(capacity);
             /*
              * Loop until we have consumed all of the data bytes
              */
             while (bufPos < endOfArray) {
                 if (numElements == capacity) {
-                    capacity *= 2;
-                    MsgArg* bigger = new MsgArg[capacity];
-                    memcpy(bigger, elements, numElements * sizeof(MsgArg));
                     /*
-                     * Clear the flags to prevent the destructor from freeing anything other
-                     * than the MsgArgs.
+                     * The count stopped short at a malformed element. Make room so the element
+                     * parse below reports the error.
                      */
-                    for (size_t i = 0; i < numElements; i++) {
-                        elements[i].flags = 0;
-                    }
-                    delete [] elements;
+                    capacity = numElements + 1;
+                    MsgArg* bigger = argArena->NewArgs(capacity);
+                    memcpy(bigger, elements, numElements * sizeof(MsgArg));
                     elements = bigger;
                 }
-                const char* esig = elemSig.c_str();
-                status = ParseValue(&elements[numElements++], esig, true);
+                status = ParseValue(&elements[numElements++], plan, elemOp);
                 if (status != ER_OK) {
                     break;
                 }
             }
         }
         if (status == ER_OK) {
-            arg->v_array.SetElements(elemSig.c_str(), numElements, elements);
-            arg->flags |= MsgArg::OwnsArgs;
-        } else {
-            delete [] elements;
+            argArena->SetElements(*arg, elemSig, elem.sigLen, numElements, elements);
         }
     }
     break;
@@ -283,18 +417,9 @@ QStatus _Message::ParseArray(MsgArg* arg,
 /*
  * Parse a STRUCT
  */
-QStatus _Message::ParseStruct(MsgArg* arg, const char*& sigPtr)
+QStatus _Message::ParseStruct(MsgArg* arg, const SignaturePlan& plan, size_t op)
 {
-    const char* memberSig = sigPtr;
-    /*
-     * First check that the struct type signature is valid
-     */
-    arg->typeId = ALLJOYN_STRUCT;
-    QStatus status = SignatureUtils::ParseContainerSignature(*arg, sigPtr);
-    if (status != ER_OK) {
-        QCC_LogError(status, ("ParseStruct error in signature\n"));
-        return status;
-    }
+    QStatus status = ER_OK;
     /*
      * Structs are aligned on an 8 byte boundary
      */
@@ -302,14 +427,17 @@ QStatus _Message::ParseStruct(MsgArg* arg, const char*& sigPtr)
 
     QCC_DbgPrintf(("ParseStruct at pos:%d", bufPos - bodyPtr));
 
-    arg->v_struct.members = new MsgArg[arg->v_struct.numMembers];
-    arg->flags |= MsgArg::OwnsArgs;
+    arg->typeId = ALLJOYN_STRUCT;
+    arg->v_struct.numMembers = plan.ops[op].numMembers;
+    arg->v_struct.members = argArena->NewArgs(arg->v_struct.numMembers);
+    size_t memberOp = op + 1;
     for (uint32_t i = 0; i < arg->v_struct.numMembers; ++i) {
-        status = ParseValue(&arg->v_struct.members[i], memberSig);
+        status = ParseValue(&arg->v_struct.members[i], plan, memberOp);
         if (status != ER_OK) {
             arg->v_struct.numMembers = i;
             break;
         }
+        memberOp = plan.ops[memberOp].next;
     }
     return status;
 }
@@ -318,32 +446,23 @@ QStatus _Message::ParseStruct(MsgArg* arg, const char*& sigPtr)
 /*
  * Parse a DICT ENTRY
  */
-QStatus _Message::ParseDictEntry(MsgArg* arg,
-                                 const char*& sigPtr)
+QStatus _Message::ParseDictEntry(MsgArg* arg, const SignaturePlan& plan, size_t op)
 {
-    const char* memberSig = sigPtr;
     /*
-     * First check that the dict entry type signature is valid
+     * Dict entries are aligned on an 8 byte boundary
      */
-    arg->typeId = ALLJOYN_DICT_ENTRY;
-    QStatus status = SignatureUtils::ParseContainerSignature(*arg, sigPtr);
-    if (status != ER_OK) {
-        arg->typeId = ALLJOYN_INVALID;
-    } else {
-        /*
-         * Dict entries are aligned on an 8 byte boundary
-         */
-        bufPos = AlignPtr(bufPos, 8);
+    bufPos = AlignPtr(bufPos, 8);
 
-        QCC_DbgPrintf(("ParseDictEntry at pos:%d", bufPos - bodyPtr));
+    QCC_DbgPrintf(("ParseDictEntry at pos:%d", bufPos - bodyPtr));
 
-        arg->v_dictEntry.key = new MsgArg();
-        arg->v_dictEntry.val = new MsgArg();
-        arg->flags |= MsgArg::OwnsArgs;
-        status = ParseValue(arg->v_dictEntry.key, memberSig);
-        if (status == ER_OK) {
-            status = ParseValue(arg->v_dictEntry.val, memberSig);
-        }
+    arg->typeId = ALLJOYN_DICT_ENTRY;
+    MsgArg* keyVal = argArena->NewArgs(2);
+    arg->v_dictEntry.key = &keyVal[0];
+    arg->v_dictEntry.val = &keyVal[1];
+    size_t keyOp = op + 1;
+    QStatus status = ParseValue(arg->v_dictEntry.key, plan, keyOp);
+    if (status == ER_OK) {
+        status = ParseValue(arg->v_dictEntry.val, plan, plan.ops[keyOp].next);
     }
     return status;
 }
@@ -366,15 +485,22 @@ QStatus _Message::ParseVariant(MsgArg* arg)
     } else if (*bufPos++ != 0) {
         status = ER_BUS_BAD_SIGNATURE;
     } else {
-        arg->v_variant.val = new MsgArg();
-        arg->flags |= MsgArg::OwnsArgs;
-        status = ParseValue(arg->v_variant.val, sigPtr);
-        if ((status == ER_OK) && (*sigPtr != 0)) {
+        /*
+         * The variant signature must be a single complete type
+         */
+        SignaturePlan scratch;
+        const SignaturePlan* plan;
+        status = bus->GetInternal().GetSignaturePlanCache().FindPlan(sigPtr, scratch, plan);
+        if ((status == ER_OK) && (plan->numArgs != 1)) {
             status = ER_BUS_BAD_SIGNATURE;
         }
+        if (status == ER_OK) {
+            arg->v_variant.val = argArena->NewArgs(1);
+            status = ParseValue(arg->v_variant.val, *plan, 0);
+        }
     }
     if (status != ER_OK) {
-        delete arg->v_variant.val;
+        arg->v_variant.val = NULL;
         arg->typeId = ALLJOYN_INVALID;
     }
     return status;
@@ -398,12 +524,12 @@ QStatus _Message::ParseSignature(MsgArg* arg)
 }
 
 
-QStatus _Message::ParseValue(MsgArg* arg, const char*& sigPtr, bool arrayElem)
+QStatus _Message::ParseValue(MsgArg* arg, const SignaturePlan& plan, size_t op)
 {
     QStatus status = ER_OK;
 
     arg->Clear();
-    switch (AllJoynTypeId typeId = (AllJoynTypeId)(*sigPtr++)) {
+    switch (AllJoynTypeId typeId = (AllJoynTypeId)plan.ops[op].typeId) {
     case ALLJOYN_BYTE:
         arg->v_byte = *bufPos++;
         arg->typeId = typeId;
@@ -493,20 +619,16 @@ QStatus _Message::ParseValue(MsgArg* arg, const char*& sigPtr, bool arrayElem)
         break;
 
     case ALLJOYN_ARRAY:
-        status = ParseArray(arg, sigPtr);
+        status = ParseArray(arg, plan, op);
         break;
 
     case ALLJOYN_DICT_ENTRY_OPEN:
-        if (arrayElem) {
-            status = ParseDictEntry(arg, sigPtr);
-        } else {
-            status = ER_BUS_BAD_SIGNATURE;
-            QCC_LogError(status, ("Message arg parse error naked dicitionary element"));
-        }
+        /* The plan only allows dictionary entries as array elements */
+        status = ParseDictEntry(arg, plan, op);
         break;
 
     case ALLJOYN_STRUCT_OPEN:
-        status = ParseStruct(arg, sigPtr);
+        status = ParseStruct(arg, plan, op);
         break;
 
     case ALLJOYN_VARIANT:
@@ -560,9 +682,26 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
     QStatus status = ER_OK;
     int _numMsgArgs = 0;
     MsgArg* _msgArgs = NULL;
+    SignaturePlan scratch;
+    const SignaturePlan* plan = NULL;
+    size_t op = 0;
 
     /* Check if message body is already unmarshaled */
     if (msgArgs != NULL) {
+        /*
+         * Shared arguments were unmarshaled for another receiver so the checks for this receiver
+         * have not been done yet.
+         */
+        if (sharedArgs) {
+            if ((expectedSignature != sig) && (expectedSignature != WildCardSignature)) {
+                status = ER_BUS_SIGNATURE_MISMATCH;
+                QCC_LogError(status, ("Expected \"%s\" got \"%s\"", expectedSignature.c_str(), sig));
+                return status;
+            }
+            if (expectedReplySignature) {
+                replySignature = expectedReplySignature;
+            }
+        }
         return ER_OK;
     }
 
@@ -620,21 +759,29 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
         authMechanism = key.GetTag();
     }
     /*
-     * Calculate how many arguments there are
+     * Get the compiled signature, this also tells us how many arguments there are
      */
-    _numMsgArgs = SignatureUtils::CountCompleteTypes(sig);
-    _msgArgs = new MsgArg[_numMsgArgs];
+    status = bus->GetInternal().GetSignaturePlanCache().FindPlan(sig, scratch, plan);
+    if (status != ER_OK) {
+        goto ExitUnmarshalArgs;
+    }
+    _numMsgArgs = plan->numArgs;
+    if (!argArena) {
+        argArena = new MsgArgArena();
+    }
+    _msgArgs = argArena->NewArgs(_numMsgArgs);
 
     /*
      * Unmarshal the body values
      */
     bufPos = bodyPtr;
     for (uint8_t i = 0; i < _numMsgArgs; i++) {
-        status = ParseValue(&_msgArgs[i], sig);
+        status = ParseValue(&_msgArgs[i], *plan, op);
         if (status != ER_OK) {
             _numMsgArgs = i;
             goto ExitUnmarshalArgs;
         }
+        op = plan->ops[op].next;
     }
     if ((bufPos - bodyPtr) != static_cast<ptrdiff_t>(msgHeader.bodyLen)) {
         QCC_DbgHLPrintf(("UnmarshalArgs expected argLen %d got %d", msgHeader.bodyLen, (bufPos - bodyPtr)));
@@ -669,7 +816,7 @@ ExitUnmarshalArgs:
         numMsgArgs = _numMsgArgs;
     } else {
         if (_msgArgs) {
-            delete [] _msgArgs;
+            argArena->Reset();
         }
         QCC_LogError(status, ("UnmarshalArgs failed"));
     }
@@ -783,6 +930,25 @@ static const AllJoynFieldType FieldTypeMapping[] = {
 };
 
 
+/*
+ * Header fields that are not needed to route a message. When a message is being forwarded
+ * cut-through these fields are skipped and only parsed if the message is delivered locally.
+ */
+static inline bool IsDeferrableField(AllJoynFieldType fieldId)
+{
+    switch (fieldId) {
+    case ALLJOYN_HDR_FIELD_PATH:
+    case ALLJOYN_HDR_FIELD_INTERFACE:
+    case ALLJOYN_HDR_FIELD_MEMBER:
+    case ALLJOYN_HDR_FIELD_ERROR_NAME:
+    case ALLJOYN_HDR_FIELD_SIGNATURE:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
 /*
  * Perform consistency checks on the header
  */
@@ -791,32 +957,32 @@ QStatus _Message::HeaderChecks(bool pedantic)
     QStatus status = ER_OK;
     switch (msgHeader.msgType) {
     case MESSAGE_SIGNAL:
-        if (hdrFields.field[ALLJOYN_HDR_FIELD_INTERFACE].typeId == ALLJOYN_INVALID) {
+        if (!HasHeaderField(ALLJOYN_HDR_FIELD_INTERFACE)) {
             status = ER_BUS_INTERFACE_MISSING;
             break;
         }
 
     /* Falling through */
     case MESSAGE_METHOD_CALL:
-        if (hdrFields.field[ALLJOYN_HDR_FIELD_PATH].typeId == ALLJOYN_INVALID) {
+        if (!HasHeaderField(ALLJOYN_HDR_FIELD_PATH)) {
             status = ER_BUS_PATH_MISSING;
             break;
         }
-        if (hdrFields.field[ALLJOYN_HDR_FIELD_MEMBER].typeId == ALLJOYN_INVALID) {
+        if (!HasHeaderField(ALLJOYN_HDR_FIELD_MEMBER)) {
             status = ER_BUS_MEMBER_MISSING;
             break;
         }
         break;
 
     case MESSAGE_ERROR:
-        if (hdrFields.field[ALLJOYN_HDR_FIELD_ERROR_NAME].typeId == ALLJOYN_INVALID) {
+        if (!HasHeaderField(ALLJOYN_HDR_FIELD_ERROR_NAME)) {
             status = ER_BUS_ERROR_NAME_MISSING;
             break;
         }
 
     /* Falling through */
     case MESSAGE_METHOD_RET:
-        if (hdrFields.field[ALLJOYN_HDR_FIELD_REPLY_SERIAL].typeId == ALLJOYN_INVALID) {
+        if (!HasHeaderField(ALLJOYN_HDR_FIELD_REPLY_SERIAL)) {
             status = ER_BUS_REPLY_SERIAL_MISSING;
             break;
         }
@@ -840,6 +1006,65 @@ QStatus _Message::HeaderChecks(bool pedantic)
 
 }
 
+QStatus _Message::ParseDeferredHeaderFields()
+{
+    QStatus status = ER_OK;
+    if (!hasDeferredFields) {
+        return status;
+    }
+    uint8_t* savPos = bufPos;
+    for (uint32_t fieldId = ALLJOYN_HDR_FIELD_PATH; fieldId < ArraySize(deferredFields); fieldId++) {
+        if (deferredFields[fieldId]) {
+            const SignaturePlan* plan = bus->GetInternal().GetSignaturePlanCache().GetBasicPlan(HeaderFields::FieldType[fieldId]);
+            bufPos = (uint8_t*)msgBuf + deferredFields[fieldId];
+            deferredFields[fieldId] = 0;
+            if (status == ER_OK) {
+                status = ParseValue(&hdrFields.field[fieldId], *plan, 0);
+            }
+        }
+    }
+    bufPos = savPos;
+    hasDeferredFields = false;
+    /*
+     * The header checks were skipped when the message was unmarshaled
+     */
+    if (status == ER_OK) {
+        status = HeaderChecks(true);
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to parse deferred header fields"));
+    }
+    return status;
+}
+
+QStatus _Message::CheckDeferredHeaderFields()
+{
+    QStatus status = ER_OK;
+    if (!hasDeferredFields) {
+        return status;
+    }
+    uint8_t* savPos = bufPos;
+    for (uint32_t fieldId = ALLJOYN_HDR_FIELD_PATH; (status == ER_OK) && (fieldId < ArraySize(deferredFields)); fieldId++) {
+        if (deferredFields[fieldId]) {
+            /*
+             * String values are parsed in place so checking a field does not allocate anything.
+             */
+            MsgArg field;
+            const SignaturePlan* plan = bus->GetInternal().GetSignaturePlanCache().GetBasicPlan(HeaderFields::FieldType[fieldId]);
+            bufPos = (uint8_t*)msgBuf + deferredFields[fieldId];
+            status = ParseValue(&field, *plan, 0);
+            if (status == ER_OK) {
+                status = PedanticCheck(&field, fieldId);
+            }
+        }
+    }
+    bufPos = savPos;
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Invalid deferred header field"));
+    }
+    return status;
+}
+
 /* Check the first 16 bytes of the header */
 QStatus _Message::InterpretHeader()
 {
@@ -890,7 +1115,7 @@ QStatus _Message::InterpretHeader()
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
     bufSize = sizeof(msgHeader) + ((pktSize + 7) & ~7) + sizeof(uint64_t);
-    _msgBuf = new uint8_t[bufSize + 7];
+    _msgBuf = bus->GetInternal().GetMessageBufferPool().Alloc(bufSize + 7);
     msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
     /*
      * Copy header into the buffer
@@ -989,6 +1214,56 @@ QStatus _Message::PullBytes(RemoteEndpoint& endpoint, bool checkSender, bool ped
     return status;
 
 }
+QStatus _Message::LoadBytes(const uint8_t*& data, size_t& avail)
+{
+    QStatus status = ER_OK;
+    size_t toCopy;
+
+    switch (readState) {
+    case MESSAGE_NEW:
+        /* Handles cannot accompany buffered data */
+        maxFds = 0;
+        readState = MESSAGE_HEADERFIELDS;
+        bufPos = (uint8_t*)&msgHeader;
+        countRead = sizeof(msgHeader);
+
+    case MESSAGE_HEADERFIELDS:
+        /* First 16 bytes of the message */
+        toCopy = (std::min)(countRead, avail);
+        memcpy(bufPos, data, toCopy);
+        bufPos += toCopy;
+        countRead -= toCopy;
+        data += toCopy;
+        avail -= toCopy;
+        if (countRead != 0) {
+            break;
+        }
+        status = InterpretHeader();
+        if (status != ER_OK) {
+            break;
+        }
+
+    /* Falling through */
+    case MESSAGE_HEADER_BODY:
+        /* Rest of the message header and body */
+        toCopy = (std::min)(countRead, avail);
+        memcpy(bufPos, data, toCopy);
+        bufPos += toCopy;
+        countRead -= toCopy;
+        data += toCopy;
+        avail -= toCopy;
+        if (countRead == 0) {
+            readState = MESSAGE_COMPLETE;
+            bufPos = (uint8_t*)msgBuf + sizeof(msgHeader);
+        }
+        break;
+
+    case MESSAGE_COMPLETE:
+        break;
+    }
+    return status;
+}
+
 QStatus _Message::ReadNonBlocking(RemoteEndpoint& endpoint, bool checkSender, bool pedantic)
 {
 
@@ -1014,7 +1289,7 @@ QStatus _Message::Read(RemoteEndpoint& endpoint, bool checkSender, bool pedantic
      * Clear out any stale message state
      */
     msgBuf = NULL;
-    delete [] _msgBuf;
+    MessageBufferPool::Free(_msgBuf);
     _msgBuf = NULL;
     ClearHeader();
     readState = MESSAGE_NEW;
@@ -1043,6 +1318,11 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
     bufPos = (uint8_t*)msgBuf + sizeof(msgHeader);
     endOfHdr = bufPos + msgHeader.headerLen;
     rcvEndpointName = endpoint->GetUniqueName();
+    /*
+     * Compressed headers must be fully parsed to be expanded and sessionless signals are always
+     * delivered locally so neither can be forwarded cut-through.
+     */
+    bool cutThrough = endpoint->GetFeatures().cutThrough && !(msgHeader.flags & (ALLJOYN_FLAG_COMPRESSED | ALLJOYN_FLAG_SESSIONLESS));
 
     /*
      * Parse the received header fields - each header starts on an 8 byte boundary
@@ -1070,19 +1350,27 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
             break;
         }
         if (fieldId == ALLJOYN_HDR_FIELD_UNKNOWN) {
-            MsgArg unknownHdr;
             /*
-             * Unknown fields are parsed but otherwise ignored
+             * Unknown fields are checked but otherwise ignored
              */
-            status = ParseValue(&unknownHdr, sigPtr);
+            status = SkipValue(bufPos, endOfHdr, sigPtr, endianSwap);
         } else {
             /*
              * Currently all header fields have a single character type code
              */
             if ((sigLen != 1) || (sigPtr[0] != HeaderFields::FieldType[fieldId]) || (sigPtr[1] != 0)) {
                 status = ER_BUS_BAD_HEADER_FIELD;
+            } else if (cutThrough && IsDeferrableField(fieldId)) {
+                /*
+                 * Record where the value is so it can be parsed later if it is needed
+                 */
+                hdrFields.field[fieldId].Clear();
+                deferredFields[fieldId] = (uint32_t)(bufPos - (uint8_t*)msgBuf);
+                hasDeferredFields = true;
+                status = SkipValue(bufPos, endOfHdr, sigPtr, endianSwap);
             } else {
-                status = ParseValue(&hdrFields.field[fieldId], sigPtr);
+                const SignaturePlan* plan = bus->GetInternal().GetSignaturePlanCache().GetBasicPlan(*sigPtr++);
+                status = ParseValue(&hdrFields.field[fieldId], *plan, 0);
             }
         }
         if (*sigPtr != 0) {
@@ -1128,9 +1416,25 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
         hdrFields.field[ALLJOYN_HDR_FIELD_COMPRESSION_TOKEN].typeId = ALLJOYN_INVALID;
     }
     /*
-     * Check the validity of the message header
+     * Check the validity of the message header. Deferred header fields count as present, their
+     * values are checked when they are parsed or before the message is forwarded. Messages
+     * without a destination are never forwarded cut-through.
      */
     status = HeaderChecks(pedantic);
+    if (status == ER_OK) {
+        if (!hasDeferredFields) {
+            /*
+             * Compute the handler lookup keys while the header fields are still in the cache.
+             * Messages that are being forwarded cut-through are rarely dispatched locally so they
+             * get their keys computed if and when they are needed.
+             */
+            if (!cutThrough && ((msgHeader.msgType == MESSAGE_METHOD_CALL) || (msgHeader.msgType == MESSAGE_SIGNAL))) {
+                ComputeDispatchKeys();
+            }
+        } else if (hdrFields.field[ALLJOYN_HDR_FIELD_DESTINATION].typeId == ALLJOYN_INVALID) {
+            status = ParseDeferredHeaderFields();
+        }
+    }
     /*
      * Check if there are handles accompanying this message and if we expect them.
      */
@@ -1268,7 +1572,7 @@ ExitUnmarshal:
          * There was an unrecoverable failure while unmarshaling the message, cleanup before we return.
          */
         msgBuf = NULL;
-        delete [] _msgBuf;
+        MessageBufferPool::Free(_msgBuf);
         _msgBuf = NULL;
         ClearHeader();
         if ((status != ER_SOCK_OTHER_END_CLOSED) && (status != ER_STOPPING_THREAD)) {
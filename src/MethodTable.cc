@@ -23,6 +23,9 @@
 
 #include <qcc/platform.h>
 
+#include <string.h>
+#include <vector>
+
 #include "MethodTable.h"
 
 /** @internal */
@@ -39,39 +42,77 @@ MethodTable::~MethodTable()
     MapType::iterator iter = hashTable.begin();
     while (iter != hashTable.end()) {
         delete iter->second;
+        ++iter;
     }
 
     hashTable.clear();
     lock.Unlock(MUTEX_CONTEXT);
 }
 
+bool MethodTable::Matches(const Entry* entry, const char* objectPath, const char* iface, const char* methodName)
+{
+    if ((strcmp(entry->methodStr.c_str(), methodName) != 0) || (strcmp(entry->object->GetPath(), objectPath) != 0)) {
+        return false;
+    }
+    /* A method call without an interface matches the method on any interface */
+    return !iface || !*iface || (strcmp(entry->ifaceStr.c_str(), iface) == 0);
+}
+
 void MethodTable::Add(BusObject* object,
                       MessageReceiver::MethodHandler func,
                       const InterfaceDescription::Member* member,
                       void* context)
 {
     Entry* entry = new Entry(object, func, member, context);
-    lock.Lock(MUTEX_CONTEXT);
-    hashTable[Key(object->GetPath(), entry->ifaceStr.empty() ? NULL : entry->ifaceStr.c_str(), member->name.c_str())] = entry;
+    uint64_t pathKey = DispatchKey::Path(object->GetPath());
+    vector<Entry*> replaced;
 
-    /* Method calls don't require an interface so we need to add an entry with a NULL interface */
-    if (!entry->ifaceStr.empty()) {
-        hashTable[Key(object->GetPath(), NULL, member->name.c_str())] = new Entry(*entry);
+    lock.Lock(MUTEX_CONTEXT);
+    /*
+     * Method calls don't require an interface so we need to add an entry with a NULL interface
+     */
+    size_t num = entry->ifaceStr.empty() ? 1 : 2;
+    for (size_t i = 0; i < num; ++i) {
+        const char* iface = (i == 0) ? entry->ifaceStr.c_str() : NULL;
+        Entry* add = (i == 0) ? entry : new Entry(*entry);
+        uint64_t key = DispatchKey::Method(pathKey, DispatchKey::Member(iface, member->name.c_str()));
+        pair<MapType::iterator, MapType::iterator> range = hashTable.equal_range(key);
+        MapType::iterator iter = range.first;
+        while ((iter != range.second) && !Matches(iter->second, object->GetPath(), iface, member->name.c_str())) {
+            ++iter;
+        }
+        if (iter != range.second) {
+            replaced.push_back(iter->second);
+            iter->second = add;
+        } else {
+            hashTable.insert(pair<const uint64_t, Entry*>(key, add));
+        }
     }
     lock.Unlock(MUTEX_CONTEXT);
+    /*
+     * Entries are deleted outside the lock because the destructor waits for the entry to be unused
+     */
+    for (size_t i = 0; i < replaced.size(); ++i) {
+        delete replaced[i];
+    }
 }
 
-MethodTable::SafeEntry* MethodTable::Find(const char* objectPath,
+MethodTable::SafeEntry* MethodTable::Find(uint64_t pathKey,
+                                          uint64_t memberKey,
+                                          const char* objectPath,
                                           const char* iface,
                                           const char* methodName)
 {
     SafeEntry* entry = NULL;
-    Key key(objectPath, iface, methodName);
+    uint64_t key = DispatchKey::Method(pathKey, memberKey);
     lock.Lock(MUTEX_CONTEXT);
-    MapType::iterator iter = hashTable.find(key);
-    if (iter != hashTable.end()) {
-        entry = new SafeEntry();
-        entry->Set(iter->second);
+    pair<MapType::iterator, MapType::iterator> range = hashTable.equal_range(key);
+    for (MapType::iterator iter = range.first; iter != range.second; ++iter) {
+        if (Matches(iter->second, objectPath, iface, methodName)) {
+            entry = new SafeEntry();
+            entry->Set(iter->second);
+            break;
+        }
     }
     lock.Unlock(MUTEX_CONTEXT);
     return entry;
@@ -79,23 +120,24 @@ MethodTable::SafeEntry* MethodTable::Find(const char* objectPath,
 
 void MethodTable::RemoveAll(BusObject* object)
 {
-    MapType::iterator iter;
+    vector<Entry*> removed;
     /*
-     * Iterate over all entries deleting all entries that reference the object
+     * Iterate over all entries removing all entries that reference the object
      */
     lock.Lock(MUTEX_CONTEXT);
-    iter = hashTable.begin();
+    MapType::iterator iter = hashTable.begin();
     while (iter != hashTable.end()) {
         if (iter->second->object == object) {
-            Entry* deleteMe = iter->second;
-            hashTable.erase(iter);
-            delete deleteMe;
-            iter = hashTable.begin();
+            removed.push_back(iter->second);
+            hashTable.erase(iter++);
         } else {
             ++iter;
         }
     }
     lock.Unlock(MUTEX_CONTEXT);
+    for (size_t i = 0; i < removed.size(); ++i) {
+        delete removed[i];
+    }
 }
 
 void MethodTable::AddAll(BusObject* object)
@@ -36,6 +36,8 @@
 
 #include <alljoyn/Status.h>
 
+#include "DispatchKey.h"
+
 #include <qcc/STLContainer.h>
 
 namespace ajn {
@@ -121,6 +123,8 @@ class MethodTable {
     /**
      * Find an Entry based on set of criteria.
      *
+     * @param pathKey      Dispatch key for the object path.
+     * @param memberKey    Dispatch key for the interface and method name.
      * @param objectPath   The object path.
      * @param iface        The interface.
      * @param methodName   The method name.
@@ -128,7 +132,7 @@ class MethodTable {
      *      - Entry that matches objectPath, interface and method
      *      - NULL if not found
      */
-    SafeEntry* Find(const char* objectPath, const char* iface, const char* methodName);
+    SafeEntry* Find(uint64_t pathKey, uint64_t memberKey, const char* objectPath, const char* iface, const char* methodName);
 
     /**
      * Remove all hash entries related to the specified object.
@@ -149,56 +153,15 @@ class MethodTable {
     qcc::Mutex lock; /**< Lock protecting the method table */
 
     /**
-     * Type definition for method hash table key
-     */
-    class Key {
-      public:
-        const char* objPath;
-        const char* iface;
-        const char* methodName;
-        Key(const char* obj, const char* ifc, const char* method) : objPath(obj), iface((ifc && *ifc) ? ifc : NULL), methodName(method) { }
-    };
-
-    /**
-     * Hash functor
+     * Check if an entry is for a method.
      */
-    struct Hash {
-        /** Calculate hash for Key k  */
-        size_t operator()(const Key& k) const {
-            size_t hash = 37;
-            for (const char* p = k.methodName; *p; ++p) {
-                hash = *p + hash * 11;
-            }
-            for (const char* p = k.objPath; *p; ++p) {
-                hash = *p + hash * 5;
-            }
-            if (k.iface) {
-                for (const char* p = k.iface; *p; ++p) {
-                    hash += *p * 7;
-                }
-            }
-            return hash;
-        }
-    };
+    static bool Matches(const Entry* entry, const char* objectPath, const char* iface, const char* methodName);
 
     /**
-     * Functor for testing 2 keys for equality
+     * The hash table is keyed by the dispatch key for the object path, interface and method. Keys
+     * can collide so the entries found for a key must be checked.
      */
-    struct Equal {
-        /**
-         * Return true two keys are equal
-         */
-        bool operator()(const Key& k1, const Key& k2) const {
-            if ((k1.iface == NULL) || (k2.iface == NULL)) {
-                return (k1.iface == k2.iface) && (strcmp(k1.methodName, k2.methodName) == 0) && (strcmp(k1.objPath, k2.objPath) == 0);
-            } else {
-                return (strcmp(k1.methodName, k2.methodName) == 0) && (strcmp(k1.iface, k2.iface) == 0) && (strcmp(k1.objPath, k2.objPath) == 0);
-            }
-        }
-    };
-
-    /** The hash table */
-    typedef std::unordered_map<Key, Entry*, Hash, Equal> MapType;
+    typedef std::unordered_multimap<uint64_t, Entry*, DispatchKey::Hasher> MapType;
     MapType hashTable;
 };
 
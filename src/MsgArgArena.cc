@@ -0,0 +1,253 @@
+/**
+ * @file
+ *
+ * This file implements the MsgArgArena class
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <new>
+#include <string.h>
+
+#include <qcc/atomic.h>
+
+#include <alljoyn/MsgArg.h>
+
+#include "MessageBufferPool.h"
+#include "MsgArgArena.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+
+namespace ajn {
+
+/*
+ * Size of the first block allocated by an arena, this is enough for the arguments of most messages.
+ * Subsequent blocks double in size.
+ */
+static const size_t MIN_BLOCK_SIZE = 1024;
+
+struct MsgArgArena::Block {
+    Block* next;
+    size_t size;
+};
+
+/*
+ * Size of the block header rounded up so the memory that follows is 8 byte aligned.
+ */
+static const size_t BLOCK_HEADER_SIZE = (sizeof(MsgArgArena::Block) + 7) & ~7;
+
+MsgArgArena::MsgArgArena() : blocks(NULL), freePtr(NULL), freeLen(0)
+{
+}
+
+MsgArgArena::~MsgArgArena()
+{
+    Reset();
+}
+
+void MsgArgArena::Reset()
+{
+    while (blocks) {
+        Block* next = blocks->next;
+        delete [] reinterpret_cast<uint64_t*>(blocks);
+        blocks = next;
+    }
+    freePtr = NULL;
+    freeLen = 0;
+}
+
+void* MsgArgArena::Alloc(size_t size)
+{
+    size = (size + 7) & ~7;
+    if (size > freeLen) {
+        size_t blockSize = blocks ? (blocks->size * 2) : MIN_BLOCK_SIZE;
+        while (blockSize < size) {
+            blockSize *= 2;
+        }
+        /*
+         * Allocate as uint64_t so the block is 8 byte aligned.
+         */
+        Block* block = reinterpret_cast<Block*>(new uint64_t[(BLOCK_HEADER_SIZE + blockSize) / sizeof(uint64_t)]);
+        block->next = blocks;
+        block->size = blockSize;
+        blocks = block;
+        freePtr = reinterpret_cast<uint8_t*>(block) + BLOCK_HEADER_SIZE;
+        freeLen = blockSize;
+    }
+    void* mem = freePtr;
+    freePtr += size;
+    freeLen -= size;
+    return mem;
+}
+
+MsgArg* MsgArgArena::NewArgs(size_t numArgs)
+{
+    /*
+     * Always allocate at least one arg so the returned pointer is unique.
+     */
+    if (numArgs == 0) {
+        numArgs = 1;
+    }
+    MsgArg* args = static_cast<MsgArg*>(Alloc(numArgs * sizeof(MsgArg)));
+    for (size_t i = 0; i < numArgs; ++i) {
+        new (&args[i])MsgArg();
+    }
+    return args;
+}
+
+char* MsgArgArena::CopyString(const char* str, size_t len)
+{
+    char* copy = static_cast<char*>(Alloc(len + 1));
+    memcpy(copy, str, len);
+    copy[len] = 0;
+    return copy;
+}
+
+void MsgArgArena::SetElements(MsgArg& arg, const char* elemSig, size_t elemSigLen, size_t numElements, MsgArg* elements)
+{
+    arg.typeId = ALLJOYN_ARRAY;
+    arg.v_array.elemSig = CopyString(elemSig, elemSigLen);
+    arg.v_array.numElements = numElements;
+    arg.v_array.elements = numElements ? elements : NULL;
+}
+
+MsgArg* MsgArgArena::CopyArgs(const MsgArg* args, size_t numArgs)
+{
+    MsgArg* copy = NewArgs(numArgs);
+    for (size_t i = 0; i < numArgs; ++i) {
+        CopyArg(copy[i], args[i]);
+    }
+    return copy;
+}
+
+void MsgArgArena::CopyArg(MsgArg& dest, const MsgArg& src)
+{
+    dest.typeId = src.typeId;
+    switch (src.typeId) {
+    case ALLJOYN_DICT_ENTRY:
+        dest.v_dictEntry.key = CopyArgs(src.v_dictEntry.key, 1);
+        dest.v_dictEntry.val = CopyArgs(src.v_dictEntry.val, 1);
+        break;
+
+    case ALLJOYN_STRUCT:
+        dest.v_struct.numMembers = src.v_struct.numMembers;
+        dest.v_struct.members = CopyArgs(src.v_struct.members, src.v_struct.numMembers);
+        break;
+
+    case ALLJOYN_ARRAY:
+    {
+        const char* elemSig = src.v_array.GetElemSig();
+        size_t numElements = src.v_array.GetNumElements();
+        SetElements(dest, elemSig, strlen(elemSig), numElements, CopyArgs(src.v_array.GetElements(), numElements));
+    }
+    break;
+
+    case ALLJOYN_VARIANT:
+        dest.v_variant.val = CopyArgs(src.v_variant.val, 1);
+        break;
+
+    case ALLJOYN_OBJECT_PATH:
+    case ALLJOYN_STRING:
+        dest.v_string.len = src.v_string.len;
+        dest.v_string.str = src.v_string.str ? CopyString(src.v_string.str, src.v_string.len) : NULL;
+        break;
+
+    case ALLJOYN_SIGNATURE:
+        dest.v_signature.len = src.v_signature.len;
+        dest.v_signature.sig = src.v_signature.sig ? CopyString(src.v_signature.sig, src.v_signature.len) : NULL;
+        break;
+
+    case ALLJOYN_BYTE_ARRAY:
+    case ALLJOYN_BOOLEAN_ARRAY:
+    case ALLJOYN_INT16_ARRAY:
+    case ALLJOYN_UINT16_ARRAY:
+    case ALLJOYN_INT32_ARRAY:
+    case ALLJOYN_UINT32_ARRAY:
+    case ALLJOYN_DOUBLE_ARRAY:
+    case ALLJOYN_INT64_ARRAY:
+    case ALLJOYN_UINT64_ARRAY:
+    {
+        size_t elemSize;
+        switch (src.typeId) {
+        case ALLJOYN_BYTE_ARRAY:
+            elemSize = sizeof(uint8_t);
+            break;
+
+        case ALLJOYN_BOOLEAN_ARRAY:
+            elemSize = sizeof(bool);
+            break;
+
+        case ALLJOYN_INT16_ARRAY:
+        case ALLJOYN_UINT16_ARRAY:
+            elemSize = sizeof(uint16_t);
+            break;
+
+        case ALLJOYN_INT32_ARRAY:
+        case ALLJOYN_UINT32_ARRAY:
+            elemSize = sizeof(uint32_t);
+            break;
+
+        default:
+            elemSize = sizeof(uint64_t);
+            break;
+        }
+        dest.v_scalarArray.numElements = src.v_scalarArray.numElements;
+        if (src.v_scalarArray.v_byte && src.v_scalarArray.numElements) {
+            size_t len = elemSize * src.v_scalarArray.numElements;
+            uint8_t* data = static_cast<uint8_t*>(Alloc(len));
+            memcpy(data, src.v_scalarArray.v_byte, len);
+            dest.v_scalarArray.v_byte = data;
+        } else {
+            dest.v_scalarArray.v_byte = NULL;
+        }
+    }
+    break;
+
+    default:
+        /* Scalar types are copied by value */
+        dest.v_invalid = src.v_invalid;
+        break;
+    }
+}
+
+SharedArgs::SharedArgs(uint8_t* buf) : buf(buf), args(NULL), numArgs(0), refs(1)
+{
+    MessageBufferPool::AddRef(buf);
+}
+
+SharedArgs::~SharedArgs()
+{
+    MessageBufferPool::Free(buf);
+}
+
+void SharedArgs::AddRef()
+{
+    IncrementAndFetch(&refs);
+}
+
+void SharedArgs::Release()
+{
+    if (DecrementAndFetch(&refs) == 0) {
+        delete this;
+    }
+}
+
+}
@@ -0,0 +1,217 @@
+/**
+ * @file
+ * Implements a bump allocator for the MsgArgs of an unmarshaled message
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_MSGARGARENA_H
+#define _ALLJOYN_MSGARGARENA_H
+
+#ifndef __cplusplus
+#error Only include MsgArgArena.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <alljoyn/MsgArg.h>
+
+namespace ajn {
+
+/**
+ * Arena that holds all of the MsgArgs, and any data they reference that is not in the message
+ * buffer, for the arguments of a single message. Memory is carved sequentially from a short list of
+ * blocks and is only released when the arena is reset or destroyed.
+ *
+ * MsgArgs allocated from the arena never own anything (the OwnsArgs and OwnsData flags are clear)
+ * and their destructors are never run, so an arena MsgArg must never be cleared or assigned to.
+ */
+class MsgArgArena {
+  public:
+
+    /**
+     * Constructor
+     */
+    MsgArgArena();
+
+    /**
+     * Destructor frees all memory allocated from the arena.
+     */
+    ~MsgArgArena();
+
+    /**
+     * Allocate an array of default-initialized MsgArgs.
+     *
+     * @param numArgs  The number of MsgArgs to allocate.
+     *
+     * @return  Pointer to the MsgArgs. This is never NULL even if numArgs is zero.
+     */
+    MsgArg* NewArgs(size_t numArgs);
+
+    /**
+     * Allocate raw memory aligned on an 8 byte boundary.
+     *
+     * @param size  The number of bytes to allocate.
+     *
+     * @return  Pointer to the memory.
+     */
+    void* Alloc(size_t size);
+
+    /**
+     * Copy a string into the arena.
+     *
+     * @param str  The string to copy, this does not need to be NUL terminated.
+     * @param len  The length of the string.
+     *
+     * @return  A NUL terminated copy of the string.
+     */
+    char* CopyString(const char* str, size_t len);
+
+    /**
+     * Set the elements of an array MsgArg to elements allocated from this arena. Unlike
+     * AllJoynArray::SetElements() the element signature is also allocated from the arena.
+     *
+     * @param arg          The array MsgArg.
+     * @param elemSig      The element signature, this does not need to be NUL terminated.
+     * @param elemSigLen   The length of the element signature.
+     * @param numElements  The number of elements.
+     * @param elements     The elements.
+     */
+    void SetElements(MsgArg& arg, const char* elemSig, size_t elemSigLen, size_t numElements, MsgArg* elements);
+
+    /**
+     * Make a deep copy of a list of MsgArgs. All of the MsgArgs and the data they reference are
+     * allocated from this arena.
+     *
+     * @param args     The MsgArgs to copy.
+     * @param numArgs  The number of MsgArgs to copy.
+     *
+     * @return  Pointer to the copied MsgArgs.
+     */
+    MsgArg* CopyArgs(const MsgArg* args, size_t numArgs);
+
+    /**
+     * Free all memory allocated from the arena.
+     */
+    void Reset();
+
+  private:
+
+    /**
+     * Copy constructor is undefined.
+     */
+    MsgArgArena(const MsgArgArena& other);
+
+    /**
+     * Assignment operator is undefined.
+     */
+    MsgArgArena& operator=(const MsgArgArena& other);
+
+    /**
+     * Deep copy a single MsgArg into an arena MsgArg.
+     */
+    void CopyArg(MsgArg& dest, const MsgArg& src);
+
+    struct Block;
+
+    Block* blocks;      /**< Blocks allocated so far, the most recent is first */
+    uint8_t* freePtr;   /**< Next free byte in the most recent block */
+    size_t freeLen;     /**< Number of free bytes in the most recent block */
+};
+
+/**
+ * A reference counted, immutable set of unmarshaled message arguments. The arguments are unmarshaled
+ * directly into the arena of the shared arguments and may reference the message buffer they were
+ * unmarshaled from, so the shared arguments hold a reference to that buffer. This lets a broadcast
+ * signal be unmarshaled once and delivered to several bus attachments in the same process.
+ */
+class SharedArgs {
+  public:
+
+    /**
+     * Constructor. The reference count starts at one and the arguments are empty until SetArgs()
+     * is called.
+     *
+     * @param buf  The pooled message buffer the arguments will be unmarshaled from.
+     */
+    SharedArgs(uint8_t* buf);
+
+    /**
+     * Get the arena the arguments are unmarshaled into.
+     *
+     * @return  The arena.
+     */
+    MsgArgArena& GetArena() { return arena; }
+
+    /**
+     * Set the arguments once they have been unmarshaled into the arena.
+     *
+     * @param args     The arguments.
+     * @param numArgs  The number of arguments.
+     */
+    void SetArgs(MsgArg* args, size_t numArgs) { this->args = args; this->numArgs = numArgs; }
+
+    /**
+     * Add a reference.
+     */
+    void AddRef();
+
+    /**
+     * Release a reference, the shared arguments are freed when the last reference is released.
+     */
+    void Release();
+
+    /**
+     * Get the arguments.
+     *
+     * @return  The arguments, these must not be modified.
+     */
+    MsgArg* GetArgs() const { return args; }
+
+    /**
+     * Get the number of arguments.
+     *
+     * @return  The number of arguments.
+     */
+    size_t GetNumArgs() const { return numArgs; }
+
+  private:
+
+    /**
+     * Only Release() can delete the shared arguments.
+     */
+    ~SharedArgs();
+
+    /**
+     * Copy constructor is undefined.
+     */
+    SharedArgs(const SharedArgs& other);
+
+    /**
+     * Assignment operator is undefined.
+     */
+    SharedArgs& operator=(const SharedArgs& other);
+
+    MsgArgArena arena;      /**< Holds the arguments and any data that is not in the buffer */
+    uint8_t* buf;           /**< The message buffer the arguments reference */
+    MsgArg* args;           /**< The arguments */
+    size_t numArgs;         /**< The number of arguments */
+    volatile int32_t refs;  /**< Reference count */
+};
+
+}
+
+#endif
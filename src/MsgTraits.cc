@@ -0,0 +1,317 @@
+/**
+ * @file
+ *
+ * This file implements the message writer and reader used by the typed marshaling templates
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <list>
+#include <string.h>
+
+#include <qcc/Debug.h>
+#include <qcc/Mutex.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgTraits.h>
+
+#include "ArrayKernels.h"
+#include "AtomicPointer.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+
+namespace ajn {
+
+MsgNone MsgNone::none;
+
+/*
+ * Signatures built by GetTypedSignature(). A list is used so the strings never move.
+ */
+static qcc::Mutex typedSignatureLock;
+static std::list<qcc::String> typedSignatures;
+
+const char* GetTypedSignature(const char* volatile& slot, void (*build)(qcc::String& sig))
+{
+    /*
+     * Signatures are never freed so once a slot has been published it can be read without the
+     * lock. The lock is only taken to build a signature the first time it is needed.
+     */
+    const char* sig = LoadAcquire(slot);
+    if (!sig) {
+        typedSignatureLock.Lock(MUTEX_CONTEXT);
+        sig = slot;
+        if (!sig) {
+            typedSignatures.push_back(qcc::String());
+            build(typedSignatures.back());
+            sig = typedSignatures.back().c_str();
+            StoreRelease(slot, sig);
+        }
+        typedSignatureLock.Unlock(MUTEX_CONTEXT);
+    }
+    return sig;
+}
+
+#define PadUp(n, i)   (((n) + (i) - 1) & ~((i) - 1))
+
+/*
+ * Make sure there is room in the message buffer for len bytes plus up to 7 bytes of alignment
+ * padding.
+ */
+#define ReserveBytes(len) \
+    do { \
+        size_t _needed = (size_t)(len) + 8; \
+        if (((size_t)(msg.bufPos - (uint8_t*)msg.msgBuf) + _needed) > msg.bufSize) { \
+            msg.GrowBuffer(_needed); \
+        } \
+    } while (0)
+
+void MsgWriter::Align(size_t alignment)
+{
+    ReserveBytes(0);
+    size_t pad = PadBytes(msg.bufPos, alignment);
+    memset(msg.bufPos, 0, pad);
+    msg.bufPos += pad;
+}
+
+void MsgWriter::Write1(uint8_t val)
+{
+    ReserveBytes(1);
+    *msg.bufPos++ = val;
+}
+
+void MsgWriter::Write2(uint16_t val)
+{
+    Align(2);
+    *((uint16_t*)msg.bufPos) = msg.endianSwap ? EndianSwap16(val) : val;
+    msg.bufPos += 2;
+}
+
+void MsgWriter::Write4(uint32_t val)
+{
+    Align(4);
+    *((uint32_t*)msg.bufPos) = msg.endianSwap ? EndianSwap32(val) : val;
+    msg.bufPos += 4;
+}
+
+void MsgWriter::Write8(uint64_t val)
+{
+    Align(8);
+    *((uint64_t*)msg.bufPos) = msg.endianSwap ? EndianSwap64(val) : val;
+    msg.bufPos += 8;
+}
+
+void MsgWriter::WriteString(const char* str, size_t len)
+{
+    Write4((uint32_t)len);
+    ReserveBytes(len + 1);
+    memcpy(msg.bufPos, str, len);
+    msg.bufPos[len] = 0;
+    msg.bufPos += len + 1;
+}
+
+size_t MsgWriter::BeginArray(size_t elemAlignment)
+{
+    Write4(0);
+    size_t lenPos = (msg.bufPos - (uint8_t*)msg.msgBuf) - 4;
+    Align(elemAlignment);
+    return lenPos;
+}
+
+void MsgWriter::EndArray(size_t lenPos, size_t elemAlignment)
+{
+    uint8_t* buf = (uint8_t*)msg.msgBuf;
+    size_t len = (msg.bufPos - buf) - PadUp(lenPos + 4, elemAlignment);
+    if (len > ALLJOYN_MAX_ARRAY_LEN) {
+        if (status == ER_OK) {
+            status = ER_BUS_BAD_LENGTH;
+            QCC_LogError(status, ("Array too big"));
+        }
+        return;
+    }
+    *((uint32_t*)(buf + lenPos)) = msg.endianSwap ? EndianSwap32((uint32_t)len) : (uint32_t)len;
+}
+
+void MsgWriter::WriteScalarArray(const void* elems, size_t numElements, size_t elemSize)
+{
+    size_t len = numElements * elemSize;
+    if (len > ALLJOYN_MAX_ARRAY_LEN) {
+        if (status == ER_OK) {
+            status = ER_BUS_BAD_LENGTH;
+            QCC_LogError(status, ("Array too big"));
+        }
+        return;
+    }
+    Write4((uint32_t)len);
+    ReserveBytes(len);
+    Align(elemSize);
+    if (!msg.endianSwap || (elemSize == 1)) {
+        memcpy(msg.bufPos, elems, len);
+    } else if (elemSize == 2) {
+        EndianSwapArray16(msg.bufPos, elems, numElements);
+    } else if (elemSize == 4) {
+        EndianSwapArray32(msg.bufPos, elems, numElements);
+    } else {
+        EndianSwapArray64(msg.bufPos, elems, numElements);
+    }
+    msg.bufPos += len;
+}
+
+QStatus MsgReader::Align(size_t alignment)
+{
+    size_t aligned = PadUp(pos, alignment);
+    if (aligned > len) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    pos = aligned;
+    return ER_OK;
+}
+
+QStatus MsgReader::Read1(uint8_t& val)
+{
+    if (pos >= len) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    val = body[pos++];
+    return ER_OK;
+}
+
+QStatus MsgReader::Read2(uint16_t& val)
+{
+    pos = PadUp(pos, 2);
+    if ((pos + 2) > len) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    val = *((const uint16_t*)(body + pos));
+    if (endianSwap) {
+        val = EndianSwap16(val);
+    }
+    pos += 2;
+    return ER_OK;
+}
+
+QStatus MsgReader::Read4(uint32_t& val)
+{
+    pos = PadUp(pos, 4);
+    if ((pos + 4) > len) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    val = *((const uint32_t*)(body + pos));
+    if (endianSwap) {
+        val = EndianSwap32(val);
+    }
+    pos += 4;
+    return ER_OK;
+}
+
+QStatus MsgReader::Read8(uint64_t& val)
+{
+    pos = PadUp(pos, 8);
+    if ((pos + 8) > len) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    val = *((const uint64_t*)(body + pos));
+    if (endianSwap) {
+        val = EndianSwap64(val);
+    }
+    pos += 8;
+    return ER_OK;
+}
+
+QStatus MsgReader::ReadBool(bool& val)
+{
+    uint32_t b;
+    QStatus status = Read4(b);
+    if (status == ER_OK) {
+        if (b > 1) {
+            status = ER_BUS_BAD_VALUE;
+        } else {
+            val = (b == 1);
+        }
+    }
+    return status;
+}
+
+QStatus MsgReader::ReadString(const char*& str, size_t& strLen)
+{
+    uint32_t n;
+    QStatus status = Read4(n);
+    if (status == ER_OK) {
+        if (n >= (len - pos)) {
+            status = ER_BUS_BAD_LENGTH;
+        } else if (body[pos + n] != 0) {
+            status = ER_BUS_NOT_NUL_TERMINATED;
+        } else {
+            str = (const char*)(body + pos);
+            strLen = n;
+            pos += n + 1;
+        }
+    }
+    return status;
+}
+
+QStatus MsgReader::BeginArray(size_t elemAlignment, size_t& end)
+{
+    uint32_t n;
+    QStatus status = Read4(n);
+    if (status == ER_OK) {
+        status = Align(elemAlignment);
+    }
+    if (status == ER_OK) {
+        if ((n > ALLJOYN_MAX_ARRAY_LEN) || (n > (len - pos))) {
+            status = ER_BUS_BAD_LENGTH;
+        } else {
+            end = pos + n;
+        }
+    }
+    return status;
+}
+
+QStatus MsgReader::ReadScalarArray(size_t elemSize, const void*& elems, size_t& numElements)
+{
+    size_t end;
+    QStatus status = BeginArray(elemSize, end);
+    if (status == ER_OK) {
+        if ((end - pos) % elemSize) {
+            status = ER_BUS_BAD_LENGTH;
+        } else {
+            elems = body + pos;
+            numElements = (end - pos) / elemSize;
+            pos = end;
+        }
+    }
+    return status;
+}
+
+void MsgReader::CopyScalars(void* dest, const void* elems, size_t numElements, size_t elemSize) const
+{
+    if (!endianSwap || (elemSize == 1)) {
+        memcpy(dest, elems, numElements * elemSize);
+    } else if (elemSize == 2) {
+        EndianSwapArray16(dest, elems, numElements);
+    } else if (elemSize == 4) {
+        EndianSwapArray32(dest, elems, numElements);
+    } else {
+        EndianSwapArray64(dest, elems, numElements);
+    }
+}
+
+}
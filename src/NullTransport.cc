@@ -198,10 +198,14 @@ QStatus _NullEndpoint::PushMessage(Message& msg)
         CheckRegisterEndpoint();
         /*
          * We need to clone broadcast signals because each receiving bus attachment must be
-         * able to unmarshal the arg list including decrypting and doing header expansion.
+         * able to unmarshal the arg list including decrypting and doing header expansion. If the
+         * daemon router shared the arguments before the fan-out the clone is shallow, it shares
+         * the message buffer and the arguments so the receivers don't copy or unmarshal them
+         * again. Otherwise the clone is a deep copy. The message itself is also being delivered
+         * to other receivers so it must not be modified here.
          */
         if (msg->IsBroadcastSignal()) {
-            Message clone(msg, true /*deep copy*/);
+            Message clone(msg, true /*copy*/);
             clone->bus = &clientBus;
             status = clientBus.GetInternal().GetRouter().PushMessage(clone, busEndpoint);
         } else {
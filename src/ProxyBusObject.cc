@@ -376,6 +376,10 @@ QStatus ProxyBusObject::AddInterface(const InterfaceDescription& iface) {
     QStatus status = ret.second ? ER_OK : ER_BUS_IFACE_ALREADY_EXISTS;
     lock->Unlock(MUTEX_CONTEXT);
 
+    if (status == ER_OK) {
+        bus->GetInternal().GetSignaturePlanCache().AddInterface(iface);
+    }
+
     /* Add org.freedesktop.DBus.Properties interface implicitly if iface specified properties */
     if ((status == ER_OK) && !hasProperties && (iface.GetProperties() > 0)) {
         const InterfaceDescription* propIntf = bus->GetInterface(::ajn::org::freedesktop::DBus::Properties::InterfaceName);
@@ -621,6 +625,31 @@ QStatus ProxyBusObject::MethodCallAsync(const InterfaceDescription::Member& meth
                                         uint32_t timeout,
                                         uint8_t flags) const
 {
+    return SendMethodCall(method, receiver, replyHandler, args, numArgs, context, timeout, flags, false);
+}
+
+QStatus ProxyBusObject::MethodCallAsyncNoWait(const InterfaceDescription::Member& method,
+                                              MessageReceiver* receiver,
+                                              MessageReceiver::ReplyHandler replyHandler,
+                                              const MsgArg* args,
+                                              size_t numArgs,
+                                              void* context,
+                                              uint32_t timeout,
+                                              uint8_t flags) const
+{
+    return SendMethodCall(method, receiver, replyHandler, args, numArgs, context, timeout, flags, true);
+}
+
+QStatus ProxyBusObject::SendMethodCall(const InterfaceDescription::Member& method,
+                                       MessageReceiver* receiver,
+                                       MessageReceiver::ReplyHandler replyHandler,
+                                       const MsgArg* args,
+                                       size_t numArgs,
+                                       void* context,
+                                       uint32_t timeout,
+                                       uint8_t flags,
+                                       bool noWait) const
+{
 
     QStatus status;
     Message msg(*bus);
@@ -655,10 +684,14 @@ QStatus ProxyBusObject::MethodCallAsync(const InterfaceDescription::Member& meth
         }
         if (status == ER_OK) {
             if (b2bEp->IsValid()) {
-                status = b2bEp->PushMessage(msg);
+                status = noWait ? b2bEp->PushMessageNoWait(msg) : b2bEp->PushMessage(msg);
             } else {
                 BusEndpoint busEndpoint = BusEndpoint::cast(localEndpoint);
-                status = bus->GetInternal().GetRouter().PushMessage(msg, busEndpoint);
+                if (noWait) {
+                    status = bus->GetInternal().GetRouter().PushMessageNoWait(msg, busEndpoint);
+                } else {
+                    status = bus->GetInternal().GetRouter().PushMessage(msg, busEndpoint);
+                }
             }
             if (status != ER_OK) {
                 bool unregistered = localEndpoint->UnregisterReplyHandler(msg);
@@ -20,6 +20,7 @@
 #include <qcc/platform.h>
 
 #include <assert.h>
+#include <algorithm>
 
 #include <qcc/Debug.h>
 #include <qcc/String.h>
@@ -29,19 +30,18 @@
 #include <qcc/SocketStream.h>
 #include <qcc/atomic.h>
 #include <qcc/IODispatch.h>
+#include <qcc/time.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/AllJoynStd.h>
+#include <alljoyn/DBusStd.h>
 
 #include "Router.h"
 #include "RemoteEndpoint.h"
 #include "LocalTransport.h"
 #include "AllJoynPeerObj.h"
 #include "BusInternal.h"
-
-#ifndef NDEBUG
-#include <qcc/time.h>
-#endif
+#include "TimingWheel.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -52,10 +52,50 @@ namespace ajn {
 
 #define ENDPOINT_IS_DEAD_ALERTCODE  1
 
+/*
+ * Size of the per-endpoint receive buffer. Large enough to hold dozens of typical signals so they
+ * can all be read with a single read from the stream.
+ */
+static const size_t RX_BUFFER_SIZE = 8192;
+
+/*
+ * Size of the per-endpoint transmit buffer. Small queued messages are coalesced into this buffer
+ * so they can be written to the stream with a single write.
+ */
+static const size_t TX_BUFFER_SIZE = 8192;
+
+/*
+ * Number of messages link probes may exceed the transmit queue budgets by
+ */
+static const size_t TX_CONTROL_RESERVE = 16;
+
+/*
+ * Link probes are small and time critical, they are queued ahead of bulk data so that a large
+ * transfer cannot delay them long enough to cause a false link timeout. Probes carry no state so
+ * overtaking other messages is harmless, all other messages keep their order.
+ */
+static bool IsTxControlMessage(Message& msg)
+{
+    if ((msg->GetType() != MESSAGE_SIGNAL) || (::strcmp(org::alljoyn::Daemon::InterfaceName, msg->GetInterface()) != 0)) {
+        return false;
+    }
+    const char* member = msg->GetMemberName();
+    return (::strcmp("ProbeReq", member) == 0) || (::strcmp("ProbeAck", member) == 0);
+}
+
 class _RemoteEndpoint::Internal {
     friend class _RemoteEndpoint;
   public:
 
+    /*
+     * An entry in the transmit queue
+     */
+    struct TxEntry {
+        TxEntry(Message& msg, bool droppable) : msg(msg), droppable(droppable) { }
+        Message msg;      /**< The queued message */
+        bool droppable;   /**< True if TX_OVERFLOW_DROP_OLDEST may drop the message to make room */
+    };
+
     Internal(BusAttachment& bus, bool incoming, const qcc::String& connectSpec, Stream* stream, const char* threadName, bool isSocket) :
         bus(bus),
         stream(stream),
@@ -83,17 +123,35 @@ class _RemoteEndpoint::Internal {
         getNextMsg(true),
         currentWriteMsg(bus),
         stopping(false),
-        sessionId(0)
+        sessionId(0),
+        rxBuf(new uint8_t[RX_BUFFER_SIZE]),
+        rxPos(rxBuf),
+        rxAvail(0),
+        txBuf(new uint8_t[TX_BUFFER_SIZE]),
+        txPos(txBuf),
+        txCount(0),
+        txBatchCount(0),
+        txQueueBytes(0),
+        txMaxBytes(DEFAULT_TX_QUEUE_BYTES),
+        txMaxMsgs(DEFAULT_TX_QUEUE_MSGS),
+        txOverflowPolicy(TX_OVERFLOW_BLOCK),
+        txMaxDrops(0),
+        txDropCount(0),
+        txDroppableCount(0),
+        txConsecutiveDrops(0),
+        txWritablePending(false)
     {
     }
 
     ~Internal() {
+        delete [] rxBuf;
+        delete [] txBuf;
     }
 
     BusAttachment& bus;                      /**< Message bus associated with this endpoint */
     qcc::Stream* stream;                     /**< Stream for this endpoint or NULL if uninitialized */
 
-    std::deque<Message> txQueue;             /**< Transmit message queue */
+    std::deque<TxEntry> txQueue;             /**< Transmit message queue */
     std::deque<qcc::Thread*> txWaitQueue;    /**< Threads waiting for txQueue to become not-full */
     qcc::Mutex lock;                         /**< Mutex that protects the txQueue and timeout values */
     int32_t exitCount;                       /**< Number of sub-threads (rx and tx) that have exited (atomically incremented) */
@@ -125,9 +183,31 @@ class _RemoteEndpoint::Internal {
     bool validateSender;                     /**< If true, the sender field on incomming messages will be overwritten with actual endpoint name */
     bool hasRxSessionMsg;                    /**< true iff this endpoint has previously processed a non-control message */
     bool getNextMsg;                         /**< If true, read the next message from the txQueue */
-    Message currentWriteMsg;                 /**< The message currently being read for this endpoint */
+    Message currentWriteMsg;                 /**< The message currently being written for this endpoint */
+    MessageWriteState writeState;            /**< Write state of currentWriteMsg for this endpoint */
     bool stopping;                           /**< Is this EP stopping? */
     uint32_t sessionId;                      /**< SessionId for BusToBus endpoint. (not used for non-B2B endpoints) */
+
+    uint8_t* rxBuf;                          /**< Receive buffer for reading many messages in one read */
+    const uint8_t* rxPos;                    /**< Start of the unconsumed data in rxBuf */
+    size_t rxAvail;                          /**< Number of unconsumed bytes in rxBuf */
+
+    uint8_t* txBuf;                          /**< Transmit buffer for coalescing queued messages into one write */
+    const uint8_t* txPos;                    /**< Start of the unwritten data in txBuf */
+    size_t txCount;                          /**< Number of unwritten bytes in txBuf */
+    size_t txBatchCount;                     /**< Number of txQueue entries (from the back) coalesced into txBuf */
+
+    size_t txQueueBytes;                     /**< Total size of the messages in txQueue */
+    size_t txMaxBytes;                       /**< Byte budget for txQueue */
+    size_t txMaxMsgs;                        /**< Message budget for txQueue */
+    TimingWheel txExpiry;                    /**< Expiry times of the messages with a TTL pushed onto txQueue, cleared when txQueue drains */
+
+    TxOverflowPolicy txOverflowPolicy;       /**< What PushMessageNoWait() does when the txQueue is full */
+    uint32_t txMaxDrops;                     /**< Consecutive drops before disconnecting with TX_OVERFLOW_DISCONNECT */
+    uint32_t txDropCount;                    /**< Number of messages dropped by PushMessageNoWait() */
+    size_t txDroppableCount;                 /**< Number of entries in txQueue that TX_OVERFLOW_DROP_OLDEST may drop */
+    uint32_t txConsecutiveDrops;             /**< Number of drops since PushMessageNoWait() last queued a message */
+    bool txWritablePending;                  /**< PushMessageNoWait() failed and the listener has not been told the queue drained */
 };
 
 void _RemoteEndpoint::SetStream(qcc::Stream* s)
@@ -186,6 +266,15 @@ const qcc::String&  _RemoteEndpoint::GetConnectSpec() const
     }
 }
 
+const char* _RemoteEndpoint::GetTransportName() const
+{
+    if (internal && internal->threadName) {
+        return internal->threadName;
+    } else {
+        return "";
+    }
+}
+
 bool _RemoteEndpoint::IsIncomingConnection() const
 {
     if (internal) {
@@ -460,6 +549,48 @@ void _RemoteEndpoint::ExitCallback() {
     internal->exitCount = 1;
 }
 
+QStatus _RemoteEndpoint::ReadMessage(RemoteEndpoint& rep, bool checkSender)
+{
+    Message& msg = internal->currentReadMsg;
+
+    /*
+     * Handles must be read together with the bytes they accompany
+     */
+    if (internal->features.handlePassing) {
+        return msg->ReadNonBlocking(rep, checkSender);
+    }
+    while (msg->readState != MESSAGE_COMPLETE) {
+        if (internal->rxAvail == 0) {
+            /*
+             * An endpoint that is about to be paused must not read ahead into data that belongs to
+             * whoever takes over the stream. The pause can be armed while a message is being read so
+             * this is checked before every refill. If the remainder of a large message is bigger
+             * than the receive buffer it is more efficient to read it directly into the message
+             * buffer.
+             */
+            if (internal->armRxPause || ((msg->readState == MESSAGE_HEADER_BODY) && (msg->countRead >= RX_BUFFER_SIZE))) {
+                return msg->ReadNonBlocking(rep, checkSender);
+            }
+            size_t read = 0;
+            QStatus status = internal->stream->PullBytes(internal->rxBuf, RX_BUFFER_SIZE, read, 0);
+            if (status != ER_OK) {
+                if ((status != ER_SOCK_OTHER_END_CLOSED) && (status != ER_STOPPING_THREAD) && (status != ER_TIMEOUT)) {
+                    QCC_LogError(status, ("Failed to read message on %s", GetUniqueName().c_str()));
+                }
+                return status;
+            }
+            internal->rxPos = internal->rxBuf;
+            internal->rxAvail = read;
+        }
+        QStatus status = msg->LoadBytes(internal->rxPos, internal->rxAvail);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to read message on %s", GetUniqueName().c_str()));
+            return status;
+        }
+    }
+    return ER_OK;
+}
+
 QStatus _RemoteEndpoint::ReadCallback(qcc::Source& source, bool isTimedOut)
 {
     /* Remote endpoints can be invalid if they were created with the default
@@ -479,7 +610,7 @@ QStatus _RemoteEndpoint::ReadCallback(qcc::Source& source, bool isTimedOut)
         status = ER_OK;
         while (status == ER_OK) {
 
-            status = internal->currentReadMsg->ReadNonBlocking(rep, (internal->validateSender && !bus2bus));
+            status = ReadMessage(rep, (internal->validateSender && !bus2bus));
             if (status == ER_OK) {
                 /* Message read complete.Proceed to unmarshal it. */
                 Message msg = internal->currentReadMsg;
@@ -581,6 +712,15 @@ QStatus _RemoteEndpoint::ReadCallback(qcc::Source& source, bool isTimedOut)
 
                 /* Check pause condition. Block until stopped */
                 if (internal->armRxPause && internal->started && (msg->GetType() == MESSAGE_METHOD_RET)) {
+                    /*
+                     * Everything after the reply belongs to whoever takes over the stream. Data is
+                     * only buffered before the pause is armed and the reply is sent in response to a
+                     * call made after that so nothing can have been read ahead.
+                     */
+                    if (internal->rxAvail != 0) {
+                        QCC_LogError(ER_FAIL, ("%u bytes following the reply were read ahead on %s", (uint32_t)internal->rxAvail, GetUniqueName().c_str()));
+                        assert(internal->rxAvail == 0);
+                    }
                     status = ER_BUS_ENDPOINT_CLOSING;
                     internal->bus.GetInternal().GetIODispatch().DisableReadCallback(internal->stream);
                     return ER_OK;
@@ -652,36 +792,90 @@ QStatus _RemoteEndpoint::WriteCallback(qcc::Sink& sink, bool isTimedOut) {
     }
 
     QStatus status = ER_OK;
+    RemoteEndpoint rep = RemoteEndpoint::wrap(this);
     while (status == ER_OK) {
         if (internal->getNextMsg) {
             internal->lock.Lock(MUTEX_CONTEXT);
+            /* Don't spend write bandwidth on messages that have already expired */
+            PurgeExpiredTx();
             if (!internal->txQueue.empty()) {
-                /* Make a deep copy of the message since there is state information inside the message.
-                 * Each copy of the message could be in different write state.
-                 */
-                internal->currentWriteMsg = Message(internal->txQueue.back(), true);
-
-                /* Alert next thread on wait queue */
-                if (0 < internal->txWaitQueue.size()) {
-                    Thread* wakeMe = internal->txWaitQueue.back();
-                    internal->txWaitQueue.pop_back();
-                    status = wakeMe->Alert();
-                    if (ER_OK != status) {
-                        QCC_LogError(status, ("Failed to alert thread blocked on full tx queue"));
+                if (GatherTxQueue()) {
+                    internal->getNextMsg = false;
+                    internal->lock.Unlock(MUTEX_CONTEXT);
+                } else {
+                    /*
+                     * The marshaled message is shared with any other endpoints it was queued on, the
+                     * write state for this endpoint is kept separately. Encryption is done in place
+                     * so a message that still has to be encrypted gets a private deep copy.
+                     */
+                    Message& nextMsg = internal->txQueue.back().msg;
+                    if (nextMsg->encrypt) {
+                        internal->currentWriteMsg = Message(nextMsg, true);
+                    } else {
+                        internal->currentWriteMsg = nextMsg;
+                    }
+                    internal->writeState = MessageWriteState();
+
+                    /* Alert next thread on wait queue */
+                    if (0 < internal->txWaitQueue.size()) {
+                        Thread* wakeMe = internal->txWaitQueue.back();
+                        internal->txWaitQueue.pop_back();
+                        status = wakeMe->Alert();
+                        if (ER_OK != status) {
+                            QCC_LogError(status, ("Failed to alert thread blocked on full tx queue"));
+                        }
                     }
+                    internal->getNextMsg = false;
+                    internal->lock.Unlock(MUTEX_CONTEXT);
                 }
-                internal->getNextMsg = false;
-                internal->lock.Unlock(MUTEX_CONTEXT);
             } else {
-
+                /* Every message the wheel has an entry for has been written or purged */
+                internal->txExpiry.Clear();
                 internal->bus.GetInternal().GetIODispatch().DisableWriteCallback(internal->stream);
+                bool writable = TxWritableAgain();
                 internal->lock.Unlock(MUTEX_CONTEXT);
+                if (writable && internal->listener) {
+                    internal->listener->EndpointWritable(rep);
+                }
                 return ER_OK;
             }
         }
+        if (internal->txBatchCount > 0) {
+            /* Write out the coalesced messages */
+            while ((status == ER_OK) && (internal->txCount > 0)) {
+                size_t pushed = 0;
+                status = internal->stream->PushBytes(internal->txPos, internal->txCount, pushed);
+                if (status == ER_OK) {
+                    internal->txPos += pushed;
+                    internal->txCount -= pushed;
+                }
+            }
+            if (status == ER_OK) {
+                internal->lock.Lock(MUTEX_CONTEXT);
+                while (internal->txBatchCount > 0) {
+                    PopTx();
+                    --internal->txBatchCount;
+                    /* Alert next thread on wait queue now that there is room in the queue */
+                    if (0 < internal->txWaitQueue.size()) {
+                        Thread* wakeMe = internal->txWaitQueue.back();
+                        internal->txWaitQueue.pop_back();
+                        QStatus alertStatus = wakeMe->Alert();
+                        if (ER_OK != alertStatus) {
+                            QCC_LogError(alertStatus, ("Failed to alert thread blocked on full tx queue"));
+                        }
+                    }
+                }
+                internal->getNextMsg = true;
+                bool writable = TxWritableAgain();
+                internal->lock.Unlock(MUTEX_CONTEXT);
+                if (writable && internal->listener) {
+                    internal->listener->EndpointWritable(rep);
+                }
+            }
+            continue;
+        }
         /* Deliver message */
-        RemoteEndpoint rep = RemoteEndpoint::wrap(this);
-        status = internal->currentWriteMsg->DeliverNonBlocking(rep);
+        status = internal->currentWriteMsg->DeliverNonBlocking(rep, internal->writeState);
         /* Report authorization failure as a security violation */
         if (status == ER_BUS_NOT_AUTHORIZED) {
             internal->bus.GetInternal().GetLocalEndpoint()->GetPeerObj()->HandleSecurityViolation(internal->currentWriteMsg, status);
@@ -695,9 +889,13 @@ QStatus _RemoteEndpoint::WriteCallback(qcc::Sink& sink, bool isTimedOut) {
             /* Message has been successfully delivered. i.e. PushBytes is complete
              */
             internal->lock.Lock(MUTEX_CONTEXT);
-            internal->txQueue.pop_back();
+            PopTx();
             internal->getNextMsg = true;
+            bool writable = TxWritableAgain();
             internal->lock.Unlock(MUTEX_CONTEXT);
+            if (writable && internal->listener) {
+                internal->listener->EndpointWritable(rep);
+            }
         }
     }
 
@@ -722,10 +920,53 @@ QStatus _RemoteEndpoint::WriteCallback(qcc::Sink& sink, bool isTimedOut) {
     return status;
 }
 
+bool _RemoteEndpoint::GatherTxQueue()
+{
+    size_t len = 0;
+    size_t count = 0;
+
+    /*
+     * Walk the tx queue from the oldest entry and count how many complete messages will fit into
+     * the transmit buffer. Messages that need per-message processing on delivery (encryption or
+     * handle passing) or that are too big to be worth copying end the batch. Some streams use the
+     * TTL passed down with each write so only reliable messages are coalesced.
+     */
+    deque<Internal::TxEntry>::reverse_iterator it = internal->txQueue.rbegin();
+    while (it != internal->txQueue.rend()) {
+        _Message& msg = *(it->msg);
+        if (msg.encrypt || msg.handles || msg.ttl) {
+            break;
+        }
+        size_t msgLen = msg.bufEOD - reinterpret_cast<const uint8_t*>(msg.msgBuf);
+        if ((msgLen == 0) || ((len + msgLen) > TX_BUFFER_SIZE)) {
+            break;
+        }
+        len += msgLen;
+        ++count;
+        ++it;
+    }
+    /* A lone message is written straight from its own buffer, copying it would gain nothing */
+    if (count < 2) {
+        return false;
+    }
+    uint8_t* pos = internal->txBuf;
+    it = internal->txQueue.rbegin();
+    for (size_t i = 0; i < count; ++i, ++it) {
+        _Message& msg = *(it->msg);
+        const uint8_t* buf = reinterpret_cast<const uint8_t*>(msg.msgBuf);
+        size_t msgLen = msg.bufEOD - buf;
+        memcpy(pos, buf, msgLen);
+        pos += msgLen;
+    }
+    internal->txPos = internal->txBuf;
+    internal->txCount = len;
+    internal->txBatchCount = count;
+    return true;
+}
+
 QStatus _RemoteEndpoint::PushMessage(Message& msg)
 {
     QCC_DbgTrace(("RemoteEndpoint::PushMessage %s (serial=%d)", GetUniqueName().c_str(), msg->GetCallSerial()));
-    static const size_t MAX_TX_QUEUE_SIZE = 30;
 
     QStatus status = ER_OK;
 
@@ -744,32 +985,31 @@ QStatus _RemoteEndpoint::PushMessage(Message& msg)
     if (internal->stopping) {
         return ER_BUS_ENDPOINT_CLOSING;
     }
+    size_t len = GetTxSize(msg);
+    bool control = IsTxControlMessage(msg);
     internal->lock.Lock(MUTEX_CONTEXT);
     size_t count = internal->txQueue.size();
     bool wasEmpty = (count == 0);
-    if (MAX_TX_QUEUE_SIZE > count) {
-        internal->txQueue.push_front(msg);
+    if (TxQueueHasRoom(len, control)) {
+        EnqueueTx(msg, len, control);
     } else {
         while (true) {
-            /* Remove a queue entry whose TTLs is expired if possible */
-            deque<Message>::iterator it = internal->txQueue.begin();
+            /* Remove the queue entries whose TTLs have expired, wait no longer than the next expiry */
+            PurgeExpiredTx();
             uint32_t maxWait = 20 * 1000;
-            while (it != internal->txQueue.end()) {
-                uint32_t expMs;
-                if ((*it)->IsExpired(&expMs)) {
-                    internal->txQueue.erase(it);
-                    break;
-                } else {
-                    ++it;
+            uint64_t nextExpiry;
+            if (internal->txExpiry.GetNextExpiry(nextExpiry)) {
+                uint64_t now = GetTimestamp64();
+                if (nextExpiry < (now + maxWait)) {
+                    maxWait = (nextExpiry > now) ? (uint32_t)(nextExpiry - now) : 1;
                 }
-                maxWait = (std::min)(maxWait, expMs);
             }
-            if (internal->txQueue.size() < MAX_TX_QUEUE_SIZE) {
+            if (TxQueueHasRoom(len, control)) {
                 /* Check queue wasn't drained while we were waiting */
                 if (internal->txQueue.size() == 0) {
                     wasEmpty = true;
                 }
-                internal->txQueue.push_front(msg);
+                EnqueueTx(msg, len, control);
                 status = ER_OK;
                 break;
             } else {
@@ -825,6 +1065,235 @@ QStatus _RemoteEndpoint::PushMessage(Message& msg)
     return status;
 }
 
+QStatus _RemoteEndpoint::PushMessageNoWait(Message& msg)
+{
+    QCC_DbgTrace(("RemoteEndpoint::PushMessageNoWait %s (serial=%d)", GetUniqueName().c_str(), msg->GetCallSerial()));
+
+    if (!internal) {
+        return ER_BUS_NO_ENDPOINT;
+    }
+    if (internal->stopping) {
+        return ER_BUS_ENDPOINT_CLOSING;
+    }
+    if (internal->txOverflowPolicy == TX_OVERFLOW_BLOCK) {
+        return PushMessage(msg);
+    }
+
+    QStatus status = ER_OK;
+    bool disconnect = false;
+    size_t len = GetTxSize(msg);
+    bool control = IsTxControlMessage(msg);
+    internal->lock.Lock(MUTEX_CONTEXT);
+    bool wasEmpty = internal->txQueue.empty();
+    if (!TxQueueHasRoom(len, control)) {
+        PurgeExpiredTx();
+    }
+    if (TxQueueHasRoom(len, control)) {
+        EnqueueTx(msg, len, control, true);
+        internal->txConsecutiveDrops = 0;
+    } else {
+        ++internal->txConsecutiveDrops;
+        status = ER_BUS_WRITE_QUEUE_FULL;
+        if (internal->txOverflowPolicy == TX_OVERFLOW_DROP_OLDEST) {
+            /*
+             * The messages at the back of the queue may be in the middle of being written so the
+             * oldest message that can be dropped is the one after them. Only messages that were
+             * themselves queued by PushMessageNoWait() are dropped, messages queued by
+             * PushMessage() and link probes are kept.
+             */
+            size_t i = internal->txQueue.size() - GetTxInFlight();
+            while ((i > 0) && (internal->txDroppableCount > 0) && !TxQueueHasRoom(len, control)) {
+                --i;
+                Internal::TxEntry& entry = internal->txQueue[i];
+                if (entry.droppable) {
+                    --internal->txDroppableCount;
+                    internal->txQueueBytes -= GetTxSize(entry.msg);
+                    /* The oldest entries are at the back so erasing moves the few entries behind this one */
+                    internal->txQueue.erase(internal->txQueue.begin() + i);
+                    ++internal->txDropCount;
+                }
+            }
+            if (TxQueueHasRoom(len, control)) {
+                EnqueueTx(msg, len, control, true);
+                status = ER_OK;
+            } else {
+                ++internal->txDropCount;
+            }
+        } else {
+            ++internal->txDropCount;
+            if (internal->txOverflowPolicy == TX_OVERFLOW_DISCONNECT) {
+                disconnect = (internal->txConsecutiveDrops >= internal->txMaxDrops);
+            }
+        }
+    }
+    if (wasEmpty && (status == ER_OK)) {
+        internal->bus.GetInternal().GetIODispatch().EnableWriteCallbackNow(internal->stream);
+    }
+    if (status == ER_BUS_WRITE_QUEUE_FULL) {
+        internal->txWritablePending = true;
+    }
+    uint32_t drops = internal->txConsecutiveDrops;
+    internal->lock.Unlock(MUTEX_CONTEXT);
+
+    if (disconnect) {
+        QCC_LogError(status, ("Disconnecting %s after %u consecutive dropped messages", GetUniqueName().c_str(), drops));
+        Stop();
+    }
+    return status;
+}
+
+void _RemoteEndpoint::SetTxOverflowPolicy(TxOverflowPolicy policy, uint32_t maxDrops)
+{
+    if (internal) {
+        internal->lock.Lock(MUTEX_CONTEXT);
+        internal->txOverflowPolicy = policy;
+        internal->txMaxDrops = maxDrops;
+        internal->lock.Unlock(MUTEX_CONTEXT);
+    }
+}
+
+void _RemoteEndpoint::SetTxQueueLimits(size_t maxBytes, size_t maxMsgs)
+{
+    if (internal) {
+        internal->lock.Lock(MUTEX_CONTEXT);
+        internal->txMaxBytes = maxBytes;
+        internal->txMaxMsgs = (std::max)(maxMsgs, (size_t)1);
+        internal->lock.Unlock(MUTEX_CONTEXT);
+    }
+}
+
+bool _RemoteEndpoint::TxWritableAgain()
+{
+    /*
+     * Wait for the queue to drain to half the budgets so a sender that is retrying does not fill
+     * it again with the next message.
+     */
+    if (internal->txWritablePending &&
+        (internal->txQueue.size() <= (internal->txMaxMsgs / 2)) &&
+        (internal->txQueueBytes <= (internal->txMaxBytes / 2))) {
+        internal->txWritablePending = false;
+        return true;
+    }
+    return false;
+}
+
+size_t _RemoteEndpoint::GetTxSize(Message& msg)
+{
+    return msg->bufEOD - reinterpret_cast<const uint8_t*>(msg->msgBuf);
+}
+
+size_t _RemoteEndpoint::GetTxInFlight()
+{
+    if (internal->getNextMsg) {
+        return 0;
+    } else {
+        return (std::max)(internal->txBatchCount, (size_t)1);
+    }
+}
+
+bool _RemoteEndpoint::TxQueueHasRoom(size_t len, bool control)
+{
+    size_t count = internal->txQueue.size();
+    if (count == 0) {
+        return true;
+    }
+    if (control) {
+        return count < (internal->txMaxMsgs + TX_CONTROL_RESERVE);
+    }
+    return (count < internal->txMaxMsgs) && ((internal->txQueueBytes + len) <= internal->txMaxBytes);
+}
+
+void _RemoteEndpoint::EnqueueTx(Message& msg, size_t len, bool control, bool droppable)
+{
+    if (control) {
+        /*
+         * The queue is pushed at the front and written from the back. The probe goes behind the
+         * messages being written and any probes queued before it.
+         */
+        size_t i = internal->txQueue.size() - GetTxInFlight();
+        while ((i > 0) && IsTxControlMessage(internal->txQueue[i - 1].msg)) {
+            --i;
+        }
+        internal->txQueue.insert(internal->txQueue.begin() + i, Internal::TxEntry(msg, false));
+    } else {
+        internal->txQueue.push_front(Internal::TxEntry(msg, droppable));
+        if (droppable) {
+            ++internal->txDroppableCount;
+        }
+    }
+    internal->txQueueBytes += len;
+    if (msg->ttl) {
+        uint32_t expMs;
+        msg->IsExpired(&expMs);
+        uint64_t now = GetTimestamp64();
+        internal->txExpiry.Add(now, now + expMs, msg.unwrap());
+    }
+}
+
+void _RemoteEndpoint::PopTx()
+{
+    Internal::TxEntry& entry = internal->txQueue.back();
+    internal->txQueueBytes -= GetTxSize(entry.msg);
+    if (entry.droppable) {
+        --internal->txDroppableCount;
+    }
+    internal->txQueue.pop_back();
+}
+
+size_t _RemoteEndpoint::PurgeExpiredTx()
+{
+    if (internal->txExpiry.Size() == 0) {
+        return 0;
+    }
+    vector<void*> expired;
+    if (internal->txExpiry.Advance(GetTimestamp64(), expired) == 0) {
+        return 0;
+    }
+    /*
+     * The wheel also holds entries for messages that have since been written so each expired
+     * entry is looked up in the queue. The queue is compacted in a single pass, messages being
+     * written stay where they are.
+     */
+    sort(expired.begin(), expired.end());
+    deque<Internal::TxEntry>& queue = internal->txQueue;
+    size_t end = queue.size() - GetTxInFlight();
+    size_t keep = 0;
+    for (size_t i = 0; i < end; ++i) {
+        _Message* m = queue[i].msg.unwrap();
+        if (binary_search(expired.begin(), expired.end(), (void*)m) && m->IsExpired()) {
+            internal->txQueueBytes -= GetTxSize(queue[i].msg);
+            if (queue[i].droppable) {
+                --internal->txDroppableCount;
+            }
+        } else {
+            if (keep != i) {
+                queue[keep] = queue[i];
+            }
+            ++keep;
+        }
+    }
+    size_t purged = end - keep;
+    if (purged > 0) {
+        QCC_DbgPrintf(("Purged %u expired messages from tx queue (%s)", purged, GetUniqueName().c_str()));
+        queue.erase(queue.begin() + keep, queue.begin() + end);
+        /* Alert threads waiting for room in the queue */
+        for (size_t i = 0; (i < purged) && !internal->txWaitQueue.empty(); ++i) {
+            Thread* wakeMe = internal->txWaitQueue.back();
+            internal->txWaitQueue.pop_back();
+            QStatus status = wakeMe->Alert();
+            if (ER_OK != status) {
+                QCC_LogError(status, ("Failed to alert thread blocked on full tx queue"));
+            }
+        }
+    }
+    return purged;
+}
+
+uint32_t _RemoteEndpoint::GetTxDropCount() const
+{
+    return internal ? internal->txDropCount : 0;
+}
+
 void _RemoteEndpoint::IncrementRef()
 {
     int refs = IncrementAndFetch(&internal->refCount);
@@ -880,4 +1349,15 @@ uint32_t _RemoteEndpoint::GetSessionId() {
     }
 }
 
+size_t _RemoteEndpoint::GetTxQueueBytes()
+{
+    size_t bytes = 0;
+    if (internal) {
+        internal->lock.Lock(MUTEX_CONTEXT);
+        bytes = internal->txQueueBytes;
+        internal->lock.Unlock(MUTEX_CONTEXT);
+    }
+    return bytes;
+}
+
 }
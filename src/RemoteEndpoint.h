@@ -62,7 +62,7 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
 
       public:
 
-        Features() : isBusToBus(false), allowRemote(false), handlePassing(false), ajVersion(0), protocolVersion(0), processId(0), trusted(false)
+        Features() : isBusToBus(false), allowRemote(false), handlePassing(false), ajVersion(0), protocolVersion(0), processId(0), trusted(false), cutThrough(false)
         { }
 
         bool isBusToBus;       /**< When initiating connection this is an input value indicating if this is a bus-to-bus connection.
@@ -82,8 +82,24 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
         uint32_t processId;        /**< Process id optionally obtained from the remote peer */
 
         bool trusted;              /**< Indicated if the remote client was trusted */
+
+        bool cutThrough;           /**< Set by the daemon router to indicate that messages received on this endpoint may be
+                                        forwarded without parsing header fields that are not needed for routing. */
     };
 
+    /**
+     * What PushMessageNoWait() does with a message when the transmit queue is full.
+     */
+    typedef enum {
+        TX_OVERFLOW_BLOCK,        /**< Wait for room in the queue like PushMessage() */
+        TX_OVERFLOW_DROP_NEWEST,  /**< Drop the message being pushed */
+        TX_OVERFLOW_DROP_OLDEST,  /**< Drop the oldest message queued by PushMessageNoWait() that is not being written */
+        TX_OVERFLOW_DISCONNECT    /**< Drop the message being pushed and disconnect after too many consecutive drops */
+    } TxOverflowPolicy;
+
+    static const size_t DEFAULT_TX_QUEUE_MSGS = 30;            /**< Default message budget for the transmit queue */
+    static const size_t DEFAULT_TX_QUEUE_BYTES = 1024 * 1024;  /**< Default byte budget for the transmit queue */
+
     /**
      * Listener called when endpoint changes state.
      */
@@ -100,6 +116,15 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
          * @param ep   Endpoint that is exiting.
          */
         virtual void EndpointExit(RemoteEndpoint& ep) = 0;
+
+        /**
+         * Called when the transmit queue has drained after PushMessageNoWait() failed with
+         * ER_BUS_WRITE_QUEUE_FULL. This is called on the thread that writes to the endpoint so
+         * it must not block.
+         *
+         * @param ep   Endpoint that can accept messages again.
+         */
+        virtual void EndpointWritable(RemoteEndpoint& ep) { }
     };
 
     /**
@@ -139,6 +164,49 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     virtual QStatus PushMessage(Message& msg);
 
+    /**
+     * Send an outgoing message without waiting for room in the transmit queue. If the queue is
+     * full the message is handled according to the endpoint's overflow policy. This is used by
+     * the daemon router when a message is fanned out to many endpoints so that one slow
+     * endpoint does not hold up delivery to the others. With the default TX_OVERFLOW_BLOCK policy
+     * this waits for room exactly like PushMessage(), messages are only dropped if a drop policy
+     * has been set with SetTxOverflowPolicy().
+     *
+     * @param msg   Message to be sent.
+     * @return
+     *      - ER_OK if the message was queued.
+     *      - ER_BUS_WRITE_QUEUE_FULL if the message was dropped.
+     *      - An error status otherwise
+     */
+    QStatus PushMessageNoWait(Message& msg);
+
+    /**
+     * Set the policy PushMessageNoWait() applies when the transmit queue is full.
+     *
+     * @param policy     The overflow policy.
+     * @param maxDrops   For TX_OVERFLOW_DISCONNECT, the number of consecutive drops after which
+     *                   the endpoint is disconnected.
+     */
+    void SetTxOverflowPolicy(TxOverflowPolicy policy, uint32_t maxDrops = 0);
+
+    /**
+     * Set the budgets for the transmit queue. Once either budget is used up pushing a bulk message
+     * waits or is handled by the overflow policy. A message is always accepted by an empty queue.
+     * Link probes (ProbeReq and ProbeAck) are queued ahead of other messages and may exceed the
+     * budgets by a small number of messages.
+     *
+     * @param maxBytes  Maximum total size in bytes of the queued messages.
+     * @param maxMsgs   Maximum number of queued messages.
+     */
+    void SetTxQueueLimits(size_t maxBytes, size_t maxMsgs);
+
+    /**
+     * Get the number of messages PushMessageNoWait() has dropped on this endpoint.
+     *
+     * @return  The number of dropped messages.
+     */
+    uint32_t GetTxDropCount() const;
+
     /**
      * Start the endpoint.
      *
@@ -260,6 +328,13 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     const qcc::String& GetConnectSpec() const;
 
+    /**
+     * Get the name of the transport this endpoint was created by.
+     *
+     * @return The transport name.
+     */
+    const char* GetTransportName() const;
+
     /**
      * Indicate whether this endpoint can receive messages from other devices.
      *
@@ -351,6 +426,15 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     void SetSessionId(uint32_t sessionId);
 
+    /**
+     * Get the number of bytes of the messages waiting in the transmit queue, including the
+     * message currently being written. This is used to choose between bus-to-bus endpoints
+     * that can reach the same remote daemon.
+     *
+     * @return  The number of bytes queued for transmission.
+     */
+    size_t GetTxQueueBytes();
+
   protected:
 
     /**
@@ -387,6 +471,66 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     QStatus GenProbeMsg(bool isAck, Message msg);
 
+    /**
+     * Check if the transmit queue has drained far enough to notify the listener that a
+     * PushMessageNoWait() that failed can be retried. Must be called with the transmit queue lock
+     * held.
+     *
+     * @return  true if the listener should be notified.
+     */
+    bool TxWritableAgain();
+
+    /**
+     * Get the number of bytes a message occupies in the transmit queue.
+     *
+     * @param msg   The message.
+     * @return  The size of the marshaled message.
+     */
+    static size_t GetTxSize(Message& msg);
+
+    /**
+     * Get the number of messages at the back of the transmit queue that are being written. Must
+     * be called with the transmit queue lock held.
+     *
+     * @return  The number of messages that must not be removed or overtaken.
+     */
+    size_t GetTxInFlight();
+
+    /**
+     * Check if the transmit queue has room for a message. Must be called with the transmit queue
+     * lock held.
+     *
+     * @param len      The size of the message.
+     * @param control  true if the message is a link probe.
+     * @return  true if the message can be queued.
+     */
+    bool TxQueueHasRoom(size_t len, bool control);
+
+    /**
+     * Add a message to the transmit queue. Link probes overtake queued messages that are not
+     * already being written. Must be called with the transmit queue lock held.
+     *
+     * @param msg        The message.
+     * @param len        The size of the message.
+     * @param control    true if the message is a link probe.
+     * @param droppable  true if TX_OVERFLOW_DROP_OLDEST may drop the message to make room.
+     */
+    void EnqueueTx(Message& msg, size_t len, bool control, bool droppable = false);
+
+    /**
+     * Remove the oldest message, the one that has just been written, from the transmit queue.
+     * Must be called with the transmit queue lock held.
+     */
+    void PopTx();
+
+    /**
+     * Remove the messages whose TTL has expired from the transmit queue. Must be called with the
+     * transmit queue lock held.
+     *
+     * @return  The number of messages removed.
+     */
+    size_t PurgeExpiredTx();
+
     /**
      * Determine if message is a ProbeReq or ProbeAck message.
      *
@@ -414,6 +558,20 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     QStatus ReadCallback(qcc::Source& source, bool isTimedOut);
 
+    /**
+     * Read the next message from the stream into the current read message. Whenever possible data
+     * is read from the stream in large chunks into the endpoint's receive buffer so that many small
+     * messages can be carved out from a single read.
+     *
+     * @param rep          Wrapped version of this endpoint.
+     * @param checkSender  True if message's sender field should be validated against the endpoint's unique name.
+     * @return
+     *      - ER_OK if a complete message was read.
+     *      - ER_TIMEOUT if more data is needed to complete the message.
+     *      - An error status otherwise
+     */
+    QStatus ReadMessage(RemoteEndpoint& rep, bool checkSender);
+
     /**
      * Internal callback used to indicate that data can be written to File descriptor.
      * RemoteEndpoint users should not call this method.
@@ -425,6 +583,15 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     QStatus WriteCallback(qcc::Sink& sink, bool isTimedOut);
 
+    /**
+     * Coalesce messages from the front of the tx queue into the endpoint's transmit buffer so they
+     * can be written with a single write. Must be called with the endpoint lock held.
+     *
+     * @return  true if two or more messages were coalesced into the transmit buffer, false if the
+     *          next message is to be written on its own.
+     */
+    bool GatherTxQueue();
+
     /**
      * Internal callback used to indicate that the Stream for this endpoint has been removed
      * from the IODispatch.
@@ -50,6 +50,19 @@ class Router {
      */
     virtual QStatus PushMessage(Message& msg, BusEndpoint& sender) = 0;
 
+    /**
+     * Route a message without waiting for room in a transmit queue. Routers that cannot fail
+     * with a full queue route the message with PushMessage().
+     *
+     * @param sender  Endpoint that is sending the message
+     * @param msg     Message to be processed.
+     * @return
+     *      - ER_OK if successful.
+     *      - ER_BUS_WRITE_QUEUE_FULL if the message was not sent because a queue is full.
+     *      - An error status otherwise.
+     */
+    virtual QStatus PushMessageNoWait(Message& msg, BusEndpoint& sender) { return PushMessage(msg, sender); }
+
     /**
      * Register an endpoint.
      * This method must be called by an endpoint before attempting to use the router.
@@ -77,6 +90,17 @@ class Router {
      */
     virtual BusEndpoint FindEndpoint(const qcc::String& busname) = 0;
 
+    /**
+     * Find the endpoint that owns the given unique or well-known name. Routers that can look up
+     * a name without constructing a qcc::String override this method.
+     *
+     * @param busname    Unique or well-known bus name
+     *
+     * @return  Returns the requested endpoint or an invalid endpoint if the
+     *          endpoint was not found.
+     */
+    virtual BusEndpoint FindEndpoint(const char* busname) { return FindEndpoint(qcc::String(busname)); }
+
     /**
      * Generate a unique endpoint name.
      * This method is not used by non-daemon instnces of the router.
@@ -107,6 +131,16 @@ class Router {
      * @param guid   GUID of bus associated with this router.
      */
     virtual void SetGlobalGUID(const qcc::GUID128& guid) = 0;
+
+    /**
+     * Called when the local endpoint becomes the primary owner of a well-known name that cannot
+     * be replaced by another endpoint, or is about to release it. A router may use this to
+     * deliver messages addressed to the name without going through the bus.
+     *
+     * @param name   The well-known name.
+     * @param owned  true if the name was acquired, false if it was released.
+     */
+    virtual void LocalNameOwnerChanged(const qcc::String& name, bool owned) { }
 };
 
 }
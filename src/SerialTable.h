@@ -0,0 +1,192 @@
+/**
+ * @file
+ * An open-addressed hash table keyed by message serial number
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_SERIALTABLE_H
+#define _ALLJOYN_SERIALTABLE_H
+
+#ifndef __cplusplus
+#error Only include SerialTable.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+namespace ajn {
+
+/**
+ * Maps message serial numbers to objects. The table uses linear probing with backward shift
+ * deletion so lookups, inserts and removes are O(1) on average and only allocate when the table
+ * grows. The table does not own the objects and is not thread safe.
+ */
+template <typename T>
+class SerialTable {
+  public:
+
+    static const size_t MIN_CAPACITY = 64;   /**< Initial number of slots, must be a power of two */
+
+    /**
+     * Constructor
+     */
+    SerialTable() : slots(MIN_CAPACITY), count(0), shift(32 - 6) { }
+
+    /**
+     * Find the object for a serial number.
+     *
+     * @param serial  The serial number.
+     *
+     * @return  The object or NULL if there is no object for the serial number.
+     */
+    T* Find(uint32_t serial) const
+    {
+        for (size_t i = Home(serial); slots[i].obj; i = Next(i)) {
+            if (slots[i].serial == serial) {
+                return slots[i].obj;
+            }
+        }
+        return NULL;
+    }
+
+    /**
+     * Add or replace the object for a serial number.
+     *
+     * @param serial  The serial number.
+     * @param obj     The object, must not be NULL.
+     */
+    void Insert(uint32_t serial, T* obj)
+    {
+        if ((count + 1) * 2 > slots.size()) {
+            Grow();
+        }
+        size_t i = Home(serial);
+        while (slots[i].obj) {
+            if (slots[i].serial == serial) {
+                slots[i].obj = obj;
+                return;
+            }
+            i = Next(i);
+        }
+        slots[i].serial = serial;
+        slots[i].obj = obj;
+        ++count;
+    }
+
+    /**
+     * Remove the object for a serial number.
+     *
+     * @param serial  The serial number.
+     *
+     * @return  The object that was removed or NULL if there was no object for the serial number.
+     */
+    T* Remove(uint32_t serial)
+    {
+        size_t i = Home(serial);
+        while (slots[i].obj && (slots[i].serial != serial)) {
+            i = Next(i);
+        }
+        T* obj = slots[i].obj;
+        if (obj) {
+            /*
+             * Shift later entries in the probe sequence back so there are no holes in it
+             */
+            size_t hole = i;
+            for (size_t j = Next(i); slots[j].obj; j = Next(j)) {
+                size_t home = Home(slots[j].serial);
+                if (((j - home) & Mask()) >= ((j - hole) & Mask())) {
+                    slots[hole] = slots[j];
+                    hole = j;
+                }
+            }
+            slots[hole].obj = NULL;
+            --count;
+        }
+        return obj;
+    }
+
+    /**
+     * Get all the objects in the table.
+     *
+     * @param objs  [OUT] The objects are appended to this vector.
+     */
+    void GetAll(std::vector<T*>& objs) const
+    {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].obj) {
+                objs.push_back(slots[i].obj);
+            }
+        }
+    }
+
+    /**
+     * Remove all objects from the table.
+     */
+    void Clear()
+    {
+        std::vector<Slot>(MIN_CAPACITY).swap(slots);
+        count = 0;
+        shift = 32 - 6;
+    }
+
+    /**
+     * Get the number of objects in the table.
+     *
+     * @return  The number of objects.
+     */
+    size_t Size() const { return count; }
+
+  private:
+
+    struct Slot {
+        Slot() : serial(0), obj(NULL) { }
+        uint32_t serial;
+        T* obj;
+    };
+
+    size_t Mask() const { return slots.size() - 1; }
+
+    size_t Next(size_t i) const { return (i + 1) & Mask(); }
+
+    /*
+     * Serial numbers are allocated sequentially so they are spread over the table with a
+     * multiplicative hash.
+     */
+    size_t Home(uint32_t serial) const { return (size_t)((serial * 2654435769U) >> shift); }
+
+    void Grow()
+    {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        --shift;
+        count = 0;
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (old[i].obj) {
+                Insert(old[i].serial, old[i].obj);
+            }
+        }
+    }
+
+    std::vector<Slot> slots;    /**< The table, the size is always a power of two */
+    size_t count;               /**< Number of objects in the table */
+    uint32_t shift;             /**< 32 - log2 of the table size */
+};
+
+}
+
+#endif
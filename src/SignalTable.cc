@@ -25,7 +25,8 @@
 #include <qcc/Debug.h>
 #include <qcc/String.h>
 
-#include <list>
+#include <string.h>
+#include <vector>
 
 #include "SignalTable.h"
 
@@ -36,6 +37,16 @@ using namespace std;
 
 namespace ajn {
 
+bool SignalTable::Matches(const Record& record, const char* sourcePath, const char* iface, const char* signalName)
+{
+    const InterfaceDescription::Member* member = record.entry.member;
+    if ((strcmp(member->name.c_str(), signalName) != 0) || (strcmp(member->iface->GetName(), iface) != 0)) {
+        return false;
+    }
+    /* An empty source path matches any source path */
+    return record.sourcePath.empty() || !sourcePath || !*sourcePath || (strcmp(record.sourcePath.c_str(), sourcePath) == 0);
+}
+
 void SignalTable::Add(MessageReceiver* receiver,
                       MessageReceiver::SignalHandler handler,
                       const InterfaceDescription::Member* member,
@@ -45,10 +56,10 @@ void SignalTable::Add(MessageReceiver* receiver,
                   member->iface->GetName(),
                   member->name.c_str(),
                   sourcePath.c_str()));
-    Entry entry(handler, receiver, member);
-    Key key(sourcePath, member->iface->GetName(), member->name);
+    Record record(Entry(handler, receiver, member), sourcePath);
+    uint64_t key = DispatchKey::Member(member->iface->GetName(), member->name.c_str());
     lock.Lock(MUTEX_CONTEXT);
-    hashTable.insert(pair<const Key, Entry>(key, entry));
+    hashTable.insert(pair<const uint64_t, Record>(key, record));
     lock.Unlock(MUTEX_CONTEXT);
 }
 
@@ -57,15 +68,16 @@ void SignalTable::Remove(MessageReceiver* receiver,
                          const InterfaceDescription::Member* member,
                          const char* sourcePath)
 {
-    Key key(sourcePath, member->iface->GetName(), member->name.c_str());
-    iterator iter;
-    pair<iterator, iterator> range;
+    uint64_t key = DispatchKey::Member(member->iface->GetName(), member->name.c_str());
+    MapType::iterator iter;
+    pair<MapType::iterator, MapType::iterator> range;
 
     lock.Lock(MUTEX_CONTEXT);
     range = hashTable.equal_range(key);
     iter = range.first;
     while (iter != range.second) {
-        if ((iter->second.object == receiver) && (iter->second.handler == handler)) {
+        if ((iter->second.entry.object == receiver) && (iter->second.entry.handler == handler) &&
+            Matches(iter->second, sourcePath, member->iface->GetName(), member->name.c_str())) {
             hashTable.erase(iter);
             break;
         } else {
@@ -77,27 +89,30 @@ void SignalTable::Remove(MessageReceiver* receiver,
 
 void SignalTable::RemoveAll(MessageReceiver* receiver)
 {
-    bool removed;
     lock.Lock(MUTEX_CONTEXT);
-    do {
-        removed = false;
-        for (iterator iter = hashTable.begin(); iter != hashTable.end(); ++iter) {
-            if (iter->second.object == receiver) {
-                hashTable.erase(iter);
-                removed = true;
-                break;
-            }
+    MapType::iterator iter = hashTable.begin();
+    while (iter != hashTable.end()) {
+        if (iter->second.entry.object == receiver) {
+            hashTable.erase(iter++);
+        } else {
+            ++iter;
         }
-    } while (removed);
+    }
     lock.Unlock(MUTEX_CONTEXT);
 }
 
-pair<SignalTable::const_iterator, SignalTable::const_iterator> SignalTable::Find(const char* sourcePath,
-                                                                                 const char* iface,
-                                                                                 const char* signalName)
+bool SignalTable::Find(uint64_t memberKey, const char* sourcePath, const char* iface, const char* signalName, vector<Entry>& entries)
 {
-    Key key(sourcePath, iface, signalName);
-    return hashTable.equal_range(key);
+    size_t num = entries.size();
+    lock.Lock(MUTEX_CONTEXT);
+    pair<MapType::const_iterator, MapType::const_iterator> range = hashTable.equal_range(memberKey);
+    for (MapType::const_iterator iter = range.first; iter != range.second; ++iter) {
+        if (Matches(iter->second, sourcePath, iface, signalName)) {
+            entries.push_back(iter->second.entry);
+        }
+    }
+    lock.Unlock(MUTEX_CONTEXT);
+    return entries.size() > num;
 }
 
 }
@@ -26,12 +26,10 @@
 #endif
 
 #include <qcc/platform.h>
-#include <qcc/StringMapKey.h>
 
 #include <vector>
 
 #include <qcc/String.h>
-#include <qcc/StringMapKey.h>
 #include <qcc/Mutex.h>
 
 #include <alljoyn/InterfaceDescription.h>
@@ -39,6 +37,8 @@
 
 #include <alljoyn/Status.h>
 
+#include "DispatchKey.h"
+
 #include <qcc/STLContainer.h>
 
 namespace ajn {
@@ -50,27 +50,6 @@ class SignalTable {
 
   public:
 
-    /**
-     * Type definition for signal hash table key
-     */
-    struct Key {
-        qcc::StringMapKey sourcePath;           /**< The object path of the signal sender */
-        qcc::StringMapKey iface;                /**< The Interface name */
-        qcc::StringMapKey signalName;           /**< The signal name */
-
-        /**
-         * Constructor used for lookups only (no storage)
-         */
-        Key(const char* src, const char* ifc, const char* sig)
-            : sourcePath(src), iface(ifc), signalName(sig) { }
-
-        /**
-         * Constructor used for storage into hash table (no dangling char*)
-         */
-        Key(const qcc::String& src, const qcc::String& ifc, const qcc::String& sig)
-            : sourcePath(src), iface(ifc), signalName(sig) { }
-    };
-
     /**
      * Type definition for a signal hash table entry
      */
@@ -93,47 +72,6 @@ class SignalTable {
         Entry(void) : handler(), object(NULL), member(NULL) { }
     };
 
-    /** %Hash functor */
-    struct Hash {
-        /** Calculate hash for Key k */
-        size_t operator()(const Key& k) const {
-            /* source path cannot factor into hash because a key with no sourcepath is considered equal to one that does */
-            size_t hash = 0;
-            for (const char* p = k.signalName.c_str(); *p; ++p) {
-                hash = *p + hash * 11;
-            }
-            for (const char* p = k.iface.c_str(); *p; ++p) {
-                hash += *p * 7;
-            }
-            return hash;
-        }
-    };
-
-    /** Functor for testing 2 keys for equality */
-    struct Equal {
-        /** Return true two keys are equal */
-        bool operator()(const Key& k1, const Key& k2) const {
-            /* If either source path is null, then this field should be treated as don't care */
-            if ((k1.sourcePath.empty()) || (k2.sourcePath.empty())) {
-                return (0 == strcmp(k1.iface.c_str(), k2.iface.c_str())) && (0 == strcmp(k1.signalName.c_str(), k2.signalName.c_str()));
-            } else {
-                return (0 == strcmp(k1.iface.c_str(), k2.iface.c_str())) && \
-                       (0 == strcmp(k1.signalName.c_str(), k2.signalName.c_str())) && \
-                       (0 == strcmp(k1.sourcePath.c_str(), k2.sourcePath.c_str()));
-            }
-        }
-    };
-
-    /**
-     * Table iterator
-     */
-    typedef std::unordered_multimap<Key, Entry, Hash, Equal>::iterator iterator;
-
-    /**
-     * Const table iterator
-     */
-    typedef std::unordered_multimap<Key, Entry, Hash, Equal>::const_iterator const_iterator;
-
     /**
      * Add an entry to the signal hash table.
      *
@@ -168,33 +106,43 @@ class SignalTable {
     void RemoveAll(MessageReceiver* receiver);
 
     /**
-     * Find Entries based on set of criteria.
-     * Signal table lock should be held until iterators are no longer in use.
+     * Find the handlers for a signal.
      *
+     * @param memberKey    Dispatch key for the interface and signal name.
      * @param sourcePath   The object path of the signal sender.
-     * @param iface    The interface.
+     * @param iface        The interface.
      * @param signalName   The signal name.
+     * @param entries      [OUT] The matching entries are appended to this vector.
      *
-     * @return   Iterator range of entries with matching criteria.
+     * @return  true if any entries were found.
      */
-    std::pair<const_iterator, const_iterator> Find(const char* sourcePath, const char* iface, const char* signalName);
+    bool Find(uint64_t memberKey, const char* sourcePath, const char* iface, const char* signalName, std::vector<Entry>& entries);
 
-    /**
-     * Get the lock that protects the signal table.
-     */
-    void Lock(void) { lock.Lock(MUTEX_CONTEXT); }
+  private:
+
+    qcc::Mutex lock; /**< Lock protecting the signal table */
 
     /**
-     * Release the lock that protects the signal table.
+     * A signal handler and the source path it was registered for
      */
-    void Unlock(void) { lock.Unlock(MUTEX_CONTEXT); }
+    struct Record {
+        Entry entry;               /**< The signal handler */
+        qcc::String sourcePath;    /**< Signal originator or empty for all signal originators */
 
-  private:
+        Record(const Entry& entry, const qcc::String& sourcePath) : entry(entry), sourcePath(sourcePath) { }
+    };
 
-    qcc::Mutex lock; /**< Lock protecting the signal table */
+    /**
+     * Check if a record is for a signal.
+     */
+    static bool Matches(const Record& record, const char* sourcePath, const char* iface, const char* signalName);
 
-    /**  The hash table */
-    std::unordered_multimap<Key, Entry, Hash, Equal> hashTable;
+    /**
+     * The hash table is keyed by the dispatch key for the interface and signal name. Keys can
+     * collide so the records found for a key must be checked.
+     */
+    typedef std::unordered_multimap<uint64_t, Record, DispatchKey::Hasher> MapType;
+    MapType hashTable;
 };
 
 }
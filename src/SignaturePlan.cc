@@ -0,0 +1,331 @@
+/**
+ * @file
+ *
+ * This file implements the SignaturePlan and SignaturePlanCache classes
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <qcc/Debug.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/STLContainer.h>
+
+#include <alljoyn/MsgArg.h>
+
+#include "AtomicPointer.h"
+#include "SignaturePlan.h"
+#include "SignatureUtils.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+/*
+ * Maximum number of plans kept in the cache for local signatures and for signatures received from
+ * peers. Together these must stay well below SignaturePlanCache::TABLE_SIZE.
+ */
+static const size_t MAX_CACHED_PLANS = 256;
+static const size_t MAX_PEER_PLANS = 128;
+
+#define PadUp(n, i)   (((n) + (i) - 1) & ~((i) - 1))
+
+/*
+ * Marshaled size of the fixed size basic types
+ */
+static size_t FixedSizeForType(char typeId)
+{
+    switch (typeId) {
+    case ALLJOYN_BYTE:
+        return 1;
+
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+        return 2;
+
+    case ALLJOYN_BOOLEAN:
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+    case ALLJOYN_HANDLE:
+        return 4;
+
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_INT64:
+    case ALLJOYN_UINT64:
+        return 8;
+
+    default:
+        return 0;
+    }
+}
+
+QStatus SignaturePlan::Compile(const char* sig)
+{
+    ops.clear();
+    numArgs = 0;
+    sizeHint = 0;
+    signature = sig;
+    if (!SignatureUtils::IsValidSignature(sig)) {
+        return ER_BUS_BAD_SIGNATURE;
+    }
+    const char* sigPtr = signature.c_str();
+    while (*sigPtr) {
+        QStatus status = CompileType(sigPtr, 0);
+        if (status != ER_OK) {
+            return status;
+        }
+        ++numArgs;
+    }
+    return ER_OK;
+}
+
+QStatus SignaturePlan::CompileType(const char*& sigPtr, uint8_t parentTypeId)
+{
+    QStatus status = ER_OK;
+    const char* start = sigPtr;
+    size_t index = ops.size();
+    Op op;
+
+    op.typeId = (uint8_t)*sigPtr++;
+    op.alignment = (uint8_t)SignatureUtils::AlignmentForType((AllJoynTypeId)op.typeId);
+    op.numMembers = 0;
+    op.sigOffset = (uint8_t)(start - signature.c_str());
+    op.fixedSize = (uint16_t)FixedSizeForType(op.typeId);
+    ops.push_back(op);
+
+    switch (op.typeId) {
+    case ALLJOYN_STRUCT:
+    case ALLJOYN_WILDCARD:
+        /*
+         * The generic struct and wildcard types are only used for matching signatures.
+         */
+        status = ER_BUS_BAD_SIGNATURE;
+        break;
+
+    case ALLJOYN_ARRAY:
+        status = CompileType(sigPtr, op.typeId);
+        break;
+
+    case ALLJOYN_DICT_ENTRY_OPEN:
+        /*
+         * Dictionary entries are only allowed as array elements.
+         */
+        if (parentTypeId != ALLJOYN_ARRAY) {
+            status = ER_BUS_BAD_SIGNATURE;
+            break;
+        }
+
+    /* Falling through */
+    case ALLJOYN_STRUCT_OPEN:
+    {
+        /*
+         * A struct or dict entry has a fixed size if all of its members do. Structs always start on
+         * an 8 byte boundary so the padding between the members is the same wherever it appears.
+         */
+        bool fixed = true;
+        size_t size = 0;
+        uint8_t numMembers = 0;
+        while ((status == ER_OK) && (*sigPtr != ALLJOYN_STRUCT_CLOSE) && (*sigPtr != ALLJOYN_DICT_ENTRY_CLOSE)) {
+            size_t member = ops.size();
+            status = CompileType(sigPtr, op.typeId);
+            if (status == ER_OK) {
+                if (ops[member].fixedSize) {
+                    size = PadUp(size, ops[member].alignment) + ops[member].fixedSize;
+                } else {
+                    fixed = false;
+                }
+                ++numMembers;
+            }
+        }
+        ++sigPtr;
+        ops[index].numMembers = numMembers;
+        ops[index].fixedSize = fixed ? (uint16_t)size : 0;
+    }
+    break;
+
+    default:
+        break;
+    }
+    ops[index].sigLen = (uint8_t)(sigPtr - start);
+    ops[index].next = (uint16_t)ops.size();
+    return status;
+}
+
+SignaturePlanCache::SignaturePlanCache() : numPlans(0), numPeerPlans(0)
+{
+    static const char basicTypes[] = {
+        ALLJOYN_BYTE, ALLJOYN_BOOLEAN, ALLJOYN_INT16, ALLJOYN_UINT16, ALLJOYN_INT32, ALLJOYN_UINT32,
+        ALLJOYN_INT64, ALLJOYN_UINT64, ALLJOYN_DOUBLE, ALLJOYN_STRING, ALLJOYN_OBJECT_PATH,
+        ALLJOYN_SIGNATURE, ALLJOYN_VARIANT, ALLJOYN_HANDLE
+    };
+    memset(basicPlans, 0, sizeof(basicPlans));
+    for (size_t i = 0; i < TABLE_SIZE; ++i) {
+        table[i] = NULL;
+    }
+    for (size_t i = 0; i < ArraySize(basicTypes); ++i) {
+        char sig[2] = { basicTypes[i], 0 };
+        SignaturePlan* plan = new SignaturePlan();
+        plan->Compile(sig);
+        basicPlans[(uint8_t)basicTypes[i]] = plan;
+    }
+}
+
+SignaturePlanCache::~SignaturePlanCache()
+{
+    for (size_t i = 0; i < ArraySize(basicPlans); ++i) {
+        delete basicPlans[i];
+    }
+    for (size_t i = 0; i < TABLE_SIZE; ++i) {
+        delete table[i];
+    }
+}
+
+const SignaturePlan* SignaturePlanCache::Lookup(const char* signature, size_t hash) const
+{
+    /*
+     * The table is never more than half full so there is always an empty slot to end the probe.
+     */
+    for (size_t i = hash & (TABLE_SIZE - 1);; i = (i + 1) & (TABLE_SIZE - 1)) {
+        const SignaturePlan* plan = LoadAcquire(table[i]);
+        if (!plan) {
+            return NULL;
+        }
+        if (strcmp(plan->GetSignature(), signature) == 0) {
+            return plan;
+        }
+    }
+}
+
+QStatus SignaturePlanCache::AddPlan(const char* signature, size_t hash, size_t& count, size_t max, SignaturePlan& scratch, const SignaturePlan*& plan)
+{
+    QStatus status = ER_OK;
+    /*
+     * Another thread may have added the plan since it was looked up.
+     */
+    plan = Lookup(signature, hash);
+    if (plan) {
+        return ER_OK;
+    }
+    if (count < max) {
+        SignaturePlan* newPlan = new SignaturePlan();
+        status = newPlan->Compile(signature);
+        if (status == ER_OK) {
+            newPlan->cached = true;
+            size_t i = hash & (TABLE_SIZE - 1);
+            while (table[i]) {
+                i = (i + 1) & (TABLE_SIZE - 1);
+            }
+            StoreRelease(table[i], newPlan);
+            ++count;
+            plan = newPlan;
+        } else {
+            delete newPlan;
+        }
+    } else {
+        QCC_DbgPrintf(("Signature plan cache is full"));
+        status = scratch.Compile(signature);
+        plan = &scratch;
+    }
+    return status;
+}
+
+QStatus SignaturePlanCache::GetPlan(const char* signature, SignaturePlan& scratch, const SignaturePlan*& plan, size_t* sizeHint)
+{
+    /*
+     * Single complete basic types are the most common variant signatures.
+     */
+    if (signature[0] && !signature[1]) {
+        plan = GetBasicPlan(signature[0]);
+        if (plan) {
+            if (sizeHint) {
+                *sizeHint = 0;
+            }
+            return ER_OK;
+        }
+    }
+    QStatus status = ER_OK;
+    size_t hash = hash_string(signature);
+    plan = Lookup(signature, hash);
+    if (!plan) {
+        lock.Lock(MUTEX_CONTEXT);
+        status = AddPlan(signature, hash, numPlans, MAX_CACHED_PLANS, scratch, plan);
+        lock.Unlock(MUTEX_CONTEXT);
+    }
+    if (sizeHint) {
+        *sizeHint = (status == ER_OK) ? plan->sizeHint : 0;
+    }
+    return status;
+}
+
+QStatus SignaturePlanCache::FindPlan(const char* signature, SignaturePlan& scratch, const SignaturePlan*& plan)
+{
+    if (signature[0] && !signature[1]) {
+        plan = GetBasicPlan(signature[0]);
+        if (plan) {
+            return ER_OK;
+        }
+    }
+    QStatus status = ER_OK;
+    size_t hash = hash_string(signature);
+    plan = Lookup(signature, hash);
+    if (!plan) {
+        lock.Lock(MUTEX_CONTEXT);
+        status = AddPlan(signature, hash, numPeerPlans, MAX_PEER_PLANS, scratch, plan);
+        lock.Unlock(MUTEX_CONTEXT);
+    }
+    return status;
+}
+
+void SignaturePlanCache::AddMember(const InterfaceDescription::Member& member)
+{
+    SignaturePlan scratch;
+    const SignaturePlan* plan;
+    if (!member.signature.empty()) {
+        GetPlan(member.signature.c_str(), scratch, plan);
+    }
+    if (!member.returnSignature.empty()) {
+        GetPlan(member.returnSignature.c_str(), scratch, plan);
+    }
+}
+
+void SignaturePlanCache::AddInterface(const InterfaceDescription& iface)
+{
+    size_t numMembers = iface.GetMembers();
+    const InterfaceDescription::Member** members = new const InterfaceDescription::Member*[numMembers];
+    iface.GetMembers(members, numMembers);
+    for (size_t i = 0; i < numMembers; ++i) {
+        AddMember(*members[i]);
+    }
+    delete [] members;
+}
+
+void SignaturePlanCache::SetSizeHint(const SignaturePlan* plan, size_t sizeHint)
+{
+    /*
+     * The size is only a hint so it is written without locking.
+     */
+    if (plan->cached) {
+        const_cast<SignaturePlan*>(plan)->sizeHint = sizeHint;
+    }
+}
+
+}
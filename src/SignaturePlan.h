@@ -0,0 +1,250 @@
+#ifndef _ALLJOYN_SIGNATUREPLAN_H
+#define _ALLJOYN_SIGNATUREPLAN_H
+/**
+ * @file
+ *
+ * This file defines the compiled form of a signature used for marshaling and unmarshaling message
+ * arguments and a cache of compiled signatures.
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include SignaturePlan.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <vector>
+#include <string.h>
+
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/InterfaceDescription.h>
+#include <alljoyn/Status.h>
+
+namespace ajn {
+
+/**
+ * A signature compiled into a flat list of operations, one for each type in the signature in the
+ * order the types appear. Container operations are followed by the operations for their members
+ * (or element type for arrays) and record where the container ends so the members do not need to
+ * be found by re-parsing the signature.
+ */
+class SignaturePlan {
+  public:
+
+    /**
+     * One operation for each type in the signature
+     */
+    struct Op {
+        uint8_t typeId;      /**< The signature character for the type */
+        uint8_t alignment;   /**< Alignment of the type on the wire */
+        uint8_t numMembers;  /**< Number of members of a struct or dict entry */
+        uint8_t sigOffset;   /**< Offset of the signature for this complete type in the plan signature */
+        uint8_t sigLen;      /**< Length of the signature for this complete type */
+        uint16_t next;       /**< Index of the operation that follows this complete type */
+        uint16_t fixedSize;  /**< Marshaled size if the type has a fixed size, otherwise 0 */
+    };
+
+    /**
+     * Constructor
+     */
+    SignaturePlan() : numArgs(0), cached(false), sizeHint(0) { }
+
+    /**
+     * Compile a signature into this plan.
+     *
+     * @param signature  A NUL terminated signature.
+     *
+     * @return
+     *      - ER_OK if the signature was compiled.
+     *      - ER_BUS_BAD_SIGNATURE if the signature is not valid or cannot appear in a message.
+     */
+    QStatus Compile(const char* signature);
+
+    /**
+     * Get the signature this plan was compiled from.
+     *
+     * @return  The signature.
+     */
+    const char* GetSignature() const { return signature.c_str(); }
+
+    /**
+     * Get the signature of the complete type for an operation.
+     *
+     * @param op  The operation.
+     *
+     * @return  Pointer to the signature, this is not NUL terminated; the length is op.sigLen.
+     */
+    const char* GetSignature(const Op& op) const { return signature.c_str() + op.sigOffset; }
+
+    /**
+     * Test if a NUL terminated signature is the same as the signature for an operation.
+     *
+     * @param op   The operation.
+     * @param sig  The signature to test.
+     *
+     * @return  true if the signatures are the same.
+     */
+    bool MatchSignature(const Op& op, const char* sig) const {
+        return sig && (strncmp(sig, GetSignature(op), op.sigLen) == 0) && (sig[op.sigLen] == 0);
+    }
+
+    std::vector<Op> ops;  /**< The operations */
+    uint8_t numArgs;      /**< Number of complete types in the signature */
+
+  private:
+
+    friend class SignaturePlanCache;
+
+    /**
+     * Compile a single complete type
+     */
+    QStatus CompileType(const char*& sigPtr, uint8_t parentTypeId);
+
+    qcc::String signature;  /**< The signature the plan was compiled from */
+    bool cached;               /**< true if the plan is owned by a SignaturePlanCache */
+    volatile size_t sizeHint;  /**< Size of the most recent body marshaled with a cached plan */
+};
+
+/**
+ * A cache of compiled signatures. There is a small number of distinct signatures in use at any time
+ * so the plans are kept for the life of the cache and lookups do not lock. Signatures used locally
+ * and signatures received from peers are counted separately so a peer cannot fill the cache. Once
+ * either budget is used up any additional signatures of that kind are compiled on demand and not
+ * kept.
+ */
+class SignaturePlanCache {
+  public:
+
+    /**
+     * Constructor
+     */
+    SignaturePlanCache();
+
+    /**
+     * Destructor
+     */
+    ~SignaturePlanCache();
+
+    /**
+     * Get the compiled plan for a signature.
+     *
+     * @param signature  A NUL terminated signature.
+     * @param scratch    A plan to compile the signature into if it cannot be cached.
+     * @param plan       Returns a pointer to the plan, this is either a cached plan or scratch.
+     * @param sizeHint   If not NULL returns the size of the last body marshaled with the plan.
+     *
+     * @return
+     *      - ER_OK if the plan was found or compiled.
+     *      - ER_BUS_BAD_SIGNATURE if the signature is not valid.
+     */
+    QStatus GetPlan(const char* signature, SignaturePlan& scratch, const SignaturePlan*& plan, size_t* sizeHint = NULL);
+
+    /**
+     * Get the compiled plan for a signature received from a peer. Signatures from peers have a
+     * separate, smaller, budget in the cache so they cannot crowd out the plans for local
+     * interfaces. Once that budget is used up signatures that are not cached are compiled into
+     * scratch.
+     *
+     * @param signature  A NUL terminated signature.
+     * @param scratch    A plan to compile the signature into if it is not cached.
+     * @param plan       Returns a pointer to the plan, this is either a cached plan or scratch.
+     *
+     * @return
+     *      - ER_OK if the plan was found or compiled.
+     *      - ER_BUS_BAD_SIGNATURE if the signature is not valid.
+     */
+    QStatus FindPlan(const char* signature, SignaturePlan& scratch, const SignaturePlan*& plan);
+
+    /**
+     * Add the argument and return signatures of the members of an interface to the cache.
+     *
+     * @param iface  The interface.
+     */
+    void AddInterface(const InterfaceDescription& iface);
+
+    /**
+     * Add the argument and return signatures of an interface member to the cache.
+     *
+     * @param member  The interface member.
+     */
+    void AddMember(const InterfaceDescription::Member& member);
+
+    /**
+     * Record the size of a body marshaled with a plan. This is a no-op for plans that are not
+     * cached.
+     *
+     * @param plan      The plan the body was marshaled with.
+     * @param sizeHint  The marshaled body size.
+     */
+    void SetSizeHint(const SignaturePlan* plan, size_t sizeHint);
+
+    /**
+     * Get the compiled plan for a basic type or variant. This does not lock the cache.
+     *
+     * @param typeId  The type signature character.
+     *
+     * @return  The plan or NULL if the type is not a basic type or variant.
+     */
+    const SignaturePlan* GetBasicPlan(char typeId) const {
+        return ((uint8_t)typeId < ArraySize(basicPlans)) ? basicPlans[(uint8_t)typeId] : NULL;
+    }
+
+  private:
+
+    /**
+     * Copy constructor is undefined.
+     */
+    SignaturePlanCache(const SignaturePlanCache& other);
+
+    /**
+     * Assignment operator is undefined.
+     */
+    SignaturePlanCache& operator=(const SignaturePlanCache& other);
+
+    /**
+     * Find a cached plan. This does not lock the cache.
+     */
+    const SignaturePlan* Lookup(const char* signature, size_t hash) const;
+
+    /**
+     * Compile a plan and add it to the cache if the count is below max, otherwise compile it into
+     * scratch. Called with the lock held.
+     */
+    QStatus AddPlan(const char* signature, size_t hash, size_t& count, size_t max, SignaturePlan& scratch, const SignaturePlan*& plan);
+
+    static const size_t TABLE_SIZE = 1024;  /**< Number of slots in the plan table, must be a power of 2 */
+
+    SignaturePlan* basicPlans[128];   /**< Plans for single character signatures */
+    qcc::Mutex lock;                  /**< Mutex serializing additions to the plan table */
+    size_t numPlans;                  /**< Number of cached plans for local signatures */
+    size_t numPeerPlans;              /**< Number of cached plans for signatures received from peers */
+
+    /**
+     * Open addressed table of cached plans. Plans are only added while the cache exists so the
+     * table is read without locking.
+     */
+    SignaturePlan* volatile table[TABLE_SIZE];
+};
+
+}
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * @file
+ * Implements a hierarchical timing wheel for tracking the expiry times of queued messages
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include "TimingWheel.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+
+namespace ajn {
+
+/*
+ * Number of ticks covered by one slot at a level
+ */
+#define SlotSpan(level) ((uint64_t)1 << (LEVEL_BITS * (level)))
+
+/*
+ * The slot a tick falls in at a level
+ */
+#define SlotIndex(tick, level) ((size_t)((tick) >> (LEVEL_BITS * (level))) & (NUM_SLOTS - 1))
+
+TimingWheel::TimingWheel() : current(0), count(0)
+{
+    memset(occupied, 0, sizeof(occupied));
+}
+
+void TimingWheel::Insert(const Entry& entry, uint64_t earliest)
+{
+    uint64_t when = (entry.expiry < earliest) ? earliest : entry.expiry;
+    uint64_t delta = when - current;
+    /*
+     * Entries beyond the span of the wheel go in the furthest slot and are put back in the right
+     * slot when that slot is cascaded.
+     */
+    if (delta >= SlotSpan(NUM_LEVELS)) {
+        delta = SlotSpan(NUM_LEVELS) - 1;
+        when = current + delta;
+    }
+    size_t level = 0;
+    while (delta >= SlotSpan(level + 1)) {
+        ++level;
+    }
+    size_t slot = SlotIndex(when, level);
+    slots[level][slot].push_back(entry);
+    occupied[level] |= ((uint64_t)1 << slot);
+    if (entry.handle) {
+        entry.handle->level = level;
+        entry.handle->slot = slot;
+        entry.handle->index = slots[level][slot].size() - 1;
+    }
+}
+
+void TimingWheel::Add(uint64_t now, uint64_t expiry, void* context, Handle* handle)
+{
+    assert(!handle || !handle->IsArmed());
+    if (count == 0) {
+        current = now;
+    }
+    Entry entry;
+    entry.expiry = expiry;
+    entry.context = context;
+    entry.handle = handle;
+    /*
+     * The slot for the current tick has already been processed
+     */
+    Insert(entry, current + 1);
+    ++count;
+}
+
+bool TimingWheel::Cancel(Handle& handle)
+{
+    if (!handle.IsArmed()) {
+        return false;
+    }
+    vector<Entry>& entries = slots[handle.level][handle.slot];
+    assert((handle.index < entries.size()) && (entries[handle.index].handle == &handle));
+    /*
+     * The last entry in the slot takes the place of the cancelled one
+     */
+    if ((handle.index + 1) < entries.size()) {
+        entries[handle.index] = entries.back();
+        if (entries[handle.index].handle) {
+            entries[handle.index].handle->index = handle.index;
+        }
+    }
+    entries.pop_back();
+    if (entries.empty()) {
+        occupied[handle.level] &= ~((uint64_t)1 << handle.slot);
+    }
+    --count;
+    handle.level = NUM_LEVELS;
+    return true;
+}
+
+void TimingWheel::Disarm(vector<Entry>& entries)
+{
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].handle) {
+            entries[i].handle->level = NUM_LEVELS;
+        }
+    }
+}
+
+void TimingWheel::Cascade(size_t level, size_t slot)
+{
+    if (occupied[level] & ((uint64_t)1 << slot)) {
+        vector<Entry> entries;
+        entries.swap(slots[level][slot]);
+        occupied[level] &= ~((uint64_t)1 << slot);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            Insert(entries[i], current);
+        }
+    }
+}
+
+size_t TimingWheel::Advance(uint64_t now, vector<void*>& expired)
+{
+    size_t num = 0;
+    while ((count > 0) && (current < now)) {
+        /*
+         * Skip over ticks where nothing can happen. If the lowest levels are empty nothing happens
+         * until the next tick that cascades the lowest non-empty level.
+         */
+        size_t level = 0;
+        while ((level < NUM_LEVELS) && (occupied[level] == 0)) {
+            ++level;
+        }
+        uint64_t skipTo = current;
+        if (level > 0) {
+            skipTo = current | (SlotSpan(level) - 1);
+        } else {
+            uint64_t last = current | (NUM_SLOTS - 1);
+            if (last > now) {
+                last = now;
+            }
+            size_t from = SlotIndex(current, 0) + 1;
+            size_t to = SlotIndex(last, 0);
+            if (from <= to) {
+                uint64_t mask = ((uint64_t)-1 << from);
+                if (to < (NUM_SLOTS - 1)) {
+                    mask &= ((uint64_t)1 << (to + 1)) - 1;
+                }
+                if ((occupied[0] & mask) == 0) {
+                    skipTo = last;
+                }
+            }
+        }
+        if (skipTo > current) {
+            current = (skipTo < now) ? skipTo : now;
+            continue;
+        }
+        /*
+         * Process the next tick, cascading the higher levels at slot boundaries
+         */
+        ++current;
+        for (level = 1; level < NUM_LEVELS; ++level) {
+            if (SlotIndex(current, level - 1) != 0) {
+                break;
+            }
+            Cascade(level, SlotIndex(current, level));
+        }
+        size_t slot = SlotIndex(current, 0);
+        if (occupied[0] & ((uint64_t)1 << slot)) {
+            vector<Entry>& entries = slots[0][slot];
+            for (size_t i = 0; i < entries.size(); ++i) {
+                expired.push_back(entries[i].context);
+            }
+            Disarm(entries);
+            num += entries.size();
+            count -= entries.size();
+            entries.clear();
+            occupied[0] &= ~((uint64_t)1 << slot);
+        }
+    }
+    if (count == 0) {
+        current = now;
+    }
+    return num;
+}
+
+void TimingWheel::Clear()
+{
+    for (size_t level = 0; level < NUM_LEVELS; ++level) {
+        for (size_t slot = 0; occupied[level] != 0; ++slot) {
+            if (occupied[level] & ((uint64_t)1 << slot)) {
+                Disarm(slots[level][slot]);
+                slots[level][slot].clear();
+                occupied[level] &= ~((uint64_t)1 << slot);
+            }
+        }
+    }
+    count = 0;
+}
+
+bool TimingWheel::GetNextExpiry(uint64_t& when) const
+{
+    if (count == 0) {
+        return false;
+    }
+    /*
+     * The first non-empty higher level is cascaded at its next slot boundary, that is the earliest
+     * an entry in a higher level can expire.
+     */
+    when = current + SlotSpan(NUM_LEVELS);
+    for (size_t level = 1; level < NUM_LEVELS; ++level) {
+        if (occupied[level]) {
+            when = (current | (SlotSpan(level) - 1)) + 1;
+            break;
+        }
+    }
+    if (occupied[0]) {
+        for (size_t i = 1; i <= NUM_SLOTS; ++i) {
+            if (occupied[0] & ((uint64_t)1 << SlotIndex(current + i, 0))) {
+                if ((current + i) < when) {
+                    when = current + i;
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,172 @@
+/**
+ * @file
+ * Implements a hierarchical timing wheel for tracking the expiry times of queued messages
+ */
+
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_TIMINGWHEEL_H
+#define _ALLJOYN_TIMINGWHEEL_H
+
+#ifndef __cplusplus
+#error Only include TimingWheel.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+namespace ajn {
+
+/**
+ * A hierarchical timing wheel. Each entry is an opaque context pointer with an expiry time in
+ * milliseconds. Adding an entry is O(1) and advancing the wheel costs O(1) per expired entry plus
+ * a small amount per block of 64 milliseconds that elapsed while the wheel had entries.
+ *
+ * An entry that is added with a handle can be cancelled in O(1). Entries added without a handle
+ * cannot be removed, the owner of the wheel must check that the context for an expired entry is
+ * still relevant before acting on it. Such an entry stays in the wheel until it expires, so the
+ * wheel holds up to the rate at which entries are added times the longest lifetime of an entry.
+ * Owners should call Clear() when they know none of the entries are relevant any more. The wheel
+ * is not thread safe.
+ */
+class TimingWheel {
+  public:
+
+    static const size_t LEVEL_BITS = 6;                 /**< log2 of the number of slots per level */
+    static const size_t NUM_SLOTS = 1 << LEVEL_BITS;    /**< Number of slots per level */
+    static const size_t NUM_LEVELS = 4;                 /**< Number of levels, the wheel spans 2^24 ms */
+
+    /**
+     * The position of an entry in the wheel. The wheel keeps the handle up to date as the entry
+     * moves between slots and disarms it when the entry expires, is cancelled or is cleared. A
+     * handle must not be destroyed while it is armed.
+     */
+    struct Handle {
+        Handle() : level(NUM_LEVELS), slot(0), index(0) { }
+
+        /**
+         * Test if the handle refers to an entry in the wheel.
+         */
+        bool IsArmed() const { return level < NUM_LEVELS; }
+
+        size_t level;   /**< Level of the entry, NUM_LEVELS if the handle is not armed */
+        size_t slot;    /**< Slot of the entry within the level */
+        size_t index;   /**< Index of the entry within the slot */
+    };
+
+    /**
+     * Constructor
+     */
+    TimingWheel();
+
+    /**
+     * Add an entry to the wheel. Entries further in the future than the span of the wheel are
+     * kept in the last slot of the top level until they come within range. An entry that has
+     * already expired is returned by the next call to Advance() with a later time.
+     *
+     * @param now      The current time in milliseconds.
+     * @param expiry   The time in milliseconds at which the entry expires.
+     * @param context  The context returned by Advance() when the entry expires.
+     * @param handle   If not NULL a handle that can be passed to Cancel(), it must not be armed.
+     */
+    void Add(uint64_t now, uint64_t expiry, void* context, Handle* handle = NULL);
+
+    /**
+     * Remove an entry from the wheel.
+     *
+     * @param handle  The handle passed to Add() for the entry.
+     *
+     * @return  true if the entry was removed, false if the handle was not armed.
+     */
+    bool Cancel(Handle& handle);
+
+    /**
+     * Advance the wheel to the current time and collect the entries that have expired.
+     *
+     * @param now      The current time in milliseconds.
+     * @param expired  [OUT] The contexts of the expired entries are appended to this vector.
+     *
+     * @return  The number of entries that expired.
+     */
+    size_t Advance(uint64_t now, std::vector<void*>& expired);
+
+    /**
+     * Get a lower bound for the time at which the next entry expires.
+     *
+     * @param when  [OUT] Returns the time in milliseconds.
+     *
+     * @return  false if the wheel is empty.
+     */
+    bool GetNextExpiry(uint64_t& when) const;
+
+    /**
+     * Remove all entries from the wheel.
+     */
+    void Clear();
+
+    /**
+     * Get the number of entries in the wheel.
+     *
+     * @return  The number of entries.
+     */
+    size_t Size() const { return count; }
+
+  private:
+
+    /**
+     * Copy constructor is undefined.
+     */
+    TimingWheel(const TimingWheel& other);
+
+    /**
+     * Assignment operator is undefined.
+     */
+    TimingWheel& operator=(const TimingWheel& other);
+
+    struct Entry {
+        uint64_t expiry;
+        void* context;
+        Handle* handle;
+    };
+
+    /**
+     * Put an entry in the slot for its expiry time relative to the current tick.
+     *
+     * @param entry     The entry.
+     * @param earliest  The earliest tick the entry may be put in.
+     */
+    void Insert(const Entry& entry, uint64_t earliest);
+
+    /**
+     * Move the entries in a slot of a higher level down to the lower levels.
+     */
+    void Cascade(size_t level, size_t slot);
+
+    /**
+     * Disarm the handles of the entries in a slot that is being emptied.
+     */
+    static void Disarm(std::vector<Entry>& entries);
+
+    uint64_t current;                                 /**< The last tick that has been processed */
+    size_t count;                                     /**< Number of entries in the wheel */
+    uint64_t occupied[NUM_LEVELS];                    /**< Bitmap of the non-empty slots at each level */
+    std::vector<Entry> slots[NUM_LEVELS][NUM_SLOTS];  /**< The entries */
+};
+
+}
+
+#endif
@@ -22,6 +22,7 @@
 
 #include <qcc/String.h>
 #include <qcc/Thread.h>
+#include <qcc/Util.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/DBusStd.h>
@@ -359,3 +360,96 @@ TEST_F(BusAttachmentTest, JoinSession) {
     EXPECT_TRUE(sessionJoined);
     EXPECT_EQ(busSessionId, otherBusSessionId);
 }
+
+static const char* ARG_MATCH_INTERFACE = "org.alljoyn.bus.BusAttachmentTest.ArgMatch";
+
+class ArgMatchSender : public BusObject {
+  public:
+    ArgMatchSender(const InterfaceDescription* iface) : BusObject("/org/alljoyn/test/ArgMatch") {
+        AddInterface(*iface);
+        sig = iface->GetMember("Sig");
+    }
+
+    QStatus Emit(const char* value) {
+        MsgArg arg("s", value);
+        return Signal(NULL, 0, *sig, &arg, 1);
+    }
+
+    const InterfaceDescription::Member* sig;
+};
+
+class ArgMatchReceiver : public MessageReceiver {
+  public:
+    void SigHandler(const InterfaceDescription::Member* member, const char* srcPath, Message& msg) {
+        values.push_back(msg->GetArg(0)->v_string.str);
+    }
+
+    std::vector<qcc::String> values;
+};
+
+TEST_F(BusAttachmentTest, AddMatch_ArgRules)
+{
+    QStatus status = ER_OK;
+
+    BusAttachment otherBus("BusAttachmentTest.ArgMatch", false);
+    status = otherBus.Start();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    InterfaceDescription* senderIface = NULL;
+    status = otherBus.CreateInterface(ARG_MATCH_INTERFACE, senderIface);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    senderIface->AddSignal("Sig", "s", "value");
+    senderIface->Activate();
+    ArgMatchSender sender(senderIface);
+    status = otherBus.RegisterBusObject(sender);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = otherBus.Connect(getConnectArg().c_str());
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    InterfaceDescription* iface = NULL;
+    status = bus.CreateInterface(ARG_MATCH_INTERFACE, iface);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    iface->AddSignal("Sig", "s", "value");
+    iface->Activate();
+    ArgMatchReceiver receiver;
+    status = bus.RegisterSignalHandler(&receiver, static_cast<MessageReceiver::SignalHandler>(&ArgMatchReceiver::SigHandler), iface->GetMember("Sig"), NULL);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /* An empty argNpath only matches an empty argument */
+    status = bus.AddMatch("type='signal',interface='org.alljoyn.bus.BusAttachmentTest.ArgMatch',arg0='match'");
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = bus.AddMatch("type='signal',interface='org.alljoyn.bus.BusAttachmentTest.ArgMatch',arg0path='/aa/'");
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = bus.AddMatch("type='signal',interface='org.alljoyn.bus.BusAttachmentTest.ArgMatch',arg0path=''");
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    const char* sent[] = { "nomatch", "match", "/aa/bb", "/aabb", "", "/" };
+    for (size_t i = 0; i < ArraySize(sent); ++i) {
+        status = sender.Emit(sent[i]);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    for (size_t i = 0; i < 200; ++i) {
+        if (receiver.values.size() >= 4) {
+            break;
+        }
+        qcc::Sleep(5);
+    }
+    /* Give any signals that should not have matched a chance to arrive */
+    qcc::Sleep(100);
+
+    /* "/" matches arg0path='/aa/' because it ends with '/' and is a prefix of the rule */
+    ASSERT_EQ((size_t)4, receiver.values.size());
+    EXPECT_STREQ("match", receiver.values[0].c_str());
+    EXPECT_STREQ("/aa/bb", receiver.values[1].c_str());
+    EXPECT_STREQ("", receiver.values[2].c_str());
+    EXPECT_STREQ("/", receiver.values[3].c_str());
+
+    status = bus.RemoveMatch("type='signal',interface='org.alljoyn.bus.BusAttachmentTest.ArgMatch',arg0path=''");
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = bus.UnregisterSignalHandler(&receiver, static_cast<MessageReceiver::SignalHandler>(&ArgMatchReceiver::SigHandler), iface->GetMember("Sig"), NULL);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    otherBus.Stop();
+    otherBus.Join();
+}
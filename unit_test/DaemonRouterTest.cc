@@ -0,0 +1,388 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <qcc/ManagedObj.h>
+#include <qcc/Socket.h>
+#include <qcc/SocketStream.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgArg.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <BusInternal.h>
+#include <DaemonConfig.h>
+#include <DaemonRouter.h>
+#include <RemoteEndpoint.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+using namespace qcc;
+
+class DaemonRouterTestMessage : public _Message {
+  public:
+
+    DaemonRouterTestMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Signal(uint32_t n)
+    {
+        MsgArg arg("u", n);
+        return SignalMsg("u", NULL, 0, "/org/alljoyn/test", "org.alljoyn.test", "Seq", &arg, 1, 0, 0);
+    }
+
+    QStatus SessionSignal(const char* sender, SessionId id, uint32_t n)
+    {
+        MsgArg arg("u", n);
+        QStatus status = SignalMsg("u", NULL, id, "/org/alljoyn/test", "org.alljoyn.test", "Seq", &arg, 1, 0, 0);
+        if (status == ER_OK) {
+            status = ReMarshal(sender);
+        }
+        return status;
+    }
+};
+
+/*
+ * An endpoint that records the serial numbers of the messages routed to it
+ */
+class DaemonRouterTestEndpoint : public _BusEndpoint {
+  public:
+    DaemonRouterTestEndpoint(const qcc::String& name) : _BusEndpoint(ENDPOINT_TYPE_NULL), name(name) { }
+
+    const qcc::String& GetUniqueName() const { return name; }
+
+    QStatus PushMessage(Message& msg) {
+        lock.Lock(MUTEX_CONTEXT);
+        received.push_back(msg->GetCallSerial());
+        lock.Unlock(MUTEX_CONTEXT);
+        return ER_OK;
+    }
+
+    std::vector<uint32_t> TakeReceived() {
+        lock.Lock(MUTEX_CONTEXT);
+        std::vector<uint32_t> ret;
+        ret.swap(received);
+        lock.Unlock(MUTEX_CONTEXT);
+        return ret;
+    }
+
+    qcc::String name;
+    qcc::Mutex lock;
+    std::vector<uint32_t> received;
+};
+
+typedef ManagedObj<DaemonRouterTestEndpoint> DaemonRouterTestEndpointObj;
+
+class DaemonRouterTest : public testing::Test {
+  public:
+    DaemonRouterTest() : bus("DaemonRouterTest", false), router(NULL) { }
+
+    virtual void SetUp() {
+        QStatus status = bus.Start();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    virtual void TearDown() {
+        delete router;
+        router = NULL;
+        members.clear();
+        endpoints.clear();
+        for (size_t i = 0; i < streams.size(); ++i) {
+            delete streams[i];
+        }
+        for (size_t i = 0; i < peers.size(); ++i) {
+            Close(peers[i]);
+        }
+        bus.Stop();
+        bus.Join();
+    }
+
+    /*
+     * Load the daemon configuration and create a router that reads it
+     */
+    void CreateRouter(const char* configXml) {
+        DaemonConfig::Load(configXml);
+        router = new DaemonRouter();
+    }
+
+    /*
+     * Create a remote endpoint for a transport and register it with the router. The endpoint is
+     * never started so everything pushed to it stays in its transmit queue.
+     */
+    RemoteEndpoint CreateEndpoint(const char* transport) {
+        SocketFd fds[2];
+        QStatus status = SocketPair(fds);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        streams.push_back(new SocketStream(fds[0]));
+        peers.push_back(fds[1]);
+        RemoteEndpoint ep(bus, true, "", streams.back(), transport);
+        endpoints.push_back(ep);
+        BusEndpoint bep = BusEndpoint::cast(ep);
+        status = router->RegisterEndpoint(bep);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        return ep;
+    }
+
+    /*
+     * Count the messages an endpoint accepts without waiting before its transmit queue is full
+     */
+    size_t CountQueued(RemoteEndpoint& ep) {
+        for (uint32_t n = 0; n < 1000; ++n) {
+            ManagedObj<DaemonRouterTestMessage> signal(bus);
+            QStatus status = signal->Signal(n);
+            EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+            Message msg = Message::cast(signal);
+            status = ep->PushMessageNoWait(msg);
+            if (status != ER_OK) {
+                EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, status) << "  Actual Status: " << QCC_StatusText(status);
+                return n;
+            }
+        }
+        return 1000;
+    }
+
+    /*
+     * Register the bus attachment's local endpoint with the router, the router does not route
+     * messages without one, and create test endpoints with the given unique names.
+     */
+    void CreateMembers(const char* const* names, size_t numNames) {
+        BusEndpoint local = BusEndpoint::cast(bus.GetInternal().GetLocalEndpoint());
+        QStatus status = router->RegisterEndpoint(local);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        for (size_t i = 0; i < numNames; ++i) {
+            DaemonRouterTestEndpointObj ep(names[i]);
+            members.push_back(ep);
+            BusEndpoint bep = BusEndpoint::cast(ep);
+            status = router->RegisterEndpoint(bep);
+            EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        }
+    }
+
+    QStatus Join(SessionId id, size_t src, size_t dest) {
+        BusEndpoint srcEp = BusEndpoint::cast(members[src]);
+        BusEndpoint destEp = BusEndpoint::cast(members[dest]);
+        RemoteEndpoint destB2bEp;
+        return router->AddSessionRoute(id, srcEp, NULL, destEp, destB2bEp);
+    }
+
+    void Leave(SessionId id, size_t member) {
+        router->RemoveSessionRoutes(members[member]->name.c_str(), id);
+    }
+
+    /*
+     * Send a session multicast message from a member and return its serial number
+     */
+    QStatus SessionCast(SessionId id, size_t src, uint32_t* serial = NULL) {
+        ManagedObj<DaemonRouterTestMessage> signal(bus);
+        QStatus status = signal->SessionSignal(members[src]->name.c_str(), id, 0);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        Message msg = Message::cast(signal);
+        if (serial) {
+            *serial = msg->GetCallSerial();
+        }
+        BusEndpoint sender = BusEndpoint::cast(members[src]);
+        return router->PushMessage(msg, sender);
+    }
+
+    /*
+     * Get the indices of the members that received a message with the given serial number since
+     * this was last called.
+     */
+    String Receivers(uint32_t serial) {
+        String indices;
+        for (size_t i = 0; i < members.size(); ++i) {
+            std::vector<uint32_t> received = members[i]->TakeReceived();
+            if (std::count(received.begin(), received.end(), serial) > 0) {
+                EXPECT_EQ((size_t)1, received.size()) << "  Member " << i << " received other messages";
+                if (!indices.empty()) {
+                    indices += " ";
+                }
+                indices += U32ToString((uint32_t)i);
+            }
+        }
+        return indices;
+    }
+
+    BusAttachment bus;
+    DaemonRouter* router;
+    std::vector<DaemonRouterTestEndpointObj> members;
+    std::vector<RemoteEndpoint> endpoints;
+    std::vector<SocketStream*> streams;
+    std::vector<SocketFd> peers;
+};
+
+TEST_F(DaemonRouterTest, TxQueueLimits) {
+    CreateRouter("<busconfig>"
+                 "  <limit tx_queue_messages=\"4\" tcp_tx_queue_messages=\"2\" ice_tx_queue_bytes=\"1\"/>"
+                 "  <property tx_overflow_policy=\"drop-newest\"/>"
+                 "</busconfig>");
+
+    /* Transports without an override get the global budgets */
+    RemoteEndpoint other = CreateEndpoint("bluetooth");
+    EXPECT_EQ((size_t)4, CountQueued(other));
+
+    /* Per-transport overrides replace the global budget they name and leave the other one */
+    RemoteEndpoint tcp = CreateEndpoint("tcp");
+    EXPECT_EQ((size_t)2, CountQueued(tcp));
+    RemoteEndpoint ice = CreateEndpoint("ice");
+    EXPECT_EQ((size_t)1, CountQueued(ice));
+}
+
+TEST_F(DaemonRouterTest, TxQueueDefaultLimits) {
+    CreateRouter("<busconfig>"
+                 "  <property tx_overflow_policy=\"drop-newest\"/>"
+                 "</busconfig>");
+
+    RemoteEndpoint ep = CreateEndpoint("tcp");
+    EXPECT_EQ((size_t)_RemoteEndpoint::DEFAULT_TX_QUEUE_MSGS, CountQueued(ep));
+}
+
+TEST_F(DaemonRouterTest, SessionCastJoinLeave) {
+    static const char* names[] = { ":1.1", ":1.2", ":1.3", ":1.4" };
+    static const SessionId id = 1234;
+    static const SessionId otherId = 5678;
+    uint32_t serial;
+    CreateRouter("<busconfig></busconfig>");
+    CreateMembers(names, ArraySize(names));
+
+    EXPECT_EQ(ER_BUS_NO_ROUTE, SessionCast(id, 0));
+
+    /* Each join rebuilds the fan-out list of both ends of the new route */
+    ASSERT_EQ(ER_OK, Join(id, 0, 1));
+    EXPECT_EQ(ER_OK, SessionCast(id, 0, &serial));
+    EXPECT_STREQ("1", Receivers(serial).c_str());
+    EXPECT_EQ(ER_OK, SessionCast(id, 1, &serial));
+    EXPECT_STREQ("0", Receivers(serial).c_str());
+
+    ASSERT_EQ(ER_OK, Join(id, 0, 2));
+    ASSERT_EQ(ER_OK, Join(id, 1, 2));
+    EXPECT_EQ(ER_OK, SessionCast(id, 0, &serial));
+    EXPECT_STREQ("1 2", Receivers(serial).c_str());
+    EXPECT_EQ(ER_OK, SessionCast(id, 2, &serial));
+    EXPECT_STREQ("0 1", Receivers(serial).c_str());
+
+    /* Routes in another session do not change this session's lists */
+    ASSERT_EQ(ER_OK, Join(otherId, 0, 3));
+    EXPECT_EQ(ER_OK, SessionCast(id, 0, &serial));
+    EXPECT_STREQ("1 2", Receivers(serial).c_str());
+    EXPECT_EQ(ER_OK, SessionCast(otherId, 0, &serial));
+    EXPECT_STREQ("3", Receivers(serial).c_str());
+
+    /* A leave removes the member from the lists of the others and drops its own list */
+    Leave(id, 1);
+    EXPECT_EQ(ER_OK, SessionCast(id, 0, &serial));
+    EXPECT_STREQ("2", Receivers(serial).c_str());
+    EXPECT_EQ(ER_OK, SessionCast(id, 2, &serial));
+    EXPECT_STREQ("0", Receivers(serial).c_str());
+    EXPECT_EQ(ER_BUS_NO_ROUTE, SessionCast(id, 1));
+
+    /* Leaving every session only affects the routes of the member that left */
+    Leave(0, 0);
+    EXPECT_EQ(ER_BUS_NO_ROUTE, SessionCast(id, 0));
+    EXPECT_EQ(ER_BUS_NO_ROUTE, SessionCast(id, 2));
+    EXPECT_EQ(ER_BUS_NO_ROUTE, SessionCast(otherId, 0));
+    EXPECT_EQ(ER_BUS_NO_ROUTE, SessionCast(otherId, 3));
+
+    /* Rejoining builds a new list */
+    ASSERT_EQ(ER_OK, Join(id, 2, 1));
+    EXPECT_EQ(ER_OK, SessionCast(id, 2, &serial));
+    EXPECT_STREQ("1", Receivers(serial).c_str());
+}
+
+/*
+ * Repeatedly joins and leaves a session
+ */
+class SessionChurnThread : public qcc::Thread {
+  public:
+    SessionChurnThread(DaemonRouterTest& test, SessionId id, size_t src, size_t member) :
+        qcc::Thread("SessionChurnThread"), test(test), id(id), src(src), member(member), errors(0) { }
+
+    qcc::ThreadReturn STDCALL Run(void* arg) {
+        for (size_t n = 0; n < 500; ++n) {
+            if (test.Join(id, src, member) != ER_OK) {
+                ++errors;
+            }
+            test.Leave(id, member);
+        }
+        return 0;
+    }
+
+    DaemonRouterTest& test;
+    SessionId id;
+    size_t src;
+    size_t member;
+    size_t errors;
+};
+
+TEST_F(DaemonRouterTest, SessionCastConcurrentMembership) {
+    static const char* names[] = { ":1.1", ":1.2", ":1.3", ":1.4", ":1.5", ":1.6" };
+    static const SessionId id = 1234;
+    static const size_t NUM_MESSAGES = 2000;
+    CreateRouter("<busconfig></busconfig>");
+    CreateMembers(names, ArraySize(names));
+
+    /* Members 1 and 2 stay in the session, members 3 to 5 keep joining and leaving */
+    ASSERT_EQ(ER_OK, Join(id, 0, 1));
+    ASSERT_EQ(ER_OK, Join(id, 0, 2));
+    std::vector<SessionChurnThread*> threads;
+    for (size_t i = 3; i < ArraySize(names); ++i) {
+        threads.push_back(new SessionChurnThread(*this, id, 0, i));
+        threads.back()->Start();
+    }
+    std::vector<uint32_t> sent;
+    for (size_t n = 0; n < NUM_MESSAGES; ++n) {
+        uint32_t serial;
+        EXPECT_EQ(ER_OK, SessionCast(id, 0, &serial));
+        sent.push_back(serial);
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->Join();
+        EXPECT_EQ((size_t)0, threads[i]->errors);
+        delete threads[i];
+    }
+
+    /* The stable members get every message in order whatever else changed in the meantime */
+    for (size_t i = 1; i <= 2; ++i) {
+        std::vector<uint32_t> received = members[i]->TakeReceived();
+        EXPECT_TRUE(received == sent) << "  Member " << i << " received " << received.size() << " of " << sent.size();
+    }
+    /* The others get an in-order subset and never a message twice */
+    for (size_t i = 3; i < ArraySize(names); ++i) {
+        std::vector<uint32_t> received = members[i]->TakeReceived();
+        std::vector<uint32_t>::const_iterator pos = sent.begin();
+        for (size_t j = 0; j < received.size(); ++j) {
+            pos = std::find(pos, sent.end(), received[j]);
+            ASSERT_TRUE(pos != sent.end()) << "  Member " << i << " received a message out of order or twice";
+            ++pos;
+        }
+    }
+    EXPECT_TRUE(members[0]->TakeReceived().empty());
+
+    /* Once the churn stops only the stable members are left */
+    uint32_t serial;
+    EXPECT_EQ(ER_OK, SessionCast(id, 0, &serial));
+    EXPECT_STREQ("1 2", Receivers(serial).c_str());
+}
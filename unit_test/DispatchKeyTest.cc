@@ -0,0 +1,220 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <vector>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/InterfaceDescription.h>
+#include <alljoyn/Message.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <DispatchKey.h>
+#include <MethodTable.h>
+#include <SignalTable.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+
+static const char* IFACE_A = "org.alljoyn.test.DispatchA";
+static const char* IFACE_B = "org.alljoyn.test.DispatchB";
+
+class DispatchTestObject : public BusObject {
+  public:
+    DispatchTestObject(const char* path) : BusObject(path) { }
+
+    void Foo(const InterfaceDescription::Member* member, Message& msg) { }
+    void Bar(const InterfaceDescription::Member* member, Message& msg) { }
+    void Sig(const InterfaceDescription::Member* member, const char* srcPath, Message& msg) { }
+};
+
+class DispatchKeyTest : public testing::Test {
+  public:
+    DispatchKeyTest() : bus("DispatchKeyTest", false), a(NULL), b(NULL) { }
+
+    virtual void SetUp() {
+        InterfaceDescription* intf = NULL;
+        ASSERT_EQ(ER_OK, bus.CreateInterface(IFACE_A, intf));
+        intf->AddMethod("Foo", "", "", NULL);
+        intf->AddMethod("Bar", "", "", NULL);
+        intf->AddSignal("Sig", "", NULL);
+        intf->Activate();
+        a = intf;
+        ASSERT_EQ(ER_OK, bus.CreateInterface(IFACE_B, intf));
+        intf->AddMethod("Foo", "", "", NULL);
+        intf->AddSignal("Sig", "", NULL);
+        intf->Activate();
+        b = intf;
+    }
+
+    static MessageReceiver::MethodHandler FooHandler() {
+        return static_cast<MessageReceiver::MethodHandler>(&DispatchTestObject::Foo);
+    }
+
+    static MessageReceiver::SignalHandler SigHandler() {
+        return static_cast<MessageReceiver::SignalHandler>(&DispatchTestObject::Sig);
+    }
+
+    /*
+     * Look up a method the way the local endpoint does for a method call
+     */
+    const BusObject* FindMethod(MethodTable& table, const char* path, const char* iface, const char* name) {
+        MethodTable::SafeEntry* safeEntry = table.Find(DispatchKey::Path(path), DispatchKey::Member(iface, name), path, iface, name);
+        const BusObject* object = safeEntry ? safeEntry->entry->object : NULL;
+        delete safeEntry;
+        return object;
+    }
+
+    BusAttachment bus;
+    const InterfaceDescription* a;
+    const InterfaceDescription* b;
+};
+
+TEST(DispatchKey, Keys) {
+    /* The same names always give the same key */
+    EXPECT_EQ(DispatchKey::Member("a.b", "c"), DispatchKey::Member("a.b", "c"));
+    EXPECT_EQ(DispatchKey::Path("/a/b"), DispatchKey::Path("/a/b"));
+
+    /* The split between interface and member is part of the key */
+    EXPECT_NE(DispatchKey::Member("a.b", "c"), DispatchKey::Member("a.", "bc"));
+    EXPECT_NE(DispatchKey::Member("", "abc"), DispatchKey::Member("abc", ""));
+
+    /* A missing interface is the same as an empty interface */
+    EXPECT_EQ(DispatchKey::Member(NULL, "c"), DispatchKey::Member("", "c"));
+    EXPECT_EQ(DispatchKey::Path(NULL), DispatchKey::Path(""));
+
+    /* The path and member are not interchangeable in a method key */
+    uint64_t x = DispatchKey::Path("/x");
+    uint64_t y = DispatchKey::Path("/y");
+    EXPECT_NE(DispatchKey::Method(x, y), DispatchKey::Method(y, x));
+}
+
+TEST_F(DispatchKeyTest, MethodLookup) {
+    MethodTable table;
+    DispatchTestObject obj1("/obj1");
+    DispatchTestObject obj2("/obj2");
+
+    table.Add(&obj1, FooHandler(), a->GetMember("Foo"));
+    table.Add(&obj2, FooHandler(), b->GetMember("Foo"));
+
+    EXPECT_EQ(&obj1, FindMethod(table, "/obj1", IFACE_A, "Foo"));
+    EXPECT_EQ(&obj2, FindMethod(table, "/obj2", IFACE_B, "Foo"));
+    EXPECT_TRUE(FindMethod(table, "/obj1", IFACE_B, "Foo") == NULL);
+    EXPECT_TRUE(FindMethod(table, "/obj2", IFACE_A, "Foo") == NULL);
+    EXPECT_TRUE(FindMethod(table, "/obj1", IFACE_A, "Bar") == NULL);
+    EXPECT_TRUE(FindMethod(table, "/obj3", IFACE_A, "Foo") == NULL);
+
+    /* A method call without an interface finds the method on any interface */
+    EXPECT_EQ(&obj1, FindMethod(table, "/obj1", NULL, "Foo"));
+    EXPECT_EQ(&obj2, FindMethod(table, "/obj2", "", "Foo"));
+
+    table.RemoveAll(&obj1);
+    EXPECT_TRUE(FindMethod(table, "/obj1", IFACE_A, "Foo") == NULL);
+    EXPECT_TRUE(FindMethod(table, "/obj1", NULL, "Foo") == NULL);
+    EXPECT_EQ(&obj2, FindMethod(table, "/obj2", IFACE_B, "Foo"));
+}
+
+TEST_F(DispatchKeyTest, MethodKeyCollision) {
+    MethodTable table;
+    DispatchTestObject obj("/obj");
+
+    table.Add(&obj, FooHandler(), a->GetMember("Foo"));
+
+    /*
+     * A message whose keys collide with a registered method must not be dispatched to it, simulate
+     * the collision by looking up different names with the keys of the registered method.
+     */
+    uint64_t pathKey = DispatchKey::Path("/obj");
+    uint64_t memberKey = DispatchKey::Member(IFACE_A, "Foo");
+    MethodTable::SafeEntry* safeEntry = table.Find(pathKey, memberKey, "/obj", IFACE_A, "Bar");
+    EXPECT_TRUE(safeEntry == NULL);
+    delete safeEntry;
+    safeEntry = table.Find(pathKey, memberKey, "/other", IFACE_A, "Foo");
+    EXPECT_TRUE(safeEntry == NULL);
+    delete safeEntry;
+    safeEntry = table.Find(pathKey, memberKey, "/obj", IFACE_B, "Foo");
+    EXPECT_TRUE(safeEntry == NULL);
+    delete safeEntry;
+
+    safeEntry = table.Find(pathKey, memberKey, "/obj", IFACE_A, "Foo");
+    ASSERT_TRUE(safeEntry != NULL);
+    EXPECT_EQ(&obj, safeEntry->entry->object);
+    delete safeEntry;
+}
+
+TEST_F(DispatchKeyTest, MethodReplace) {
+    MethodTable table;
+    DispatchTestObject obj("/obj");
+
+    /* Registering a method again replaces the handler rather than adding a second entry */
+    table.Add(&obj, FooHandler(), a->GetMember("Foo"), (void*)1);
+    table.Add(&obj, FooHandler(), a->GetMember("Foo"), (void*)2);
+    MethodTable::SafeEntry* safeEntry = table.Find(DispatchKey::Path("/obj"), DispatchKey::Member(IFACE_A, "Foo"), "/obj", IFACE_A, "Foo");
+    ASSERT_TRUE(safeEntry != NULL);
+    EXPECT_EQ((void*)2, safeEntry->entry->context);
+    delete safeEntry;
+    safeEntry = table.Find(DispatchKey::Path("/obj"), DispatchKey::Member(NULL, "Foo"), "/obj", NULL, "Foo");
+    ASSERT_TRUE(safeEntry != NULL);
+    EXPECT_EQ((void*)2, safeEntry->entry->context);
+    delete safeEntry;
+}
+
+TEST_F(DispatchKeyTest, SignalLookup) {
+    SignalTable table;
+    DispatchTestObject rx1("/rx1");
+    DispatchTestObject rx2("/rx2");
+    std::vector<SignalTable::Entry> entries;
+
+    table.Add(&rx1, SigHandler(), a->GetMember("Sig"), "");
+    table.Add(&rx2, SigHandler(), a->GetMember("Sig"), "/src");
+    table.Add(&rx2, SigHandler(), b->GetMember("Sig"), "");
+
+    /* A handler without a source path matches any source */
+    uint64_t keyA = DispatchKey::Member(IFACE_A, "Sig");
+    EXPECT_TRUE(table.Find(keyA, "/other", IFACE_A, "Sig", entries));
+    ASSERT_EQ((size_t)1, entries.size());
+    EXPECT_EQ(&rx1, entries[0].object);
+
+    entries.clear();
+    EXPECT_TRUE(table.Find(keyA, "/src", IFACE_A, "Sig", entries));
+    EXPECT_EQ((size_t)2, entries.size());
+
+    /* A collision on the key is rejected by comparing the names */
+    entries.clear();
+    EXPECT_FALSE(table.Find(keyA, "/src", IFACE_B, "Other", entries));
+    EXPECT_FALSE(table.Find(keyA, "/src", IFACE_A, "Other", entries));
+    EXPECT_TRUE(entries.empty());
+
+    entries.clear();
+    EXPECT_TRUE(table.Find(DispatchKey::Member(IFACE_B, "Sig"), "/src", IFACE_B, "Sig", entries));
+    ASSERT_EQ((size_t)1, entries.size());
+    EXPECT_EQ(&rx2, entries[0].object);
+
+    table.Remove(&rx2, SigHandler(), a->GetMember("Sig"), "/src");
+    entries.clear();
+    EXPECT_TRUE(table.Find(keyA, "/src", IFACE_A, "Sig", entries));
+    ASSERT_EQ((size_t)1, entries.size());
+    EXPECT_EQ(&rx1, entries[0].object);
+
+    table.RemoveAll(&rx1);
+    entries.clear();
+    EXPECT_FALSE(table.Find(keyA, "/src", IFACE_A, "Sig", entries));
+}
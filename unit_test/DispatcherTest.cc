@@ -0,0 +1,257 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <map>
+
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+#include <qcc/Thread.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/MsgArg.h>
+
+#include <alljoyn/Status.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+#include "ajTestCommon.h"
+
+using namespace ajn;
+
+static const char* INTERFACE_NAME = "org.alljoyn.test.Dispatcher";
+static const char* OBJECT_PATH = "/org/alljoyn/test/Dispatcher";
+static const uint32_t NUM_SIGNALS = 200;
+
+class DispatcherTestSender : public BusObject {
+  public:
+    DispatcherTestSender(const InterfaceDescription* intf) : BusObject(OBJECT_PATH), seq(intf->GetMember("Seq")) {
+        AddInterface(*intf);
+    }
+
+    QStatus Send(const char* destination, uint32_t n) {
+        MsgArg arg("u", n);
+        return Signal(destination, 0, *seq, &arg, 1);
+    }
+
+    const InterfaceDescription::Member* seq;
+};
+
+class DispatcherTestReceiver : public MessageReceiver {
+  public:
+    DispatcherTestReceiver(BusAttachment& bus) :
+        bus(bus), handOff(false), handedOff(false), outOfOrder(0), maxConcurrent(0), active(0), maxActive(0), total(0) { }
+
+    void SeqHandler(const InterfaceDescription::Member* member, const char* srcPath, Message& msg) {
+        uint32_t n = msg->GetArg(0)->v_uint32;
+        lock.Lock();
+        Sender& sender = senders[msg->GetSender()];
+        if (n != sender.next) {
+            ++outOfOrder;
+        }
+        sender.next = n + 1;
+        if (++sender.active > maxConcurrent) {
+            maxConcurrent = sender.active;
+        }
+        if (++active > maxActive) {
+            maxActive = active;
+        }
+        lock.Unlock();
+
+        if (handOff && (n == 0)) {
+            /*
+             * Give up the sender's lane and wait for the sender's next signal to be handled while
+             * this handler is still running.
+             */
+            bus.EnableConcurrentCallbacks();
+            for (size_t i = 0; (i < 500) && !handedOff; ++i) {
+                qcc::Sleep(10);
+            }
+        } else if ((n % 10) == 0) {
+            /* Give the other workers a chance to get ahead */
+            qcc::Sleep(5);
+        }
+        if (handOff && (n == 1)) {
+            handedOff = true;
+        }
+
+        lock.Lock();
+        --sender.active;
+        --active;
+        ++total;
+        lock.Unlock();
+    }
+
+    uint32_t GetTotal() {
+        lock.Lock();
+        uint32_t n = total;
+        lock.Unlock();
+        return n;
+    }
+
+    struct Sender {
+        Sender() : next(0), active(0) { }
+        uint32_t next;
+        uint32_t active;
+    };
+
+    BusAttachment& bus;
+    bool handOff;
+    volatile bool handedOff;
+    qcc::Mutex lock;
+    std::map<qcc::String, Sender> senders;
+    uint32_t outOfOrder;
+    uint32_t maxConcurrent;   /* Most handlers running at once for one sender */
+    uint32_t active;
+    uint32_t maxActive;       /* Most handlers running at once for all senders */
+    uint32_t total;
+};
+
+class DispatcherTest : public testing::Test {
+  public:
+    DispatcherTest() :
+        rxBus("DispatcherTestRx", false),
+        txBus1("DispatcherTestTx1", false),
+        txBus2("DispatcherTestTx2", false),
+        receiver(rxBus),
+        sender1(NULL),
+        sender2(NULL),
+        concurrentSenders(false)
+    { }
+
+    virtual void SetUp() {
+        const InterfaceDescription* intf = NULL;
+        if (concurrentSenders) {
+            ASSERT_EQ(ER_OK, rxBus.EnableConcurrentSenders());
+        }
+        StartBus(rxBus, intf);
+        QStatus status = rxBus.RegisterSignalHandler(&receiver,
+                                                     static_cast<MessageReceiver::SignalHandler>(&DispatcherTestReceiver::SeqHandler),
+                                                     intf->GetMember("Seq"),
+                                                     NULL);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        StartBus(txBus1, intf);
+        sender1 = new DispatcherTestSender(intf);
+        status = txBus1.RegisterBusObject(*sender1);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        StartBus(txBus2, intf);
+        sender2 = new DispatcherTestSender(intf);
+        status = txBus2.RegisterBusObject(*sender2);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    virtual void TearDown() {
+        txBus1.Stop();
+        txBus2.Stop();
+        rxBus.Stop();
+        txBus1.Join();
+        txBus2.Join();
+        rxBus.Join();
+        delete sender1;
+        delete sender2;
+    }
+
+    void StartBus(BusAttachment& bus, const InterfaceDescription*& intf) {
+        QStatus status = bus.Start();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = bus.Connect(getConnectArg().c_str());
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        InterfaceDescription* newIntf = NULL;
+        status = bus.CreateInterface(INTERFACE_NAME, newIntf);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        newIntf->AddSignal("Seq", "u", NULL);
+        newIntf->Activate();
+        intf = newIntf;
+    }
+
+    bool WaitForTotal(uint32_t total) {
+        for (size_t i = 0; i < 1000; ++i) {
+            if (receiver.GetTotal() >= total) {
+                return true;
+            }
+            qcc::Sleep(10);
+        }
+        return false;
+    }
+
+    BusAttachment rxBus;
+    BusAttachment txBus1;
+    BusAttachment txBus2;
+    DispatcherTestReceiver receiver;
+    DispatcherTestSender* sender1;
+    DispatcherTestSender* sender2;
+    bool concurrentSenders;
+};
+
+class DispatcherConcurrentSendersTest : public DispatcherTest {
+  public:
+    DispatcherConcurrentSendersTest() { concurrentSenders = true; }
+};
+
+TEST_F(DispatcherTest, PerSenderOrdering) {
+    const char* dest = rxBus.GetUniqueName().c_str();
+    for (uint32_t n = 0; n < NUM_SIGNALS; ++n) {
+        ASSERT_EQ(ER_OK, sender1->Send(dest, n));
+        ASSERT_EQ(ER_OK, sender2->Send(dest, n));
+    }
+    EXPECT_TRUE(WaitForTotal(2 * NUM_SIGNALS));
+
+    /* Signals from each sender are handled one at a time in the order they were sent */
+    EXPECT_EQ((size_t)2, receiver.senders.size());
+    EXPECT_EQ((uint32_t)0, receiver.outOfOrder);
+    EXPECT_EQ((uint32_t)1, receiver.maxConcurrent);
+    EXPECT_EQ(2 * NUM_SIGNALS, receiver.GetTotal());
+
+    /* By default handlers for different senders are not called concurrently either */
+    EXPECT_EQ((uint32_t)1, receiver.maxActive);
+}
+
+TEST_F(DispatcherTest, EnableConcurrentSendersAfterStart) {
+    EXPECT_EQ(ER_BUS_BUS_ALREADY_STARTED, rxBus.EnableConcurrentSenders());
+}
+
+TEST_F(DispatcherConcurrentSendersTest, PerSenderOrdering) {
+    const char* dest = rxBus.GetUniqueName().c_str();
+    for (uint32_t n = 0; n < NUM_SIGNALS; ++n) {
+        ASSERT_EQ(ER_OK, sender1->Send(dest, n));
+        ASSERT_EQ(ER_OK, sender2->Send(dest, n));
+    }
+    EXPECT_TRUE(WaitForTotal(2 * NUM_SIGNALS));
+
+    /* Each sender's signals are still handled in order but the two senders run in parallel */
+    EXPECT_EQ((size_t)2, receiver.senders.size());
+    EXPECT_EQ((uint32_t)0, receiver.outOfOrder);
+    EXPECT_EQ((uint32_t)1, receiver.maxConcurrent);
+    EXPECT_EQ((uint32_t)2, receiver.maxActive);
+    EXPECT_EQ(2 * NUM_SIGNALS, receiver.GetTotal());
+}
+
+TEST_F(DispatcherTest, ConcurrentCallbacksHandOff) {
+    receiver.handOff = true;
+    const char* dest = rxBus.GetUniqueName().c_str();
+    ASSERT_EQ(ER_OK, sender1->Send(dest, 0));
+    ASSERT_EQ(ER_OK, sender1->Send(dest, 1));
+    ASSERT_EQ(ER_OK, sender1->Send(dest, 2));
+    EXPECT_TRUE(WaitForTotal(3));
+
+    /* The second signal was handled while the handler for the first was still running */
+    EXPECT_TRUE(receiver.handedOff);
+    EXPECT_EQ((uint32_t)2, receiver.maxConcurrent);
+    EXPECT_EQ((uint32_t)0, receiver.outOfOrder);
+}
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <string.h>
+#include <vector>
+
+/* Private files included for unit testing */
+#include <InterestSummary.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+
+static bool IsEmpty(const InterestSummary& summary)
+{
+    static const uint8_t zeros[InterestSummary::NUM_BITS / 8] = { 0 };
+    return memcmp(zeros, summary.GetBitmap(), sizeof(zeros)) == 0;
+}
+
+TEST(InterestSummaryTest, StableHash) {
+    /*
+     * The bit positions are part of the daemon to daemon protocol
+     */
+    uint16_t bits[InterestKeys::NUM_HASHES];
+    InterestKeys::GetBits("org.alljoyn.Test", "Sig", bits);
+    EXPECT_EQ(1803, bits[0]);
+    EXPECT_EQ(572, bits[1]);
+    EXPECT_EQ(1389, bits[2]);
+    InterestKeys::GetBits("", "", bits);
+    EXPECT_EQ(1311, bits[0]);
+    EXPECT_EQ(58, bits[1]);
+    EXPECT_EQ(853, bits[2]);
+}
+
+TEST(InterestSummaryTest, EmptyMatchesNothing) {
+    InterestSummary summary;
+    EXPECT_TRUE(IsEmpty(summary));
+    EXPECT_FALSE(summary.MayMatch(InterestKeys("org.alljoyn.Test", "Sig")));
+    EXPECT_FALSE(summary.MayMatch(InterestKeys("", "")));
+}
+
+TEST(InterestSummaryTest, Wildcards) {
+    InterestCounter exact;
+    exact.Add("org.alljoyn.Test", "Sig");
+    EXPECT_TRUE(exact.GetSummary().MayMatch(InterestKeys("org.alljoyn.Test", "Sig")));
+
+    /* A rule that only names the interface matches any member of the interface */
+    InterestCounter ifaceOnly;
+    ifaceOnly.Add("org.alljoyn.Test", "");
+    EXPECT_TRUE(ifaceOnly.GetSummary().MayMatch(InterestKeys("org.alljoyn.Test", "Sig")));
+    EXPECT_TRUE(ifaceOnly.GetSummary().MayMatch(InterestKeys("org.alljoyn.Test", "Other")));
+
+    /* A rule that only names the member matches the member of any interface */
+    InterestCounter memberOnly;
+    memberOnly.Add("", "Sig");
+    EXPECT_TRUE(memberOnly.GetSummary().MayMatch(InterestKeys("org.alljoyn.Test", "Sig")));
+    EXPECT_TRUE(memberOnly.GetSummary().MayMatch(InterestKeys("org.alljoyn.Other", "Sig")));
+
+    /* A rule that names neither matches everything */
+    InterestCounter all;
+    all.Add("", "");
+    EXPECT_TRUE(all.GetSummary().MayMatch(InterestKeys("org.alljoyn.Test", "Sig")));
+    EXPECT_TRUE(all.GetSummary().MayMatch(InterestKeys("a.b", "c")));
+}
+
+TEST(InterestSummaryTest, CountedRemove) {
+    InterestCounter counter;
+    InterestKeys keys("org.alljoyn.Test", "Sig");
+
+    counter.Add("org.alljoyn.Test", "Sig");
+    counter.Add("org.alljoyn.Test", "Sig");
+    counter.Remove("org.alljoyn.Test", "Sig");
+    EXPECT_TRUE(counter.GetSummary().MayMatch(keys));
+    counter.Remove("org.alljoyn.Test", "Sig");
+    EXPECT_FALSE(counter.GetSummary().MayMatch(keys));
+    EXPECT_TRUE(IsEmpty(counter.GetSummary()));
+
+    /* Removing an interest that was never added has no effect */
+    counter.Remove("org.alljoyn.Test", "Sig");
+    EXPECT_TRUE(IsEmpty(counter.GetSummary()));
+}
+
+TEST(InterestSummaryTest, TakeChanges) {
+    InterestCounter counter;
+    InterestSummary remote;
+    std::vector<uint16_t> toggled;
+
+    EXPECT_FALSE(counter.TakeChanges(toggled));
+    EXPECT_TRUE(toggled.empty());
+
+    counter.Add("org.alljoyn.Test", "Sig");
+    counter.Add("org.alljoyn.Test", "");
+    EXPECT_TRUE(counter.TakeChanges(toggled));
+    for (size_t i = 0; i < toggled.size(); ++i) {
+        remote.Toggle(toggled[i]);
+    }
+    EXPECT_EQ(0, memcmp(remote.GetBitmap(), counter.GetSummary().GetBitmap(), InterestSummary::NUM_BITS / 8));
+
+    /* Changes are only reported once */
+    EXPECT_FALSE(counter.TakeChanges(toggled));
+
+    /* Applying the delta for a removal brings the remote copy up to date */
+    counter.Remove("org.alljoyn.Test", "Sig");
+    EXPECT_TRUE(counter.TakeChanges(toggled));
+    for (size_t i = 0; i < toggled.size(); ++i) {
+        remote.Toggle(toggled[i]);
+    }
+    EXPECT_EQ(0, memcmp(remote.GetBitmap(), counter.GetSummary().GetBitmap(), InterestSummary::NUM_BITS / 8));
+    EXPECT_TRUE(remote.MayMatch(InterestKeys("org.alljoyn.Test", "Other")));
+}
+
+TEST(InterestSummaryTest, SetAndMerge) {
+    InterestCounter a;
+    a.Add("org.alljoyn.A", "Sig");
+    InterestCounter b;
+    b.Add("org.alljoyn.B", "Sig");
+
+    InterestSummary copy;
+    EXPECT_FALSE(copy.Set(a.GetSummary().GetBitmap(), InterestSummary::NUM_BITS / 8 - 1));
+    EXPECT_TRUE(IsEmpty(copy));
+    EXPECT_TRUE(copy.Set(a.GetSummary().GetBitmap(), InterestSummary::NUM_BITS / 8));
+    EXPECT_TRUE(copy.MayMatch(InterestKeys("org.alljoyn.A", "Sig")));
+
+    copy.Merge(b.GetSummary());
+    EXPECT_TRUE(copy.MayMatch(InterestKeys("org.alljoyn.A", "Sig")));
+    EXPECT_TRUE(copy.MayMatch(InterestKeys("org.alljoyn.B", "Sig")));
+
+    copy.Clear();
+    EXPECT_TRUE(IsEmpty(copy));
+}
@@ -22,15 +22,19 @@
 #include <qcc/Pipe.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/Message.h>
+#include <alljoyn/MsgTraits.h>
 #include <alljoyn/version.h>
 
 #include <alljoyn/Status.h>
 
 /* Private files included for unit testing */
+#include <ArrayKernels.h>
 #include <PeerState.h>
+#include <SignaturePlan.h>
 #include <SignatureUtils.h>
 #include <RemoteEndpoint.h>
 
@@ -116,8 +120,25 @@ class MyMessage : public _Message {
         return SignalMsg(sig, destination, 0, objPath, iface, signalName, argList, numArgs, 0, 0);
     }
 
+    QStatus Signal(const char* destination,
+                   const char* objPath,
+                   const char* iface,
+                   const char* signalName,
+                   const TypedArgsWriter& typedArgs)
+    {
+        return SignalMsg(typedArgs.GetSignature(), destination, 0, objPath, iface, signalName, NULL, 0, 0, 0, &typedArgs);
+    }
+
     QStatus UnmarshalBody() { return UnmarshalArgs("*"); }
 
+    QStatus UnmarshalBody(const char* expectedSignature) { return UnmarshalArgs(expectedSignature); }
+
+    QStatus ShareArgs() { return _Message::ShareArgs(); }
+
+    void SetSerialNumber() { _Message::SetSerialNumber(); }
+
+    bool SharesBufferWith(const MyMessage& other) const { return _msgBuf == other._msgBuf; }
+
     QStatus Read(RemoteEndpoint& ep, const qcc::String& endpointName, bool pedantic = true)
     {
         QStatus test = _Message::Read(ep, pedantic);
@@ -133,6 +154,11 @@ class MyMessage : public _Message {
     {
         return _Message::Deliver(ep);
     }
+
+    bool HasDeferredHeaderFields() const { return _Message::HasDeferredHeaderFields(); }
+
+    QStatus ParseDeferredHeaderFields() { return _Message::ParseDeferredHeaderFields(); }
+    QStatus CheckDeferredHeaderFields() { return _Message::CheckDeferredHeaderFields(); }
 };
 
 
@@ -297,6 +323,509 @@ TEST(MarshalTest, TestMsgUnpack) {
     delete bus;
 }
 
+TEST(MarshalTest, ArrayKernels) {
+    const size_t maxElements = 100;
+    uint64_t src[maxElements];
+    uint64_t dst[maxElements + 1];
+    for (size_t i = 0; i < maxElements; ++i) {
+        src[i] = 0x0102030405060708ULL * (i + 1);
+    }
+    /* Check every length so that all of the vector and scalar tails are exercised */
+    for (size_t num = 0; num <= maxElements; ++num) {
+        dst[num] = 0xDEADBEEF;
+        EndianSwapArray64(dst, src, num);
+        for (size_t i = 0; i < num; ++i) {
+            ASSERT_EQ(EndianSwap64(src[i]), dst[i]);
+        }
+        ASSERT_EQ((uint64_t)0xDEADBEEF, dst[num]);
+
+        EndianSwapArray32(dst, src, num);
+        for (size_t i = 0; i < num; ++i) {
+            ASSERT_EQ(EndianSwap32(((uint32_t*)src)[i]), ((uint32_t*)dst)[i]);
+        }
+        EndianSwapArray16(dst, src, num);
+        for (size_t i = 0; i < num; ++i) {
+            ASSERT_EQ(EndianSwap16(((uint16_t*)src)[i]), ((uint16_t*)dst)[i]);
+        }
+    }
+
+    uint32_t bools[maxElements];
+    uint32_t swappedBools[maxElements];
+    bool out[maxElements];
+    for (size_t i = 0; i < maxElements; ++i) {
+        bools[i] = (i % 3) == 0;
+        swappedBools[i] = EndianSwap32(bools[i]);
+    }
+    for (size_t num = 0; num <= maxElements; ++num) {
+        ASSERT_TRUE(NarrowBoolArray(out, bools, num, false));
+        for (size_t i = 0; i < num; ++i) {
+            ASSERT_EQ(bools[i] == 1, out[i]);
+        }
+        ASSERT_TRUE(NarrowBoolArray(out, swappedBools, num, true));
+        for (size_t i = 0; i < num; ++i) {
+            ASSERT_EQ(bools[i] == 1, out[i]);
+        }
+    }
+    /* An invalid value anywhere in the array must be detected */
+    for (size_t i = 0; i < maxElements; ++i) {
+        uint32_t save = bools[i];
+        bools[i] = 2;
+        ASSERT_FALSE(NarrowBoolArray(out, bools, maxElements, false));
+        bools[i] = save;
+        save = swappedBools[i];
+        swappedBools[i] = EndianSwap32(2);
+        ASSERT_FALSE(NarrowBoolArray(out, swappedBools, maxElements, true));
+        swappedBools[i] = save;
+    }
+}
+
+TEST(MarshalTest, SignaturePlan) {
+    SignaturePlan plan;
+
+    ASSERT_EQ(ER_OK, plan.Compile("a(yq)a{sv}"));
+    ASSERT_EQ((uint8_t)2, plan.numArgs);
+    /* a (yq) y q a {sv} s v */
+    ASSERT_EQ((size_t)9, plan.ops.size());
+    ASSERT_EQ((uint16_t)4, plan.ops[0].next);
+    ASSERT_EQ((uint8_t)2, plan.ops[1].numMembers);
+    ASSERT_EQ((uint16_t)4, plan.ops[1].fixedSize);
+    ASSERT_EQ((uint16_t)0, plan.ops[5].fixedSize);
+    ASSERT_TRUE(plan.MatchSignature(plan.ops[5], "{sv}"));
+    ASSERT_FALSE(plan.MatchSignature(plan.ops[5], "{sv}s"));
+
+    ASSERT_EQ(ER_OK, plan.Compile("(ybx)"));
+    ASSERT_EQ((uint16_t)16, plan.ops[0].fixedSize);
+
+    /* Dictionary entries are only allowed as array elements */
+    ASSERT_EQ(ER_BUS_BAD_SIGNATURE, plan.Compile("{sv}"));
+    ASSERT_EQ(ER_BUS_BAD_SIGNATURE, plan.Compile("({sv})"));
+    ASSERT_EQ(ER_BUS_BAD_SIGNATURE, plan.Compile("a(s"));
+
+    SignaturePlanCache cache;
+    SignaturePlan scratch;
+    const SignaturePlan* p1 = NULL;
+    const SignaturePlan* p2 = NULL;
+    ASSERT_EQ(ER_OK, cache.GetPlan("a{sv}", scratch, p1));
+    qcc::String sig("a{sv}");
+    ASSERT_EQ(ER_OK, cache.GetPlan(sig.c_str(), scratch, p2));
+    ASSERT_EQ(p1, p2);
+    ASSERT_EQ(ER_OK, cache.GetPlan("s", scratch, p1));
+    ASSERT_EQ(cache.GetBasicPlan('s'), p1);
+}
+
+TEST(MarshalTest, SignaturePlanCachePeerBudget) {
+    SignaturePlanCache cache;
+    SignaturePlan scratch;
+    const SignaturePlan* p1 = NULL;
+    const SignaturePlan* p2 = NULL;
+
+    /* Signatures from peers are cached */
+    ASSERT_EQ(ER_OK, cache.FindPlan("a{sv}", scratch, p1));
+    ASSERT_TRUE(p1 != &scratch);
+    ASSERT_EQ(ER_OK, cache.FindPlan("a{sv}", scratch, p2));
+    ASSERT_EQ(p1, p2);
+    ASSERT_EQ(ER_OK, cache.GetPlan("a{sv}", scratch, p2));
+    ASSERT_EQ(p1, p2);
+
+    /* Bad signatures are not */
+    ASSERT_EQ(ER_BUS_BAD_SIGNATURE, cache.FindPlan("a{sv", scratch, p1));
+
+    /* Until the peer budget is used up, after that they are compiled into scratch */
+    qcc::String sig = "(";
+    size_t numCached = 1;
+    for (size_t i = 0; i < 200; ++i) {
+        sig += 'y';
+        qcc::String s = sig + ")";
+        ASSERT_EQ(ER_OK, cache.FindPlan(s.c_str(), scratch, p1));
+        ASSERT_STREQ(s.c_str(), p1->GetSignature());
+        if (p1 != &scratch) {
+            ++numCached;
+        }
+    }
+    ASSERT_EQ((size_t)128, numCached);
+
+    /* Local signatures have their own budget */
+    ASSERT_EQ(ER_OK, cache.GetPlan(sig.c_str() + 1, scratch, p1));
+    ASSERT_TRUE(p1 != &scratch);
+    ASSERT_EQ(ER_OK, cache.FindPlan(sig.c_str() + 1, scratch, p2));
+    ASSERT_EQ(p1, p2);
+}
+
+class SignaturePlanCacheThread : public qcc::Thread {
+  public:
+    SignaturePlanCacheThread(SignaturePlanCache& cache) : qcc::Thread("SignaturePlanCacheThread"), cache(cache), errors(0) { }
+
+    qcc::ThreadReturn STDCALL Run(void* arg) {
+        for (size_t n = 0; n < 1000; ++n) {
+            qcc::String sig = "a(";
+            sig += qcc::String(1 + (n % 50), 'u');
+            sig += ")";
+            SignaturePlan scratch;
+            const SignaturePlan* plan = NULL;
+            QStatus status = (n & 1) ? cache.FindPlan(sig.c_str(), scratch, plan) : cache.GetPlan(sig.c_str(), scratch, plan);
+            if ((status != ER_OK) || (plan == &scratch) || (strcmp(plan->GetSignature(), sig.c_str()) != 0)) {
+                ++errors;
+            }
+        }
+        return 0;
+    }
+
+    SignaturePlanCache& cache;
+    size_t errors;
+};
+
+TEST(MarshalTest, SignaturePlanCacheConcurrent) {
+    SignaturePlanCache cache;
+    SignaturePlanCacheThread* threads[4];
+    for (size_t i = 0; i < ArraySize(threads); ++i) {
+        threads[i] = new SignaturePlanCacheThread(cache);
+        threads[i]->Start();
+    }
+    for (size_t i = 0; i < ArraySize(threads); ++i) {
+        threads[i]->Join();
+        EXPECT_EQ((size_t)0, threads[i]->errors);
+        delete threads[i];
+    }
+}
+
+class TypedSignatureThread : public qcc::Thread {
+  public:
+    TypedSignatureThread() : qcc::Thread("TypedSignatureThread"), sig(NULL), errors(0) { }
+
+    qcc::ThreadReturn STDCALL Run(void* arg) {
+        for (size_t n = 0; n < 1000; ++n) {
+            const char* s = TypedSignature<uint16_t, qcc::String, std::vector<int64_t>, MsgNone>::Get();
+            if ((n > 0) && (s != sig)) {
+                ++errors;
+            }
+            sig = s;
+        }
+        return 0;
+    }
+
+    const char* sig;
+    size_t errors;
+};
+
+TEST(MarshalTest, TypedSignatureConcurrent) {
+    TypedSignatureThread* threads[4];
+    for (size_t i = 0; i < ArraySize(threads); ++i) {
+        threads[i] = new TypedSignatureThread();
+        threads[i]->Start();
+    }
+    /* Every thread sees the same signature, built once */
+    const char* sig = TypedSignature<uint16_t, qcc::String, std::vector<int64_t>, MsgNone>::Get();
+    EXPECT_STREQ("qsax", sig);
+    for (size_t i = 0; i < ArraySize(threads); ++i) {
+        threads[i]->Join();
+        EXPECT_EQ((size_t)0, threads[i]->errors);
+        EXPECT_EQ(sig, threads[i]->sig);
+        delete threads[i];
+    }
+}
+
+struct TypedPoint {
+    int32_t x;
+    double y;
+    qcc::String label;
+    std::vector<bool> flags;
+};
+
+namespace ajn {
+template <> struct MsgTraits<TypedPoint> : public MsgStructTraits<TypedPoint> {
+    template <typename F> static void Members(F& f, TypedPoint& p) { f(p.x); f(p.y); f(p.label); f(p.flags); }
+};
+}
+
+TEST(MarshalTest, TypedArgs) {
+    QStatus status;
+    BusAttachment* bus = new BusAttachment("TypedArgs", false);
+    bus->Start();
+
+    TestPipe stream;
+    TestPipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(*bus, falsiness, String::Empty, pStream);
+    MyMessage msg(*bus);
+
+    TypedPoint point;
+    point.x = -7;
+    point.y = 2.5;
+    point.label = "origin";
+    point.flags.push_back(true);
+    point.flags.push_back(false);
+    std::vector<int16_t> samples;
+    for (int16_t n = 0; n < 100; ++n) {
+        samples.push_back(n * 3);
+    }
+    std::map<qcc::String, uint32_t> counts;
+    counts["one"] = 1;
+    counts["two"] = 2;
+    std::vector<TypedPoint> points(3, point);
+
+    TypedArgs<TypedPoint, std::vector<int16_t>, std::map<qcc::String, uint32_t>, std::vector<TypedPoint> > out(point, samples, counts, points);
+    ASSERT_STREQ("(idsab)ana{su}a(idsab)", out.GetSignature());
+
+    status = msg.Signal(NULL, "/foo/bar", "foo.bar", "typed", out);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Deliver(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Read(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Unmarshal(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    /*
+     * The typed marshaling must produce the same wire format as MsgArg marshaling
+     */
+    status = msg.UnmarshalBody();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    int16_t* an;
+    size_t numAn;
+    EXPECT_EQ(ER_OK, msg.GetArg(1)->Get("an", &numAn, &an));
+    ASSERT_EQ(samples.size(), numAn);
+    EXPECT_EQ(0, memcmp(&samples[0], an, numAn * sizeof(int16_t)));
+
+    TypedPoint inPoint;
+    std::vector<int16_t> inSamples;
+    std::map<qcc::String, uint32_t> inCounts;
+    std::vector<TypedPoint> inPoints;
+    status = msg.GetArgs(TieTypedArgs(inPoint, inSamples, inCounts, inPoints));
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ(point.x, inPoint.x);
+    EXPECT_EQ(point.y, inPoint.y);
+    EXPECT_EQ(point.label, inPoint.label);
+    EXPECT_TRUE(point.flags == inPoint.flags);
+    EXPECT_TRUE(samples == inSamples);
+    EXPECT_TRUE(counts == inCounts);
+    ASSERT_EQ(points.size(), inPoints.size());
+    EXPECT_EQ(point.label, inPoints[2].label);
+
+    /*
+     * Variables that do not match the signature are rejected
+     */
+    std::vector<int32_t> wrong;
+    EXPECT_EQ(ER_BUS_SIGNATURE_MISMATCH, msg.GetArgs(TieTypedArgs(inPoint, wrong, inCounts, inPoints)));
+
+    delete bus;
+}
+
+TEST(MarshalTest, CutThrough) {
+    QStatus status;
+    BusAttachment* bus = new BusAttachment("CutThrough", false);
+    bus->Start();
+
+    TestPipe stream;
+    TestPipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(*bus, falsiness, String::Empty, pStream);
+    MyMessage msg(*bus);
+    MsgArg arg("s", "hello");
+
+    /*
+     * A message with a destination only has the routing fields parsed
+     */
+    ep->GetFeatures().cutThrough = true;
+    status = msg.MethodCall(":1.99", "/foo/bar", "foo.bar", "test", &arg, 1);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Deliver(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Read(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Unmarshal(ep, ":88.88", false);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_TRUE(msg.HasDeferredHeaderFields());
+    EXPECT_STREQ(":1.99", msg.GetDestination());
+    EXPECT_STREQ("", msg.GetInterface());
+
+    /*
+     * Checking the deferred fields validates them without parsing them into the message
+     */
+    status = msg.CheckDeferredHeaderFields();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_TRUE(msg.HasDeferredHeaderFields());
+    EXPECT_STREQ("", msg.GetInterface());
+
+    status = msg.ParseDeferredHeaderFields();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_FALSE(msg.HasDeferredHeaderFields());
+    EXPECT_STREQ("foo.bar", msg.GetInterface());
+    EXPECT_STREQ("test", msg.GetMemberName());
+    EXPECT_STREQ("/foo/bar", msg.GetObjectPath());
+    EXPECT_STREQ("s", msg.GetSignature());
+    status = msg.UnmarshalBody();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_STREQ("hello", msg.GetArg(0)->v_string.str);
+
+    /*
+     * A message without a destination is always fully parsed
+     */
+    status = msg.Signal(NULL, "/foo/bar", "foo.bar", "sig", &arg, 1);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Deliver(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Read(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Unmarshal(ep, ":88.88", false);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_FALSE(msg.HasDeferredHeaderFields());
+    EXPECT_STREQ("sig", msg.GetMemberName());
+
+    delete bus;
+}
+
+TEST(MarshalTest, SharedArgs) {
+    QStatus status;
+    BusAttachment* bus = new BusAttachment("SharedArgs", false);
+    bus->Start();
+
+    uint32_t vals[] = { 1, 2, 3 };
+    MsgArg args[2];
+    args[0].Set("s", "hello");
+    args[1].Set("au", ArraySize(vals), vals);
+    MyMessage* msg = new MyMessage(*bus);
+    status = msg->Signal(NULL, "/foo/bar", "foo.bar", "sig", args, ArraySize(args));
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg->ShareArgs();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /*
+     * A copy shares the buffer and the arguments with the original
+     */
+    MyMessage* copy = new MyMessage(*msg);
+    EXPECT_TRUE(copy->SharesBufferWith(*msg));
+    EXPECT_EQ(msg->GetArg(0), copy->GetArg(0));
+
+    /*
+     * The receiver of the copy still has its expected signature checked
+     */
+    status = copy->UnmarshalBody("su");
+    EXPECT_EQ(ER_BUS_SIGNATURE_MISMATCH, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = copy->UnmarshalBody("sau");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /*
+     * The copy's arguments and buffer outlive the original
+     */
+    delete msg;
+    EXPECT_TRUE(copy->GetArg(2) == NULL);
+    EXPECT_STREQ("hello", copy->GetArg(0)->v_string.str);
+    ASSERT_EQ(ArraySize(vals), copy->GetArg(1)->v_scalarArray.numElements);
+    for (size_t i = 0; i < ArraySize(vals); ++i) {
+        EXPECT_EQ(vals[i], copy->GetArg(1)->v_scalarArray.v_uint32[i]);
+    }
+
+    /*
+     * Changing the serial number of a copy gives it a private buffer
+     */
+    MyMessage* other = new MyMessage(*copy);
+    EXPECT_TRUE(other->SharesBufferWith(*copy));
+    uint32_t serial = copy->GetCallSerial();
+    other->SetSerialNumber();
+    EXPECT_FALSE(other->SharesBufferWith(*copy));
+    EXPECT_NE(serial, other->GetCallSerial());
+    EXPECT_EQ(serial, copy->GetCallSerial());
+    status = other->UnmarshalBody("sau");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_STREQ("hello", other->GetArg(0)->v_string.str);
+    EXPECT_STREQ("hello", copy->GetArg(0)->v_string.str);
+
+    delete other;
+    delete copy;
+    delete bus;
+}
+
+TEST(MarshalTest, LargeDictionary) {
+    QStatus status = ER_OK;
+
+    BusAttachment*bus = new BusAttachment("LargeDictionary", false);
+    bus->Start();
+
+    TestPipe stream;
+    MyMessage msg(*bus);
+
+    TestPipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(*bus, falsiness, String::Empty, pStream);
+    ep->GetFeatures().handlePassing = true;
+
+    const size_t numEntries = 500;
+    qcc::String* keys = new qcc::String[numEntries];
+    int32_t* ints = new int32_t[numEntries];
+    MsgArg* vals = new MsgArg[numEntries];
+    MsgArg* entries = new MsgArg[numEntries];
+    for (size_t i = 0; i < numEntries; ++i) {
+        keys[i] = "key" + U32ToString((uint32_t)i);
+        ints[i] = (int32_t)i;
+        if (i & 1) {
+            status = vals[i].Set("u", (uint32_t)i);
+        } else {
+            status = vals[i].Set("(sai)", keys[i].c_str(), 1, &ints[i]);
+        }
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = entries[i].Set("{sv}", keys[i].c_str(), &vals[i]);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+    MsgArg dict("a{sv}", numEntries, entries);
+
+    status = msg.MethodCall("a.b.c", "/foo/bar", "foo.bar", "test", &dict, 1);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = msg.Deliver(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = msg.Read(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = msg.Unmarshal(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    status = msg.UnmarshalBody();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /* The copy must have its own copy of the unmarshaled args */
+    MyMessage* copy = new MyMessage(msg);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        const MsgArg* arg = (pass == 0) ? copy->GetArg(0) : msg.GetArg(0);
+        ASSERT_TRUE(arg != NULL);
+        size_t num;
+        MsgArg* rxEntries;
+        status = arg->Get("a{sv}", &num, &rxEntries);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_EQ(numEntries, num);
+        for (size_t i = 0; i < num; ++i) {
+            const char* key;
+            MsgArg* val;
+            status = rxEntries[i].Get("{sv}", &key, &val);
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+            ASSERT_STREQ(keys[i].c_str(), key);
+            if (i & 1) {
+                uint32_t u;
+                status = val->Get("u", &u);
+                ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+                ASSERT_EQ((uint32_t)i, u);
+            } else {
+                const char* str;
+                size_t n;
+                int32_t* ai;
+                status = val->Get("(sai)", &str, &n, &ai);
+                ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+                ASSERT_STREQ(keys[i].c_str(), str);
+                ASSERT_EQ((size_t)1, n);
+                ASSERT_EQ((int32_t)i, ai[0]);
+            }
+        }
+        if (pass == 0) {
+            delete copy;
+        }
+    }
+    delete [] entries;
+    delete [] vals;
+    delete [] ints;
+    delete [] keys;
+    delete bus;
+}
+
 /*--------------------------FUZZING TEST CODE---------------------------------*/
 static bool fuzzing = false;
 static bool nobig = false;
@@ -0,0 +1,242 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <string.h>
+#include <vector>
+
+#include <qcc/Thread.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+
+/* Private files included for unit testing */
+#include <MessageBufferPool.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+
+TEST(MessageBufferPoolTest, HitRate) {
+    MessageBufferPool* pool = new MessageBufferPool();
+    MessageBufferPool::Stats stats;
+
+    /* The first allocation of each size class misses, later ones reuse the freed buffer */
+    for (size_t n = 0; n < 10; ++n) {
+        uint8_t* buf = pool->Alloc(100);
+        ASSERT_TRUE(buf != NULL);
+        memset(buf, 0xAA, 100);
+        MessageBufferPool::Free(buf);
+    }
+    pool->GetStats(stats);
+    EXPECT_EQ((uint32_t)10, stats.allocs);
+    EXPECT_EQ((uint32_t)9, stats.hits);
+    EXPECT_EQ((uint32_t)0, stats.unpooled);
+    EXPECT_EQ((uint32_t)1, stats.classFree[0]);
+
+    /* A different size class has its own free list */
+    uint8_t* buf = pool->Alloc(1000);
+    MessageBufferPool::Free(buf);
+    pool->GetStats(stats);
+    EXPECT_EQ((uint32_t)11, stats.allocs);
+    EXPECT_EQ((uint32_t)9, stats.hits);
+    EXPECT_EQ((uint32_t)1, stats.classFree[0]);
+    EXPECT_EQ((uint32_t)1, stats.classFree[2]);
+
+    pool->Release();
+}
+
+TEST(MessageBufferPoolTest, Stats) {
+    MessageBufferPool* pool = new MessageBufferPool();
+    MessageBufferPool::Stats stats;
+
+    uint8_t* small[3];
+    for (size_t i = 0; i < ArraySize(small); ++i) {
+        small[i] = pool->Alloc(128);
+    }
+    uint8_t* medium = pool->Alloc(129);
+    uint8_t* large = pool->Alloc(100 * 1024);
+
+    pool->GetStats(stats);
+    EXPECT_EQ((uint32_t)5, stats.allocs);
+    EXPECT_EQ((uint32_t)0, stats.hits);
+    EXPECT_EQ((uint32_t)1, stats.unpooled);
+    EXPECT_EQ((uint32_t)5, stats.inUse);
+    EXPECT_EQ((size_t)(3 * 128 + 512 + 100 * 1024), stats.bytesInUse);
+    EXPECT_EQ((uint32_t)3, stats.classInUse[0]);
+    EXPECT_EQ((uint32_t)1, stats.classInUse[1]);
+    EXPECT_EQ((uint32_t)0, stats.classInUse[2]);
+    EXPECT_EQ((uint32_t)3, stats.classPeakInUse[0]);
+
+    for (size_t i = 0; i < ArraySize(small); ++i) {
+        MessageBufferPool::Free(small[i]);
+    }
+    MessageBufferPool::Free(medium);
+    MessageBufferPool::Free(large);
+
+    pool->GetStats(stats);
+    EXPECT_EQ((uint32_t)0, stats.inUse);
+    EXPECT_EQ((size_t)0, stats.bytesInUse);
+    EXPECT_EQ((uint32_t)0, stats.classInUse[0]);
+    EXPECT_EQ((uint32_t)3, stats.classPeakInUse[0]);
+    EXPECT_EQ((uint32_t)3, stats.classFree[0]);
+    EXPECT_EQ((uint32_t)1, stats.classFree[1]);
+    /* Buffers too large to pool are not kept */
+    for (size_t i = 2; i < MessageBufferPool::NUM_SIZE_CLASSES; ++i) {
+        EXPECT_EQ((uint32_t)0, stats.classFree[i]);
+    }
+
+    pool->Release();
+}
+
+TEST(MessageBufferPoolTest, SharedBuffer) {
+    MessageBufferPool* pool = new MessageBufferPool();
+    MessageBufferPool::Stats stats;
+
+    uint8_t* buf = pool->Alloc(64);
+    EXPECT_FALSE(MessageBufferPool::IsShared(buf));
+    MessageBufferPool::AddRef(buf);
+    EXPECT_TRUE(MessageBufferPool::IsShared(buf));
+
+    /* The buffer is only returned when the last reference is released */
+    MessageBufferPool::Free(buf);
+    EXPECT_FALSE(MessageBufferPool::IsShared(buf));
+    pool->GetStats(stats);
+    EXPECT_EQ((uint32_t)1, stats.inUse);
+    MessageBufferPool::Free(buf);
+    pool->GetStats(stats);
+    EXPECT_EQ((uint32_t)0, stats.inUse);
+    EXPECT_EQ((uint32_t)1, stats.classFree[0]);
+
+    EXPECT_FALSE(MessageBufferPool::IsShared(NULL));
+    MessageBufferPool::AddRef(NULL);
+    MessageBufferPool::Free(NULL);
+
+    pool->Release();
+}
+
+TEST(MessageBufferPoolTest, OutlivesRelease) {
+    MessageBufferPool* pool = new MessageBufferPool();
+
+    /* Buffers that are still in use when the creator releases the pool remain valid */
+    uint8_t* a = pool->Alloc(100);
+    uint8_t* b = pool->Alloc(100 * 1024);
+    pool->Release();
+    memset(a, 0x55, 100);
+    memset(b, 0x55, 100 * 1024);
+    MessageBufferPool::Free(a);
+    /* The pool is deleted when the last buffer is returned */
+    MessageBufferPool::Free(b);
+}
+
+class MessageBufferPoolThread : public qcc::Thread {
+  public:
+    MessageBufferPoolThread(MessageBufferPool& pool, size_t size) : qcc::Thread("MessageBufferPoolThread"), pool(pool), size(size), errors(0) { }
+
+    qcc::ThreadReturn STDCALL Run(void* arg) {
+        std::vector<uint8_t*> bufs;
+        for (size_t n = 0; n < 10000; ++n) {
+            uint8_t* buf = pool.Alloc(size);
+            memset(buf, static_cast<int>(n), size);
+            bufs.push_back(buf);
+            if (bufs.size() == 8) {
+                for (size_t i = 0; i < bufs.size(); ++i) {
+                    if (bufs[i][0] != bufs[i][size - 1]) {
+                        ++errors;
+                    }
+                    MessageBufferPool::Free(bufs[i]);
+                }
+                bufs.clear();
+            }
+        }
+        for (size_t i = 0; i < bufs.size(); ++i) {
+            MessageBufferPool::Free(bufs[i]);
+        }
+        return 0;
+    }
+
+    MessageBufferPool& pool;
+    size_t size;
+    size_t errors;
+};
+
+TEST(MessageBufferPoolTest, Concurrent) {
+    MessageBufferPool* pool = new MessageBufferPool();
+    MessageBufferPool::Stats stats;
+
+    /* Two threads per size class so threads contend within a size class as well as across them */
+    static const size_t sizes[6] = { 100, 100, 500, 500, 4000, 4000 };
+    MessageBufferPoolThread* threads[6];
+    for (size_t i = 0; i < ArraySize(threads); ++i) {
+        threads[i] = new MessageBufferPoolThread(*pool, sizes[i]);
+        threads[i]->Start();
+    }
+    for (size_t i = 0; i < ArraySize(threads); ++i) {
+        threads[i]->Join();
+        EXPECT_EQ((size_t)0, threads[i]->errors);
+        delete threads[i];
+    }
+
+    pool->GetStats(stats);
+    EXPECT_EQ((uint32_t)(10000 * ArraySize(sizes)), stats.allocs);
+    EXPECT_EQ((uint32_t)0, stats.inUse);
+    EXPECT_EQ((size_t)0, stats.bytesInUse);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_LE(stats.classPeakInUse[i], (uint32_t)16);
+        EXPECT_EQ(stats.classPeakInUse[i], stats.classFree[i]);
+    }
+
+    pool->Release();
+}
+
+class BufferPoolTestMessage : public _Message {
+  public:
+    BufferPoolTestMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Signal(const MsgArg* args, size_t numArgs)
+    {
+        qcc::String sig = MsgArg::Signature(args, numArgs);
+        return SignalMsg(sig, NULL, 0, "/foo/bar", "foo.bar", "sig", args, numArgs, 0, 0);
+    }
+
+    QStatus UnmarshalBody() { return UnmarshalArgs("*"); }
+};
+
+TEST(MessageBufferPoolTest, OutlivesBusAttachment) {
+    QStatus status;
+    BusAttachment* bus = new BusAttachment("MessageBufferPoolTest", false);
+    bus->Start();
+
+    MsgArg args[2];
+    args[0].Set("s", "hello");
+    args[1].Set("u", 42);
+    BufferPoolTestMessage* msg = new BufferPoolTestMessage(*bus);
+    status = msg->Signal(args, ArraySize(args));
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg->UnmarshalBody();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    bus->Stop();
+    bus->Join();
+    delete bus;
+
+    /* The message buffer belongs to the pool, which is kept until the message is destroyed */
+    EXPECT_STREQ("hello", msg->GetArg(0)->v_string.str);
+    EXPECT_EQ((uint32_t)42, msg->GetArg(1)->v_uint32);
+    delete msg;
+}
@@ -0,0 +1,296 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <vector>
+
+#include <qcc/ManagedObj.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/DBusStd.h>
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <BusEndpoint.h>
+#include <NameTable.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+
+class NameTableTestEndpoint : public _BusEndpoint {
+  public:
+    NameTableTestEndpoint(const qcc::String& name) : _BusEndpoint(ENDPOINT_TYPE_NULL), name(name) { }
+
+    const qcc::String& GetUniqueName() const { return name; }
+
+    qcc::String name;
+};
+
+class NameTableTestListener : public NameListener {
+  public:
+    struct Change {
+        qcc::String alias;
+        qcc::String oldOwner;
+        qcc::String newOwner;
+    };
+
+    void NameOwnerChanged(const qcc::String& alias, const qcc::String* oldOwner, const qcc::String* newOwner) {
+        Change change;
+        change.alias = alias;
+        change.oldOwner = oldOwner ? *oldOwner : "";
+        change.newOwner = newOwner ? *newOwner : "";
+        changes.push_back(change);
+    }
+
+    std::vector<Change> changes;
+};
+
+/*
+ * Looks up a name that always resolves to the same endpoint while the name table changes
+ */
+class NameTableTestReader : public qcc::Thread {
+  public:
+    NameTableTestReader(NameTable& names, const qcc::String& name, const BusEndpoint& expect) :
+        Thread("NameTableTestReader"), names(names), name(name), expect(expect), lookups(0), failures(0) { }
+
+    qcc::ThreadReturn STDCALL Run(void* arg) {
+        while (!IsStopping()) {
+            if (!(names.FindEndpoint(name) == expect)) {
+                ++failures;
+            }
+            ++lookups;
+        }
+        return 0;
+    }
+
+    NameTable& names;
+    qcc::String name;
+    BusEndpoint expect;
+    volatile uint32_t lookups;
+    volatile uint32_t failures;
+};
+
+class NameTableTest : public testing::Test {
+  public:
+
+    /*
+     * Add an endpoint with the given unique name to the name table
+     */
+    BusEndpoint Add(const qcc::String& name) {
+        qcc::ManagedObj<NameTableTestEndpoint> tep(name);
+        BusEndpoint ep = BusEndpoint::cast(tep);
+        names.AddUniqueName(ep);
+        return ep;
+    }
+
+    NameTable names;
+};
+
+TEST_F(NameTableTest, EmptyTable) {
+    /* Lookups before any name was added must not touch the unique name slots */
+    EXPECT_FALSE(names.FindEndpoint(":1.1")->IsValid());
+    EXPECT_FALSE(names.FindEndpoint(":1.0")->IsValid());
+    EXPECT_FALSE(names.FindEndpoint(":abc")->IsValid());
+    EXPECT_FALSE(names.FindEndpoint("org.alljoyn.test")->IsValid());
+    EXPECT_FALSE(names.FindEndpoint("")->IsValid());
+}
+
+TEST_F(NameTableTest, UniqueNames) {
+    std::vector<BusEndpoint> eps;
+    for (size_t i = 0; i < 1000; ++i) {
+        eps.push_back(Add(names.GenerateUniqueName()));
+    }
+    for (size_t i = 0; i < eps.size(); ++i) {
+        ASSERT_TRUE(names.FindEndpoint(eps[i]->GetUniqueName()) == eps[i]);
+    }
+    EXPECT_FALSE(names.FindEndpoint(names.GenerateUniqueName())->IsValid());
+
+    for (size_t i = 0; i < eps.size(); i += 2) {
+        names.RemoveUniqueName(eps[i]->GetUniqueName());
+    }
+    for (size_t i = 0; i < eps.size(); ++i) {
+        if (i & 1) {
+            ASSERT_TRUE(names.FindEndpoint(eps[i]->GetUniqueName()) == eps[i]);
+        } else {
+            ASSERT_FALSE(names.FindEndpoint(eps[i]->GetUniqueName())->IsValid());
+        }
+    }
+}
+
+TEST_F(NameTableTest, MalformedUniqueNames) {
+    /*
+     * Names that cannot be decoded to a handle are found by string. The last two have counters
+     * that do not fit in 32 bits.
+     */
+    const char* malformed[] = { ":", ":abc", ":abc.", ":abc.1x", ":abc.1.2", ":abc.12345678901", ":abc.4294967296" };
+    std::vector<BusEndpoint> eps;
+    for (size_t i = 0; i < ArraySize(malformed); ++i) {
+        eps.push_back(Add(malformed[i]));
+    }
+    BusEndpoint wellFormed = Add(":abc.1");
+    BusEndpoint maxCounter = Add(":abc.4294967295");
+
+    for (size_t i = 0; i < eps.size(); ++i) {
+        EXPECT_TRUE(names.FindEndpoint(malformed[i]) == eps[i]) << "  Name: " << malformed[i];
+    }
+    EXPECT_TRUE(names.FindEndpoint(":abc.1") == wellFormed);
+    EXPECT_TRUE(names.FindEndpoint(":abc.4294967295") == maxCounter);
+    EXPECT_FALSE(names.FindEndpoint(":abc.01")->IsValid());
+    EXPECT_FALSE(names.FindEndpoint(":abc.0")->IsValid());
+}
+
+TEST_F(NameTableTest, SharedHandle) {
+    /*
+     * The prefixes "wBAD" and "S3cC" have the same 32 bit FNV-1a hash so these names decode to
+     * the same handle and must be told apart by comparing the names.
+     */
+    BusEndpoint ep1 = Add(":wBAD.7");
+    EXPECT_FALSE(names.FindEndpoint(":S3cC.7")->IsValid());
+    BusEndpoint ep2 = Add(":S3cC.7");
+    EXPECT_TRUE(names.FindEndpoint(":wBAD.7") == ep1);
+    EXPECT_TRUE(names.FindEndpoint(":S3cC.7") == ep2);
+
+    names.RemoveUniqueName(":wBAD.7");
+    EXPECT_FALSE(names.FindEndpoint(":wBAD.7")->IsValid());
+    EXPECT_TRUE(names.FindEndpoint(":S3cC.7") == ep2);
+}
+
+TEST_F(NameTableTest, ProbeClusters) {
+    /*
+     * Names with the same prefix and consecutive counters have consecutive home slots so they form
+     * a single cluster, names from a second prefix probe past them.
+     */
+    std::vector<BusEndpoint> eps;
+    for (size_t i = 0; i < 7; ++i) {
+        eps.push_back(Add(qcc::String(":p.") + qcc::U32ToString(i)));
+        eps.push_back(Add(qcc::String(":q.") + qcc::U32ToString(i)));
+    }
+    for (size_t i = 0; i < eps.size(); ++i) {
+        EXPECT_TRUE(names.FindEndpoint(eps[i]->GetUniqueName()) == eps[i]);
+    }
+    for (size_t i = 0; i < eps.size(); i += 3) {
+        names.RemoveUniqueName(eps[i]->GetUniqueName());
+    }
+    for (size_t i = 0; i < eps.size(); ++i) {
+        if ((i % 3) == 0) {
+            EXPECT_FALSE(names.FindEndpoint(eps[i]->GetUniqueName())->IsValid());
+        } else {
+            EXPECT_TRUE(names.FindEndpoint(eps[i]->GetUniqueName()) == eps[i]);
+        }
+    }
+}
+
+TEST_F(NameTableTest, Aliases) {
+    BusEndpoint ep1 = Add(names.GenerateUniqueName());
+    BusEndpoint ep2 = Add(names.GenerateUniqueName());
+    uint32_t disposition;
+
+    EXPECT_EQ(ER_OK, names.AddAlias("org.alljoyn.test", ep1->GetUniqueName(), DBUS_NAME_FLAG_ALLOW_REPLACEMENT, disposition));
+    EXPECT_EQ((uint32_t)DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER, disposition);
+    EXPECT_TRUE(names.FindEndpoint("org.alljoyn.test") == ep1);
+
+    EXPECT_EQ(ER_OK, names.AddAlias("org.alljoyn.test", ep2->GetUniqueName(), DBUS_NAME_FLAG_REPLACE_EXISTING, disposition));
+    EXPECT_EQ((uint32_t)DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER, disposition);
+    EXPECT_TRUE(names.FindEndpoint("org.alljoyn.test") == ep2);
+
+    /* The name goes back to the queued owner when the primary owner goes away */
+    names.RemoveUniqueName(ep2->GetUniqueName());
+    EXPECT_TRUE(names.FindEndpoint("org.alljoyn.test") == ep1);
+
+    names.RemoveAlias("org.alljoyn.test", ep1->GetUniqueName(), disposition);
+    EXPECT_EQ((uint32_t)DBUS_RELEASE_NAME_REPLY_RELEASED, disposition);
+    EXPECT_FALSE(names.FindEndpoint("org.alljoyn.test")->IsValid());
+}
+
+TEST_F(NameTableTest, RemoveUniqueNameReleasesAliases) {
+    BusEndpoint ep1 = Add(names.GenerateUniqueName());
+    BusEndpoint ep2 = Add(names.GenerateUniqueName());
+    const qcc::String& name1 = ep1->GetUniqueName();
+    const qcc::String& name2 = ep2->GetUniqueName();
+    uint32_t disposition;
+
+    /* ep1 owns several names and is queued for a name owned by ep2, ep2 is queued for one of them */
+    const char* aliases[] = { "org.alljoyn.test.a", "org.alljoyn.test.b", "org.alljoyn.test.c" };
+    for (size_t i = 0; i < ArraySize(aliases); ++i) {
+        ASSERT_EQ(ER_OK, names.AddAlias(aliases[i], name1, 0, disposition));
+        ASSERT_EQ((uint32_t)DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER, disposition);
+    }
+    ASSERT_EQ(ER_OK, names.AddAlias(aliases[0], name2, 0, disposition));
+    ASSERT_EQ((uint32_t)DBUS_REQUEST_NAME_REPLY_IN_QUEUE, disposition);
+    ASSERT_EQ(ER_OK, names.AddAlias("org.alljoyn.test.d", name2, 0, disposition));
+    ASSERT_EQ(ER_OK, names.AddAlias("org.alljoyn.test.d", name1, 0, disposition));
+    ASSERT_EQ((uint32_t)DBUS_REQUEST_NAME_REPLY_IN_QUEUE, disposition);
+
+    NameTableTestListener listener;
+    names.AddListener(&listener);
+    names.RemoveUniqueName(name1);
+    names.RemoveListener(&listener);
+
+    /* Every name ep1 owned is released and the listener hears about each of them */
+    EXPECT_TRUE(names.FindEndpoint(aliases[0]) == ep2);
+    EXPECT_FALSE(names.FindEndpoint(aliases[1])->IsValid());
+    EXPECT_FALSE(names.FindEndpoint(aliases[2])->IsValid());
+    EXPECT_FALSE(names.FindEndpoint(name1)->IsValid());
+    EXPECT_TRUE(names.FindEndpoint("org.alljoyn.test.d") == ep2);
+    ASSERT_EQ((size_t)4, listener.changes.size());
+    for (size_t i = 0; i < 3; ++i) {
+        const NameTableTestListener::Change& change = listener.changes[i];
+        EXPECT_STREQ(name1.c_str(), change.oldOwner.c_str());
+        EXPECT_STREQ((change.alias == aliases[0]) ? name2.c_str() : "", change.newOwner.c_str()) << "  Name: " << change.alias.c_str();
+    }
+    EXPECT_STREQ(name1.c_str(), listener.changes[3].alias.c_str());
+    EXPECT_STREQ("", listener.changes[3].newOwner.c_str());
+
+    /* ep1 is no longer queued for the name owned by ep2 */
+    names.RemoveUniqueName(name2);
+    EXPECT_FALSE(names.FindEndpoint("org.alljoyn.test.d")->IsValid());
+    EXPECT_FALSE(names.FindEndpoint(aliases[0])->IsValid());
+}
+
+TEST_F(NameTableTest, ConcurrentLookups) {
+    BusEndpoint stable = Add(names.GenerateUniqueName());
+    uint32_t disposition;
+    ASSERT_EQ(ER_OK, names.AddAlias("org.alljoyn.test.stable", stable->GetUniqueName(), 0, disposition));
+
+    /*
+     * Names that are looked up all the time keep resolving while every change to the table
+     * publishes a new snapshot and frees the old one.
+     */
+    std::vector<NameTableTestReader*> readers;
+    for (size_t i = 0; i < 4; ++i) {
+        readers.push_back(new NameTableTestReader(names, (i & 1) ? "org.alljoyn.test.stable" : stable->GetUniqueName(), stable));
+        ASSERT_EQ(ER_OK, readers.back()->Start());
+    }
+    for (size_t i = 0; i < 200; ++i) {
+        BusEndpoint ep = Add(names.GenerateUniqueName());
+        names.AddAlias("org.alljoyn.test.churn", ep->GetUniqueName(), 0, disposition);
+        EXPECT_TRUE(names.FindEndpoint("org.alljoyn.test.churn") == ep);
+        names.RemoveUniqueName(ep->GetUniqueName());
+        EXPECT_FALSE(names.FindEndpoint(ep->GetUniqueName())->IsValid());
+    }
+    for (size_t i = 0; i < readers.size(); ++i) {
+        readers[i]->Stop();
+        readers[i]->Join();
+        EXPECT_LT((uint32_t)0, readers[i]->lookups);
+        EXPECT_EQ((uint32_t)0, readers[i]->failures);
+        delete readers[i];
+    }
+}
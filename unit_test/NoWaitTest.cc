@@ -0,0 +1,246 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include <qcc/Mutex.h>
+#include <qcc/Thread.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusListener.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/DBusStd.h>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/ProxyBusObject.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <BusInternal.h>
+#include <RemoteEndpoint.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+#include "ajTestCommon.h"
+
+using namespace ajn;
+
+static const char* INTERFACE_NAME = "org.alljoyn.test.NoWait";
+static const char* OBJECT_PATH = "/org/alljoyn/test/NoWait";
+
+/*
+ * Large enough that a signal is still being written when the next one is sent
+ */
+static const size_t PAYLOAD_SIZE = 64 * 1024;
+
+class NoWaitTestObject : public BusObject {
+  public:
+    NoWaitTestObject(const InterfaceDescription* intf) : BusObject(OBJECT_PATH), signal(intf->GetMember("Data")) {
+        AddInterface(*intf);
+    }
+
+    const InterfaceDescription::Member* signal;
+};
+
+class NoWaitTestListener : public BusListener {
+  public:
+    NoWaitTestListener() : writable(false) { }
+
+    virtual void BusWritable() {
+        writable = true;
+    }
+
+    volatile bool writable;
+};
+
+class NoWaitTestReceiver : public MessageReceiver {
+  public:
+    void ReplyHandler(Message& msg, void* context) {
+        lock.Lock();
+        replies.push_back(context);
+        lock.Unlock();
+    }
+
+    size_t NumReplies() {
+        lock.Lock();
+        size_t num = replies.size();
+        lock.Unlock();
+        return num;
+    }
+
+    bool GotReply(void* context) {
+        lock.Lock();
+        bool got = std::find(replies.begin(), replies.end(), context) != replies.end();
+        lock.Unlock();
+        return got;
+    }
+
+    qcc::Mutex lock;
+    std::vector<void*> replies;
+};
+
+class NoWaitTest : public testing::Test {
+  public:
+    NoWaitTest() : bus("NoWaitTest", false), obj(NULL), remote(false) { }
+
+    virtual void SetUp() {
+        QStatus status = bus.Start();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = bus.Connect(getConnectArg().c_str());
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        InterfaceDescription* intf = NULL;
+        status = bus.CreateInterface(INTERFACE_NAME, intf);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        intf->AddSignal("Data", "ay", NULL);
+        intf->Activate();
+        obj = new NoWaitTestObject(intf);
+        status = bus.RegisterBusObject(*obj);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        static uint8_t buf[PAYLOAD_SIZE];
+        payload.Set("ay", PAYLOAD_SIZE, buf);
+
+        /*
+         * Only a connection to a separate daemon has a transmit queue that can fill up, limit it
+         * to one message so the queue is full whenever a message is being written.
+         */
+        BusEndpoint ep = bus.GetInternal().GetRouter().FindEndpoint(bus.GetUniqueName());
+        if (ep->IsValid() && (ep->GetEndpointType() == ENDPOINT_TYPE_REMOTE)) {
+            RemoteEndpoint::cast(ep)->SetTxQueueLimits(_RemoteEndpoint::DEFAULT_TX_QUEUE_BYTES, 1);
+            remote = true;
+        }
+    }
+
+    virtual void TearDown() {
+        bus.Stop();
+        bus.Join();
+        delete obj;
+    }
+
+    /*
+     * Send signals until one is rejected because the queue is full
+     */
+    QStatus FillQueue() {
+        QStatus status = ER_OK;
+        for (size_t i = 0; (status == ER_OK) && (i < 1000); ++i) {
+            status = obj->SignalNoWait(NULL, 0, *obj->signal, &payload, 1);
+        }
+        return status;
+    }
+
+    bool WaitForWritable() {
+        for (size_t i = 0; i < 500; ++i) {
+            if (listener.writable) {
+                return true;
+            }
+            qcc::Sleep(10);
+        }
+        return false;
+    }
+
+    BusAttachment bus;
+    NoWaitTestObject* obj;
+    NoWaitTestListener listener;
+    MsgArg payload;
+    bool remote;
+};
+
+TEST_F(NoWaitTest, SignalQueueFull) {
+    if (!remote) {
+        printf("Skipping NoWaitTest.SignalQueueFull, there is no transmit queue to the daemon\n");
+        return;
+    }
+    bus.RegisterBusListener(listener);
+
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, FillQueue());
+
+    /* The listener is told when the queue has drained and the signal can be sent again */
+    EXPECT_TRUE(WaitForWritable());
+    QStatus status = obj->SignalNoWait(NULL, 0, *obj->signal, &payload, 1);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /* Signal() still waits for room rather than failing */
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, FillQueue());
+    status = obj->Signal(NULL, 0, *obj->signal, &payload, 1);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    bus.UnregisterBusListener(listener);
+}
+
+TEST_F(NoWaitTest, MethodCallQueueFull) {
+    if (!remote) {
+        printf("Skipping NoWaitTest.MethodCallQueueFull, there is no transmit queue to the daemon\n");
+        return;
+    }
+    bus.RegisterBusListener(listener);
+
+    const ProxyBusObject& dbusObj = bus.GetDBusProxyObj();
+    const InterfaceDescription::Member* listNames = bus.GetInterface(org::freedesktop::DBus::InterfaceName)->GetMember("ListNames");
+    ASSERT_TRUE(listNames != NULL);
+    NoWaitTestReceiver receiver;
+
+    /*
+     * The queue can drain between filling it and making the call so keep trying until a call is
+     * rejected. The context of each call is its attempt number.
+     */
+    QStatus status = ER_OK;
+    size_t accepted = 0;
+    uintptr_t attempt = 0;
+    while ((status == ER_OK) && (attempt < 100)) {
+        ++attempt;
+        FillQueue();
+        status = dbusObj.MethodCallAsyncNoWait(*listNames, &receiver,
+                                               static_cast<MessageReceiver::ReplyHandler>(&NoWaitTestReceiver::ReplyHandler),
+                                               NULL, 0, reinterpret_cast<void*>(attempt));
+        if (status == ER_OK) {
+            ++accepted;
+        }
+    }
+    ASSERT_EQ(ER_BUS_WRITE_QUEUE_FULL, status);
+    void* rejected = reinterpret_cast<void*>(attempt);
+
+    /*
+     * The call can be made again once the queue has drained. The listener may have been told about
+     * an earlier attempt so the call is retried until the queue has room.
+     */
+    EXPECT_TRUE(WaitForWritable());
+    void* retried = reinterpret_cast<void*>(attempt + 1);
+    for (size_t i = 0; i < 100; ++i) {
+        status = dbusObj.MethodCallAsyncNoWait(*listNames, &receiver,
+                                               static_cast<MessageReceiver::ReplyHandler>(&NoWaitTestReceiver::ReplyHandler),
+                                               NULL, 0, retried);
+        if (status != ER_BUS_WRITE_QUEUE_FULL) {
+            break;
+        }
+        qcc::Sleep(10);
+    }
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ++accepted;
+
+    /* Every accepted call gets a reply, the rejected call never does */
+    for (size_t i = 0; (i < 500) && (receiver.NumReplies() < accepted); ++i) {
+        qcc::Sleep(10);
+    }
+    EXPECT_EQ(accepted, receiver.NumReplies());
+    EXPECT_TRUE(receiver.GotReply(retried));
+    EXPECT_FALSE(receiver.GotReply(rejected));
+
+    bus.UnregisterBusListener(listener);
+}
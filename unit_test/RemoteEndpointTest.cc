@@ -0,0 +1,655 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <qcc/Crypto.h>
+#include <qcc/KeyBlob.h>
+#include <qcc/ManagedObj.h>
+#include <qcc/Socket.h>
+#include <qcc/SocketStream.h>
+#include <qcc/Thread.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/AllJoynStd.h>
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgArg.h>
+
+#include <alljoyn/Status.h>
+
+#if defined(QCC_OS_GROUP_POSIX)
+#include <sys/types.h>
+#include <sys/socket.h>
+#endif
+
+/* Private files included for unit testing */
+#include <BusInternal.h>
+#include <PeerState.h>
+#include <RemoteEndpoint.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+#include "ajTestCommon.h"
+
+using namespace ajn;
+
+/*
+ * Append a little endian uint32 to a byte vector
+ */
+static void AppendUInt32(std::vector<uint8_t>& buf, uint32_t val)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        buf.push_back((uint8_t)(val >> (8 * i)));
+    }
+}
+
+/*
+ * Read a uint32 in the byte order of a marshaled message
+ */
+static uint32_t ReadUInt32(const uint8_t* buf, char endian)
+{
+    uint32_t val = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        val |= (uint32_t)buf[(endian == 'B') ? (3 - i) : i] << (8 * i);
+    }
+    return val;
+}
+
+/*
+ * Get the serial numbers of the marshaled messages in a buffer in the order they appear
+ */
+static std::vector<uint32_t> GetSerials(const std::vector<uint8_t>& buf)
+{
+    std::vector<uint32_t> serials;
+    size_t pos = 0;
+    while ((pos + 16) <= buf.size()) {
+        const uint8_t* hdr = &buf[pos];
+        char endian = (char)hdr[0];
+        uint32_t bodyLen = ReadUInt32(hdr + 4, endian);
+        uint32_t fieldsLen = ReadUInt32(hdr + 12, endian);
+        serials.push_back(ReadUInt32(hdr + 8, endian));
+        pos += 16 + ((fieldsLen + 7) & ~7) + bodyLen;
+    }
+    EXPECT_EQ(buf.size(), pos) << "  Stream ends part way through a message";
+    return serials;
+}
+
+/*
+ * Marshal a method reply with no body the way a peer would put it on the wire
+ */
+static void AppendMethodReply(std::vector<uint8_t>& buf, uint32_t serial, uint32_t replySerial)
+{
+    buf.push_back('l');
+    buf.push_back((uint8_t)MESSAGE_METHOD_RET);
+    buf.push_back(0);
+    buf.push_back(1);
+    AppendUInt32(buf, 0);
+    AppendUInt32(buf, serial);
+    /* A single header field, the reply serial, that ends on an 8 byte boundary */
+    AppendUInt32(buf, 8);
+    buf.push_back((uint8_t)ALLJOYN_HDR_FIELD_REPLY_SERIAL);
+    buf.push_back(1);
+    buf.push_back('u');
+    buf.push_back(0);
+    AppendUInt32(buf, replySerial);
+}
+
+class RemoteEndpointTestMessage : public _Message {
+  public:
+
+    RemoteEndpointTestMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Signal(uint32_t n)
+    {
+        MsgArg arg("u", n);
+        return SignalMsg("u", NULL, 0, "/org/alljoyn/test", "org.alljoyn.test", "Seq", &arg, 1, 0, 0);
+    }
+
+    QStatus Probe()
+    {
+        return SignalMsg("", NULL, 0, "/", org::alljoyn::Daemon::InterfaceName, "ProbeReq", NULL, 0, 0, 0);
+    }
+
+    QStatus Unicast(const char* destination, uint32_t n, uint8_t flags)
+    {
+        MsgArg arg("u", n);
+        return SignalMsg("u", destination, 0, "/org/alljoyn/test", "org.alljoyn.test", "Seq", &arg, 1, flags, 0);
+    }
+
+    /*
+     * Get the marshaled message as it is held in this message's buffer
+     */
+    std::vector<uint8_t> GetBytes() const
+    {
+        const uint8_t* buf = reinterpret_cast<const uint8_t*>(msgBuf);
+        return std::vector<uint8_t>(buf, static_cast<const uint8_t*>(bufEOD));
+    }
+
+    bool IsEncryptPending() const { return encrypt; }
+};
+
+/*
+ * A socket stream that accepts at most a few bytes per write and makes no progress on every other
+ * write, as if the socket buffer were full.
+ */
+class TrickleSocketStream : public qcc::SocketStream {
+  public:
+    TrickleSocketStream(qcc::SocketFd fd, size_t chunk) : qcc::SocketStream(fd), chunk(chunk), stall(false) { }
+
+    QStatus PushBytes(const void* buf, size_t numBytes, size_t& numSent) {
+        stall = !stall;
+        if (stall) {
+            numSent = 0;
+            return ER_TIMEOUT;
+        }
+        return qcc::SocketStream::PushBytes(buf, (std::min)(numBytes, chunk), numSent);
+    }
+
+    size_t chunk;
+    bool stall;
+};
+
+class RemoteEndpointTest : public testing::Test {
+  public:
+    RemoteEndpointTest() : bus("RemoteEndpointTest", false) { }
+
+    virtual void SetUp() {
+        QStatus status = bus.Start();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    virtual void TearDown() {
+        for (size_t i = 0; i < endpoints.size(); ++i) {
+            endpoints[i]->Stop();
+            endpoints[i]->Join();
+        }
+        endpoints.clear();
+        idleEndpoints.clear();
+        for (size_t i = 0; i < streams.size(); ++i) {
+            delete streams[i];
+        }
+        for (size_t i = 0; i < peers.size(); ++i) {
+            qcc::Close(peers[i]);
+        }
+        bus.Stop();
+        bus.Join();
+    }
+
+    /*
+     * Start a remote endpoint on one end of a socket pair and return the other end. The endpoint
+     * is not authenticated, it is registered with the router as the connection to the bus.
+     */
+    QStatus StartEndpoint(RemoteEndpoint& ep, qcc::SocketFd& local, qcc::SocketFd& peer) {
+        qcc::SocketFd fds[2];
+        QStatus status = qcc::SocketPair(fds);
+        if (status != ER_OK) {
+            return status;
+        }
+        local = fds[0];
+        peer = fds[1];
+        qcc::SocketStream* stream = new qcc::SocketStream(local);
+        streams.push_back(stream);
+        peers.push_back(peer);
+        ep = RemoteEndpoint(bus, false, "", stream, "RemoteEndpointTest");
+        status = ep->Start();
+        if (status == ER_OK) {
+            endpoints.push_back(ep);
+        }
+        return status;
+    }
+
+    /*
+     * Create a remote endpoint that is never started so everything pushed to it stays in its
+     * transmit queue until the test writes it out with Drain().
+     */
+    RemoteEndpoint CreateIdleEndpoint(qcc::SocketFd* peer = NULL) {
+        qcc::SocketFd fds[2];
+        QStatus status = qcc::SocketPair(fds);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        qcc::SocketStream* stream = new qcc::SocketStream(fds[0]);
+        streams.push_back(stream);
+        peers.push_back(fds[1]);
+        if (peer) {
+            qcc::SetBlocking(fds[1], false);
+            *peer = fds[1];
+        }
+        RemoteEndpoint ep(bus, false, "", stream, "RemoteEndpointTest");
+        idleEndpoints.push_back(ep);
+        return ep;
+    }
+
+    /*
+     * Create an idle remote endpoint that writes at most chunk bytes at a time
+     */
+    RemoteEndpoint CreateTrickleEndpoint(size_t chunk, qcc::SocketFd* peer) {
+        qcc::SocketFd fds[2];
+        QStatus status = qcc::SocketPair(fds);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        qcc::SocketStream* stream = new TrickleSocketStream(fds[0], chunk);
+        streams.push_back(stream);
+        peers.push_back(fds[1]);
+        qcc::SetBlocking(fds[1], false);
+        *peer = fds[1];
+        RemoteEndpoint ep(bus, false, "", stream, "RemoteEndpointTest");
+        idleEndpoints.push_back(ep);
+        return ep;
+    }
+
+    QStatus Push(RemoteEndpoint& ep, uint32_t n, bool noWait, uint32_t* serial = NULL) {
+        qcc::ManagedObj<RemoteEndpointTestMessage> signal(bus);
+        QStatus status = signal->Signal(n);
+        if (status == ER_OK) {
+            Message msg = Message::cast(signal);
+            if (serial) {
+                *serial = msg->GetCallSerial();
+            }
+            status = noWait ? ep->PushMessageNoWait(msg) : ep->PushMessage(msg);
+        }
+        return status;
+    }
+
+    QStatus PushProbe(RemoteEndpoint& ep, bool noWait, uint32_t* serial = NULL) {
+        qcc::ManagedObj<RemoteEndpointTestMessage> probe(bus);
+        QStatus status = probe->Probe();
+        if (status == ER_OK) {
+            Message msg = Message::cast(probe);
+            if (serial) {
+                *serial = msg->GetCallSerial();
+            }
+            status = noWait ? ep->PushMessageNoWait(msg) : ep->PushMessage(msg);
+        }
+        return status;
+    }
+
+    /*
+     * Write out the transmit queue of an idle endpoint the way the I/O dispatcher would and
+     * return everything the peer received.
+     */
+    std::vector<uint8_t> Drain(RemoteEndpoint& ep, qcc::SocketFd peer) {
+        qcc::IOWriteListener* listener = ep.unwrap();
+        QStatus status = listener->WriteCallback(ep->GetSink(), false);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        std::vector<uint8_t> received;
+        uint8_t buf[4096];
+        size_t got = 0;
+        /* The peer end is non-blocking so this stops when everything written has been read */
+        while ((qcc::Recv(peer, buf, sizeof(buf), got) == ER_OK) && (got > 0)) {
+            received.insert(received.end(), buf, buf + got);
+        }
+        return received;
+    }
+
+    /*
+     * Like Drain() but for an endpoint whose writes do not always complete. The write callback is
+     * called again each time it returns ER_TIMEOUT, as the I/O dispatcher does once the stream is
+     * writable again, and nothing may leave the transmit queue before all of its bytes are written.
+     */
+    std::vector<uint8_t> DrainPartial(RemoteEndpoint& ep, qcc::SocketFd peer, size_t& partialWrites) {
+        qcc::IOWriteListener* listener = ep.unwrap();
+        size_t queued = ep->GetTxQueueBytes();
+        QStatus status;
+        partialWrites = 0;
+        std::vector<uint8_t> received;
+        do {
+            status = listener->WriteCallback(ep->GetSink(), false);
+            uint8_t buf[4096];
+            size_t got = 0;
+            while ((qcc::Recv(peer, buf, sizeof(buf), got) == ER_OK) && (got > 0)) {
+                received.insert(received.end(), buf, buf + got);
+            }
+            if (status == ER_TIMEOUT) {
+                ++partialWrites;
+                EXPECT_LE(queued, received.size() + ep->GetTxQueueBytes()) << "  A message left the queue before it was written";
+            }
+        } while ((status == ER_TIMEOUT) && (partialWrites < 100000));
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        return received;
+    }
+
+    BusAttachment bus;
+    std::vector<RemoteEndpoint> endpoints;
+    std::vector<RemoteEndpoint> idleEndpoints;
+    std::vector<qcc::SocketStream*> streams;
+    std::vector<qcc::SocketFd> peers;
+};
+
+TEST_F(RemoteEndpointTest, PauseAfterRxReplyLeavesRawData) {
+#if defined(QCC_OS_GROUP_POSIX)
+    RemoteEndpoint ep;
+    qcc::SocketFd local;
+    qcc::SocketFd peer;
+    QStatus status = StartEndpoint(ep, local, peer);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_EQ(ER_OK, ep->PauseAfterRxReply());
+
+    /* The reply and the first raw session bytes arrive together as they would from a fast peer */
+    std::vector<uint8_t> raw;
+    for (size_t i = 0; i < 1000; ++i) {
+        raw.push_back((uint8_t)(i * 7));
+    }
+    std::vector<uint8_t> data;
+    AppendMethodReply(data, 1, 1);
+    data.insert(data.end(), raw.begin(), raw.end());
+    size_t sent = 0;
+    status = qcc::Send(peer, &data[0], data.size(), sent);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_EQ(data.size(), sent);
+
+    /* Wait for the endpoint to read the reply and pause */
+    uint8_t buf[2048];
+    ssize_t avail = (ssize_t)data.size();
+    for (size_t i = 0; (i < 500) && (avail > (ssize_t)raw.size()); ++i) {
+        qcc::Sleep(10);
+        avail = recv(local, buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT);
+    }
+
+    /* Everything after the reply is still in the socket for whoever takes it over */
+    ASSERT_EQ((ssize_t)raw.size(), avail);
+    ASSERT_EQ((ssize_t)raw.size(), recv(local, buf, sizeof(buf), MSG_DONTWAIT));
+    EXPECT_TRUE(memcmp(buf, &raw[0], raw.size()) == 0);
+#else
+    printf("RemoteEndpointTest.PauseAfterRxReplyLeavesRawData skipped: needs POSIX sockets\n");
+#endif
+}
+
+TEST_F(RemoteEndpointTest, TxOverflowDropNewest) {
+    RemoteEndpoint ep = CreateIdleEndpoint();
+    ep->SetTxQueueLimits(_RemoteEndpoint::DEFAULT_TX_QUEUE_BYTES, 3);
+    ep->SetTxOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_DROP_NEWEST);
+    for (uint32_t n = 0; n < 3; ++n) {
+        EXPECT_EQ(ER_OK, Push(ep, n, true));
+    }
+    size_t queued = ep->GetTxQueueBytes();
+
+    /* The messages being pushed are dropped, the queued ones are kept */
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, Push(ep, 3, true));
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, Push(ep, 4, true));
+    EXPECT_EQ((uint32_t)2, ep->GetTxDropCount());
+    EXPECT_EQ(queued, ep->GetTxQueueBytes());
+}
+
+TEST_F(RemoteEndpointTest, TxOverflowDropOldest) {
+    RemoteEndpoint ep = CreateIdleEndpoint();
+    ep->SetTxQueueLimits(_RemoteEndpoint::DEFAULT_TX_QUEUE_BYTES, 3);
+    ep->SetTxOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_DROP_OLDEST);
+    EXPECT_EQ(ER_OK, Push(ep, 0, false));
+    EXPECT_EQ(ER_OK, Push(ep, 1, true));
+    EXPECT_EQ(ER_OK, Push(ep, 2, true));
+    size_t queued = ep->GetTxQueueBytes();
+
+    /* Each message pushed without waiting replaces the oldest message that was also pushed without waiting */
+    EXPECT_EQ(ER_OK, Push(ep, 3, true));
+    EXPECT_EQ((uint32_t)1, ep->GetTxDropCount());
+    EXPECT_EQ(ER_OK, Push(ep, 4, true));
+    EXPECT_EQ(ER_OK, Push(ep, 5, true));
+    EXPECT_EQ((uint32_t)3, ep->GetTxDropCount());
+    EXPECT_EQ(queued, ep->GetTxQueueBytes());
+}
+
+TEST_F(RemoteEndpointTest, TxOverflowDropOldestKeepsWaitingMessages) {
+    RemoteEndpoint ep = CreateIdleEndpoint();
+    ep->SetTxQueueLimits(_RemoteEndpoint::DEFAULT_TX_QUEUE_BYTES, 2);
+    ep->SetTxOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_DROP_OLDEST);
+    EXPECT_EQ(ER_OK, Push(ep, 0, false));
+    EXPECT_EQ(ER_OK, Push(ep, 1, false));
+    size_t queued = ep->GetTxQueueBytes();
+
+    /* Messages queued by PushMessage() are never dropped so the new message is */
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, Push(ep, 2, true));
+    EXPECT_EQ((uint32_t)1, ep->GetTxDropCount());
+    EXPECT_EQ(queued, ep->GetTxQueueBytes());
+}
+
+TEST_F(RemoteEndpointTest, TxOverflowDisconnect) {
+    static const uint32_t MAX_DROPS = 3;
+    RemoteEndpoint ep = CreateIdleEndpoint();
+    ep->SetTxQueueLimits(_RemoteEndpoint::DEFAULT_TX_QUEUE_BYTES, 1);
+    ep->SetTxOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_DISCONNECT, MAX_DROPS);
+    EXPECT_EQ(ER_OK, Push(ep, 0, true));
+
+    /* The endpoint is disconnected by the drop that reaches the limit */
+    for (uint32_t n = 1; n <= MAX_DROPS; ++n) {
+        EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, Push(ep, n, true));
+    }
+    EXPECT_EQ(MAX_DROPS, ep->GetTxDropCount());
+    EXPECT_EQ(ER_BUS_ENDPOINT_CLOSING, Push(ep, MAX_DROPS + 1, true));
+}
+
+TEST_F(RemoteEndpointTest, TxQueueMessageBudget) {
+    RemoteEndpoint ep = CreateIdleEndpoint();
+    ep->SetTxQueueLimits(_RemoteEndpoint::DEFAULT_TX_QUEUE_BYTES, 4);
+    ep->SetTxOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_DROP_NEWEST);
+    for (uint32_t n = 0; n < 4; ++n) {
+        EXPECT_EQ(ER_OK, Push(ep, n, true));
+    }
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, Push(ep, 4, true));
+    EXPECT_EQ((uint32_t)1, ep->GetTxDropCount());
+}
+
+TEST_F(RemoteEndpointTest, TxQueueByteBudget) {
+    RemoteEndpoint ep = CreateIdleEndpoint();
+    EXPECT_EQ(ER_OK, Push(ep, 0, true));
+    size_t len = ep->GetTxQueueBytes();
+    ASSERT_NE((size_t)0, len);
+
+    /* Room for exactly three messages, the message budget is not the limit */
+    ep = CreateIdleEndpoint();
+    ep->SetTxQueueLimits(3 * len, 100);
+    ep->SetTxOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_DROP_NEWEST);
+    for (uint32_t n = 0; n < 3; ++n) {
+        EXPECT_EQ(ER_OK, Push(ep, n, true));
+    }
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, Push(ep, 3, true));
+    EXPECT_EQ(3 * len, ep->GetTxQueueBytes());
+
+    /* A message bigger than the byte budget is still accepted by an empty queue */
+    ep = CreateIdleEndpoint();
+    ep->SetTxQueueLimits(len / 2, 100);
+    ep->SetTxOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_DROP_NEWEST);
+    EXPECT_EQ(ER_OK, Push(ep, 0, true));
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, Push(ep, 1, true));
+}
+
+TEST_F(RemoteEndpointTest, TxQueueProbesExceedBudgets) {
+    RemoteEndpoint ep = CreateIdleEndpoint();
+    ep->SetTxQueueLimits(_RemoteEndpoint::DEFAULT_TX_QUEUE_BYTES, 2);
+    ep->SetTxOverflowPolicy(_RemoteEndpoint::TX_OVERFLOW_DROP_NEWEST);
+    EXPECT_EQ(ER_OK, Push(ep, 0, true));
+    EXPECT_EQ(ER_OK, Push(ep, 1, true));
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, Push(ep, 2, true));
+
+    /* Link probes have a reserve of 16 messages on top of the message budget */
+    for (size_t i = 0; i < 16; ++i) {
+        EXPECT_EQ(ER_OK, PushProbe(ep, true)) << "  Probe " << i;
+    }
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, PushProbe(ep, true));
+    EXPECT_EQ(ER_BUS_WRITE_QUEUE_FULL, Push(ep, 3, true));
+}
+
+TEST_F(RemoteEndpointTest, TxProbesOvertakeBulkData) {
+    qcc::SocketFd peer;
+    RemoteEndpoint ep = CreateIdleEndpoint(&peer);
+    uint32_t bulk[5];
+    uint32_t probes[3];
+    ASSERT_EQ(ER_OK, Push(ep, 0, false, &bulk[0]));
+    ASSERT_EQ(ER_OK, Push(ep, 1, false, &bulk[1]));
+    ASSERT_EQ(ER_OK, Push(ep, 2, false, &bulk[2]));
+    ASSERT_EQ(ER_OK, PushProbe(ep, false, &probes[0]));
+    ASSERT_EQ(ER_OK, Push(ep, 3, false, &bulk[3]));
+    ASSERT_EQ(ER_OK, PushProbe(ep, false, &probes[1]));
+    ASSERT_EQ(ER_OK, PushProbe(ep, false, &probes[2]));
+    ASSERT_EQ(ER_OK, Push(ep, 4, false, &bulk[4]));
+
+    /* The probes are written first in the order they were queued, followed by the bulk data in order */
+    std::vector<uint32_t> written = GetSerials(Drain(ep, peer));
+    ASSERT_EQ(ArraySize(probes) + ArraySize(bulk), written.size());
+    for (size_t i = 0; i < ArraySize(probes); ++i) {
+        EXPECT_EQ(probes[i], written[i]) << "  Position " << i;
+    }
+    for (size_t i = 0; i < ArraySize(bulk); ++i) {
+        EXPECT_EQ(bulk[i], written[ArraySize(probes) + i]) << "  Position " << ArraySize(probes) + i;
+    }
+    EXPECT_EQ((size_t)0, ep->GetTxQueueBytes());
+}
+
+TEST_F(RemoteEndpointTest, TxPartialWritesInsideBatch) {
+    qcc::SocketFd peer;
+    /* An odd write size so partial writes end at many different offsets, including inside message headers */
+    RemoteEndpoint ep = CreateTrickleEndpoint(7, &peer);
+    uint32_t serials[10];
+    for (size_t i = 0; i < ArraySize(serials); ++i) {
+        ASSERT_EQ(ER_OK, Push(ep, i, false, &serials[i]));
+    }
+    size_t queued = ep->GetTxQueueBytes();
+
+    size_t partialWrites;
+    std::vector<uint8_t> received = DrainPartial(ep, peer, partialWrites);
+    EXPECT_EQ(queued, received.size());
+    EXPECT_GT(partialWrites, ArraySize(serials));
+    std::vector<uint32_t> written = GetSerials(received);
+    ASSERT_EQ(ArraySize(serials), written.size());
+    for (size_t i = 0; i < ArraySize(serials); ++i) {
+        EXPECT_EQ(serials[i], written[i]) << "  Position " << i;
+    }
+    EXPECT_EQ((size_t)0, ep->GetTxQueueBytes());
+}
+
+TEST_F(RemoteEndpointTest, TxPartialWritesSingleMessage) {
+    qcc::SocketFd peer;
+    RemoteEndpoint ep = CreateTrickleEndpoint(7, &peer);
+
+    /* A lone message is not copied into the transmit buffer but is written the same way */
+    uint32_t serial;
+    ASSERT_EQ(ER_OK, Push(ep, 0, false, &serial));
+    size_t queued = ep->GetTxQueueBytes();
+    size_t partialWrites;
+    std::vector<uint8_t> received = DrainPartial(ep, peer, partialWrites);
+    EXPECT_EQ(queued, received.size());
+    EXPECT_LT((size_t)1, partialWrites);
+    std::vector<uint32_t> written = GetSerials(received);
+    ASSERT_EQ((size_t)1, written.size());
+    EXPECT_EQ(serial, written[0]);
+
+    /* A message queued behind a partly written one is not added to it */
+    ASSERT_EQ(ER_OK, Push(ep, 1, false, &serial));
+    qcc::IOWriteListener* listener = ep.unwrap();
+    EXPECT_EQ(ER_TIMEOUT, listener->WriteCallback(ep->GetSink(), false));
+    uint32_t next;
+    ASSERT_EQ(ER_OK, Push(ep, 2, false, &next));
+    written = GetSerials(DrainPartial(ep, peer, partialWrites));
+    ASSERT_EQ((size_t)2, written.size());
+    EXPECT_EQ(serial, written[0]);
+    EXPECT_EQ(next, written[1]);
+    EXPECT_EQ((size_t)0, ep->GetTxQueueBytes());
+}
+
+TEST_F(RemoteEndpointTest, TxSharedMessage) {
+    qcc::SocketFd peers[3];
+    RemoteEndpoint eps[3];
+    for (size_t i = 0; i < ArraySize(eps); ++i) {
+        /* Different write sizes so each endpoint is at a different point in the message */
+        eps[i] = CreateTrickleEndpoint(5 + 4 * i, &peers[i]);
+    }
+    qcc::ManagedObj<RemoteEndpointTestMessage> signal(bus);
+    QStatus status = signal->Unicast(":1.99", 42, 0);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    std::vector<uint8_t> marshaled = signal->GetBytes();
+    Message msg = Message::cast(signal);
+    for (size_t i = 0; i < ArraySize(eps); ++i) {
+        ASSERT_EQ(ER_OK, eps[i]->PushMessage(msg));
+    }
+
+    /* Interleave the writes the way the I/O dispatcher would if all the streams were slow */
+    std::vector<uint8_t> received[3];
+    bool done[3] = { false, false, false };
+    size_t numDone = 0;
+    for (size_t n = 0; (numDone < ArraySize(eps)) && (n < 100000); ++n) {
+        size_t i = n % ArraySize(eps);
+        if (done[i]) {
+            continue;
+        }
+        qcc::IOWriteListener* listener = eps[i].unwrap();
+        status = listener->WriteCallback(eps[i]->GetSink(), false);
+        uint8_t buf[4096];
+        size_t got = 0;
+        while ((qcc::Recv(peers[i], buf, sizeof(buf), got) == ER_OK) && (got > 0)) {
+            received[i].insert(received[i].end(), buf, buf + got);
+        }
+        if (status != ER_TIMEOUT) {
+            EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+            done[i] = true;
+            ++numDone;
+        }
+    }
+    ASSERT_EQ(ArraySize(eps), numDone);
+
+    /* Each endpoint writes the whole message and the message itself is unchanged */
+    for (size_t i = 0; i < ArraySize(eps); ++i) {
+        EXPECT_TRUE(received[i] == marshaled) << "  Endpoint " << i << " wrote " << received[i].size() << " of " << marshaled.size() << " bytes";
+        EXPECT_EQ((size_t)0, eps[i]->GetTxQueueBytes());
+    }
+    EXPECT_TRUE(signal->GetBytes() == marshaled);
+}
+
+TEST_F(RemoteEndpointTest, TxEncryptedMessageIsCopied) {
+    static const char* destination = ":1.99";
+
+    /* A session key for the destination so the message is encrypted when it is written */
+    qcc::KeyBlob key;
+    key.Rand(qcc::Crypto_AES::AES128_SIZE, qcc::KeyBlob::AES);
+    PeerState peerState = bus.GetInternal().GetPeerStateTable()->GetPeerState(destination);
+    peerState->SetKey(key, PEER_SESSION_KEY);
+    peerState->SetAuthorization(MESSAGE_SIGNAL, _PeerState::ALLOW_SECURE_TX);
+
+    qcc::SocketFd peers[2];
+    RemoteEndpoint eps[2];
+    for (size_t i = 0; i < ArraySize(eps); ++i) {
+        eps[i] = CreateIdleEndpoint(&peers[i]);
+    }
+    qcc::ManagedObj<RemoteEndpointTestMessage> signal(bus);
+    QStatus status = signal->Unicast(destination, 42, ALLJOYN_FLAG_ENCRYPTED);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_TRUE(signal->IsEncryptPending());
+    std::vector<uint8_t> marshaled = signal->GetBytes();
+    Message msg = Message::cast(signal);
+    for (size_t i = 0; i < ArraySize(eps); ++i) {
+        ASSERT_EQ(ER_OK, eps[i]->PushMessage(msg));
+    }
+
+    std::vector<uint8_t> written[2];
+    for (size_t i = 0; i < ArraySize(eps); ++i) {
+        written[i] = Drain(eps[i], peers[i]);
+    }
+
+    /*
+     * Encryption is done in place so each endpoint encrypts a private copy, the queued message
+     * stays unencrypted and still marked for encryption.
+     */
+    EXPECT_TRUE(signal->IsEncryptPending());
+    EXPECT_TRUE(signal->GetBytes() == marshaled);
+
+    /* Both endpoints write the same encrypted message, the header is not encrypted */
+    ASSERT_EQ(marshaled.size(), written[0].size());
+    EXPECT_TRUE(written[0] == written[1]);
+    const uint8_t* hdr = &marshaled[0];
+    size_t hdrLen = 16 + ((ReadUInt32(hdr + 12, (char)hdr[0]) + 7) & ~7);
+    EXPECT_TRUE(std::equal(marshaled.begin(), marshaled.begin() + hdrLen, written[0].begin()));
+    EXPECT_FALSE(std::equal(marshaled.begin() + hdrLen, marshaled.end(), written[0].begin() + hdrLen));
+}
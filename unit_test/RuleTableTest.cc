@@ -0,0 +1,327 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <qcc/ManagedObj.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgArg.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <RuleTable.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+using namespace qcc;
+
+class RuleTestMessage : public _Message {
+  public:
+
+    RuleTestMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Signal(const char* objPath, const char* iface, const char* signalName, const MsgArg* argList, size_t numArgs)
+    {
+        qcc::String sig = MsgArg::Signature(argList, numArgs);
+        return SignalMsg(sig, NULL, 0, objPath, iface, signalName, argList, numArgs, 0, 0);
+    }
+};
+
+class RuleTableTest : public testing::Test {
+  public:
+    RuleTableTest() : bus("RuleTableTest", false) { }
+
+    virtual void SetUp() {
+        QStatus status = bus.Start();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        /* The rule table only compares endpoints so they do not need to be connected */
+        EndpointType type = ENDPOINT_TYPE_NULL;
+        for (size_t i = 0; i < 8; ++i) {
+            eps.push_back(BusEndpoint(type));
+        }
+    }
+
+    virtual void TearDown() {
+        eps.clear();
+        bus.Stop();
+        bus.Join();
+    }
+
+    /*
+     * Marshal a signal with the given arguments
+     */
+    Message MakeSignal(const MsgArg* args, size_t numArgs) {
+        ManagedObj<RuleTestMessage> msg(bus);
+        QStatus status = msg->Signal("/org/alljoyn/test", "org.alljoyn.test", "Sig", args, numArgs);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        return Message::cast(msg);
+    }
+
+    bool IsMatch(const char* ruleSpec, const Message& msg) {
+        QStatus status;
+        Rule rule(ruleSpec, &status);
+        EXPECT_EQ(ER_OK, status) << "  Rule: " << ruleSpec << "  Actual Status: " << QCC_StatusText(status);
+        return rule.IsMatch(msg);
+    }
+
+    void AddRule(RuleTable& table, BusEndpoint& ep, const char* ruleSpec) {
+        QStatus status;
+        Rule rule(ruleSpec, &status);
+        EXPECT_EQ(ER_OK, status) << "  Rule: " << ruleSpec << "  Actual Status: " << QCC_StatusText(status);
+        status = table.AddRule(ep, rule);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    void RemoveRule(RuleTable& table, BusEndpoint& ep, const char* ruleSpec) {
+        QStatus status;
+        Rule rule(ruleSpec, &status);
+        EXPECT_EQ(ER_OK, status) << "  Rule: " << ruleSpec << "  Actual Status: " << QCC_StatusText(status);
+        status = table.RemoveRule(ep, rule);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    /*
+     * Get the indices of the endpoints with a matching rule as a sorted list and check they are
+     * returned once each in rule table order.
+     */
+    String Match(RuleTable& table, const Message& msg) {
+        std::vector<BusEndpoint> matched;
+        table.Lock();
+        table.GetMatchingEndpoints(msg, matched);
+        std::vector<BusEndpoint> inOrder;
+        for (RuleIterator it = table.Begin(); it != table.End(); it = table.AdvanceToNextEndpoint(it->first)) {
+            if (std::find(matched.begin(), matched.end(), it->first) != matched.end()) {
+                inOrder.push_back(it->first);
+            }
+        }
+        table.Unlock();
+        EXPECT_TRUE(inOrder == matched);
+        String indices;
+        for (size_t j = 0; j < eps.size(); ++j) {
+            if (std::find(matched.begin(), matched.end(), eps[j]) != matched.end()) {
+                if (!indices.empty()) {
+                    indices += " ";
+                }
+                indices += U32ToString((uint32_t)j);
+            }
+        }
+        return indices;
+    }
+
+    size_t IndexSize(RuleTable& table) {
+        table.Lock();
+        size_t size = table.GetIndexSize();
+        table.Unlock();
+        return size;
+    }
+
+    BusAttachment bus;
+    std::vector<BusEndpoint> eps;
+};
+
+TEST_F(RuleTableTest, ParseArgKeys) {
+    QStatus status;
+
+    Rule argRule("type='signal',arg0='foo',arg3path='/a/b/'", &status);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_STREQ("foo", argRule.args[0].c_str());
+    EXPECT_STREQ("/a/b/", argRule.pathArgs[3].c_str());
+
+    Rule emptyRule("arg0path=''", &status);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_EQ((size_t)1, emptyRule.pathArgs.size());
+    EXPECT_TRUE(emptyRule.pathArgs[0].empty());
+
+    Rule maxRule("arg63='x'", &status);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    Rule badIndex("arg64='x'", &status);
+    EXPECT_NE(ER_OK, status);
+
+    Rule noIndex("arg='x'", &status);
+    EXPECT_NE(ER_OK, status);
+
+    Rule badSuffix("arg0namespace='x'", &status);
+    EXPECT_NE(ER_OK, status);
+}
+
+TEST_F(RuleTableTest, ArgMatch) {
+    MsgArg args[3];
+    args[0].Set("s", "/aa/bb");
+    args[1].Set("o", "/aa/bb");
+    args[2].Set("i", 42);
+    Message msg = MakeSignal(args, 3);
+
+    EXPECT_TRUE(IsMatch("arg0='/aa/bb'", msg));
+    EXPECT_FALSE(IsMatch("arg0='/aa'", msg));
+    /* argN only matches string arguments */
+    EXPECT_FALSE(IsMatch("arg1='/aa/bb'", msg));
+    EXPECT_FALSE(IsMatch("arg2='42'", msg));
+    /* No such argument */
+    EXPECT_FALSE(IsMatch("arg3='/aa/bb'", msg));
+    /* All arg matches must match */
+    EXPECT_TRUE(IsMatch("type='signal',arg0='/aa/bb',arg1path='/aa/'", msg));
+    EXPECT_FALSE(IsMatch("type='signal',arg0='/aa/bb',arg1path='/cc/'", msg));
+}
+
+TEST_F(RuleTableTest, PathMatch) {
+    MsgArg args[2];
+    args[0].Set("s", "/aa/bb");
+    args[1].Set("o", "/aa/");
+    Message msg = MakeSignal(args, 2);
+
+    /* Equal paths */
+    EXPECT_TRUE(IsMatch("arg0path='/aa/bb'", msg));
+    EXPECT_TRUE(IsMatch("arg1path='/aa/'", msg));
+    /* The rule is a prefix ending with '/' */
+    EXPECT_TRUE(IsMatch("arg0path='/aa/'", msg));
+    EXPECT_TRUE(IsMatch("arg0path='/'", msg));
+    EXPECT_FALSE(IsMatch("arg0path='/aa'", msg));
+    EXPECT_FALSE(IsMatch("arg0path='/aa/b'", msg));
+    /* The argument is a prefix ending with '/' */
+    EXPECT_TRUE(IsMatch("arg1path='/aa/bb/cc'", msg));
+    EXPECT_FALSE(IsMatch("arg0path='/aa/bb/cc'", msg));
+    EXPECT_FALSE(IsMatch("arg1path='/cc/aa/'", msg));
+}
+
+TEST_F(RuleTableTest, EmptyPathMatch) {
+    MsgArg args[2];
+    args[0].Set("s", "/aa/bb");
+    args[1].Set("s", "");
+    Message msg = MakeSignal(args, 2);
+
+    /* An empty rule path only matches an empty argument */
+    EXPECT_FALSE(IsMatch("arg0path=''", msg));
+    EXPECT_TRUE(IsMatch("arg1path=''", msg));
+    EXPECT_FALSE(IsMatch("arg1path='/'", msg));
+    EXPECT_FALSE(IsMatch("arg1path='/aa/bb'", msg));
+    EXPECT_TRUE(IsMatch("arg1=''", msg));
+}
+
+TEST_F(RuleTableTest, InterfaceMemberIndex) {
+    RuleTable table;
+    MsgArg arg("s", "a");
+    Message msg = MakeSignal(&arg, 1);
+
+    AddRule(table, eps[0], "interface='org.alljoyn.test',member='Sig'");
+    AddRule(table, eps[1], "interface='org.alljoyn.test'");
+    AddRule(table, eps[2], "member='Sig'");
+    AddRule(table, eps[3], "type='signal'");
+    AddRule(table, eps[4], "interface='org.alljoyn.other'");
+    AddRule(table, eps[5], "interface='org.alljoyn.test',member='Other'");
+    AddRule(table, eps[6], "member='Other'");
+    /* An endpoint with several matching rules is only returned once */
+    AddRule(table, eps[0], "type='signal'");
+    AddRule(table, eps[0], "interface='org.alljoyn.test'");
+    /* Indexed rules are still checked against the rest of the message */
+    AddRule(table, eps[7], "interface='org.alljoyn.test',member='Sig',path='/other'");
+
+    EXPECT_STREQ("0 1 2 3", Match(table, msg).c_str());
+
+    /*
+     * Interface buckets: test, other and the wildcard. Member buckets: Sig, wildcard and Other
+     * under test, wildcard under other and Sig, wildcard and Other under the wildcard.
+     */
+    EXPECT_EQ((size_t)10, IndexSize(table));
+}
+
+TEST_F(RuleTableTest, Arg0Index) {
+    RuleTable table;
+    MsgArg args[2];
+    args[0].Set("s", "a");
+    args[1].Set("s", "x");
+    Message msg = MakeSignal(args, 2);
+
+    AddRule(table, eps[0], "arg0='a'");
+    AddRule(table, eps[1], "arg0='b'");
+    AddRule(table, eps[2], "interface='org.alljoyn.test',member='Sig',arg0='a'");
+    AddRule(table, eps[3], "interface='org.alljoyn.test',arg0='b'");
+    /* Rules without an arg0 string match are not in the arg0 buckets */
+    AddRule(table, eps[4], "arg0path='a'");
+    AddRule(table, eps[5], "arg1='x'");
+    AddRule(table, eps[6], "arg0='a',arg1='y'");
+
+    EXPECT_STREQ("0 2 4 5", Match(table, msg).c_str());
+
+    /* A non-string arg0 does not match any of the arg0 buckets */
+    MsgArg intArgs[2];
+    intArgs[0].Set("i", 42);
+    intArgs[1].Set("s", "x");
+    msg = MakeSignal(intArgs, 2);
+    EXPECT_STREQ("5", Match(table, msg).c_str());
+
+    MsgArg otherArgs[2];
+    otherArgs[0].Set("s", "b");
+    otherArgs[1].Set("s", "x");
+    msg = MakeSignal(otherArgs, 2);
+    EXPECT_STREQ("1 3 5", Match(table, msg).c_str());
+}
+
+TEST_F(RuleTableTest, Unindex) {
+    RuleTable table;
+    MsgArg arg("s", "a");
+    Message msg = MakeSignal(&arg, 1);
+
+    AddRule(table, eps[0], "interface='org.alljoyn.test',member='Sig'");
+    AddRule(table, eps[0], "arg0='a'");
+    AddRule(table, eps[1], "interface='org.alljoyn.test',member='Sig',arg0='a'");
+    AddRule(table, eps[1], "interface='org.alljoyn.test',member='Sig',arg0='b'");
+    AddRule(table, eps[2], "interface='org.alljoyn.test'");
+    EXPECT_STREQ("0 1 2", Match(table, msg).c_str());
+    /*
+     * Interface buckets: test and the wildcard. Member buckets: Sig and wildcard under test and
+     * wildcard under the wildcard. Arg0 buckets: a and b under test/Sig and a under the wildcard.
+     */
+    EXPECT_EQ((size_t)8, IndexSize(table));
+
+    /* Removing one of an endpoint's rules leaves its other rules indexed */
+    RemoveRule(table, eps[0], "interface='org.alljoyn.test',member='Sig'");
+    EXPECT_STREQ("0 1 2", Match(table, msg).c_str());
+    RemoveRule(table, eps[0], "arg0='a'");
+    EXPECT_STREQ("1 2", Match(table, msg).c_str());
+    /* The wildcard interface bucket is freed with its last rule */
+    EXPECT_EQ((size_t)5, IndexSize(table));
+
+    /* Removing the last rule with an arg0 value frees its bucket but not the member bucket */
+    RemoveRule(table, eps[1], "interface='org.alljoyn.test',member='Sig',arg0='a'");
+    EXPECT_STREQ("2", Match(table, msg).c_str());
+    EXPECT_EQ((size_t)4, IndexSize(table));
+
+    /* Removing a rule that is not in the table changes nothing */
+    RemoveRule(table, eps[1], "interface='org.alljoyn.test',member='Sig',arg0='c'");
+    EXPECT_EQ((size_t)4, IndexSize(table));
+
+    /* RemoveAllRules unindexes every rule of the endpoint and frees the empty buckets */
+    EXPECT_EQ(ER_OK, table.RemoveAllRules(eps[1]));
+    EXPECT_STREQ("2", Match(table, msg).c_str());
+    EXPECT_EQ((size_t)2, IndexSize(table));
+    EXPECT_EQ(ER_OK, table.RemoveAllRules(eps[2]));
+    EXPECT_STREQ("", Match(table, msg).c_str());
+    EXPECT_EQ((size_t)0, IndexSize(table));
+
+    /* The index is rebuilt when rules are added again */
+    AddRule(table, eps[2], "interface='org.alljoyn.test',member='Sig',arg0='a'");
+    EXPECT_STREQ("2", Match(table, msg).c_str());
+}
@@ -0,0 +1,251 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <qcc/Mutex.h>
+#include <qcc/Thread.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/DBusStd.h>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/ProxyBusObject.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <BusInternal.h>
+#include <ClientRouter.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+#include "ajTestCommon.h"
+
+using namespace ajn;
+
+static const char* INTERFACE_NAME = "org.alljoyn.test.SelfCall";
+static const char* OBJECT_PATH = "/org/alljoyn/test/SelfCall";
+static const char* WELL_KNOWN_NAME = "org.alljoyn.test.SelfCall.Name";
+static const uint32_t NUM_SIGNALS = 100;
+
+class SelfCallTestObject : public BusObject {
+  public:
+    SelfCallTestObject(const InterfaceDescription* intf, uint32_t id) :
+        BusObject(OBJECT_PATH), id(id), seq(intf->GetMember("Seq")), pingThread(NULL),
+        next(0), active(0), outOfOrder(0), maxConcurrent(0), total(0)
+    {
+        AddInterface(*intf);
+        AddMethodHandler(intf->GetMember("Ping"), static_cast<MessageReceiver::MethodHandler>(&SelfCallTestObject::Ping));
+    }
+
+    void Ping(const InterfaceDescription::Member* member, Message& msg) {
+        pingThread = qcc::Thread::GetThread();
+        MsgArg arg("u", id);
+        MethodReply(msg, &arg, 1);
+    }
+
+    void SeqHandler(const InterfaceDescription::Member* member, const char* srcPath, Message& msg) {
+        uint32_t n = msg->GetArg(0)->v_uint32;
+        lock.Lock();
+        if (n != next) {
+            ++outOfOrder;
+        }
+        next = n + 1;
+        if (++active > maxConcurrent) {
+            maxConcurrent = active;
+        }
+        lock.Unlock();
+
+        if ((n % 10) == 0) {
+            /* Give the other workers a chance to get ahead */
+            qcc::Sleep(5);
+        }
+
+        lock.Lock();
+        --active;
+        ++total;
+        lock.Unlock();
+    }
+
+    QStatus Send(const char* destination, uint32_t n) {
+        MsgArg arg("u", n);
+        return Signal(destination, 0, *seq, &arg, 1);
+    }
+
+    uint32_t GetTotal() {
+        lock.Lock();
+        uint32_t n = total;
+        lock.Unlock();
+        return n;
+    }
+
+    uint32_t id;
+    const InterfaceDescription::Member* seq;
+    qcc::Thread* volatile pingThread;
+    qcc::Mutex lock;
+    uint32_t next;
+    uint32_t active;
+    uint32_t outOfOrder;
+    uint32_t maxConcurrent;
+    uint32_t total;
+};
+
+class SelfCallTest : public testing::Test {
+  public:
+    SelfCallTest() : bus("SelfCallTest", false), otherBus("SelfCallTestOther", false), obj(NULL), otherObj(NULL) { }
+
+    virtual void SetUp() {
+        StartBus(bus, obj, 1);
+        StartBus(otherBus, otherObj, 2);
+    }
+
+    virtual void TearDown() {
+        bus.Stop();
+        otherBus.Stop();
+        bus.Join();
+        otherBus.Join();
+        delete obj;
+        delete otherObj;
+    }
+
+    void StartBus(BusAttachment& b, SelfCallTestObject*& o, uint32_t id) {
+        QStatus status = b.Start();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = b.Connect(getConnectArg().c_str());
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        InterfaceDescription* intf = NULL;
+        status = b.CreateInterface(INTERFACE_NAME, intf);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        intf->AddMethod("Ping", "", "u", "id", 0);
+        intf->AddSignal("Seq", "u", NULL);
+        intf->Activate();
+        o = new SelfCallTestObject(intf, id);
+        status = b.RegisterBusObject(*o);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = b.RegisterSignalHandler(o,
+                                         static_cast<MessageReceiver::SignalHandler>(&SelfCallTestObject::SeqHandler),
+                                         intf->GetMember("Seq"),
+                                         NULL);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    /*
+     * Call Ping on the object owned by the given name and return the id of the object that replied
+     */
+    QStatus Ping(const char* name, uint32_t& id) {
+        ProxyBusObject proxy(bus, name, OBJECT_PATH, 0);
+        proxy.AddInterface(*bus.GetInterface(INTERFACE_NAME));
+        Message reply(bus);
+        QStatus status = proxy.MethodCall(INTERFACE_NAME, "Ping", NULL, 0, reply);
+        if (status == ER_OK) {
+            status = reply->GetArgs("u", &id);
+        }
+        return status;
+    }
+
+    /*
+     * Number of messages the bus under test has sent to the daemon
+     */
+    uint32_t BusTxCount() {
+        return static_cast<ClientRouter&>(bus.GetInternal().GetRouter()).GetBusTxCount();
+    }
+
+    BusAttachment bus;
+    BusAttachment otherBus;
+    SelfCallTestObject* obj;
+    SelfCallTestObject* otherObj;
+};
+
+TEST_F(SelfCallTest, UniqueName) {
+    uint32_t id = 0;
+    uint32_t txCount = BusTxCount();
+    QStatus status = Ping(bus.GetUniqueName().c_str(), id);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ((uint32_t)1, id);
+
+    /* Neither the call nor the reply went through the daemon */
+    EXPECT_EQ(txCount, BusTxCount());
+
+    /* The method handler runs on a dispatcher thread, not nested in the caller */
+    EXPECT_TRUE(obj->pingThread != NULL);
+    EXPECT_TRUE(obj->pingThread != qcc::Thread::GetThread());
+}
+
+TEST_F(SelfCallTest, SignalOrdering) {
+    const char* dest = bus.GetUniqueName().c_str();
+    uint32_t txCount = BusTxCount();
+    for (uint32_t n = 0; n < NUM_SIGNALS; ++n) {
+        ASSERT_EQ(ER_OK, obj->Send(dest, n));
+    }
+    for (size_t i = 0; (i < 1000) && (obj->GetTotal() < NUM_SIGNALS); ++i) {
+        qcc::Sleep(10);
+    }
+    EXPECT_EQ(txCount, BusTxCount());
+
+    /* Signals sent to self are handled one at a time in the order they were sent */
+    EXPECT_EQ(NUM_SIGNALS, obj->GetTotal());
+    EXPECT_EQ((uint32_t)0, obj->outOfOrder);
+    EXPECT_EQ((uint32_t)1, obj->maxConcurrent);
+}
+
+TEST_F(SelfCallTest, RequestReleaseName) {
+    QStatus status = bus.RequestName(WELL_KNOWN_NAME, DBUS_NAME_FLAG_DO_NOT_QUEUE);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    uint32_t id = 0;
+    uint32_t txCount = BusTxCount();
+    status = Ping(WELL_KNOWN_NAME, id);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ((uint32_t)1, id);
+    EXPECT_EQ(txCount, BusTxCount());
+
+    /* Once the name is released calls to it go to the daemon which has no owner for it */
+    status = bus.ReleaseName(WELL_KNOWN_NAME);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    txCount = BusTxCount();
+    status = Ping(WELL_KNOWN_NAME, id);
+    EXPECT_TRUE(status == ER_BUS_REPLY_IS_ERROR_MESSAGE || status == ER_BUS_NO_ROUTE) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ(txCount + 1, BusTxCount());
+
+    /* The next owner gets the calls */
+    status = otherBus.RequestName(WELL_KNOWN_NAME, DBUS_NAME_FLAG_DO_NOT_QUEUE);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = Ping(WELL_KNOWN_NAME, id);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ((uint32_t)2, id);
+    EXPECT_EQ(ER_OK, otherBus.ReleaseName(WELL_KNOWN_NAME));
+}
+
+TEST_F(SelfCallTest, ReplaceableName) {
+    QStatus status = bus.RequestName(WELL_KNOWN_NAME, DBUS_NAME_FLAG_DO_NOT_QUEUE | DBUS_NAME_FLAG_ALLOW_REPLACEMENT);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /* A call to a name that can be taken over goes through the daemon, the reply to the unique name does not */
+    uint32_t id = 0;
+    uint32_t txCount = BusTxCount();
+    status = Ping(WELL_KNOWN_NAME, id);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ((uint32_t)1, id);
+    EXPECT_EQ(txCount + 1, BusTxCount());
+
+    /* A call made as soon as the name has been taken over goes to the new owner */
+    status = otherBus.RequestName(WELL_KNOWN_NAME, DBUS_NAME_FLAG_DO_NOT_QUEUE | DBUS_NAME_FLAG_REPLACE_EXISTING);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = Ping(WELL_KNOWN_NAME, id);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ((uint32_t)2, id);
+    EXPECT_EQ(ER_OK, otherBus.ReleaseName(WELL_KNOWN_NAME));
+}
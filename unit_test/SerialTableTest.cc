@@ -0,0 +1,174 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <stdlib.h>
+#include <map>
+#include <vector>
+
+/* Private files included for unit testing */
+#include <SerialTable.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+
+/*
+ * The home slot of a serial number in a table with the initial capacity
+ */
+static size_t InitialHome(uint32_t serial)
+{
+    return (size_t)((serial * 2654435769U) >> (32 - 6));
+}
+
+/*
+ * Find serial numbers that all hash to the same slot of a table with the initial capacity
+ */
+static void FindCollisions(size_t home, size_t num, std::vector<uint32_t>& serials)
+{
+    for (uint32_t serial = 1; serials.size() < num; ++serial) {
+        if (InitialHome(serial) == home) {
+            serials.push_back(serial);
+        }
+    }
+}
+
+TEST(SerialTableTest, InsertFindRemove) {
+    SerialTable<int> table;
+    int a = 1, b = 2, c = 3;
+
+    EXPECT_EQ((size_t)0, table.Size());
+    EXPECT_TRUE(table.Find(1) == NULL);
+    EXPECT_TRUE(table.Remove(1) == NULL);
+
+    table.Insert(1, &a);
+    table.Insert(2, &b);
+    table.Insert(0, &c);
+    EXPECT_EQ((size_t)3, table.Size());
+    EXPECT_EQ(&a, table.Find(1));
+    EXPECT_EQ(&b, table.Find(2));
+    EXPECT_EQ(&c, table.Find(0));
+
+    /* Inserting an existing serial number replaces the object */
+    table.Insert(1, &c);
+    EXPECT_EQ((size_t)3, table.Size());
+    EXPECT_EQ(&c, table.Find(1));
+
+    EXPECT_EQ(&c, table.Remove(1));
+    EXPECT_TRUE(table.Find(1) == NULL);
+    EXPECT_TRUE(table.Remove(1) == NULL);
+    EXPECT_EQ((size_t)2, table.Size());
+
+    std::vector<int*> all;
+    table.GetAll(all);
+    EXPECT_EQ((size_t)2, all.size());
+
+    table.Clear();
+    EXPECT_EQ((size_t)0, table.Size());
+    EXPECT_TRUE(table.Find(2) == NULL);
+}
+
+TEST(SerialTableTest, BackwardShiftDeletion) {
+    SerialTable<int> table;
+    int objs[4] = { 0, 1, 2, 3 };
+
+    /*
+     * Three serial numbers that share the last slot of the table so the probe sequence wraps
+     * around, followed by one whose home is the first slot and is displaced by the wrapped entries.
+     */
+    std::vector<uint32_t> serials;
+    FindCollisions(SerialTable<int>::MIN_CAPACITY - 1, 3, serials);
+    FindCollisions(0, 4, serials);
+    serials.resize(4);
+    for (size_t i = 0; i < 4; ++i) {
+        table.Insert(serials[i], &objs[i]);
+    }
+
+    /* Removing the head of the cluster must not hide the entries that probed past it */
+    EXPECT_EQ(&objs[0], table.Remove(serials[0]));
+    EXPECT_EQ(&objs[1], table.Find(serials[1]));
+    EXPECT_EQ(&objs[2], table.Find(serials[2]));
+    EXPECT_EQ(&objs[3], table.Find(serials[3]));
+
+    /* Removing from the middle of the wrapped part of the cluster */
+    EXPECT_EQ(&objs[2], table.Remove(serials[2]));
+    EXPECT_EQ(&objs[1], table.Find(serials[1]));
+    EXPECT_TRUE(table.Find(serials[2]) == NULL);
+    EXPECT_EQ(&objs[3], table.Find(serials[3]));
+
+    EXPECT_EQ(&objs[1], table.Remove(serials[1]));
+    EXPECT_EQ(&objs[3], table.Find(serials[3]));
+    EXPECT_EQ(&objs[3], table.Remove(serials[3]));
+    EXPECT_EQ((size_t)0, table.Size());
+}
+
+TEST(SerialTableTest, Grow) {
+    SerialTable<uint32_t> table;
+    std::vector<uint32_t> serials(1000);
+
+    for (uint32_t i = 0; i < serials.size(); ++i) {
+        serials[i] = i + 1;
+        table.Insert(serials[i], &serials[i]);
+    }
+    EXPECT_EQ(serials.size(), table.Size());
+    for (uint32_t i = 0; i < serials.size(); ++i) {
+        ASSERT_EQ(&serials[i], table.Find(i + 1));
+    }
+    for (uint32_t i = 0; i < serials.size(); i += 2) {
+        ASSERT_EQ(&serials[i], table.Remove(i + 1));
+    }
+    for (uint32_t i = 0; i < serials.size(); ++i) {
+        if (i & 1) {
+            ASSERT_EQ(&serials[i], table.Find(i + 1));
+        } else {
+            ASSERT_TRUE(table.Find(i + 1) == NULL);
+        }
+    }
+}
+
+TEST(SerialTableTest, Random) {
+    SerialTable<int> table;
+    std::map<uint32_t, int*> reference;
+    int objs[16];
+
+    /*
+     * Keep the table below its growth threshold so it stays at the initial capacity with long
+     * clusters, serial numbers are drawn from a small range so removes often hit.
+     */
+    srand(7);
+    for (size_t i = 0; i < 20000; ++i) {
+        uint32_t serial = rand() % 200;
+        if ((reference.size() < 30) && (rand() & 1)) {
+            int* obj = &objs[rand() % 16];
+            table.Insert(serial, obj);
+            reference[serial] = obj;
+        } else {
+            std::map<uint32_t, int*>::iterator it = reference.find(serial);
+            int* expect = (it == reference.end()) ? NULL : it->second;
+            ASSERT_EQ(expect, table.Remove(serial));
+            if (it != reference.end()) {
+                reference.erase(it);
+            }
+        }
+        ASSERT_EQ(reference.size(), table.Size());
+    }
+    for (uint32_t serial = 0; serial < 200; ++serial) {
+        std::map<uint32_t, int*>::iterator it = reference.find(serial);
+        int* expect = (it == reference.end()) ? NULL : it->second;
+        EXPECT_EQ(expect, table.Find(serial));
+    }
+}
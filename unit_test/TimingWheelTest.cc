@@ -0,0 +1,289 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <stdlib.h>
+#include <vector>
+
+/* Private files included for unit testing */
+#include <TimingWheel.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+
+static void* Ctx(uintptr_t i)
+{
+    return reinterpret_cast<void*>(i);
+}
+
+TEST(TimingWheelTest, Empty) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    uint64_t when;
+
+    EXPECT_EQ((size_t)0, wheel.Size());
+    EXPECT_FALSE(wheel.GetNextExpiry(when));
+    EXPECT_EQ((size_t)0, wheel.Advance(1000, expired));
+    EXPECT_TRUE(expired.empty());
+}
+
+TEST(TimingWheelTest, ExpiryOrder) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    uint64_t now = 100000;
+
+    wheel.Add(now, now + 30, Ctx(3));
+    wheel.Add(now, now + 10, Ctx(1));
+    wheel.Add(now, now + 20, Ctx(2));
+    EXPECT_EQ((size_t)3, wheel.Size());
+
+    EXPECT_EQ((size_t)0, wheel.Advance(now + 9, expired));
+    EXPECT_EQ((size_t)1, wheel.Advance(now + 10, expired));
+    ASSERT_EQ((size_t)1, expired.size());
+    EXPECT_EQ(Ctx(1), expired[0]);
+
+    /* Advancing past several entries returns them all */
+    expired.clear();
+    EXPECT_EQ((size_t)2, wheel.Advance(now + 100, expired));
+    ASSERT_EQ((size_t)2, expired.size());
+    EXPECT_EQ(Ctx(2), expired[0]);
+    EXPECT_EQ(Ctx(3), expired[1]);
+    EXPECT_EQ((size_t)0, wheel.Size());
+}
+
+TEST(TimingWheelTest, AlreadyExpired) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    uint64_t now = 5000;
+
+    /* An entry that has already expired is returned by the next advance */
+    wheel.Add(now, now - 100, Ctx(1));
+    EXPECT_EQ((size_t)0, wheel.Advance(now, expired));
+    EXPECT_EQ((size_t)1, wheel.Advance(now + 1, expired));
+    ASSERT_EQ((size_t)1, expired.size());
+    EXPECT_EQ(Ctx(1), expired[0]);
+}
+
+TEST(TimingWheelTest, Cascade) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    uint64_t now = 123456;
+
+    /* One entry at each level of the wheel */
+    uint64_t delays[TimingWheel::NUM_LEVELS] = { 50, 3000, 200000, 10000000 };
+    for (size_t i = 0; i < TimingWheel::NUM_LEVELS; ++i) {
+        wheel.Add(now, now + delays[i], Ctx(i + 1));
+    }
+    for (size_t i = 0; i < TimingWheel::NUM_LEVELS; ++i) {
+        /* Entries in the higher levels expire on their exact expiry time after cascading */
+        EXPECT_EQ((size_t)0, wheel.Advance(now + delays[i] - 1, expired));
+        EXPECT_EQ((size_t)1, wheel.Advance(now + delays[i], expired));
+        ASSERT_EQ(i + 1, expired.size());
+        EXPECT_EQ(Ctx(i + 1), expired[i]);
+    }
+    EXPECT_EQ((size_t)0, wheel.Size());
+}
+
+TEST(TimingWheelTest, FarExpiry) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    uint64_t now = 7;
+    uint64_t span = (uint64_t)1 << (TimingWheel::LEVEL_BITS * TimingWheel::NUM_LEVELS);
+
+    /* Entries beyond the span of the wheel are clamped and put back until they come within range */
+    uint64_t far = now + 3 * span + 1234;
+    wheel.Add(now, far, Ctx(1));
+    wheel.Add(now, now + span, Ctx(2));
+    EXPECT_EQ((size_t)0, wheel.Advance(now + span - 1, expired));
+    EXPECT_EQ((size_t)1, wheel.Advance(now + span, expired));
+    ASSERT_EQ((size_t)1, expired.size());
+    EXPECT_EQ(Ctx(2), expired[0]);
+
+    expired.clear();
+    EXPECT_EQ((size_t)0, wheel.Advance(now + 2 * span, expired));
+    EXPECT_EQ((size_t)0, wheel.Advance(far - 1, expired));
+    EXPECT_EQ((size_t)1, wheel.Advance(far, expired));
+    ASSERT_EQ((size_t)1, expired.size());
+    EXPECT_EQ(Ctx(1), expired[0]);
+}
+
+TEST(TimingWheelTest, NextExpiry) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    uint64_t now = 64 * 64;
+    uint64_t when;
+
+    wheel.Add(now, now + 5, Ctx(1));
+    ASSERT_TRUE(wheel.GetNextExpiry(when));
+    EXPECT_EQ(now + 5, when);
+
+    /* The next expiry of an entry in a higher level is a lower bound */
+    wheel.Advance(now + 5, expired);
+    wheel.Add(now + 5, now + 100000, Ctx(2));
+    ASSERT_TRUE(wheel.GetNextExpiry(when));
+    EXPECT_GT(when, now + 5);
+    EXPECT_LE(when, now + 100000);
+
+    /* Following the next expiry never skips past the entry */
+    while (wheel.Size() > 0) {
+        ASSERT_TRUE(wheel.GetNextExpiry(when));
+        ASSERT_LE(when, now + 100000);
+        wheel.Advance(when, expired);
+    }
+    EXPECT_EQ(when, now + 100000);
+}
+
+TEST(TimingWheelTest, Clear) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    uint64_t now = 1000;
+
+    wheel.Add(now, now + 10, Ctx(1));
+    wheel.Add(now, now + 100000, Ctx(2));
+    wheel.Clear();
+    EXPECT_EQ((size_t)0, wheel.Size());
+    EXPECT_EQ((size_t)0, wheel.Advance(now + 200000, expired));
+    EXPECT_TRUE(expired.empty());
+
+    /* The wheel is usable after being cleared */
+    wheel.Add(now + 200000, now + 200010, Ctx(3));
+    EXPECT_EQ((size_t)1, wheel.Advance(now + 200010, expired));
+    ASSERT_EQ((size_t)1, expired.size());
+    EXPECT_EQ(Ctx(3), expired[0]);
+}
+
+TEST(TimingWheelTest, Random) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    std::vector<uint64_t> expiry;
+    std::vector<bool> seen;
+    uint64_t now = 98765;
+    uint64_t last = now;
+
+    srand(42);
+    for (size_t i = 0; wheel.Size() || (i < 2000); ++i) {
+        /* Mix of short and long timeouts added while the wheel advances */
+        if (i < 2000) {
+            uint64_t delay = 1 + ((i & 1) ? (rand() % 100) : (rand() % 1000000));
+            wheel.Add(now, now + delay, Ctx(expiry.size()));
+            expiry.push_back(now + delay);
+            seen.push_back(false);
+            if ((i % 10) != 0) {
+                continue;
+            }
+        }
+        /* Every entry expires exactly once and not early */
+        last = now;
+        now += rand() % 20000;
+        expired.clear();
+        wheel.Advance(now, expired);
+        for (size_t j = 0; j < expired.size(); ++j) {
+            uintptr_t idx = reinterpret_cast<uintptr_t>(expired[j]);
+            EXPECT_FALSE(seen[idx]);
+            seen[idx] = true;
+            EXPECT_LE(expiry[idx], now);
+            EXPECT_GT(expiry[idx], last);
+        }
+    }
+    for (size_t i = 0; i < seen.size(); ++i) {
+        EXPECT_TRUE(seen[i]);
+    }
+}
+
+TEST(TimingWheelTest, Cancel) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    uint64_t now = 1000;
+    TimingWheel::Handle handles[4];
+
+    /* Two entries share a slot so cancelling the first moves the second */
+    wheel.Add(now, now + 10, Ctx(1), &handles[0]);
+    wheel.Add(now, now + 10, Ctx(2), &handles[1]);
+    wheel.Add(now, now + 5000, Ctx(3), &handles[2]);
+    wheel.Add(now, now + 20, Ctx(4));
+    EXPECT_TRUE(handles[0].IsArmed());
+    EXPECT_FALSE(handles[3].IsArmed());
+    EXPECT_EQ((size_t)4, wheel.Size());
+
+    EXPECT_TRUE(wheel.Cancel(handles[0]));
+    EXPECT_FALSE(handles[0].IsArmed());
+    EXPECT_FALSE(wheel.Cancel(handles[0]));
+    EXPECT_FALSE(wheel.Cancel(handles[3]));
+    EXPECT_EQ((size_t)3, wheel.Size());
+
+    EXPECT_EQ((size_t)1, wheel.Advance(now + 10, expired));
+    ASSERT_EQ((size_t)1, expired.size());
+    EXPECT_EQ(Ctx(2), expired[0]);
+    EXPECT_FALSE(handles[1].IsArmed());
+
+    /* An entry in a higher level can be cancelled before and after it cascades */
+    wheel.Add(now + 10, now + 6000, Ctx(5), &handles[3]);
+    EXPECT_TRUE(wheel.Cancel(handles[3]));
+    expired.clear();
+    EXPECT_EQ((size_t)1, wheel.Advance(now + 4990, expired));
+    EXPECT_EQ(Ctx(4), expired[0]);
+    EXPECT_TRUE(handles[2].IsArmed());
+    EXPECT_TRUE(wheel.Cancel(handles[2]));
+    EXPECT_EQ((size_t)0, wheel.Size());
+    EXPECT_EQ((size_t)0, wheel.Advance(now + 10000, expired));
+
+    /* A handle can be reused once it is disarmed and clearing the wheel disarms it */
+    wheel.Add(now + 10000, now + 10010, Ctx(6), &handles[0]);
+    wheel.Clear();
+    EXPECT_FALSE(handles[0].IsArmed());
+}
+
+TEST(TimingWheelTest, CancelRandom) {
+    TimingWheel wheel;
+    std::vector<void*> expired;
+    const size_t num = 2000;
+    std::vector<TimingWheel::Handle> handles(num);
+    std::vector<uint64_t> expiry(num);
+    std::vector<bool> cancelled(num, false);
+    std::vector<bool> seen(num, false);
+    uint64_t now = 4321;
+
+    srand(7);
+    for (size_t i = 0; i < num; ++i) {
+        expiry[i] = now + 1 + (rand() % 100000);
+        wheel.Add(now, expiry[i], Ctx(i), &handles[i]);
+    }
+    /* Cancel every other entry while the wheel advances, the rest still expire exactly once */
+    for (size_t i = 0; i < num; i += 2) {
+        if ((i % 100) == 0) {
+            now += rand() % 5000;
+            wheel.Advance(now, expired);
+        }
+        if (handles[i].IsArmed()) {
+            EXPECT_TRUE(wheel.Cancel(handles[i]));
+            cancelled[i] = true;
+        }
+    }
+    wheel.Advance(now + 200000, expired);
+    EXPECT_EQ((size_t)0, wheel.Size());
+    for (size_t j = 0; j < expired.size(); ++j) {
+        uintptr_t idx = reinterpret_cast<uintptr_t>(expired[j]);
+        EXPECT_FALSE(seen[idx]);
+        EXPECT_FALSE(cancelled[idx]);
+        seen[idx] = true;
+    }
+    for (size_t i = 0; i < num; ++i) {
+        EXPECT_TRUE(seen[i] || cancelled[i]);
+        EXPECT_FALSE(handles[i].IsArmed());
+    }
+}
@@ -0,0 +1,183 @@
+/******************************************************************************
+ * Copyright 2013, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <vector>
+
+#include <qcc/ManagedObj.h>
+#include <qcc/Socket.h>
+#include <qcc/SocketStream.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgArg.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <DaemonConfig.h>
+#include <RemoteEndpoint.h>
+#include <VirtualEndpoint.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+using namespace qcc;
+
+static const size_t NUM_MESSAGES = 20;
+
+class VirtualEndpointTestMessage : public _Message {
+  public:
+
+    VirtualEndpointTestMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Signal(const char* sender, uint32_t n)
+    {
+        MsgArg arg("u", n);
+        QStatus status = SignalMsg("u", NULL, 0, "/org/alljoyn/test", "org.alljoyn.test", "Seq", &arg, 1, 0, 0);
+        if (status == ER_OK) {
+            status = ReMarshal(sender);
+        }
+        return status;
+    }
+};
+
+class VirtualEndpointTest : public testing::Test {
+  public:
+    VirtualEndpointTest() : bus("VirtualEndpointTest", false) { }
+
+    virtual void SetUp() {
+        DaemonConfig::Load("<busconfig></busconfig>");
+        QStatus status = bus.Start();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        /*
+         * The bus-to-bus endpoints are never started so everything pushed to them stays in their
+         * transmit queues.
+         */
+        for (size_t i = 0; i < 2; ++i) {
+            SocketFd fds[2];
+            status = SocketPair(fds);
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+            streams.push_back(new SocketStream(fds[0]));
+            peers.push_back(fds[1]);
+            b2bEps.push_back(RemoteEndpoint(bus, false, "", streams.back(), "VirtualEndpointTest"));
+        }
+        vep = VirtualEndpoint(":remote.2", b2bEps[0]);
+        vep->AddBusToBusEndpoint(b2bEps[1]);
+    }
+
+    virtual void TearDown() {
+        vep = VirtualEndpoint();
+        b2bEps.clear();
+        for (size_t i = 0; i < streams.size(); ++i) {
+            delete streams[i];
+        }
+        for (size_t i = 0; i < peers.size(); ++i) {
+            Close(peers[i]);
+        }
+        bus.Stop();
+        bus.Join();
+    }
+
+    /*
+     * Push a message from the sender to the virtual endpoint and return the index of the
+     * bus-to-bus endpoint that queued it or -1 if none did.
+     */
+    int Push(const char* sender, uint32_t n) {
+        ManagedObj<VirtualEndpointTestMessage> msg(bus);
+        QStatus status = msg->Signal(sender, n);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        Message m = Message::cast(msg);
+        std::vector<size_t> before;
+        for (size_t i = 0; i < b2bEps.size(); ++i) {
+            before.push_back(b2bEps[i]->GetTxQueueBytes());
+        }
+        status = vep->PushMessage(m, 0);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        int chosen = -1;
+        for (size_t i = 0; i < b2bEps.size(); ++i) {
+            if (b2bEps[i]->GetTxQueueBytes() != before[i]) {
+                EXPECT_EQ(-1, chosen) << "  Message queued on more than one endpoint";
+                chosen = (int)i;
+            }
+        }
+        return chosen;
+    }
+
+    /*
+     * Find a sender whose first message goes to a different bus-to-bus endpoint than the given one
+     */
+    String OtherSender(int ep) {
+        for (uint32_t i = 0; i < 1000; ++i) {
+            String sender = ":other." + U32ToString(i);
+            if (Push(sender.c_str(), 0) != ep) {
+                return sender;
+            }
+        }
+        return String();
+    }
+
+    BusAttachment bus;
+    std::vector<SocketStream*> streams;
+    std::vector<SocketFd> peers;
+    std::vector<RemoteEndpoint> b2bEps;
+    VirtualEndpoint vep;
+};
+
+TEST_F(VirtualEndpointTest, FlowStaysOnLink) {
+    int first = Push(":sender.1", 0);
+    ASSERT_NE(-1, first);
+
+    /* The other link gets a new flow because it has fewer queued bytes */
+    String other = OtherSender(first);
+    ASSERT_FALSE(other.empty());
+    int second = 1 - first;
+
+    /* Make the first flow's link the busier one, its messages must still not move */
+    for (uint32_t n = 1; n < NUM_MESSAGES; ++n) {
+        EXPECT_EQ(first, Push(":sender.1", n));
+        EXPECT_EQ(first, Push(":sender.1", n));
+        EXPECT_EQ(second, Push(other.c_str(), n));
+    }
+    EXPECT_GT(b2bEps[first]->GetTxQueueBytes(), b2bEps[second]->GetTxQueueBytes());
+}
+
+TEST_F(VirtualEndpointTest, FlowMovesWhenLinkRemoved) {
+    int first = Push(":sender.1", 0);
+    ASSERT_NE(-1, first);
+    int second = 1 - first;
+
+    EXPECT_FALSE(vep->RemoveBusToBusEndpoint(b2bEps[first]));
+    for (uint32_t n = 1; n < NUM_MESSAGES; ++n) {
+        EXPECT_EQ(second, Push(":sender.1", n));
+    }
+}
+
+TEST_F(VirtualEndpointTest, FlowMovesWhenLinkCloses) {
+    int first = Push(":sender.1", 0);
+    ASSERT_NE(-1, first);
+    int second = 1 - first;
+
+    /* Messages go to the other link once the flow's link is closing and stay there */
+    b2bEps[first]->Stop();
+    for (uint32_t n = 1; n < NUM_MESSAGES; ++n) {
+        EXPECT_EQ(second, Push(":sender.1", n));
+    }
+}